@@ -40,10 +40,12 @@
 
 #include <utils/compiler.h>
 
+#include <atomic>
 #include <functional>
 #include <tuple>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <cassert>
 #include <cstddef>
@@ -57,6 +59,7 @@ namespace backend {
 
 class Driver;
 class CommandBase;
+class CommandSubBuffers;
 
 /*
  * Dispatcher is a data structure containing only function pointers.
@@ -286,12 +289,20 @@ public:
             size_t count = 1, size_t alignment = alignof(PodType)) noexcept;
 
 private:
+    friend class CommandSubBuffers;
+
     // Dispatcher could be a value (instead of pointer), which saves a load when writing commands
     // at the expense of a larger CommandStream object (about ~400 bytes)
     Dispatcher* mDispatcher = nullptr;
     Driver* mDriver = nullptr;
     CircularBuffer* UTILS_RESTRICT mCurrentBuffer = nullptr;
 
+    // only used by the sub-streams of a CommandSubBuffers, in which case mCurrentBuffer is null
+    CommandSubBuffers* mSubBuffers = nullptr;
+    char* mSubBufferFirst = nullptr;    // first command recorded in this sub-stream
+    char* mSubBufferHead = nullptr;     // next available command in the current block
+    char* mSubBufferEnd = nullptr;      // end of the current block
+
 #ifndef NDEBUG
     // just for debugging...
     std::thread::id mThreadId;
@@ -300,9 +311,73 @@ private:
     bool mUsePerformanceCounter = false;
 
     inline void* allocateCommand(size_t size) {
+        if (UTILS_UNLIKELY(mSubBuffers)) {
+            return allocateSubBufferCommand(size);
+        }
         assert(mThreadId == std::this_thread::get_id());
         return mCurrentBuffer->allocate(size);
     }
+
+    inline void* allocateSubBufferCommand(size_t size) noexcept;
+    void* allocateSubBufferBlock(size_t size) noexcept;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+/*
+ * CommandSubBuffers allows several threads to record commands at the same time.
+ *
+ * It reserves a region of a CommandStream's CircularBuffer, which is handed out in blocks to a
+ * fixed number of sub-streams through an atomic bump pointer, so recording never takes a lock.
+ * Each sub-stream is a regular CommandStream which can only be used by one thread at a time.
+ * When a sub-stream's block is full, it gets a new one and jumps to it with a NoopCommand.
+ *
+ * submit() links the sub-streams, in order, between the commands recorded on the parent stream
+ * before and after the CommandSubBuffers was created. It must be called from the parent stream's
+ * thread, after all sub-streams are done recording and before the parent stream is flushed.
+ *
+ * The reserved region counts against the space guaranteed by the CommandBufferQueue between
+ * two flushes. Commands that return a value call into the Driver directly, so they can only be
+ * recorded on sub-streams if the Driver supports it.
+ */
+class CommandSubBuffers {
+public:
+    // size of the blocks handed out to the sub-streams
+    static constexpr size_t BLOCK_SIZE = 4 * CircularBuffer::BLOCK_SIZE;
+
+    // reserves 'size' bytes from 'stream' for 'count' sub-streams
+    CommandSubBuffers(CommandStream& stream, size_t count, size_t size) noexcept;
+
+    CommandSubBuffers(CommandSubBuffers const& rhs) = delete;
+    CommandSubBuffers& operator=(CommandSubBuffers const& rhs) = delete;
+
+    size_t getCount() const noexcept { return mStreams.size(); }
+
+    // sub-streams are executed in the order of their index
+    CommandStream& operator[](size_t index) noexcept {
+        assert(index < mStreams.size());
+        return mStreams[index];
+    }
+
+    // number of bytes of the reserved region used so far
+    size_t getUsedSize() const noexcept;
+
+    // links the sub-streams in the parent stream, they can't be used afterwards
+    void submit() noexcept;
+
+private:
+    friend class CommandStream;
+
+    // size of the NoopCommand linking two blocks
+    static constexpr size_t LINK_SIZE = CommandBase::align(sizeof(NoopCommand));
+
+    char* allocateBlock(size_t size) noexcept;
+
+    std::vector<CommandStream> mStreams;
+    char* mJump;                // NoopCommand in the parent stream that jumps to the sub-streams
+    char* mBegin;               // reserved region
+    char* mEnd;
+    std::atomic<size_t> mOffset{ 0 };
 };
 
 void* CommandStream::allocate(size_t size, size_t alignment) noexcept {
@@ -322,6 +397,16 @@ void* CommandStream::allocate(size_t size, size_t alignment) noexcept {
     return data;
 }
 
+void* CommandStream::allocateSubBufferCommand(size_t size) noexcept {
+    char* const cur = mSubBufferHead;
+    // always keep enough space for the NoopCommand jumping to the next block
+    if (UTILS_UNLIKELY(size_t(mSubBufferEnd - cur) < size + CommandSubBuffers::LINK_SIZE)) {
+        return allocateSubBufferBlock(size);
+    }
+    mSubBufferHead = cur + size;
+    return cur;
+}
+
 template<typename PodType, typename>
 PodType* CommandStream::allocatePod(size_t count, size_t alignment) noexcept {
     return static_cast<PodType*>(allocate(count * sizeof(PodType), alignment));
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+#define TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
+
+#include <backend/Handle.h>
+
+#include <utils/algorithm.h>
+#include <utils/compiler.h>
+#include <utils/SpinLock.h>
+
+#include <type_traits>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Generation checks catch most uses of a handle after it's been destroyed, they're enabled by
+// default in debug builds.
+#ifndef FILAMENT_HANDLE_GENERATION_CHECKS
+#   ifdef NDEBUG
+#       define FILAMENT_HANDLE_GENERATION_CHECKS 0
+#   else
+#       define FILAMENT_HANDLE_GENERATION_CHECKS 1
+#   endif
+#endif
+
+namespace filament {
+namespace backend {
+
+/*
+ * A pool of fixed-size slots, used by HandleAllocator below.
+ *
+ * Free slots are kept in a singly-linked list threaded through the slots themselves, so
+ * allocations and deallocations are O(1) and never fragment the pool. The pool grows by adding
+ * slabs, each one twice as large as the previous one (except for the 2nd one). Slabs never move,
+ * so growing doesn't invalidate the slots already allocated.
+ *
+ * Each slot has a generation, which is incremented when it's freed.
+ *
+ * HandlePool is not thread-safe, except for getSlot() and getGeneration() which can be called
+ * concurrently with allocate() and free(), for slots allocated before.
+ */
+class HandlePool {
+public:
+    static constexpr uint32_t INVALID = uint32_t(-1);
+
+    HandlePool() noexcept = default;
+    ~HandlePool() noexcept;
+
+    HandlePool(HandlePool const& rhs) = delete;
+    HandlePool& operator=(HandlePool const& rhs) = delete;
+
+    // slotSize must be a multiple of 16, firstSlabSize is rounded up to a power of two.
+    void init(size_t slotSize, size_t firstSlabSize, uint32_t maxCount) noexcept;
+
+    // returns the index of a free slot, or INVALID if the pool can't grow anymore
+    uint32_t allocate() noexcept;
+
+    void free(uint32_t index) noexcept;
+
+    void* getSlot(uint32_t index) const noexcept {
+        const uint32_t slab = getSlabIndex(index);
+        return mSlabs[slab] + (index - getSlabStart(slab)) * mSlotSize;
+    }
+
+    uint8_t getGeneration(uint32_t index) const noexcept {
+        const uint32_t slab = getSlabIndex(index);
+        return getGenerations(slab)[index - getSlabStart(slab)];
+    }
+
+    size_t getSlotSize() const noexcept { return mSlotSize; }
+    size_t getCount() const noexcept { return mCount; }
+    size_t getHighWatermark() const noexcept { return mHighWatermark; }
+    size_t getCapacity() const noexcept { return mCapacity; }
+    size_t getAllocatedBytes() const noexcept { return mCapacity * (mSlotSize + 1); }
+
+private:
+    // enough slabs to cover all 2^24 indices even with the smallest first slab
+    static constexpr uint32_t MAX_SLABS = 24;
+
+    uint32_t getSlabIndex(uint32_t index) const noexcept {
+        // slab 0 is [0, N), slab k is [N << (k - 1), N << k)
+        const uint32_t n = index >> mFirstSlabShift;
+        return n ? 32u - utils::clz(n) : 0u;
+    }
+
+    uint32_t getSlabStart(uint32_t slab) const noexcept {
+        return slab ? (1u << (mFirstSlabShift + slab - 1u)) : 0u;
+    }
+
+    uint32_t getSlabSize(uint32_t slab) const noexcept {
+        return slab ? getSlabStart(slab) : (1u << mFirstSlabShift);
+    }
+
+    // the generations of a slab are stored after its slots
+    uint8_t* getGenerations(uint32_t slab) const noexcept {
+        return reinterpret_cast<uint8_t*>(mSlabs[slab] + getSlabSize(slab) * mSlotSize);
+    }
+
+    bool grow() noexcept;
+
+    char* mSlabs[MAX_SLABS] = {};
+    uint32_t mSlabCount = 0;
+    uint32_t mFirstSlabShift = 0;
+    uint32_t mSlotSize = 0;
+    uint32_t mMaxCount = 0;
+    uint32_t mCapacity = 0;     // number of slots in all slabs
+    uint32_t mNext = 0;         // first slot never used
+    uint32_t mFreeList = INVALID;
+    uint32_t mCount = 0;
+    uint32_t mHighWatermark = 0;
+};
+
+/*
+ * HandleAllocator allocates the storage of the objects referred to by Handle<>s. It's shared by
+ * the backends, each of which picks three size classes suitable for its concrete handle types.
+ *
+ * Each size class has its own HandlePool. A handle id encodes the size class, the index of
+ * the slot in its pool and the generation of the slot when it was allocated. With
+ * FILAMENT_HANDLE_GENERATION_CHECKS, handle_cast() verifies that the generation still matches,
+ * which catches uses of destroyed handles, even when their slot has been reused.
+ *
+ * allocate() and deallocate() can be called from different threads. handle_cast() doesn't lock.
+ */
+template <size_t P0, size_t P1, size_t P2>
+class HandleAllocator {
+    static_assert(P0 % 16 == 0 && P1 % 16 == 0 && P2 % 16 == 0,
+            "size classes must be multiples of 16 bytes");
+    static_assert(P0 < P1 && P1 < P2, "size classes must be sorted");
+
+public:
+    struct Stats {
+        struct Pool {
+            size_t slotSize;        // size of a slot in bytes
+            size_t count;           // number of live handles
+            size_t highWatermark;   // maximum number of live handles so far
+            size_t capacity;        // number of slots allocated so far
+        };
+        Pool pools[3];
+        size_t bytes;               // total memory used by the pools
+    };
+
+    // initialSize is the memory initially reserved for all the pools, they grow as needed.
+    HandleAllocator(const char* name, size_t initialSize) noexcept;
+    ~HandleAllocator() noexcept;
+
+    HandleAllocator(HandleAllocator const& rhs) = delete;
+    HandleAllocator& operator=(HandleAllocator const& rhs) = delete;
+
+    /*
+     * Allocates a handle and constructs its object.
+     */
+    template<typename D, typename ... ARGS>
+    Handle<D> allocateAndConstruct(ARGS&& ... args) noexcept {
+        Handle<D> h{ allocateHandle(getPoolIndex<D>()) };
+        new(handle_cast<D*>(h)) D(std::forward<ARGS>(args)...);
+        return h;
+    }
+
+    /*
+     * Allocates a handle without constructing its object, which is done later by construct().
+     */
+    template<typename D>
+    Handle<D> allocate() noexcept {
+        return Handle<D>{ allocateHandle(getPoolIndex<D>()) };
+    }
+
+    /*
+     * Constructs the object of a handle returned by allocate().
+     */
+    template<typename D, typename B, typename ... ARGS>
+    typename std::enable_if<std::is_base_of<B, D>::value, D>::type*
+    construct(Handle<B> const& handle, ARGS&& ... args) noexcept {
+        D* addr = handle_cast<D*>(const_cast<Handle<B>&>(handle));
+        new(addr) D(std::forward<ARGS>(args)...);
+        return addr;
+    }
+
+    /*
+     * Destroys the object of a handle and frees the handle. Like operator delete, this is a
+     * no-op if p is nullptr.
+     */
+    template <typename B, typename D,
+            typename = typename std::enable_if<std::is_base_of<B, D>::value, D>::type>
+    void deallocate(Handle<B>& handle, D const* p) noexcept {
+        if (p) {
+            p->~D();
+            deallocateHandle(handle.getId());
+        }
+    }
+
+    /*
+     * Frees a handle whose object was never constructed (or is trivially destructible).
+     */
+    template <typename B>
+    void deallocate(Handle<B>& handle) noexcept {
+        if (handle) {
+            deallocateHandle(handle.getId());
+        }
+    }
+
+    /*
+     * handle_cast
+     *
+     * casts a Handle<> to a pointer to the data it refers to.
+     */
+    template<typename Dp, typename B>
+    inline typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
+    handle_cast(Handle<B>& handle) noexcept {
+        assert(handle);
+        if (!handle) return nullptr; // better to get a NPE than random behavior/corruption
+        const HandleBase::HandleId id = handle.getId();
+        const uint32_t pool = id >> POOL_SHIFT;
+        const uint32_t index = id & INDEX_MASK;
+        assert(pool < 3);
+        // assert that this handle is even a valid one
+        assert(sizeof(typename std::remove_pointer<Dp>::type) <= mPools[pool].getSlotSize());
+#if FILAMENT_HANDLE_GENERATION_CHECKS
+        if (UTILS_UNLIKELY(getGeneration(id) !=
+                (mPools[pool].getGeneration(index) & GENERATION_MASK))) {
+            useAfterFree(id);
+        }
+#endif
+        return static_cast<Dp>(mPools[pool].getSlot(index));
+    }
+
+    template<typename Dp, typename B>
+    inline typename std::enable_if<
+            std::is_pointer<Dp>::value &&
+            std::is_base_of<B, typename std::remove_pointer<Dp>::type>::value, Dp>::type
+    handle_cast(Handle<B> const& handle) noexcept {
+        return handle_cast<Dp>(const_cast<Handle<B>&>(handle));
+    }
+
+    Stats getStats() const noexcept;
+
+private:
+    // handle ids are laid out as [pool:2][generation:6][index:24], the null id is never valid
+    // because it would be in the 4th pool.
+    static constexpr uint32_t POOL_SHIFT = 30;
+    static constexpr uint32_t GENERATION_SHIFT = 24;
+    static constexpr uint32_t GENERATION_MASK = 0x3F;
+    static constexpr uint32_t INDEX_MASK = (1u << GENERATION_SHIFT) - 1u;
+
+    template<typename D>
+    static constexpr uint32_t getPoolIndex() noexcept {
+        static_assert(sizeof(D) <= P2, "Handle<> too large");
+        return sizeof(D) <= P0 ? 0u : (sizeof(D) <= P1 ? 1u : 2u);
+    }
+
+    static constexpr uint8_t getGeneration(HandleBase::HandleId id) noexcept {
+        return uint8_t((id >> GENERATION_SHIFT) & GENERATION_MASK);
+    }
+
+    HandleBase::HandleId allocateHandle(uint32_t pool) noexcept;
+    void deallocateHandle(HandleBase::HandleId id) noexcept;
+    UTILS_NOINLINE void useAfterFree(HandleBase::HandleId id) const noexcept;
+
+    const char* mName;
+    mutable utils::SpinLock mLock;
+    HandlePool mPools[3];
+};
+
+// For reference on a 64-bits machine in Release mode:
+//    GLFence                   :  8        few
+//    GLIndexBuffer             : 12        moderate
+//    GLSamplerGroup            : 16        few
+// -- less than or equal 16 bytes
+//    GLRenderPrimitive         : 40        many
+//    GLTexture                 : 44        moderate
+//    OpenGLProgram             : 40        moderate
+//    GLRenderTarget            : 56        few
+// -- less than or equal 64 bytes
+//    GLVertexBuffer            : 208       moderate
+//    GLStream                  : 120       few
+//    GLUniformBuffer           : 128       many
+// -- less than or equal to 208 bytes
+using HandleAllocatorGL = HandleAllocator<16, 64, 208>;
+
+// For reference on a 64-bits machine in Release mode:
+//    VulkanSamplerGroup        :   8       few
+//    VulkanSync                :  16       few
+//    VulkanFence               :  24       few
+//    VulkanIndexBuffer         :  24       moderate
+//    VulkanTimerQuery          :  24       few
+//    VulkanUniformBuffer       :  40       many
+// -- less than or equal 64 bytes
+//    VulkanTexture             : 112       moderate
+//    VulkanVertexBuffer        : 160       moderate
+//    VulkanProgram             : 168       moderate
+//    VulkanSwapChain           : 240       few
+// -- less than or equal 256 bytes
+//    VulkanRenderTarget        : 504       few
+//    VulkanRenderPrimitive     : 544       many
+// -- less than or equal to 576 bytes
+using HandleAllocatorVK = HandleAllocator<64, 256, 576>;
+
+} // namespace backend
+} // namespace filament
+
+#endif // TNT_FILAMENT_DRIVER_HANDLEALLOCATOR_H
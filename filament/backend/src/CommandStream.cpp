@@ -18,9 +18,11 @@
 
 #include <utils/CallStack.h>
 #include <utils/Log.h>
+#include <utils/Panic.h>
 #include <utils/Profiler.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
 #include <functional>
 
 #ifdef ANDROID
@@ -111,6 +113,21 @@ void CommandStream::queueCommand(std::function<void()> command) {
     new(allocateCommand(CustomCommand::align(sizeof(CustomCommand)))) CustomCommand(std::move(command));
 }
 
+void* CommandStream::allocateSubBufferBlock(size_t size) noexcept {
+    // commands larger than a block get a block of their own
+    const size_t blockSize = std::max(CommandSubBuffers::BLOCK_SIZE,
+            CommandBase::align(size + CommandSubBuffers::LINK_SIZE));
+    char* const block = mSubBuffers->allocateBlock(blockSize);
+    if (mSubBufferHead) {
+        new(mSubBufferHead) NoopCommand(block);
+    } else {
+        mSubBufferFirst = block;
+    }
+    mSubBufferHead = block + size;
+    mSubBufferEnd = block + blockSize;
+    return block;
+}
+
 template<typename... ARGS>
 template<void (Driver::*METHOD)(ARGS...)>
 template<std::size_t... I>
@@ -152,6 +169,58 @@ void CustomCommand::execute(Driver&, CommandBase* base, intptr_t* next) noexcept
     static_cast<CustomCommand*>(base)->~CustomCommand();
 }
 
+// ------------------------------------------------------------------------------------------------
+
+CommandSubBuffers::CommandSubBuffers(CommandStream& stream, size_t count, size_t size) noexcept
+        : mStreams(count) {
+    assert(!stream.mSubBuffers);
+
+    for (CommandStream& s : mStreams) {
+        s.mDispatcher = stream.mDispatcher;
+        s.mDriver = stream.mDriver;
+        s.mSubBuffers = this;
+    }
+
+    // Until submit() is called, the parent stream just skips the reserved region. Commands
+    // recorded on the parent stream from now on go after it.
+    size = CommandBase::align(size);
+    mJump = static_cast<char*>(stream.allocateCommand(LINK_SIZE));
+    mBegin = static_cast<char*>(stream.allocateCommand(size));
+    mEnd = mBegin + size;
+    new(mJump) NoopCommand(mEnd);
+}
+
+char* CommandSubBuffers::allocateBlock(size_t size) noexcept {
+    // blocks are owned by a single sub-stream, and their content is published to the parent
+    // thread by whatever mechanism the caller uses to wait for the sub-streams, so this doesn't
+    // need to synchronize anything.
+    const size_t offset = mOffset.fetch_add(size, std::memory_order_relaxed);
+    ASSERT_POSTCONDITION(offset + size <= size_t(mEnd - mBegin),
+            "CommandSubBuffers ran out of space (%u bytes reserved)", unsigned(mEnd - mBegin));
+    return mBegin + offset;
+}
+
+size_t CommandSubBuffers::getUsedSize() const noexcept {
+    return std::min(mOffset.load(std::memory_order_relaxed), size_t(mEnd - mBegin));
+}
+
+void CommandSubBuffers::submit() noexcept {
+    SYSTRACE_CALL();
+
+    // link the sub-streams back to front, skipping the empty ones; the last one continues with
+    // the commands recorded on the parent stream after the reserved region.
+    char* next = mEnd;
+    for (size_t i = mStreams.size(); i-- > 0;) {
+        CommandStream& s = mStreams[i];
+        if (s.mSubBufferFirst) {
+            new(s.mSubBufferHead) NoopCommand(next);
+            next = s.mSubBufferFirst;
+        }
+        s.mSubBuffers = nullptr;
+    }
+    new(mJump) NoopCommand(next);
+}
+
 } // namespace backend
 } // namespace filament
 
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "private/backend/HandleAllocator.h"
+
+#include <utils/Log.h>
+#include <utils/memalign.h>
+#include <utils/Panic.h>
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+
+#include <string.h>
+
+using namespace utils;
+
+namespace filament {
+namespace backend {
+
+// ------------------------------------------------------------------------------------------------
+
+HandlePool::~HandlePool() noexcept {
+    for (uint32_t i = 0; i < mSlabCount; i++) {
+        utils::aligned_free(mSlabs[i]);
+    }
+}
+
+void HandlePool::init(size_t slotSize, size_t firstSlabSize, uint32_t maxCount) noexcept {
+    assert(slotSize % 16 == 0);
+    assert(!mSlabCount);
+    mSlotSize = uint32_t(slotSize);
+    mMaxCount = maxCount;
+    // at least 64 slots, so that we never need more than MAX_SLABS slabs
+    mFirstSlabShift = 6;
+    while ((1u << mFirstSlabShift) < firstSlabSize && (2u << mFirstSlabShift) <= maxCount) {
+        mFirstSlabShift++;
+    }
+}
+
+UTILS_NOINLINE
+bool HandlePool::grow() noexcept {
+    const uint32_t slab = mSlabCount;
+    const uint32_t size = getSlabSize(slab);
+    if (UTILS_UNLIKELY(slab == MAX_SLABS || mCapacity + size > mMaxCount)) {
+        return false;
+    }
+    // slots are followed by their generation
+    char* const p = (char*)utils::aligned_alloc(size * (mSlotSize + 1), 16);
+    if (UTILS_UNLIKELY(!p)) {
+        return false;
+    }
+    memset(p + size * mSlotSize, 0, size);
+    mSlabs[slab] = p;
+    mSlabCount = slab + 1;
+    mCapacity += size;
+    return true;
+}
+
+uint32_t HandlePool::allocate() noexcept {
+    uint32_t index = mFreeList;
+    if (index != INVALID) {
+        // the next free slot is stored in the slot itself
+        memcpy(&mFreeList, getSlot(index), sizeof(mFreeList));
+    } else {
+        if (UTILS_UNLIKELY(mNext == mCapacity && !grow())) {
+            return INVALID;
+        }
+        index = mNext++;
+    }
+    mCount++;
+    mHighWatermark = std::max(mHighWatermark, mCount);
+    return index;
+}
+
+void HandlePool::free(uint32_t index) noexcept {
+    assert(index < mNext);
+    const uint32_t slab = getSlabIndex(index);
+    getGenerations(slab)[index - getSlabStart(slab)]++;
+    memcpy(getSlot(index), &mFreeList, sizeof(mFreeList));
+    mFreeList = index;
+    mCount--;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+template <size_t P0, size_t P1, size_t P2>
+HandleAllocator<P0, P1, P2>::HandleAllocator(const char* name, size_t initialSize) noexcept
+        : mName(name) {
+    // the initial size is split between the pools like it used to be with the OpenGL backend,
+    // which is a good guess of how many handles of each size class are typically needed.
+    mPools[0].init(P0, (1 * initialSize) / (16 * P0), INDEX_MASK + 1);
+    mPools[1].init(P1, (5 * initialSize) / (16 * P1), INDEX_MASK + 1);
+    mPools[2].init(P2, (10 * initialSize) / (16 * P2), INDEX_MASK + 1);
+}
+
+template <size_t P0, size_t P1, size_t P2>
+HandleAllocator<P0, P1, P2>::~HandleAllocator() noexcept {
+#ifndef NDEBUG
+    const Stats stats = getStats();
+    slog.d << mName << ": " << stats.bytes / 1024 << " KiB";
+    for (auto const& pool : stats.pools) {
+        slog.d << ", " << pool.slotSize << "B slots: " << pool.highWatermark << " max";
+        if (pool.count) {
+            slog.d << " (" << pool.count << " leaked)";
+        }
+    }
+    slog.d << io::endl;
+#endif
+}
+
+// This is "NOINLINE" because it ends-up generating more code than we'd like because of
+// the locking (unfortunately, handles are allocated and freed from 2 threads)
+template <size_t P0, size_t P1, size_t P2>
+UTILS_NOINLINE
+HandleBase::HandleId HandleAllocator<P0, P1, P2>::allocateHandle(uint32_t pool) noexcept {
+    std::lock_guard<utils::SpinLock> guard(mLock);
+    HandlePool& p = mPools[pool];
+    const uint32_t index = p.allocate();
+    ASSERT_POSTCONDITION(index != HandlePool::INVALID,
+            "%s: out of memory for %u bytes handles", mName, unsigned(p.getSlotSize()));
+    const uint32_t generation = p.getGeneration(index) & GENERATION_MASK;
+    return (pool << POOL_SHIFT) | (generation << GENERATION_SHIFT) | index;
+}
+
+template <size_t P0, size_t P1, size_t P2>
+UTILS_NOINLINE
+void HandleAllocator<P0, P1, P2>::deallocateHandle(HandleBase::HandleId id) noexcept {
+    const uint32_t pool = id >> POOL_SHIFT;
+    const uint32_t index = id & INDEX_MASK;
+    assert(pool < 3);
+    std::lock_guard<utils::SpinLock> guard(mLock);
+    HandlePool& p = mPools[pool];
+#if FILAMENT_HANDLE_GENERATION_CHECKS
+    // catches double frees
+    if (UTILS_UNLIKELY(getGeneration(id) != (p.getGeneration(index) & GENERATION_MASK))) {
+        useAfterFree(id);
+    }
+#endif
+    p.free(index);
+}
+
+template <size_t P0, size_t P1, size_t P2>
+void HandleAllocator<P0, P1, P2>::useAfterFree(HandleBase::HandleId id) const noexcept {
+    slog.e << mName << ": handle " << id << " used after it was destroyed" << io::endl;
+    std::terminate();
+}
+
+template <size_t P0, size_t P1, size_t P2>
+typename HandleAllocator<P0, P1, P2>::Stats HandleAllocator<P0, P1, P2>::getStats() const noexcept {
+    std::lock_guard<utils::SpinLock> guard(mLock);
+    Stats stats{};
+    for (size_t i = 0; i < 3; i++) {
+        HandlePool const& p = mPools[i];
+        stats.pools[i] = { p.getSlotSize(), p.getCount(), p.getHighWatermark(), p.getCapacity() };
+        stats.bytes += p.getAllocatedBytes();
+    }
+    return stats;
+}
+
+// explicit instantiation of the allocators used by the backends
+template class HandleAllocator<16, 64, 208>;
+template class HandleAllocator<64, 256, 576>;
+
+} // namespace backend
+} // namespace filament
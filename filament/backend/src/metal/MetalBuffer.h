@@ -43,6 +43,14 @@ public:
      */
     void copyIntoBuffer(void* src, size_t size);
 
+    /**
+     * Update a range of the buffer with data inside src, the rest of the buffer is preserved.
+     * The range is written in place, unless the current allocation is still used by a command
+     * buffer. In this case a new allocation is made and the rest of the previous contents are
+     * copied to it, so further updates before the next draw call are written in place.
+     */
+    void copyIntoBuffer(void* src, size_t size, size_t byteOffset);
+
     /**
      * Denotes that this buffer is used for a draw call ensuring that its allocation remains valid
      * until the end of the current frame.
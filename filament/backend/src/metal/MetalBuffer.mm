@@ -67,6 +67,39 @@ void MetalBuffer::copyIntoBuffer(void* src, size_t size) {
     memcpy(static_cast<uint8_t*>(mBufferPoolEntry->buffer.contents), src, size);
 }
 
+void MetalBuffer::copyIntoBuffer(void* src, size_t size, size_t byteOffset) {
+    if (size <= 0) {
+        return;
+    }
+    ASSERT_PRECONDITION(byteOffset + size <= mBufferSize,
+            "Attempting to copy %d bytes at offset %d into a buffer of size %d",
+            size, byteOffset, mBufferSize);
+
+    if (mCpuBuffer) {
+        memcpy(static_cast<uint8_t*>(mCpuBuffer) + byteOffset, src, size);
+        return;
+    }
+
+    const size_t end = byteOffset + size;
+
+    // The current allocation can be written in place, unless a command buffer that the GPU
+    // hasn't completed yet uses it. In this case, we acquire a new one and carry over the
+    // contents that are not updated.
+    if (!mBufferPoolEntry || mContext.bufferPool->isBufferShared(mBufferPoolEntry)) {
+        const MetalBufferPoolEntry* previous = mBufferPoolEntry;
+        mBufferPoolEntry = mContext.bufferPool->acquireBuffer(mBufferSize);
+        if (previous) {
+            uint8_t* const contents = static_cast<uint8_t*>(mBufferPoolEntry->buffer.contents);
+            auto const* previousContents = static_cast<uint8_t const*>(previous->buffer.contents);
+            memcpy(contents, previousContents, byteOffset);
+            memcpy(contents + end, previousContents + end, mBufferSize - end);
+            mContext.bufferPool->releaseBuffer(previous);
+        }
+    }
+
+    memcpy(static_cast<uint8_t*>(mBufferPoolEntry->buffer.contents) + byteOffset, src, size);
+}
+
 id<MTLBuffer> MetalBuffer::getGpuBufferForDraw(id<MTLCommandBuffer> cmdBuffer) noexcept {
     if (!mBufferPoolEntry) {
         // If there's a CPU buffer, then we return nil here, as the CPU-side buffer will be bound
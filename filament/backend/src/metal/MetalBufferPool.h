@@ -52,6 +52,10 @@ public:
     // the count is 0.
     void releaseBuffer(MetalBufferPoolEntry const *stage) noexcept;
 
+    // Returns true if the buffer is referenced more than once, e.g. by a command buffer that
+    // hasn't completed yet.
+    bool isBufferShared(MetalBufferPoolEntry const *stage) noexcept;
+
     // Evicts old unused buffers and bumps the current frame number.
     void gc() noexcept;
 
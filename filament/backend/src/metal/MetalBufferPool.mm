@@ -80,6 +80,12 @@ void MetalBufferPool::releaseBuffer(MetalBufferPoolEntry const *stage) noexcept
     mFreeStages.insert(std::make_pair(stage->capacity, stage));
 }
 
+bool MetalBufferPool::isBufferShared(MetalBufferPoolEntry const *stage) noexcept {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    return stage->referenceCount > 1;
+}
+
 void MetalBufferPool::gc() noexcept {
     // If this is one of the first few frames, return early to avoid wrapping unsigned integers.
     if (++mCurrentFrame <= TIME_BEFORE_EVICTION) {
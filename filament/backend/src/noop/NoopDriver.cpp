@@ -25,7 +25,8 @@ Driver* NoopDriver::create() {
     return new NoopDriver();
 }
 
-NoopDriver::NoopDriver() noexcept : DriverBase(new ConcreteDispatcher<NoopDriver>()) {
+NoopDriver::NoopDriver() noexcept : DriverBase(new ConcreteDispatcher<NoopDriver>()),
+        mHandleAllocator("Handles", 1024U * 1024U) {
 }
 
 NoopDriver::~NoopDriver() noexcept = default;
@@ -74,39 +75,51 @@ void NoopDriver::finish(int) {
 }
 
 void NoopDriver::destroyUniformBuffer(Handle<HwUniformBuffer> ubh) {
+    mHandleAllocator.deallocate(ubh);
 }
 
 void NoopDriver::destroyRenderPrimitive(Handle<HwRenderPrimitive> rph) {
+    mHandleAllocator.deallocate(rph);
 }
 
 void NoopDriver::destroyVertexBuffer(Handle<HwVertexBuffer> vbh) {
+    mHandleAllocator.deallocate(vbh);
 }
 
 void NoopDriver::destroyIndexBuffer(Handle<HwIndexBuffer> ibh) {
+    mHandleAllocator.deallocate(ibh);
 }
 
 void NoopDriver::destroyTexture(Handle<HwTexture> th) {
+    mHandleAllocator.deallocate(th);
 }
 
 void NoopDriver::destroyProgram(Handle<HwProgram> ph) {
+    mHandleAllocator.deallocate(ph);
 }
 
 void NoopDriver::destroyRenderTarget(Handle<HwRenderTarget> rth) {
+    mHandleAllocator.deallocate(rth);
 }
 
 void NoopDriver::destroySamplerGroup(Handle<HwSamplerGroup> sbh) {
+    mHandleAllocator.deallocate(sbh);
 }
 
 void NoopDriver::destroySwapChain(Handle<HwSwapChain> sch) {
+    mHandleAllocator.deallocate(sch);
 }
 
 void NoopDriver::destroyStream(Handle<HwStream> sh) {
+    mHandleAllocator.deallocate(sh);
 }
 
 void NoopDriver::destroyTimerQuery(Handle<HwTimerQuery> tqh) {
+    mHandleAllocator.deallocate(tqh);
 }
 
 void NoopDriver::destroySync(Handle<HwSync> fh) {
+    mHandleAllocator.deallocate(fh);
 }
 
 Handle<HwStream> NoopDriver::createStreamNative(void* nativeStream) {
@@ -132,6 +145,7 @@ void NoopDriver::updateStreams(CommandStream* driver) {
 }
 
 void NoopDriver::destroyFence(Handle<HwFence> fh) {
+    mHandleAllocator.deallocate(fh);
 }
 
 FenceStatus NoopDriver::wait(Handle<HwFence> fh, uint64_t timeout) {
@@ -229,6 +243,11 @@ void NoopDriver::loadUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor
     scheduleDestroy(std::move(data));
 }
 
+void NoopDriver::updateUniformBuffer(Handle<HwUniformBuffer> ubh, BufferDescriptor&& data,
+        uint32_t byteOffset) {
+    scheduleDestroy(std::move(data));
+}
+
 void NoopDriver::updateSamplerGroup(Handle<HwSamplerGroup> sbh,
         SamplerGroup&& samplerGroup) {
 }
@@ -300,7 +319,8 @@ void NoopDriver::blit(TargetBufferFlags buffers,
         SamplerMagFilter filter) {
 }
 
-void NoopDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph) {
+void NoopDriver::draw(PipelineState pipelineState, Handle<HwRenderPrimitive> rph,
+        uint32_t instanceCount) {
 }
 
 void NoopDriver::beginTimerQuery(Handle<HwTimerQuery> tqh) {
@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_DRIVER_NOOPDRIVER_H
 
 #include "private/backend/Driver.h"
+#include "private/backend/HandleAllocator.h"
 #include "DriverBase.h"
 
 #include <utils/compiler.h>
@@ -49,10 +50,19 @@ private:
 
 #define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) \
     RetType methodName##S() noexcept override { \
-        return RetType((RetType::HandleId)0xDEAD0000); } \
+        return allocateHandle(RetType{}); } \
     UTILS_ALWAYS_INLINE void methodName##R(RetType, paramsDecl) { }
 
 #include "private/backend/DriverAPI.inc"
+
+    // Handles are real, so that the cost of their allocation can be measured with this backend,
+    // but their objects are never constructed.
+    backend::HandleAllocatorGL mHandleAllocator;
+
+    template<typename T>
+    backend::Handle<T> allocateHandle(backend::Handle<T> const&) noexcept {
+        return mHandleAllocator.allocate<T>();
+    }
 };
 
 } // namespace filament
@@ -19,6 +19,8 @@
 #include "ShaderGenerator.h"
 #include "TrianglePrimitive.h"
 
+#include <math/vec4.h>
+
 namespace {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -46,6 +48,25 @@ void main() {
 
 )");
 
+// The uniform buffer is larger than 4 KiB, so that the Metal backend doesn't use
+// setFragmentBytes() for it.
+std::string uniformFragment (R"(#version 450 core
+
+layout(location = 0) out vec4 fragColor;
+
+layout(binding = 0) uniform Params {
+    vec4 colors[512];
+} params;
+
+void main() {
+    fragColor = params.colors[0] + params.colors[511];
+}
+
+)");
+
+constexpr size_t UNIFORM_COLOR_COUNT = 512;
+constexpr uint32_t UNIFORM_TARGET_SIZE = 256;
+
 }
 
 namespace test {
@@ -115,7 +136,7 @@ TEST_F(BackendTest, VertexBufferUpdate) {
                     triangle.updateIndices(i);
                 }
             }
-            getDriverApi().draw(state, triangle.getRenderPrimitive());
+            getDriverApi().draw(state, triangle.getRenderPrimitive(), 1);
 
             triangleIndex++;
         }
@@ -135,4 +156,119 @@ TEST_F(BackendTest, VertexBufferUpdate) {
     executeCommands();
 }
 
+TEST_F(BackendTest, UniformBufferUpdate) {
+    using filament::math::float2;
+    using filament::math::float4;
+
+    // Only the updated ranges of a uniform buffer must change, including when the buffer is
+    // updated while a previous draw call still uses it, or several times before a draw call.
+    const uint32_t size = UNIFORM_TARGET_SIZE;
+
+    {
+        auto swapChain = getDriverApi().createSwapChainHeadless(size, size, 0);
+        getDriverApi().makeCurrent(swapChain, swapChain);
+
+        ShaderGenerator shaderGen(vertex, uniformFragment, sBackend, sIsMobilePlatform);
+        Program p = shaderGen.getProgram();
+        p.setUniformBlock(0, utils::CString("Params"));
+        auto program = getDriverApi().createProgram(std::move(p));
+
+        Handle<HwTexture> texture = getDriverApi().createTexture(SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, size, size, 1,
+                TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE);
+        Handle<HwRenderTarget> renderTarget = getDriverApi().createRenderTarget(
+                TargetBufferFlags::COLOR, size, size, 1, TargetBufferInfo(texture, 0), {}, {});
+
+        auto ubo = getDriverApi().createUniformBuffer(UNIFORM_COLOR_COUNT * sizeof(float4),
+                BufferUsage::DYNAMIC);
+        auto update = [this, ubo](size_t index, float4 color) {
+            float4* data = new float4(color);
+            getDriverApi().updateUniformBuffer(ubo, BufferDescriptor(data, sizeof(float4),
+                    [](void* buffer, size_t, void*) { delete (float4*) buffer; }),
+                    uint32_t(index * sizeof(float4)));
+        };
+
+        // the shader adds the first and last colors, the ones in between are never updated
+        float4* colors = new float4[UNIFORM_COLOR_COUNT]();
+        colors[0] = { 1, 0, 0, 0 };
+        colors[UNIFORM_COLOR_COUNT - 1] = { 0, 0, 0, 1 };
+        getDriverApi().loadUniformBuffer(ubo, BufferDescriptor(colors,
+                UNIFORM_COLOR_COUNT * sizeof(float4),
+                [](void* buffer, size_t, void*) { delete[] (float4*) buffer; }));
+        getDriverApi().bindUniformBuffer(0, ubo);
+
+        TrianglePrimitive triangle(getDriverApi());
+
+        RenderPassParams params = {};
+        fullViewport(params);
+        params.viewport.width = size;
+        params.viewport.height = size;
+        params.flags.clear = TargetBufferFlags::COLOR;
+        params.clearColor = { 0.f, 0.f, 0.f, 1.f };
+        params.flags.discardStart = TargetBufferFlags::ALL;
+        params.flags.discardEnd = TargetBufferFlags::NONE;
+
+        PipelineState state;
+        state.program = program;
+        state.rasterState.colorWrite = true;
+        state.rasterState.depthWrite = false;
+        state.rasterState.depthFunc = RasterState::DepthFunc::A;
+        state.rasterState.culling = CullingMode::NONE;
+
+        getDriverApi().makeCurrent(swapChain, swapChain);
+        getDriverApi().beginFrame(0, 0);
+        getDriverApi().beginRenderPass(renderTarget, params);
+
+        // red triangle on the left half
+        const float2 left[3] = {{ -1, -1 }, { 0, -1 }, { -1, 1 }};
+        triangle.updateVertices(left);
+        getDriverApi().draw(state, triangle.getRenderPrimitive(), 1);
+
+        // cyan triangle on the right half, updated with two ranges before drawing
+        update(0, { 0, 1, 0, 0 });
+        update(UNIFORM_COLOR_COUNT - 1, { 0, 0, 1, 1 });
+        const float2 right[3] = {{ 1, -1 }, { 0, -1 }, { 1, 1 }};
+        triangle.updateVertices(right);
+        getDriverApi().draw(state, triangle.getRenderPrimitive(), 1);
+
+        getDriverApi().endRenderPass();
+
+        const size_t bufferSize = size * size * 4;
+        void* buffer = calloc(1, bufferSize);
+        PixelBufferDescriptor descriptor(buffer, bufferSize,
+                PixelDataFormat::RGBA, PixelDataType::UBYTE,
+                [](void* buffer, size_t, void*) {
+                    const uint32_t size = UNIFORM_TARGET_SIZE;
+                    auto pixel = [buffer](uint32_t x, uint32_t y) {
+                        const uint8_t* p = (const uint8_t*) buffer + (y * size + x) * 4;
+                        return filament::math::uint4{ p[0], p[1], p[2], p[3] };
+                    };
+                    // the triangles are symmetrical vertically, so the orientation of the rows
+                    // doesn't matter
+                    EXPECT_EQ(filament::math::uint4(255, 0, 0, 255), pixel(size / 10, size / 2));
+                    EXPECT_EQ(filament::math::uint4(0, 255, 255, 255),
+                            pixel(size - size / 10, size / 2));
+                    free(buffer);
+                });
+        getDriverApi().readPixels(renderTarget, 0, 0, size, size, std::move(descriptor));
+
+        getDriverApi().flush();
+        getDriverApi().commit(swapChain);
+        getDriverApi().endFrame(0);
+
+        getDriverApi().destroyProgram(program);
+        getDriverApi().destroySwapChain(swapChain);
+        getDriverApi().destroyRenderTarget(renderTarget);
+        getDriverApi().destroyTexture(texture);
+        getDriverApi().destroyUniformBuffer(ubo);
+    }
+
+    // This ensures all driver commands have finished before exiting the test.
+    getDriverApi().finish();
+
+    executeCommands();
+
+    getDriver().purge();
+}
+
 } // namespace test
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "details/Engine.h"
+
+#include <private/backend/CommandStream.h>
+
+#include <utils/JobSystem.h>
+#include <utils/Mutex.h>
+
+#include <mutex>
+
+using namespace filament;
+using namespace filament::backend;
+using namespace utils;
+
+// Records the same number of commands from several jobs, either in the Engine's command stream
+// protected by a lock, or in CommandSubBuffers. The Noop backend executes the commands.
+class CommandStreamFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t COMMAND_COUNT = 4096;
+    static constexpr size_t SUB_BUFFERS_SIZE = 512 * 1024;
+
+    // commands recorded by each job between two lock acquisitions
+    static constexpr size_t BATCH_SIZE = 16;
+
+    Engine* engine = nullptr;
+
+    static void record(DriverApi& driver, size_t count) noexcept {
+        for (size_t i = 0; i < count; i++) {
+            driver.draw({}, {}, 1);
+        }
+    }
+
+public:
+    void SetUp(benchmark::State& state) override {
+        engine = Engine::create(Engine::Backend::NOOP);
+    }
+
+    void TearDown(benchmark::State& state) override {
+        Engine::destroy(&engine);
+    }
+};
+
+BENCHMARK_DEFINE_F(CommandStreamFixture, lockedStream)(benchmark::State& state) {
+    FEngine& fengine = upcast(*engine);
+    DriverApi& driver = fengine.getDriverApi();
+    JobSystem& js = fengine.getJobSystem();
+    const size_t jobCount = size_t(state.range(0));
+    Mutex lock;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            auto* parent = js.createJob();
+            for (size_t i = 0; i < jobCount; i++) {
+                js.run(js.createJob(parent, [&driver, &lock, jobCount](JobSystem&, JobSystem::Job*) {
+                    for (size_t c = 0; c < COMMAND_COUNT / jobCount; c += BATCH_SIZE) {
+                        std::lock_guard<Mutex> guard(lock);
+                        driver.debugThreading();
+                        record(driver, BATCH_SIZE);
+                    }
+                }));
+            }
+            js.runAndWait(parent);
+            driver.debugThreading();
+            fengine.flush();
+        }
+        pc.stop();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * COMMAND_COUNT));
+}
+
+BENCHMARK_DEFINE_F(CommandStreamFixture, subBuffers)(benchmark::State& state) {
+    FEngine& fengine = upcast(*engine);
+    DriverApi& driver = fengine.getDriverApi();
+    JobSystem& js = fengine.getJobSystem();
+    const size_t jobCount = size_t(state.range(0));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            CommandSubBuffers subBuffers(driver, jobCount, SUB_BUFFERS_SIZE);
+            auto* parent = js.createJob();
+            for (size_t i = 0; i < jobCount; i++) {
+                js.run(js.createJob(parent, [&subBuffers, i, jobCount](JobSystem&, JobSystem::Job*) {
+                    record(subBuffers[i], COMMAND_COUNT / jobCount);
+                }));
+            }
+            js.runAndWait(parent);
+            subBuffers.submit();
+            fengine.flush();
+        }
+        pc.stop();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * COMMAND_COUNT));
+}
+
+BENCHMARK_REGISTER_F(CommandStreamFixture, lockedStream)->RangeMultiplier(2)->Range(1, 8);
+BENCHMARK_REGISTER_F(CommandStreamFixture, subBuffers)->RangeMultiplier(2)->Range(1, 8);
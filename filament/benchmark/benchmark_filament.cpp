@@ -22,8 +22,10 @@
 #include <filament/Box.h>
 #include <filament/Frustum.h>
 #include "details/Culler.h"
+#include "details/CullingBvh.h"
 
 #include <utils/Allocator.h>
+#include <utils/JobSystem.h>
 
 #include <vector>
 #include <random>
@@ -103,3 +105,164 @@ BENCHMARK_F(FilamentFixture, sphereCulling)(benchmark::State& state) {
         state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
     }
 }
+
+static const char* kernelName(Culler::Kernel kernel) {
+    switch (kernel) {
+        case Culler::Kernel::SCALAR:    return "scalar";
+        case Culler::Kernel::SSE2:      return "sse2";
+        case Culler::Kernel::AVX2:      return "avx2";
+        case Culler::Kernel::NEON:      return "neon";
+    }
+    return "unknown";
+}
+
+BENCHMARK_DEFINE_F(FilamentFixture, boxCullingKernel)(benchmark::State& state) {
+    const Culler::Kernel kernel = Culler::Kernel(state.range(0));
+    if (!Culler::Test::isSupported(kernel)) {
+        state.SkipWithError("kernel not supported");
+        return;
+    }
+    state.SetLabel(kernelName(kernel));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            Culler::Test::intersects(kernel, visibles, frustum,
+                    boxesCenter.data(), boxesExtent.data(), BATCH_SIZE);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+        state.counters["boxes/ns"] = benchmark::Counter(
+                double(state.iterations() * BATCH_SIZE) * 1e-9, benchmark::Counter::kIsRate);
+    }
+}
+
+BENCHMARK_DEFINE_F(FilamentFixture, sphereCullingKernel)(benchmark::State& state) {
+    const Culler::Kernel kernel = Culler::Kernel(state.range(0));
+    if (!Culler::Test::isSupported(kernel)) {
+        state.SkipWithError("kernel not supported");
+        return;
+    }
+    state.SetLabel(kernelName(kernel));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            Culler::Test::intersects(kernel, visibles, frustum, spheres.data(), BATCH_SIZE);
+        }
+        benchmark::ClobberMemory();
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+        state.counters["spheres/ns"] = benchmark::Counter(
+                double(state.iterations() * BATCH_SIZE) * 1e-9, benchmark::Counter::kIsRate);
+    }
+}
+
+BENCHMARK_REGISTER_F(FilamentFixture, boxCullingKernel)
+        ->ArgName("kernel")->DenseRange(0, int(Culler::Kernel::NEON));
+
+BENCHMARK_REGISTER_F(FilamentFixture, sphereCullingKernel)
+        ->ArgName("kernel")->DenseRange(0, int(Culler::Kernel::NEON));
+
+// ------------------------------------------------------------------------------------------------
+// Flat vs. hierarchical culling of a large scene
+// ------------------------------------------------------------------------------------------------
+
+class CullingFixture : public benchmark::Fixture {
+protected:
+    Frustum frustum{};
+    std::vector<float3> boxesCenter;
+    std::vector<float3> boxesExtent;
+    std::vector<Culler::result_type> visibles;
+    CullingBvh bvh;
+
+public:
+    void SetUp(const ::benchmark::State& state) override {
+        std::default_random_engine gen; // NOLINT
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> size(0.1f, 5.0f);
+
+        // a scene much larger than the frustum, like an open world
+        const size_t count = size_t(state.range(0));
+        frustum = Frustum{ mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f) };
+        boxesCenter.resize(Culler::round(count));
+        boxesExtent.resize(Culler::round(count));
+        visibles.resize(Culler::round(count));
+        for (size_t i = 0; i < count; i++) {
+            boxesCenter[i] = { position(gen), position(gen), position(gen) };
+            boxesExtent[i] = { size(gen), size(gen), size(gen) };
+        }
+        CullingBvh::Test::build(bvh, boxesCenter.data(), boxesExtent.data(), count);
+    }
+
+    void TearDown(const ::benchmark::State&) override {
+        boxesCenter = {};
+        boxesExtent = {};
+        visibles = {};
+    }
+};
+
+BENCHMARK_DEFINE_F(CullingFixture, flatCulling)(benchmark::State& state) {
+    const size_t count = size_t(state.range(0));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            Culler::Test::intersects(visibles.data(), frustum,
+                    boxesCenter.data(), boxesExtent.data(), count);
+            benchmark::DoNotOptimize(visibles.data());
+        }
+        pc.stop();
+        state.SetItemsProcessed(int64_t(state.iterations() * count));
+    }
+}
+
+BENCHMARK_DEFINE_F(CullingFixture, bvhCulling)(benchmark::State& state) {
+    const size_t count = size_t(state.range(0));
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            CullingBvh::Test::cull(bvh, visibles.data(), frustum, 0);
+            benchmark::DoNotOptimize(visibles.data());
+        }
+        pc.stop();
+        state.SetItemsProcessed(int64_t(state.iterations() * count));
+    }
+}
+
+BENCHMARK_DEFINE_F(CullingFixture, bvhParallelCulling)(benchmark::State& state) {
+    const size_t count = size_t(state.range(0));
+    JobSystem js;
+    js.adopt();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            CullingBvh::Test::cull(bvh, js, visibles.data(), frustum, 0);
+            benchmark::DoNotOptimize(visibles.data());
+        }
+        pc.stop();
+        state.SetItemsProcessed(int64_t(state.iterations() * count));
+    }
+    js.emancipate();
+}
+
+BENCHMARK_DEFINE_F(CullingFixture, bvhRefit)(benchmark::State& state) {
+    // moves 1% of the boxes each iteration
+    const size_t count = size_t(state.range(0));
+    float offset = 0.01f;
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            for (size_t i = 0; i < count; i += 100) {
+                boxesCenter[i].x += offset;
+            }
+            offset = -offset;
+            CullingBvh::Test::refit(bvh, boxesCenter.data(), boxesExtent.data(), count);
+        }
+        pc.stop();
+        state.SetItemsProcessed(int64_t(state.iterations() * count));
+    }
+}
+
+BENCHMARK_REGISTER_F(CullingFixture, flatCulling)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK_REGISTER_F(CullingFixture, bvhCulling)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK_REGISTER_F(CullingFixture, bvhParallelCulling)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK_REGISTER_F(CullingFixture, bvhRefit)->RangeMultiplier(10)->Range(10000, 1000000);
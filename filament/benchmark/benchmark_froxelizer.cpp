@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "details/Allocators.h"
+#include "details/Camera.h"
+#include "details/Engine.h"
+#include "details/Froxelizer.h"
+#include "details/Scene.h"
+
+#include <filament/LightManager.h>
+
+#include <private/filament/EngineEnums.h>
+
+#include <utils/EntityManager.h>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+// Froxelizes a random set of point and spot lights, half of each, either with the bitset
+// froxelization (limited to CONFIG_MAX_LIGHT_COUNT lights) or the binned froxelization.
+class FroxelizerFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t MAX_LIGHT_COUNT = 16384;
+
+    Engine* engine = nullptr;
+    std::vector<Entity> entities;
+    FScene::LightSoa lights;
+
+    void createLights(size_t count) {
+        FEngine& fengine = upcast(*engine);
+        std::default_random_engine generator(82828); // NOLINT
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        auto random = [&]() { return distribution(generator); };
+
+        lights.clear();
+        lights.push_back({}, {}, {}, {}, {}, {});   // the directional light is skipped
+        for (size_t i = 0; i < count; i++) {
+            LightManager::Instance instance = fengine.getLightManager().getInstance(entities[i]);
+            float4 sphere{ 50.0f * random(), 25.0f * random(), -55.0f + 50.0f * random(),
+                           2.0f + random() };
+            float3 direction = normalize(float3{ random(), random(), -1.0f });
+            lights.push_back(sphere, direction, instance, 1, {}, {});
+        }
+    }
+
+    void froxelize(benchmark::State& state, bool binned) {
+        FEngine& fengine = upcast(*engine);
+        const size_t count = size_t(state.range(0));
+        if (!binned && count > CONFIG_MAX_LIGHT_COUNT) {
+            state.SkipWithError("the bitset froxelization is limited to CONFIG_MAX_LIGHT_COUNT lights");
+            return;
+        }
+        createLights(count);
+
+        LinearAllocatorArena arena("froxelizer benchmark", FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+        filament::ArenaScope scope(arena);
+
+        Froxelizer froxelizer(fengine);
+        froxelizer.setOptions(5.0f, 100.0f);
+        froxelizer.setBinningEnabled(binned);
+        froxelizer.prepare(fengine.getDriverApi(), scope, { 0, 0, 1920, 1080 },
+                mat4f::perspective(60.0f, 1920.0f / 1080.0f, 0.1f, 100.0f), 0.1f, 100.0f);
+
+        const CameraInfo camera;
+        {
+            PerformanceCounters pc(state);
+            for (auto _ : state) {
+                froxelizer.froxelizeLights(fengine, camera, lights);
+                benchmark::ClobberMemory();
+            }
+            pc.stop();
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * count));
+
+        froxelizer.terminate(fengine.getDriverApi());
+        fengine.flush();
+    }
+
+public:
+    void SetUp(benchmark::State& state) override {
+        engine = Engine::create(Engine::Backend::NOOP);
+        entities.resize(MAX_LIGHT_COUNT);
+        EntityManager::get().create(entities.size(), entities.data());
+        for (size_t i = 0; i < entities.size(); i++) {
+            LightManager::Builder((i % 2) ? LightManager::Type::SPOT : LightManager::Type::POINT)
+                    .spotLightCone(0.2f, 0.5f)
+                    .build(*engine, entities[i]);
+        }
+    }
+
+    void TearDown(benchmark::State& state) override {
+        for (Entity e : entities) {
+            engine->getLightManager().destroy(e);
+        }
+        EntityManager::get().destroy(entities.size(), entities.data());
+        Engine::destroy(&engine);
+    }
+};
+
+BENCHMARK_DEFINE_F(FroxelizerFixture, bitset)(benchmark::State& state) {
+    froxelize(state, false);
+}
+
+BENCHMARK_DEFINE_F(FroxelizerFixture, binned)(benchmark::State& state) {
+    froxelize(state, true);
+}
+
+BENCHMARK_REGISTER_F(FroxelizerFixture, bitset)->RangeMultiplier(2)->Range(256, 16384);
+BENCHMARK_REGISTER_F(FroxelizerFixture, binned)->RangeMultiplier(2)->Range(256, 16384);
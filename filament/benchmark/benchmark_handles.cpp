@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "details/Engine.h"
+
+#include <private/backend/HandleAllocator.h>
+
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::backend;
+
+// Keeps a working set of live handles of the 3 size classes, and replaces a random one at each
+// step, which is the worst case for the allocator since the free lists end up shuffled.
+class HandlesFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t STEP_COUNT = 16384;
+
+    // commands recorded between two flushes
+    static constexpr size_t BATCH_SIZE = 1024;
+
+    Engine* engine = nullptr;
+
+    template<size_t S>
+    struct Object {
+        uint8_t data[S];
+    };
+
+public:
+    void SetUp(benchmark::State& state) override {
+        engine = Engine::create(Engine::Backend::NOOP);
+    }
+
+    void TearDown(benchmark::State& state) override {
+        Engine::destroy(&engine);
+    }
+};
+
+BENCHMARK_DEFINE_F(HandlesFixture, allocator)(benchmark::State& state) {
+    const size_t liveCount = size_t(state.range(0));
+    HandleAllocatorGL allocator("benchmark", 1024 * 1024);
+    std::vector<Handle<Object<16>>> handles0(liveCount);
+    std::vector<Handle<Object<64>>> handles1(liveCount);
+    std::vector<Handle<Object<208>>> handles2(liveCount);
+    for (size_t i = 0; i < liveCount; i++) {
+        handles0[i] = allocator.allocate<Object<16>>();
+        handles1[i] = allocator.allocate<Object<64>>();
+        handles2[i] = allocator.allocate<Object<208>>();
+    }
+
+    std::default_random_engine generator(82828); // NOLINT
+    std::vector<uint32_t> indices(STEP_COUNT);
+    for (auto& index : indices) {
+        index = uint32_t(generator() % liveCount);
+    }
+
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            for (size_t i = 0; i < STEP_COUNT; i++) {
+                const uint32_t index = indices[i];
+                switch (i % 3) {
+                    case 0:
+                        allocator.deallocate(handles0[index]);
+                        handles0[index] = allocator.allocate<Object<16>>();
+                        break;
+                    case 1:
+                        allocator.deallocate(handles1[index]);
+                        handles1[index] = allocator.allocate<Object<64>>();
+                        break;
+                    default:
+                        allocator.deallocate(handles2[index]);
+                        handles2[index] = allocator.allocate<Object<208>>();
+                        break;
+                }
+            }
+            benchmark::ClobberMemory();
+        }
+        pc.stop();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * STEP_COUNT));
+
+    const auto stats = allocator.getStats();
+    state.counters["KiB"] = double(stats.bytes) / 1024.0;
+    state.counters["capacity"] = double(stats.pools[0].capacity);
+
+    for (size_t i = 0; i < liveCount; i++) {
+        allocator.deallocate(handles0[i]);
+        allocator.deallocate(handles1[i]);
+        allocator.deallocate(handles2[i]);
+    }
+}
+
+BENCHMARK_DEFINE_F(HandlesFixture, noopDriver)(benchmark::State& state) {
+    FEngine& fengine = upcast(*engine);
+    DriverApi& driver = fengine.getDriverApi();
+    const size_t liveCount = size_t(state.range(0));
+    std::vector<UniformBufferHandle> uniformBuffers(liveCount);
+    std::vector<RenderPrimitiveHandle> renderPrimitives(liveCount);
+    std::vector<VertexBufferHandle> vertexBuffers(liveCount);
+    for (size_t i = 0; i < liveCount; i++) {
+        uniformBuffers[i] = driver.createUniformBuffer(64, BufferUsage::DYNAMIC);
+        renderPrimitives[i] = driver.createRenderPrimitive();
+        vertexBuffers[i] = driver.createVertexBuffer(1, 1, 4, {}, BufferUsage::STATIC);
+    }
+    fengine.flush();
+
+    std::default_random_engine generator(82828); // NOLINT
+    std::vector<uint32_t> indices(STEP_COUNT);
+    for (auto& index : indices) {
+        index = uint32_t(generator() % liveCount);
+    }
+
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            for (size_t i = 0; i < STEP_COUNT; i++) {
+                const uint32_t index = indices[i];
+                switch (i % 3) {
+                    case 0:
+                        driver.destroyUniformBuffer(uniformBuffers[index]);
+                        uniformBuffers[index] = driver.createUniformBuffer(64, BufferUsage::DYNAMIC);
+                        break;
+                    case 1:
+                        driver.destroyRenderPrimitive(renderPrimitives[index]);
+                        renderPrimitives[index] = driver.createRenderPrimitive();
+                        break;
+                    default:
+                        driver.destroyVertexBuffer(vertexBuffers[index]);
+                        vertexBuffers[index] = driver.createVertexBuffer(
+                                1, 1, 4, {}, BufferUsage::STATIC);
+                        break;
+                }
+                if ((i % BATCH_SIZE) == BATCH_SIZE - 1) {
+                    fengine.flush();
+                }
+            }
+            fengine.flush();
+        }
+        pc.stop();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * STEP_COUNT));
+
+    for (size_t i = 0; i < liveCount; i++) {
+        driver.destroyUniformBuffer(uniformBuffers[i]);
+        driver.destroyRenderPrimitive(renderPrimitives[i]);
+        driver.destroyVertexBuffer(vertexBuffers[i]);
+    }
+    fengine.flush();
+}
+
+BENCHMARK_REGISTER_F(HandlesFixture, allocator)->RangeMultiplier(8)->Range(64, 32768);
+BENCHMARK_REGISTER_F(HandlesFixture, noopDriver)->RangeMultiplier(8)->Range(64, 32768);
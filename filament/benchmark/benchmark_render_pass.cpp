@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "RenderPass.h"
+
+#include <utils/JobSystem.h>
+
+#include <vector>
+#include <random>
+
+using namespace filament;
+using namespace utils;
+
+using Command = RenderPass::Command;
+
+class RenderPassFixture : public benchmark::Fixture {
+protected:
+    static constexpr size_t MAX_COMMAND_COUNT = 64 * 1024;
+
+    std::vector<Command> reference;
+    std::vector<Command> commands;
+    std::vector<Command> scratch;
+
+public:
+    RenderPassFixture() {
+        std::default_random_engine gen; // NOLINT
+        std::uniform_int_distribution<uint32_t> material(0, 63);
+        std::uniform_int_distribution<uint32_t> instance(0, 255);
+        std::uniform_int_distribution<uint32_t> zbucket(0, 1023);
+        std::uniform_int_distribution<uint32_t> priority(0, 7);
+
+        // generates keys that look like a typical color pass
+        reference.resize(MAX_COMMAND_COUNT);
+        for (Command& cmd : reference) {
+            cmd.key = uint64_t(RenderPass::Pass::COLOR);
+            cmd.key |= uint64_t(RenderPass::CustomCommand::PASS);
+            cmd.key |= RenderPass::makeField(priority(gen),
+                    RenderPass::PRIORITY_MASK, RenderPass::PRIORITY_SHIFT);
+            cmd.key |= RenderPass::makeField(zbucket(gen),
+                    RenderPass::Z_BUCKET_MASK, RenderPass::Z_BUCKET_SHIFT);
+            cmd.key |= RenderPass::makeMaterialSortingKey(material(gen), instance(gen));
+        }
+        commands.resize(MAX_COMMAND_COUNT);
+        scratch.resize(MAX_COMMAND_COUNT);
+    }
+};
+
+BENCHMARK_DEFINE_F(RenderPassFixture, stdSort)(benchmark::State& state) {
+    const size_t count = state.range(0);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            state.PauseTiming();
+            std::copy_n(reference.begin(), count, commands.begin());
+            state.ResumeTiming();
+            RenderPass::Test::sortCommands(commands.data(), commands.data() + count);
+            benchmark::ClobberMemory();
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+}
+
+BENCHMARK_DEFINE_F(RenderPassFixture, radixSort)(benchmark::State& state) {
+    const size_t count = state.range(0);
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            state.PauseTiming();
+            std::copy_n(reference.begin(), count, commands.begin());
+            state.ResumeTiming();
+            RenderPass::Test::radixSortCommands(commands.data(), commands.data() + count,
+                    scratch.data());
+            benchmark::ClobberMemory();
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+}
+
+BENCHMARK_DEFINE_F(RenderPassFixture, parallelSort)(benchmark::State& state) {
+    const size_t count = state.range(0);
+    JobSystem js;
+    js.adopt();
+    {
+        PerformanceCounters pc(state);
+        for (auto _ : state) {
+            state.PauseTiming();
+            std::copy_n(reference.begin(), count, commands.begin());
+            state.ResumeTiming();
+            RenderPass::Test::parallelSortCommands(js,
+                    commands.data(), commands.data() + count, scratch.data());
+            benchmark::ClobberMemory();
+        }
+        pc.stop();
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+    js.emancipate();
+}
+
+BENCHMARK_REGISTER_F(RenderPassFixture, stdSort)->Range(256, 64 * 1024);
+BENCHMARK_REGISTER_F(RenderPassFixture, radixSort)->Range(256, 64 * 1024);
+BENCHMARK_REGISTER_F(RenderPassFixture, parallelSort)->Range(256, 64 * 1024);
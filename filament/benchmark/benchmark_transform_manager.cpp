@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PerformanceCounters.h"
+
+#include <benchmark/benchmark.h>
+
+#include "components/TransformManager.h"
+
+#include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
+
+#include <math/mat4.h>
+
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+using namespace utils;
+
+class TransformManagerFixture : public benchmark::Fixture {
+protected:
+    // number of roots of the deep hierarchy, i.e. number of nodes per level
+    static constexpr size_t DEEP_WIDTH = 1024;
+
+    std::vector<Entity> entities;
+
+    // flat: a single root with all the other nodes as children
+    // deep: DEEP_WIDTH chains of nodes
+    void createHierarchy(FTransformManager& tcm, size_t count, bool deep) {
+        entities.resize(count);
+        EntityManager::get().create(count, entities.data());
+        for (size_t i = 0; i < count; i++) {
+            TransformManager::Instance parent{};
+            if (deep) {
+                parent = i < DEEP_WIDTH ? parent : tcm.getInstance(entities[i - DEEP_WIDTH]);
+            } else {
+                parent = i == 0 ? parent : tcm.getInstance(entities[0]);
+            }
+            tcm.create(entities[i], parent, mat4f::translation(float3{ 1, 0, 0 }));
+        }
+    }
+
+    void commit(benchmark::State& state, bool deep, bool parallel) {
+        const size_t count = size_t(state.range(0));
+        JobSystem js;
+        js.adopt();
+        {
+            FTransformManager tcm;
+            tcm.setJobSystem(&js);
+            tcm.setParallelCommitEnabled(parallel);
+            createHierarchy(tcm, count, deep);
+            PerformanceCounters pc(state);
+            for (auto _ : state) {
+                state.PauseTiming();
+                tcm.openLocalTransformTransaction();
+                for (Entity e : entities) {
+                    tcm.setTransform(tcm.getInstance(e), mat4f::translation(float3{ 0, 1, 0 }));
+                }
+                state.ResumeTiming();
+                tcm.commitLocalTransformTransaction();
+                benchmark::ClobberMemory();
+            }
+            pc.stop();
+            state.SetItemsProcessed(int64_t(state.iterations() * count));
+        }
+        EntityManager::get().destroy(entities.size(), entities.data());
+        js.emancipate();
+    }
+};
+
+BENCHMARK_DEFINE_F(TransformManagerFixture, flatCommit)(benchmark::State& state) {
+    commit(state, false, false);
+}
+
+BENCHMARK_DEFINE_F(TransformManagerFixture, flatParallelCommit)(benchmark::State& state) {
+    commit(state, false, true);
+}
+
+BENCHMARK_DEFINE_F(TransformManagerFixture, deepCommit)(benchmark::State& state) {
+    commit(state, true, false);
+}
+
+BENCHMARK_DEFINE_F(TransformManagerFixture, deepParallelCommit)(benchmark::State& state) {
+    commit(state, true, true);
+}
+
+BENCHMARK_REGISTER_F(TransformManagerFixture, flatCommit)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK_REGISTER_F(TransformManagerFixture, flatParallelCommit)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK_REGISTER_F(TransformManagerFixture, deepCommit)->RangeMultiplier(10)->Range(1000, 100000);
+BENCHMARK_REGISTER_F(TransformManagerFixture, deepParallelCommit)->RangeMultiplier(10)->Range(1000, 100000);
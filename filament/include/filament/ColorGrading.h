@@ -60,6 +60,11 @@ class FColorGrading;
  * 3D LUT may need to be generated. The generation of a 3D LUT, if necessary, may happen on
  * the CPU.
  *
+ * The intermediate results of the last 3D LUT generated are cached, so that creating a new
+ * ColorGrading object that only differs in the last stages of the pipeline (see below, e.g.
+ * contrast or curves) is cheaper. The LUT can also be generated asynchronously, see
+ * Builder::asynchronous().
+ *
  * Ordering
  * ========
  *
@@ -332,6 +337,20 @@ public:
          */
         Builder& curves(math::float3 shadowGamma, math::float3 midPoint, math::float3 highlightScale) noexcept;
 
+        /**
+         * Generates the 3D LUT in the background, false by default.
+         *
+         * When enabled, build() returns immediately and the ColorGrading object uses the last
+         * LUT generated with the same quality level until the new one is ready, which makes
+         * interactive edits smoother. The new LUT is used as soon as it's ready, typically a
+         * frame or two later. If there is no such LUT, the LUT is generated synchronously.
+         *
+         * @param enabled True to generate the LUT asynchronously
+         *
+         * @return This Builder, for chaining calls
+         */
+        Builder& asynchronous(bool enabled) noexcept;
+
         /**
          * Creates the ColorGrading object and returns a pointer to it.
          *
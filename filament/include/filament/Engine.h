@@ -487,6 +487,24 @@ public:
      */
     utils::JobSystem& getJobSystem() noexcept;
 
+    /**
+     * Sets the maximum amount of memory used to keep render targets and intermediate textures
+     * between frames, so they can be reused instead of being reallocated. The least recently
+     * used textures are freed first when the cache is over capacity. The default is 64 MiB.
+     *
+     * Applications using dynamic resolution, or rendering several views of different sizes,
+     * can benefit from a larger capacity.
+     *
+     * @param capacity Capacity of the cache in bytes.
+     */
+    void setResourceCacheCapacity(size_t capacity) noexcept;
+
+    /**
+     * Returns the maximum amount of memory used to keep render targets and intermediate
+     * textures between frames, in bytes.
+     */
+    size_t getResourceCacheCapacity() const noexcept;
+
     DebugRegistry& getDebugRegistry() noexcept;
 
 protected:
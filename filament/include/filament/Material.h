@@ -61,6 +61,7 @@ public:
     using CullingMode = filament::backend::CullingMode;
     using ShaderModel = filament::backend::ShaderModel;
     using SubpassType = filament::backend::SubpassType;
+    using ParameterHandle = MaterialInstance::ParameterHandle;
 
     /**
      * Holds information about a material parameter.
@@ -178,6 +179,9 @@ public:
     //! This values only makes sense when the shading mode is unlit.
     bool hasShadowMultiplier() const noexcept;
 
+    //! Indicates whether this material can be used by instanced renderables.
+    bool isInstanced() const noexcept;
+
     //! Indicates whether this material has specular anti-aliasing enabled
     bool hasSpecularAntiAliasing() const noexcept;
 
@@ -219,6 +223,19 @@ public:
     //! Indicates whether an existing parameter is a sampler or not.
     bool isSampler(const char* name) const noexcept;
 
+    /**
+     * Resolves a parameter of this material ahead of time. The handle can then be used with
+     * MaterialInstance::setParameter() on any instance of this material to set the parameter
+     * without looking its name up. This is useful for parameters updated every frame.
+     *
+     * @param name The name of the material parameter
+     *
+     * @return A handle to the parameter, or an invalid handle if the parameter doesn't exist.
+     *
+     * @see MaterialInstance::ParameterHandle::isValid()
+     */
+    ParameterHandle getParameterHandle(const char* name) const noexcept;
+
     /**
      * Sets the value of the given parameter on this material's default instance.
      *
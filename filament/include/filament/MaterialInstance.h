@@ -28,6 +28,8 @@
 
 namespace filament {
 
+class FMaterial;
+class FMaterialInstance;
 class Material;
 class Texture;
 class TextureSampler;
@@ -60,6 +62,31 @@ public:
             std::is_same<math::mat4f, T>::value
     >::type;
 
+    /**
+     * A material parameter resolved ahead of time by Material::getParameterHandle(), so that
+     * setting it doesn't need to look its name up. A handle can only be used with instances of
+     * the Material that created it.
+     */
+    class ParameterHandle {
+    public:
+        ParameterHandle() noexcept = default;
+
+        //! Whether this handle refers to a parameter of its material.
+        bool isValid() const noexcept { return mMaterial != nullptr; }
+
+        //! Whether this handle refers to a sampler (texture) parameter.
+        bool isSampler() const noexcept { return mIsSampler; }
+
+    private:
+        friend class FMaterial;
+        friend class FMaterialInstance;
+        FMaterial const* mMaterial = nullptr;
+        uint32_t mOffset = 0;       // offset in bytes in the uniform buffer, or sampler index
+        uint32_t mCount = 0;        // number of elements of the uniform array
+        backend::UniformType mType = backend::UniformType::FLOAT;
+        bool mIsSampler = false;
+    };
+
     /**
      * @return the Material associated with this instance
      */
@@ -124,6 +151,57 @@ public:
      */
     void setParameter(const char* name, RgbaType type, math::float4 color) noexcept;
 
+    /**
+     * Set a uniform from a pre-resolved handle, this is faster than setting it by name.
+     *
+     * @param handle    Handle of the parameter returned by Material::getParameterHandle().
+     * @param value     Value of the parameter to set.
+     * @throws utils::PreConditionPanic if the handle isn't a valid uniform of this instance's
+     *         material or no-op if exceptions are disabled.
+     */
+    template<typename T, typename = is_supported_parameter_t<T>>
+    void setParameter(ParameterHandle handle, T value) noexcept;
+
+    /**
+     * Set a uniform array from a pre-resolved handle, this is faster than setting it by name.
+     *
+     * @param handle    Handle of the parameter returned by Material::getParameterHandle().
+     * @param values    Array of values to set to the parameter array.
+     * @param count     Size of the array to set.
+     * @throws utils::PreConditionPanic if the handle isn't a valid uniform of this instance's
+     *         material or no-op if exceptions are disabled.
+     */
+    template<typename T, typename = is_supported_parameter_t<T>>
+    void setParameter(ParameterHandle handle, const T* values, size_t count) noexcept;
+
+    /**
+     * Set a texture from a pre-resolved handle, this is faster than setting it by name.
+     *
+     * @param handle    Handle of the parameter returned by Material::getParameterHandle().
+     * @param texture   Non nullptr Texture object pointer.
+     * @param sampler   Sampler parameters.
+     * @throws utils::PreConditionPanic if the handle isn't a valid sampler of this instance's
+     *         material or no-op if exceptions are disabled.
+     */
+    void setParameter(ParameterHandle handle,
+            Texture const* texture, TextureSampler const& sampler) noexcept;
+
+    /**
+     * Sets the same parameter on several instances of a material, each with its own value.
+     * This is equivalent to calling setParameter(handle, values[i]) on each instance, but
+     * avoids a function call per instance.
+     *
+     * @param instances Array of \p count instances of the material that created \p handle.
+     * @param handle    Handle of the parameter returned by Material::getParameterHandle().
+     * @param values    Array of \p count values, one per instance.
+     * @param count     Number of instances to update.
+     * @throws utils::PreConditionPanic if the handle isn't a valid uniform of an instance's
+     *         material, in which case that instance is skipped if exceptions are disabled.
+     */
+    template<typename T, typename = is_supported_parameter_t<T>>
+    static void setParameters(MaterialInstance* const* instances, ParameterHandle handle,
+            const T* values, size_t count) noexcept;
+
     /**
      * Set up a custom scissor rectangle; by default this encompasses the View.
      *
@@ -175,6 +175,17 @@ public:
          */
         Builder& boundingBox(const Box& axisAlignedBoundingBox) noexcept;
 
+        /**
+         * An object-space box used as an occluder by the CPU occlusion culling, empty by default.
+         *
+         * The box must be entirely contained in the opaque geometry of the renderable, for
+         * instance the inside of a wall or of a building, because any renderable behind it is
+         * considered hidden. Renderables with an empty occluder box don't occlude anything.
+         *
+         * \see View::setOcclusionCullingEnabled()
+         */
+        Builder& occluder(const Box& occluder) noexcept;
+
         /**
          * Sets bits in a visibility mask. By default, this is 0x1.
          *
@@ -267,6 +278,26 @@ public:
          */
         Builder& morphing(bool enable) noexcept;
 
+        /**
+         * Draws this renderable several times with a single instanced draw call, 0 by default.
+         *
+         * Each instance has its own model transform, which is applied after the transform of
+         * the entity's TransformManager component. The bounding box given by boundingBox() is the
+         * bounding box of a single instance; unless the renderable casts shadows, instances are
+         * culled individually against the viewing camera, and only the visible ones are drawn.
+         *
+         * All the materials of this renderable must be instanced, see
+         * MaterialBuilder::instanced(). Instanced renderables can't use skinning or morphing.
+         *
+         * See also RenderableManager::setInstanceTransforms(), which can be called on a per-frame
+         * basis to move the instances.
+         *
+         * @param instanceCount 0 to disable, otherwise the number of instances
+         * @param transforms the initial set of transforms (one for each instance), identity
+         *                   if nullptr
+         */
+        Builder& instances(size_t instanceCount, math::mat4f const* transforms = nullptr) noexcept;
+
         /**
          * Sets an ordering index for blended primitives that all live at the same Z value.
          *
@@ -325,6 +356,14 @@ public:
      */
     void setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept;
 
+    /**
+     * Changes the box used as an occluder by the CPU occlusion culling.
+     *
+     * \see Builder::occluder()
+     * \see RenderableManager::getOccluder()
+     */
+    void setOccluder(Instance instance, const Box& occluder) noexcept;
+
     /**
      * Changes the visibility bits.
      *
@@ -390,6 +429,29 @@ public:
     void setBones(Instance instance, Bone const* transforms, size_t boneCount = 1, size_t offset = 0) noexcept;
     void setBones(Instance instance, math::mat4f const* transforms, size_t boneCount = 1, size_t offset = 0) noexcept; //!< \overload
 
+    /**
+     * Updates the bones of several renderables at once, which is cheaper than calling setBones()
+     * for each of them. The transforms of all the renderables are stored back to back: the first
+     * \p boneCounts[0] transforms are the bones of \p instances[0] starting at its first bone,
+     * the next \p boneCounts[1] those of \p instances[1], and so on. Null instances are skipped,
+     * but their transforms must still be present.
+     */
+    void setBones(Instance const* instances, size_t const* boneCounts, size_t count,
+            math::mat4f const* transforms) noexcept;
+
+    /**
+     * Updates the instance transforms in the range [offset, offset + count).
+     * The instances must be pre-allocated using Builder::instances().
+     */
+    void setInstanceTransforms(Instance instance, math::mat4f const* transforms,
+            size_t count = 1, size_t offset = 0) noexcept;
+
+    /**
+     * Returns the number of instances of this renderable, 0 unless it was built with
+     * Builder::instances().
+     */
+    size_t getInstanceCount(Instance instance) const noexcept;
+
     /**
      * Updates the vertex morphing weights on a renderable, all zeroes by default.
      *
@@ -408,6 +470,14 @@ public:
      */
     const Box& getAxisAlignedBoundingBox(Instance instance) const noexcept;
 
+    /**
+     * Gets the box used as an occluder by the CPU occlusion culling.
+     *
+     * \see Builder::occluder()
+     * \see RenderableManager::setOccluder()
+     */
+    const Box& getOccluder(Instance instance) const noexcept;
+
     /**
      * Get the visibility bits.
      *
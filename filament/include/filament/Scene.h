@@ -156,6 +156,32 @@ public:
      * @return Whether the given entity is in the Scene.
      */
     bool hasEntity(utils::Entity entity) const noexcept;
+
+    /**
+     * Enables or disables hierarchical culling of the Scene's renderables.
+     *
+     * When enabled, a bounding volume hierarchy is maintained over the world-space bounding
+     * boxes of the renderables, which allows culling whole groups of renderables at once for the
+     * camera and each shadow-casting light. This greatly reduces the cost of culling scenes with
+     * many mostly static renderables. The hierarchy is rebuilt when renderables are added to
+     * or removed from the Scene, and updated when they move.
+     *
+     * Culling results are the same whether hierarchical culling is enabled or not, except
+     * possibly for renderables whose bounding box touches the edge of a frustum, which can be
+     * classified differently due to rounding.
+     *
+     * Disabled by default.
+     *
+     * @param enabled true to enable hierarchical culling, false to disable it.
+     */
+    void setHierarchicalCullingEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns whether hierarchical culling is enabled.
+     *
+     * @return true if hierarchical culling is enabled, false otherwise.
+     */
+    bool isHierarchicalCullingEnabled() const noexcept;
 };
 
 } // namespace filament
@@ -244,9 +244,31 @@ public:
      *
      * @note If the local transform transaction is not open, this is a no-op.
      *
-     * @see openLocalTransformTransaction(), setTransform()
+     * @see openLocalTransformTransaction(), setTransform(), setParallelCommitEnabled()
      */
     void commitLocalTransformTransaction() noexcept;
+
+    /**
+     * Enables or disables the parallel computation of world transforms in
+     * commitLocalTransformTransaction(). When enabled, the hierarchy is processed one level at
+     * a time, and the transforms of large levels are computed in parallel using the Engine's
+     * JobSystem. This is beneficial with many thousands of transforms. Disabled by default.
+     *
+     * @param enabled true to enable parallel commits, false otherwise.
+     *
+     * @attention When enabled, commitLocalTransformTransaction() must be called from the
+     *            Engine's main thread.
+     *
+     * @see commitLocalTransformTransaction()
+     */
+    void setParallelCommitEnabled(bool enabled) noexcept;
+
+    /**
+     * Returns whether parallel commits are enabled.
+     *
+     * @see setParallelCommitEnabled()
+     */
+    bool isParallelCommitEnabled() const noexcept;
 };
 
 } // namespace filament
@@ -295,6 +295,16 @@ public:
         uint8_t anisotropy = 0;
     };
 
+    /**
+     * Statistics of the CPU occlusion culling for the last frame.
+     * @see setOcclusionCullingEnabled()
+     */
+    struct OcclusionCullingStats {
+        uint32_t occluderCount = 0;     //!< number of occluders rasterized
+        uint32_t testedCount = 0;       //!< number of renderables tested for occlusion
+        uint32_t culledCount = 0;       //!< number of renderables found occluded
+    };
+
     /**
      * Sets the View's name. Only useful for debugging.
      * @param name Pointer to the View's name. The string is copied.
@@ -487,6 +497,79 @@ public:
      */
     bool isScreenSpaceRefractionEnabled() const noexcept;
 
+    /**
+     * Enables or disables the caching of the sorted rendering commands across frames.
+     * Disabled by default.
+     *
+     * When enabled, the commands of the depth and color passes are kept from one frame to the
+     * next, and only the commands of the renderables that changed (e.g. moved, or had their
+     * material instance or visibility changed) are regenerated. This reduces CPU usage
+     * significantly for mostly static scenes viewed by a still or slow moving camera, at the
+     * cost of keeping a copy of the commands in memory.
+     *
+     * @param enabled true enables command caching, false disables it and frees the cache.
+     */
+    void setCommandCachingEnabled(bool enabled) noexcept;
+
+    /**
+     * @return whether command caching is enabled
+     */
+    bool isCommandCachingEnabled() const noexcept;
+
+    /**
+     * Enables or disables shadow caching. Disabled by default.
+     *
+     * When enabled, the shadow maps are kept from one frame to the next, and a shadow map (or a
+     * cascade of the directional light) is only rendered again when its light or the shadow
+     * casters inside its frustum changed (e.g. moved, or had their geometry or material instance
+     * replaced). With a static light, this removes most of the cost of the shadow passes for
+     * mostly static scenes, at the cost of keeping the shadow texture in memory. Note that the
+     * cascades of the directional light follow the camera, they're only cached while the camera
+     * is still.
+     *
+     * Skinned and instanced renderables are considered changed every frame, and so are the
+     * casters whose material instances had their parameters changed. Changes to the content of
+     * vertex or index buffers, or of textures, are not detected; disabling shadow caching forces
+     * all the shadow maps to be rendered again.
+     *
+     * @param enabled true enables shadow caching, false disables it.
+     */
+    void setShadowCachingEnabled(bool enabled) noexcept;
+
+    /**
+     * @return whether shadow caching is enabled
+     */
+    bool isShadowCachingEnabled() const noexcept;
+
+    /**
+     * Enables or disables CPU occlusion culling. Disabled by default.
+     *
+     * When enabled, the occluder boxes of the renderables that pass frustum culling are
+     * rasterized into a small depth buffer, and the renderables hidden behind them are not
+     * rendered. Only renderables with an occluder can hide other renderables, see
+     * RenderableManager::Builder::occluder(). Shadow casters are not affected.
+     *
+     * This is useful for dense scenes, such as cities or interiors, where many renderables are
+     * entirely hidden. Occlusion culling has no effect when frustum culling is disabled.
+     *
+     * @param enabled true enables occlusion culling, false disables it.
+     *
+     * @see getOcclusionCullingStats()
+     */
+    void setOcclusionCullingEnabled(bool enabled) noexcept;
+
+    /**
+     * @return whether occlusion culling is enabled
+     */
+    bool isOcclusionCullingEnabled() const noexcept;
+
+    /**
+     * Returns the occlusion culling statistics of the last frame rendered with this View.
+     *
+     * @return OcclusionCullingStats, all counts are zero if occlusion culling is disabled.
+     */
+    OcclusionCullingStats getOcclusionCullingStats() const noexcept;
+
     /**
      * Sets how many samples are to be used for MSAA in the post-process stage.
      * Default is 1 and disables MSAA.
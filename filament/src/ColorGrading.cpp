@@ -30,9 +30,14 @@
 #include <math/vec4.h>
 
 #include <utils/JobSystem.h>
+#include <utils/Mutex.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 #include <math.h>
 
@@ -73,6 +78,8 @@ struct ColorGrading::BuilderDetails {
     float3 shadowGamma      = {1.0f};
     float3 midPoint         = {1.0f};
     float3 highlightScale   = {1.0f};
+    // Not a color grading parameter
+    bool asynchronous       = false;
     // Keep last
     bool hasAdjustments     = false;
 
@@ -81,7 +88,7 @@ struct ColorGrading::BuilderDetails {
     }
 
     bool operator==(const BuilderDetails &rhs) const {
-        // Note: Do NOT compare hasAdjustments
+        // Note: Do NOT compare hasAdjustments and asynchronous
         return quality == rhs.quality &&
                toneMapping == rhs.toneMapping &&
                whiteBalance == rhs.whiteBalance &&
@@ -184,6 +191,11 @@ ColorGrading::Builder& ColorGrading::Builder::curves(
     return *this;
 }
 
+ColorGrading::Builder& ColorGrading::Builder::asynchronous(bool enabled) noexcept {
+    mImpl->asynchronous = enabled;
+    return *this;
+}
+
 ColorGrading* ColorGrading::Builder::build(Engine& engine) {
     // We want to see if any of the default adjustment values have been modified
     // We skip the tonemapping operator on purpose since we always want to apply it
@@ -217,14 +229,6 @@ inline float3 adaptationTransform(float2 whiteBalance) {
     return ILLUMINANT_D65_LMS / lms;
 }
 
-UTILS_ALWAYS_INLINE
-inline float3 chromaticAdaptation(float3 v, float2 whiteBalance) {
-    v = sRGB_to_LMS * v;
-    v = adaptationTransform(whiteBalance) * v;
-    v = LMS_to_sRGB * v;
-    return v;
-}
-
 //------------------------------------------------------------------------------
 // General color grading
 //------------------------------------------------------------------------------
@@ -430,6 +434,7 @@ ColorTransform selectToneMapping(ColorGrading::ToneMapping toneMapping) {
 struct Config {
     mat3f colorGradingTransformIn;
     mat3f colorGradingTransformOut;
+    mat3f inputTransform;           // white balance followed by colorGradingTransformIn
     float3 lumaTransform;
     ColorTransform linearToLogTransform;
     ColorTransform logToLinearTransform;
@@ -437,108 +442,210 @@ struct Config {
     size_t lutDimension;
 };
 
-// Inside the FColorGrading constructor, TSAN sporadically detects a data race on the config struct;
-// the Filament thread writes and the Job thread reads. In practice there should be no data race, so
-// we force TSAN off to silence the warning.
-UTILS_NO_SANITIZE_THREAD
-FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
-    SYSTRACE_CALL();
+// The LUT is generated in three stages, each stage only needs to be recomputed when its
+// parameters, or the parameters of a previous stage, change:
+// - input:   LogC decoding, white balance, channel mixer, tonal ranges
+// - grading: CDL, contrast, vibrance, saturation, curves
+// - output:  tone mapping, output color space and OECF, which only depend on the tone mapping
+//            operator, part of the input stage parameters
 
-    DriverApi& driver = engine.getDriverApi();
+struct InputStage {
+    size_t lutDimension;
+    ColorGrading::ToneMapping toneMapping;
+    bool hasAdjustments;
+    float2 whiteBalance;
+    float3 outRed;
+    float3 outGreen;
+    float3 outBlue;
+    float3 shadows;
+    float3 midtones;
+    float3 highlights;
+    float4 tonalRanges;
+
+    bool operator==(InputStage const& rhs) const noexcept {
+        return lutDimension == rhs.lutDimension &&
+               toneMapping == rhs.toneMapping &&
+               hasAdjustments == rhs.hasAdjustments &&
+               whiteBalance == rhs.whiteBalance &&
+               outRed == rhs.outRed &&
+               outGreen == rhs.outGreen &&
+               outBlue == rhs.outBlue &&
+               shadows == rhs.shadows &&
+               midtones == rhs.midtones &&
+               highlights == rhs.highlights &&
+               tonalRanges == rhs.tonalRanges;
+    }
+};
 
-    Config config{
-        .colorGradingTransformIn  = selectColorGradingTransformIn(builder->toneMapping),
-        .colorGradingTransformOut = selectColorGradingTransformOut(builder->toneMapping),
-        .lumaTransform            = selectLumaTransform(builder->toneMapping),
-        .linearToLogTransform     = selectLinearToLogTransform(builder->toneMapping),
-        .logToLinearTransform     = selectLogToLinearTransform(builder->toneMapping),
-        .toneMapper               = selectToneMapping(builder->toneMapping),
-        .lutDimension             = selectLutDimension(builder->quality)
+struct GradingStage {
+    float3 slope;
+    float3 offset;
+    float3 power;
+    float contrast;
+    float vibrance;
+    float saturation;
+    float3 shadowGamma;
+    float3 midPoint;
+    float3 highlightScale;
+
+    bool operator==(GradingStage const& rhs) const noexcept {
+        return slope == rhs.slope &&
+               offset == rhs.offset &&
+               power == rhs.power &&
+               contrast == rhs.contrast &&
+               vibrance == rhs.vibrance &&
+               saturation == rhs.saturation &&
+               shadowGamma == rhs.shadowGamma &&
+               midPoint == rhs.midPoint &&
+               highlightScale == rhs.highlightScale;
+    }
+};
+
+class FColorGrading::LutCache {
+public:
+    ~LutCache() noexcept {
+        free(stages.output);
+        free(lut);
+    }
+
+    // results of the last LUT generated, a generation takes them for its whole duration
+    struct Stages {
+        bool valid = false;
+        InputStage input{};
+        GradingStage grading{};
+        std::vector<float3> linear;     // result of the input stage
+        std::vector<float3> graded;     // result of the grading stage
+        half4* output = nullptr;        // result of the output stage
+        size_t outputCount = 0;
     };
 
-    size_t lutElementCount = config.lutDimension * config.lutDimension * config.lutDimension;
-    size_t elementSize = sizeof(half4);
-    void* data = malloc(lutElementCount * elementSize);
+    // Only held to take or publish the results, never while generating a LUT: waiting for the
+    // generation jobs can run an asynchronous build on the same thread.
+    utils::Mutex lock;
+    Stages stages;
 
-    TextureFormat textureFormat;
-    PixelDataFormat format;
-    PixelDataType type;
-    selectLutTextureParams(builder->quality, textureFormat, format, type);
-     assert(FTexture::validatePixelFormatAndType(textureFormat, format, type));
+    // copy of the last LUT generated, used as a placeholder by asynchronous builds
+    size_t lutDimension = 0;
+    half4* lut = nullptr;
+};
 
-     void* converted = nullptr;
-    if (type == PixelDataType::UINT_2_10_10_10_REV) {
-        // convert input to UINT_2_10_10_10_REV if needed
-        converted = malloc(lutElementCount * sizeof(uint32_t));
-    }
+FColorGrading::LutCache* FColorGrading::createLutCache() {
+    return new LutCache;
+}
 
-    //auto now = std::chrono::steady_clock::now();
+void FColorGrading::destroyLutCache(LutCache* cache) noexcept {
+    delete cache;
+}
 
-    // Multithreadedly generate the tone mapping 3D look-up table using 32 jobs
-    // Slices are 8 KiB (128 cache lines) apart.
-    // This takes about 3-6ms on Android in Release
-    JobSystem& js = engine.getJobSystem();
-    auto *slices = js.createJob();
-    for (size_t b = 0; b < config.lutDimension; b++) {
-        auto *job = js.createJob(slices, [data, converted, b, &config, builder](JobSystem&, JobSystem::Job*) {
-            half4* UTILS_RESTRICT p = (half4*) data + b * config.lutDimension * config.lutDimension;
-            for (size_t g = 0; g < config.lutDimension; g++) {
-                for (size_t r = 0; r < config.lutDimension; r++) {
-                    float3 v = float3{ r, g, b } * (1.0f / float(config.lutDimension - 1u));
-
-                    // LogC encoding
-                    v = LogC_to_linear(v);
-
-                    // TODO: Performed in sRGB, should be in Rec.2020 or AP1
-                    if (builder->hasAdjustments) {
-                        // White balance
-                        v = chromaticAdaptation(v, builder->whiteBalance);
-                    }
+struct FColorGrading::AsyncBuild {
+    Config config;
+    InputStage input;
+    GradingStage grading;
+    LutCache* cache;
+    half4* lut;
+    std::atomic<bool> ready = { false };
+    std::atomic<bool> cancelled = { false };
+};
 
-                    // Convert to color grading color space
-                    v = config.colorGradingTransformIn * v;
+// Generates the LUT in lut (which must hold lutDimension^3 elements), only the stages whose
+// parameters differ from the ones of the cached results are recomputed.
+static void generateLut(JobSystem& js, FColorGrading::LutCache& cache, Config const& config,
+        InputStage const& input, GradingStage const& grading, half4* lut) {
+    SYSTRACE_CALL();
 
-                    if (builder->hasAdjustments) {
-                        // Kill negative values before the next transforms
-                        v = max(v, 0.0f);
+    // Take the cached results, a concurrent generation starts from scratch in the meantime.
+    FColorGrading::LutCache::Stages stages;
+    {
+        std::lock_guard<utils::Mutex> guard(cache.lock);
+        std::swap(stages, cache.stages);
+    }
+
+    const size_t dim = config.lutDimension;
+    const size_t sliceSize = dim * dim;
+    const size_t count = sliceSize * dim;
+
+    const bool computeInput = !stages.valid || !(stages.input == input);
+    const bool computeGrading = input.hasAdjustments && (computeInput || !(stages.grading == grading));
+    const bool computeOutput = computeInput || computeGrading;
+
+    if (computeOutput) {
+        stages.linear.resize(count);
+        stages.graded.resize(input.hasAdjustments ? count : 0);
+        if (stages.outputCount != count) {
+            free(stages.output);
+            stages.output = (half4*)malloc(count * sizeof(half4));
+            stages.outputCount = count;
+        }
+
+        auto work = [&](uint32_t start, uint32_t sliceCount) {
+            for (size_t b = start, e = start + sliceCount; b < e; b++) {
+                // without adjustments, the grading stage is skipped
+                float3* const linear = stages.linear.data() + b * sliceSize;
+                float3* const graded = input.hasAdjustments ?
+                        stages.graded.data() + b * sliceSize : linear;
+                half4* const UTILS_RESTRICT output = stages.output + b * sliceSize;
+
+                if (computeInput) {
+                    // LogC encoding, white balance and conversion to the color grading color
+                    // space; this loop is written so that the compiler can vectorize it
+                    const float scale = 1.0f / float(dim - 1u);
+                    for (size_t g = 0; g < dim; g++) {
+                        for (size_t r = 0; r < dim; r++) {
+                            const float3 v = float3{ r, g, b } * scale;
+                            linear[g * dim + r] = config.inputTransform * LogC_to_linear(v);
+                        }
+                    }
+                    if (input.hasAdjustments) {
+                        for (size_t i = 0; i < sliceSize; i++) {
+                            // Kill negative values before the next transforms
+                            float3 v = max(linear[i], 0.0f);
 
-                        // Channel mixer
-                        v = channelMixer(v, builder->outRed, builder->outGreen, builder->outBlue);
+                            // Channel mixer
+                            v = channelMixer(v, input.outRed, input.outGreen, input.outBlue);
 
-                        // Shadows/mid-tones/highlights
-                        v = tonalRanges(v, config.lumaTransform,
-                                builder->shadows, builder->midtones, builder->highlights,
-                                builder->tonalRanges);
+                            // Shadows/mid-tones/highlights
+                            v = tonalRanges(v, config.lumaTransform,
+                                    input.shadows, input.midtones, input.highlights,
+                                    input.tonalRanges);
 
+                            linear[i] = v;
+                        }
+                    }
+                }
+
+                if (computeGrading) {
+                    for (size_t i = 0; i < sliceSize; i++) {
                         // The adjustments below behave better in log space using the ACEScct
                         // color space.
-                        v = config.linearToLogTransform(v);
+                        float3 v = config.linearToLogTransform(linear[i]);
 
                         // ASC CDL
-                        v = colorDecisionList(v, builder->slope, builder->offset, builder->power);
+                        v = colorDecisionList(v, grading.slope, grading.offset, grading.power);
 
                         // Contrast in log space
-                        v = contrast(v, builder->contrast);
+                        v = contrast(v, grading.contrast);
 
                         // Back to linear space
                         v = config.logToLinearTransform(v);
 
                         // Vibrance in linear space
-                        v = vibrance(v, builder->vibrance);
+                        v = vibrance(v, grading.vibrance);
 
                         // Saturation in linear space
-                        v = saturation(v, builder->saturation);
+                        v = saturation(v, grading.saturation);
 
                         // Kill negative values before tone mapping
                         v = max(v, 0.0f);
 
                         // RGB curves
-                        v = curves(v,
-                                builder->shadowGamma, builder->midPoint, builder->highlightScale);
+                        graded[i] = curves(v,
+                                grading.shadowGamma, grading.midPoint, grading.highlightScale);
                     }
+                }
 
+                for (size_t i = 0; i < sliceSize; i++) {
                     // Tone mapping
-                    v = config.toneMapper(v);
+                    float3 v = config.toneMapper(graded[i]);
 
                     // Convert to output color space
                     // TODO: allow to customize the output color space,
@@ -549,59 +656,196 @@ FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
                     // Apply OECF
                     v = OECF_sRGB(v);
 
-                    *p++ = half4{v, 0.0f};
+                    output[i] = half4{ v, 0.0f };
                 }
             }
+        };
 
-            if (converted) {
-                uint32_t* const UTILS_RESTRICT dst = (uint32_t*)converted + b * config.lutDimension * config.lutDimension;
-                half4* UTILS_RESTRICT src = (half4*) data + b * config.lutDimension * config.lutDimension;
-                // we use a vectorize width of 8 because, on ARMv8 it allows the compiler to write eight
-                // 32-bits results in one go.
-                const size_t count = (config.lutDimension * config.lutDimension) & ~0x7u; // tell the compiler that we're a multiple of 8
-                #pragma clang loop vectorize_width(8)
-                for (size_t i = 0; i < count; ++i) {
-                    float4 v{ src[i] };
-                    uint32_t r = uint32_t(floorf(v.x * 1023.0f + 0.5f));
-                    uint32_t g = uint32_t(floorf(v.y * 1023.0f + 0.5f));
-                    uint32_t b = uint32_t(floorf(v.z * 1023.0f + 0.5f));
-                    dst[i] = (b << 20u) | (g << 10u) | r;
-                }
+        // Multithreadedly generate the tone mapping 3D look-up table, by groups of blue slices.
+        // Slices are 8 KiB (128 cache lines) apart.
+        js.runAndWait(jobs::parallel_for(js, nullptr, 0, uint32_t(dim),
+                std::ref(work), jobs::CountSplitter<1, 8>()));
+
+        stages.input = input;
+        stages.grading = grading;
+        stages.valid = true;
+    }
+
+    std::copy_n(stages.output, count, lut);
+
+    // Publish the results, the last generation to finish wins.
+    {
+        std::lock_guard<utils::Mutex> guard(cache.lock);
+        if (computeOutput) {
+            if (cache.lutDimension != dim) {
+                free(cache.lut);
+                cache.lut = (half4*)malloc(count * sizeof(half4));
+                cache.lutDimension = dim;
             }
+            std::copy_n(stages.output, count, cache.lut);
+        }
+        std::swap(stages, cache.stages);
+    }
+
+    // results of a concurrent generation, if any
+    free(stages.output);
+}
+
+// Inside the FColorGrading constructor, TSAN sporadically detects a data race on the config struct;
+// the Filament thread writes and the Job thread reads. In practice there should be no data race, so
+// we force TSAN off to silence the warning.
+UTILS_NO_SANITIZE_THREAD
+FColorGrading::FColorGrading(FEngine& engine, const Builder& builder) {
+    SYSTRACE_CALL();
 
-        });
-        js.run(job);
+    DriverApi& driver = engine.getDriverApi();
+    JobSystem& js = engine.getJobSystem();
+    LutCache& cache = engine.getColorGradingLutCache();
+
+    // TODO: Performed in sRGB, should be in Rec.2020 or AP1
+    mat3f inputTransform = selectColorGradingTransformIn(builder->toneMapping);
+    if (builder->hasAdjustments) {
+        // White balance, the adaptation transform is the same for all the texels
+        const float3 adaptation = adaptationTransform(builder->whiteBalance);
+        inputTransform = inputTransform * (LMS_to_sRGB * mat3f{ adaptation } * sRGB_to_LMS);
     }
 
-    // TODO: Should we do a runAndRetain() and defer the wait() + texture creation until
-    //       getHwHandle() is invoked?
-    js.runAndWait(slices);
+    Config config{
+        .colorGradingTransformIn  = selectColorGradingTransformIn(builder->toneMapping),
+        .colorGradingTransformOut = selectColorGradingTransformOut(builder->toneMapping),
+        .inputTransform           = inputTransform,
+        .lumaTransform            = selectLumaTransform(builder->toneMapping),
+        .linearToLogTransform     = selectLinearToLogTransform(builder->toneMapping),
+        .logToLinearTransform     = selectLogToLinearTransform(builder->toneMapping),
+        .toneMapper               = selectToneMapping(builder->toneMapping),
+        .lutDimension             = selectLutDimension(builder->quality)
+    };
+
+    const InputStage input{
+        .lutDimension   = config.lutDimension,
+        .toneMapping    = builder->toneMapping,
+        .hasAdjustments = builder->hasAdjustments,
+        .whiteBalance   = builder->whiteBalance,
+        .outRed         = builder->outRed,
+        .outGreen       = builder->outGreen,
+        .outBlue        = builder->outBlue,
+        .shadows        = builder->shadows,
+        .midtones       = builder->midtones,
+        .highlights     = builder->highlights,
+        .tonalRanges    = builder->tonalRanges
+    };
+
+    const GradingStage grading{
+        .slope          = builder->slope,
+        .offset         = builder->offset,
+        .power          = builder->power,
+        .contrast       = builder->contrast,
+        .vibrance       = builder->vibrance,
+        .saturation     = builder->saturation,
+        .shadowGamma    = builder->shadowGamma,
+        .midPoint       = builder->midPoint,
+        .highlightScale = builder->highlightScale
+    };
+
+    TextureFormat textureFormat;
+    selectLutTextureParams(builder->quality, textureFormat, mFormat, mType);
+    assert(FTexture::validatePixelFormatAndType(textureFormat, mFormat, mType));
 
-    //std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - now;
-    //slog.d << "LUT generation time: " << duration.count() << " ms" << io::endl;
+    mLutDimension = config.lutDimension;
+    const size_t lutElementCount = mLutDimension * mLutDimension * mLutDimension;
+    half4* lut = (half4*)malloc(lutElementCount * sizeof(half4));
 
     mLutHandle = driver.createTexture(SamplerType::SAMPLER_3D, 1, textureFormat, 1,
-            config.lutDimension, config.lutDimension, config.lutDimension, TextureUsage::DEFAULT);
+            mLutDimension, mLutDimension, mLutDimension, TextureUsage::DEFAULT);
+
+    if (builder->asynchronous) {
+        // until the new LUT is ready, we use the last one generated if it has the same size,
+        // which is most likely the one the new LUT replaces.
+        bool hasPlaceholder = false;
+        {
+            std::lock_guard<utils::Mutex> guard(cache.lock);
+            if (cache.lutDimension == mLutDimension) {
+                std::copy_n(cache.lut, lutElementCount, lut);
+                hasPlaceholder = true;
+            }
+        }
+        if (hasPlaceholder) {
+            upload(driver, lut);
+            mAsyncBuild.reset(new AsyncBuild{ config, input, grading, &cache, lut });
+            mAsyncJob = js.runAndRetain(js.createJob(nullptr,
+                    [build = mAsyncBuild.get()](JobSystem& js, JobSystem::Job*) {
+                        if (!build->cancelled.load(std::memory_order_relaxed)) {
+                            generateLut(js, *build->cache, build->config,
+                                    build->input, build->grading, build->lut);
+                        }
+                        build->ready.store(true, std::memory_order_release);
+                    }));
+            return;
+        }
+    }
 
-    if (converted) {
-        free(data);
-        data = converted;
-        elementSize = sizeof(uint32_t);
+    // This takes about 3-6ms on Android in Release when the whole LUT is generated
+    generateLut(js, cache, config, input, grading, lut);
+    upload(driver, lut);
+    free(lut);
+}
+
+void FColorGrading::upload(DriverApi& driver, void const* lut) noexcept {
+    const size_t lutElementCount = mLutDimension * mLutDimension * mLutDimension;
+    void* data;
+    size_t size;
+    if (mType == PixelDataType::UINT_2_10_10_10_REV) {
+        // convert input to UINT_2_10_10_10_REV if needed
+        size = lutElementCount * sizeof(uint32_t);
+        data = malloc(size);
+        uint32_t* const UTILS_RESTRICT dst = (uint32_t*)data;
+        half4 const* const UTILS_RESTRICT src = (half4 const*)lut;
+        // we use a vectorize width of 8 because, on ARMv8 it allows the compiler to write eight
+        // 32-bits results in one go.
+        const size_t count = lutElementCount & ~0x7u; // tell the compiler that we're a multiple of 8
+        #pragma clang loop vectorize_width(8)
+        for (size_t i = 0; i < count; ++i) {
+            float4 v{ src[i] };
+            uint32_t r = uint32_t(floorf(v.x * 1023.0f + 0.5f));
+            uint32_t g = uint32_t(floorf(v.y * 1023.0f + 0.5f));
+            uint32_t b = uint32_t(floorf(v.z * 1023.0f + 0.5f));
+            dst[i] = (b << 20u) | (g << 10u) | r;
+        }
+    } else {
+        size = lutElementCount * sizeof(half4);
+        data = malloc(size);
+        memcpy(data, lut, size);
     }
 
     driver.update3DImage(mLutHandle, 0,
             0, 0, 0,
-            config.lutDimension, config.lutDimension, config.lutDimension,
+            mLutDimension, mLutDimension, mLutDimension,
             PixelBufferDescriptor{
-                    data, lutElementCount * elementSize,format, type,
+                    data, size, mFormat, mType,
                     [](void* buffer, size_t, void*) { free(buffer); }
             }
     );
 }
 
+void FColorGrading::commit(FEngine& engine) noexcept {
+    if (UTILS_UNLIKELY(mAsyncJob) && mAsyncBuild->ready.load(std::memory_order_acquire)) {
+        engine.getJobSystem().waitAndRelease(mAsyncJob);
+        upload(engine.getDriverApi(), mAsyncBuild->lut);
+        free(mAsyncBuild->lut);
+        mAsyncBuild.reset();
+    }
+}
+
 FColorGrading::~FColorGrading() noexcept = default;
 
 void FColorGrading::terminate(FEngine& engine) {
+    if (mAsyncJob) {
+        // skip the generation if it didn't start yet
+        mAsyncBuild->cancelled.store(true, std::memory_order_relaxed);
+        engine.getJobSystem().waitAndRelease(mAsyncJob);
+        free(mAsyncBuild->lut);
+        mAsyncBuild.reset();
+    }
     DriverApi& driver = engine.getDriverApi();
     driver.destroyTexture(mLutHandle);
 }
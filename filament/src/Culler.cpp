@@ -20,22 +20,39 @@
 
 #include <math/fast.h>
 
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#   define CULLER_HAS_SSE2 1
+#   include <emmintrin.h>
+#   if defined(__clang__) || defined(__GNUC__)
+#       define CULLER_HAS_AVX2 1
+#       include <immintrin.h>
+#   endif
+#endif
+
+#if defined(__ARM_NEON)
+#   define CULLER_HAS_NEON 1
+#   include <arm_neon.h>
+#endif
+
 using namespace filament::math;
 
 namespace filament {
 
-void Culler::intersects(
-        result_type* UTILS_RESTRICT results,
-        Frustum const& UTILS_RESTRICT frustum,
+// ------------------------------------------------------------------------------------------------
+// Scalar kernels
+// ------------------------------------------------------------------------------------------------
+
+static void intersectsSpheresScalar(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
         float4 const* UTILS_RESTRICT b,
         size_t count) noexcept {
 
-    float4 const * const UTILS_RESTRICT planes = frustum.mPlanes;
-
     // we use a vectorize width of 8 because, on ARMv8 it allow the compiler to write 8
     // 8-bits results in one go. Without this it has to do 4 separate byte writes, which
     // ends-up being slower.
-    count = round(count); // capacity guaranteed to be multiple of 8
     #pragma clang loop vectorize_width(8)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -51,23 +68,20 @@ void Culler::intersects(
                               planes[j].w - sphere.w;
             visible &= fast::signbit(dot);
         }
-        results[i] = result_type(visible);
+        results[i] = Culler::result_type(visible);
     }
 }
 
-void Culler::intersects(
-        result_type* UTILS_RESTRICT results,
-        Frustum const& UTILS_RESTRICT frustum,
+static void intersectsBoxesScalar(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
         float3 const* UTILS_RESTRICT center,
         float3 const* UTILS_RESTRICT extent,
         size_t count, size_t bit) noexcept {
 
-    float4 const * UTILS_RESTRICT const planes = frustum.mPlanes;
-
     // we use a vectorize width of 8 because, on ARMv8 it allows the compiler to write eight
     // 8-bits results in one go. Without this it has to do 4 separate byte writes, which
     // ends-up being slower.
-    count = round(count); // capacity guaranteed to be multiple of 8
     #pragma clang loop vectorize_width(8)
     for (size_t i = 0; i < count; i++) {
         int visible = ~0;
@@ -85,10 +99,358 @@ void Culler::intersects(
             visible &= fast::signbit(dot) << bit;
         }
 
-        results[i] |= result_type(visible);
+        results[i] |= Culler::result_type(visible);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// SSE2 and AVX2 kernels
+//
+// In all SIMD kernels, a box or sphere is visible if all its plane distances are negative, which
+// is computed by AND-ing the distances together and looking at the resulting sign bit.
+// The distances are not accumulated in the same order as the scalar kernel, so they can differ
+// by a few ulps, which only matters for objects touching a plane.
+// ------------------------------------------------------------------------------------------------
+
+#if CULLER_HAS_SSE2
+
+// loads 4 consecutive float3 and transposes them into x, y and z vectors
+UTILS_ALWAYS_INLINE
+static inline void loadTransposed(float3 const* p, __m128& x, __m128& y, __m128& z) noexcept {
+    float const* const f = &p->x;
+    const __m128 a  = _mm_loadu_ps(f + 0);                            // x0 y0 z0 x1
+    const __m128 b  = _mm_loadu_ps(f + 4);                            // y1 z1 x2 y2
+    const __m128 c  = _mm_loadu_ps(f + 8);                            // z2 x3 y3 z3
+    const __m128 t0 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));  // x2 y2 x3 y3
+    const __m128 t1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));  // y0 z0 y1 z1
+    x = _mm_shuffle_ps(a,  t0, _MM_SHUFFLE(2, 0, 3, 0));              // x0 x1 x2 x3
+    y = _mm_shuffle_ps(t1, t0, _MM_SHUFFLE(3, 1, 2, 0));              // y0 y1 y2 y3
+    z = _mm_shuffle_ps(t1, c,  _MM_SHUFFLE(3, 0, 3, 1));              // z0 z1 z2 z3
+}
+
+// loads 4 consecutive float4 and transposes them into x, y, z and w vectors
+UTILS_ALWAYS_INLINE
+static inline void loadTransposed(float4 const* p,
+        __m128& x, __m128& y, __m128& z, __m128& w) noexcept {
+    x = _mm_loadu_ps(&p[0].x);
+    y = _mm_loadu_ps(&p[1].x);
+    z = _mm_loadu_ps(&p[2].x);
+    w = _mm_loadu_ps(&p[3].x);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+static void intersectsSpheresSSE2(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 x, y, z, r;
+        loadTransposed(b + i, x, y, z, r);
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m128 dot = _mm_sub_ps(_mm_set1_ps(planes[j].w), r);
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_set1_ps(planes[j].x), x));
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_set1_ps(planes[j].y), y));
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_set1_ps(planes[j].z), z));
+            visible = _mm_and_ps(visible, dot);
+        }
+        const unsigned int mask = unsigned(_mm_movemask_ps(visible));
+        results[i + 0] = Culler::result_type((mask >> 0u) & 1u);
+        results[i + 1] = Culler::result_type((mask >> 1u) & 1u);
+        results[i + 2] = Culler::result_type((mask >> 2u) & 1u);
+        results[i + 3] = Culler::result_type((mask >> 3u) & 1u);
+    }
+}
+
+static void intersectsBoxesSSE2(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 cx, cy, cz, ex, ey, ez;
+        loadTransposed(center + i, cx, cy, cz);
+        loadTransposed(extent + i, ex, ey, ez);
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            const __m128 px = _mm_set1_ps(planes[j].x);
+            const __m128 py = _mm_set1_ps(planes[j].y);
+            const __m128 pz = _mm_set1_ps(planes[j].z);
+            __m128 dot = _mm_set1_ps(planes[j].w);
+            dot = _mm_add_ps(dot, _mm_mul_ps(px, cx));
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_and_ps(px, signMask), ex));
+            dot = _mm_add_ps(dot, _mm_mul_ps(py, cy));
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_and_ps(py, signMask), ey));
+            dot = _mm_add_ps(dot, _mm_mul_ps(pz, cz));
+            dot = _mm_sub_ps(dot, _mm_mul_ps(_mm_and_ps(pz, signMask), ez));
+            visible = _mm_and_ps(visible, dot);
+        }
+        const unsigned int mask = unsigned(_mm_movemask_ps(visible));
+        results[i + 0] |= Culler::result_type(((mask >> 0u) & 1u) << bit);
+        results[i + 1] |= Culler::result_type(((mask >> 1u) & 1u) << bit);
+        results[i + 2] |= Culler::result_type(((mask >> 2u) & 1u) << bit);
+        results[i + 3] |= Culler::result_type(((mask >> 3u) & 1u) << bit);
+    }
+}
+
+#endif // CULLER_HAS_SSE2
+
+#if CULLER_HAS_AVX2
+
+#define CULLER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+
+// loads 8 consecutive float3 and transposes them into x, y and z vectors
+CULLER_TARGET_AVX2
+UTILS_ALWAYS_INLINE
+static inline void loadTransposed(float3 const* p, __m256& x, __m256& y, __m256& z) noexcept {
+    __m128 x0, y0, z0, x1, y1, z1;
+    loadTransposed(p + 0, x0, y0, z0);
+    loadTransposed(p + 4, x1, y1, z1);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+}
+
+// loads 8 consecutive float4 and transposes them into x, y, z and w vectors
+CULLER_TARGET_AVX2
+UTILS_ALWAYS_INLINE
+static inline void loadTransposed(float4 const* p,
+        __m256& x, __m256& y, __m256& z, __m256& w) noexcept {
+    __m128 x0, y0, z0, w0, x1, y1, z1, w1;
+    loadTransposed(p + 0, x0, y0, z0, w0);
+    loadTransposed(p + 4, x1, y1, z1, w1);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+    y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+    z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+    w = _mm256_insertf128_ps(_mm256_castps128_ps256(w0), w1, 1);
+}
+
+// packs the sign bits of 8 floats into 8 bytes, each either 0 or (1 << bit), and stores them
+CULLER_TARGET_AVX2
+UTILS_ALWAYS_INLINE
+static inline __m128i packSignBits(__m256 v, size_t bit) noexcept {
+    __m256i b = _mm256_srli_epi32(_mm256_castps_si256(v), 31);
+    b = _mm256_sll_epi32(b, _mm_cvtsi32_si128(int(bit)));
+    const __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1));
+    return _mm_packus_epi16(w, w);
+}
+
+CULLER_TARGET_AVX2
+static void intersectsSpheresAVX2(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 x, y, z, r;
+        loadTransposed(b + i, x, y, z, r);
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            __m256 dot = _mm256_sub_ps(_mm256_set1_ps(planes[j].w), r);
+            dot = _mm256_fmadd_ps(_mm256_set1_ps(planes[j].x), x, dot);
+            dot = _mm256_fmadd_ps(_mm256_set1_ps(planes[j].y), y, dot);
+            dot = _mm256_fmadd_ps(_mm256_set1_ps(planes[j].z), z, dot);
+            visible = _mm256_and_ps(visible, dot);
+        }
+        _mm_storel_epi64((__m128i*)(results + i), packSignBits(visible, 0));
+    }
+}
+
+CULLER_TARGET_AVX2
+static void intersectsBoxesAVX2(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 cx, cy, cz, ex, ey, ez;
+        loadTransposed(center + i, cx, cy, cz);
+        loadTransposed(extent + i, ex, ey, ez);
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (size_t j = 0; j < 6; j++) {
+            const __m256 px = _mm256_set1_ps(planes[j].x);
+            const __m256 py = _mm256_set1_ps(planes[j].y);
+            const __m256 pz = _mm256_set1_ps(planes[j].z);
+            __m256 dot = _mm256_set1_ps(planes[j].w);
+            dot = _mm256_fmadd_ps(px, cx, dot);
+            dot = _mm256_fnmadd_ps(_mm256_and_ps(px, signMask), ex, dot);
+            dot = _mm256_fmadd_ps(py, cy, dot);
+            dot = _mm256_fnmadd_ps(_mm256_and_ps(py, signMask), ey, dot);
+            dot = _mm256_fmadd_ps(pz, cz, dot);
+            dot = _mm256_fnmadd_ps(_mm256_and_ps(pz, signMask), ez, dot);
+            visible = _mm256_and_ps(visible, dot);
+        }
+        const __m128i r = _mm_loadl_epi64((__m128i const*)(results + i));
+        _mm_storel_epi64((__m128i*)(results + i), _mm_or_si128(r, packSignBits(visible, bit)));
+    }
+}
+
+#endif // CULLER_HAS_AVX2
+
+// ------------------------------------------------------------------------------------------------
+// NEON kernels
+// ------------------------------------------------------------------------------------------------
+
+#if CULLER_HAS_NEON
+
+// narrows two vectors of 0/1 32-bits values into 8 bytes
+UTILS_ALWAYS_INLINE
+static inline uint8x8_t narrow(uint32x4_t a, uint32x4_t b) noexcept {
+    return vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b)));
+}
+
+UTILS_ALWAYS_INLINE
+static inline uint32x4_t intersectsSpheresNEON(float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b) noexcept {
+    const float32x4x4_t s = vld4q_f32(&b->x);
+    uint32x4_t visible = vdupq_n_u32(0xFFFFFFFFu);
+    for (size_t j = 0; j < 6; j++) {
+        float32x4_t dot = vsubq_f32(vdupq_n_f32(planes[j].w), s.val[3]);
+        dot = vmlaq_n_f32(dot, s.val[0], planes[j].x);
+        dot = vmlaq_n_f32(dot, s.val[1], planes[j].y);
+        dot = vmlaq_n_f32(dot, s.val[2], planes[j].z);
+        visible = vandq_u32(visible, vreinterpretq_u32_f32(dot));
+    }
+    return vshrq_n_u32(visible, 31);
+}
+
+static void intersectsSpheresNEON(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    for (size_t i = 0; i < count; i += 8) {
+        const uint32x4_t v0 = intersectsSpheresNEON(planes, b + i);
+        const uint32x4_t v1 = intersectsSpheresNEON(planes, b + i + 4);
+        vst1_u8(results + i, narrow(v0, v1));
+    }
+}
+
+UTILS_ALWAYS_INLINE
+static inline uint32x4_t intersectsBoxesNEON(float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center, float3 const* UTILS_RESTRICT extent) noexcept {
+    const float32x4x3_t c = vld3q_f32(&center->x);
+    const float32x4x3_t e = vld3q_f32(&extent->x);
+    uint32x4_t visible = vdupq_n_u32(0xFFFFFFFFu);
+    for (size_t j = 0; j < 6; j++) {
+        float32x4_t dot = vdupq_n_f32(planes[j].w);
+        dot = vmlaq_n_f32(dot, c.val[0], planes[j].x);
+        dot = vmlsq_n_f32(dot, e.val[0], std::abs(planes[j].x));
+        dot = vmlaq_n_f32(dot, c.val[1], planes[j].y);
+        dot = vmlsq_n_f32(dot, e.val[1], std::abs(planes[j].y));
+        dot = vmlaq_n_f32(dot, c.val[2], planes[j].z);
+        dot = vmlsq_n_f32(dot, e.val[2], std::abs(planes[j].z));
+        visible = vandq_u32(visible, vreinterpretq_u32_f32(dot));
+    }
+    return vshrq_n_u32(visible, 31);
+}
+
+static void intersectsBoxesNEON(
+        Culler::result_type* UTILS_RESTRICT results,
+        float4 const* UTILS_RESTRICT planes,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    const int8x8_t shift = vdup_n_s8(int8_t(bit));
+    for (size_t i = 0; i < count; i += 8) {
+        const uint32x4_t v0 = intersectsBoxesNEON(planes, center + i, extent + i);
+        const uint32x4_t v1 = intersectsBoxesNEON(planes, center + i + 4, extent + i + 4);
+        const uint8x8_t v = vshl_u8(narrow(v0, v1), shift);
+        vst1_u8(results + i, vorr_u8(vld1_u8(results + i), v));
+    }
+}
+
+#endif // CULLER_HAS_NEON
+
+// ------------------------------------------------------------------------------------------------
+// Dispatch
+// ------------------------------------------------------------------------------------------------
+
+static bool isKernelSupported(Culler::Kernel kernel) noexcept {
+    switch (kernel) {
+        case Culler::Kernel::SCALAR:
+            return true;
+#if CULLER_HAS_SSE2
+        case Culler::Kernel::SSE2:
+            return true;
+#endif
+#if CULLER_HAS_AVX2
+        case Culler::Kernel::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#if CULLER_HAS_NEON
+        case Culler::Kernel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+Culler::Kernels Culler::getKernels(Kernel kernel) noexcept {
+    switch (kernel) {
+#if CULLER_HAS_SSE2
+        case Kernel::SSE2:
+            return { intersectsBoxesSSE2, intersectsSpheresSSE2, kernel };
+#endif
+#if CULLER_HAS_AVX2
+        case Kernel::AVX2:
+            return { intersectsBoxesAVX2, intersectsSpheresAVX2, kernel };
+#endif
+#if CULLER_HAS_NEON
+        case Kernel::NEON:
+            return { intersectsBoxesNEON, intersectsSpheresNEON, kernel };
+#endif
+        default:
+            return { intersectsBoxesScalar, intersectsSpheresScalar, Kernel::SCALAR };
     }
 }
 
+Culler::Kernels const& Culler::getBestKernels() noexcept {
+    static const Kernels kernels = []() {
+        // in order of preference
+        constexpr Kernel candidates[] = { Kernel::AVX2, Kernel::NEON, Kernel::SSE2 };
+        for (Kernel kernel : candidates) {
+            if (isKernelSupported(kernel)) {
+                return getKernels(kernel);
+            }
+        }
+        return getKernels(Kernel::SCALAR);
+    }();
+    return kernels;
+}
+
+Culler::Kernel Culler::getKernel() noexcept {
+    return getBestKernels().kernel;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b,
+        size_t count) noexcept {
+    count = round(count); // capacity guaranteed to be multiple of 8
+    getBestKernels().spheres(results, frustum.mPlanes, b, count);
+}
+
+void Culler::intersects(
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT center,
+        float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) noexcept {
+    count = round(count); // capacity guaranteed to be multiple of 8
+    getBestKernels().boxes(results, frustum.mPlanes, center, extent, count, bit);
+}
+
 /*
  * returns whether a box intersects with the frustum
  */
@@ -136,4 +498,26 @@ void Culler::Test::intersects(
     Culler::intersects(results, frustum, b, count);
 }
 
+bool Culler::Test::isSupported(Kernel kernel) noexcept {
+    return isKernelSupported(kernel) && getKernels(kernel).kernel == kernel;
+}
+
+void Culler::Test::intersects(Kernel kernel,
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float3 const* UTILS_RESTRICT c,
+        float3 const* UTILS_RESTRICT e,
+        size_t count) noexcept {
+    assert(isSupported(kernel));
+    getKernels(kernel).boxes(results, frustum.mPlanes, c, e, round(count), 0);
+}
+
+void Culler::Test::intersects(Kernel kernel,
+        result_type* UTILS_RESTRICT results,
+        Frustum const& UTILS_RESTRICT frustum,
+        float4 const* UTILS_RESTRICT b, size_t count) noexcept {
+    assert(isSupported(kernel));
+    getKernels(kernel).spheres(results, frustum.mPlanes, b, round(count));
+}
+
 } // namespace filament
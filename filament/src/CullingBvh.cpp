@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/CullingBvh.h"
+
+#include <utils/JobSystem.h>
+#include <utils/Systrace.h>
+
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <assert.h>
+
+using namespace filament::math;
+
+namespace filament {
+
+void CullingBvh::clear() noexcept {
+    mCenter.clear();
+    mExtent.clear();
+    mIndices.clear();
+    mNodes.clear();
+    mDirty.clear();
+    mCount = 0;
+}
+
+void CullingBvh::build(float3 const* center, float3 const* extent, size_t count) {
+    SYSTRACE_CALL();
+
+    clear();
+    if (count == 0) {
+        return;
+    }
+
+    assert(count <= std::numeric_limits<uint32_t>::max());
+
+    mCount = count;
+    mIndices.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        mIndices[i] = i;
+    }
+
+    // a binary tree with leaves of at least LEAF_SIZE/2 boxes has fewer than 4*count/LEAF_SIZE
+    // nodes
+    mNodes.reserve(4 * (count + LEAF_SIZE - 1) / LEAF_SIZE);
+    buildRecursive(center, 0, uint32_t(count), 0);
+    mDirty.resize(mNodes.size(), 0);
+
+    // store the boxes in hierarchy order so that leaves can be culled in one go; the arrays
+    // are padded because Culler processes MODULO boxes at a time, starting at any leaf.
+    mCenter.resize(count + Culler::MODULO);
+    mExtent.resize(count + Culler::MODULO);
+    for (size_t s = 0; s < count; s++) {
+        mCenter[s] = center[mIndices[s]];
+        mExtent[s] = extent[mIndices[s]];
+    }
+
+    // children always come after their parent, so a reverse walk computes the bounds bottom-up
+    for (size_t i = mNodes.size(); i-- > 0;) {
+        Node& node = mNodes[i];
+        if (node.next == i + 1) {
+            computeLeafBounds(node);
+        } else {
+            Node const& left = mNodes[i + 1];
+            computeInternalBounds(node, left, mNodes[left.next]);
+        }
+    }
+}
+
+uint32_t CullingBvh::buildRecursive(float3 const* center,
+        uint32_t first, uint32_t count, uint32_t parent) {
+    const uint32_t index = uint32_t(mNodes.size());
+    mNodes.push_back({ {}, {}, first, count, 0, parent });
+
+    if (count > LEAF_SIZE) {
+        // split at the median of the longest axis of the centers' bounds
+        float3 lo{ std::numeric_limits<float>::max() };
+        float3 hi{ std::numeric_limits<float>::lowest() };
+        for (uint32_t s = first; s < first + count; s++) {
+            lo = min(lo, center[mIndices[s]]);
+            hi = max(hi, center[mIndices[s]]);
+        }
+        const float3 size = hi - lo;
+        const size_t axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+
+        const uint32_t half = count / 2;
+        auto* const begin = mIndices.data() + first;
+        std::nth_element(begin, begin + half, begin + count,
+                [center, axis](uint32_t lhs, uint32_t rhs) {
+                    return center[lhs][axis] < center[rhs][axis];
+                });
+
+        const uint32_t left = buildRecursive(center, first, half, index);
+        assert(left == index + 1);
+        (void)left;
+        buildRecursive(center, first + half, count - half, index);
+    }
+
+    mNodes[index].next = uint32_t(mNodes.size());
+    return index;
+}
+
+void CullingBvh::computeLeafBounds(Node& node) const noexcept {
+    float3 lo{ std::numeric_limits<float>::max() };
+    float3 hi{ std::numeric_limits<float>::lowest() };
+    for (uint32_t s = node.first, e = node.first + node.count; s < e; s++) {
+        lo = min(lo, mCenter[s] - mExtent[s]);
+        hi = max(hi, mCenter[s] + mExtent[s]);
+    }
+    node.center = (hi + lo) * 0.5f;
+    // grow the box by a few ulps so that rounding never makes it smaller than its content,
+    // which could incorrectly reject a box that Culler would have accepted
+    node.extent = (hi - lo) * (0.5f * (1.0f + 4.0f * std::numeric_limits<float>::epsilon()));
+}
+
+void CullingBvh::computeInternalBounds(Node& node,
+        Node const& left, Node const& right) const noexcept {
+    const float3 lo = min(left.center - left.extent, right.center - right.extent);
+    const float3 hi = max(left.center + left.extent, right.center + right.extent);
+    node.center = (hi + lo) * 0.5f;
+    node.extent = (hi - lo) * (0.5f * (1.0f + 4.0f * std::numeric_limits<float>::epsilon()));
+}
+
+void CullingBvh::refit(float3 const* center, float3 const* extent, size_t count) noexcept {
+    SYSTRACE_CALL();
+
+    assert(count == mCount);
+    (void)count;
+
+    // find the leaves that contain a box that moved, and flag them and their ancestors
+    Node* const nodes = mNodes.data();
+    uint8_t* const dirty = mDirty.data();
+    bool changed = false;
+    for (uint32_t i = 0, n = uint32_t(mNodes.size()); i < n; i++) {
+        Node const& node = nodes[i];
+        if (node.next != i + 1) {
+            continue;
+        }
+        bool moved = false;
+        for (uint32_t s = node.first, e = node.first + node.count; s < e; s++) {
+            const uint32_t index = mIndices[s];
+            if (UTILS_UNLIKELY(mCenter[s] != center[index] || mExtent[s] != extent[index])) {
+                mCenter[s] = center[index];
+                mExtent[s] = extent[index];
+                moved = true;
+            }
+        }
+        if (moved) {
+            changed = true;
+            // the root is its own parent
+            for (uint32_t j = i; !dirty[j]; j = nodes[j].parent) {
+                dirty[j] = 1;
+            }
+        }
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    for (size_t i = mNodes.size(); i-- > 0;) {
+        if (dirty[i]) {
+            dirty[i] = 0;
+            Node& node = nodes[i];
+            if (node.next == i + 1) {
+                computeLeafBounds(node);
+            } else {
+                Node const& left = nodes[i + 1];
+                computeInternalBounds(node, left, nodes[left.next]);
+            }
+        }
+    }
+}
+
+CullingBvh::Classification CullingBvh::classify(float4 const* UTILS_RESTRICT planes,
+        float3 const& center, float3 const& extent) noexcept {
+    // same conventions as Culler: a box is visible if it's on the negative side of all planes
+    bool inside = true;
+    for (size_t j = 0; j < 6; j++) {
+        const float d = dot(planes[j].xyz, center) + planes[j].w;
+        const float r = dot(abs(planes[j].xyz), extent);
+        if (d - r >= 0.0f) {
+            return Classification::OUTSIDE;
+        }
+        inside = inside && (d + r < 0.0f);
+    }
+    return inside ? Classification::INSIDE : Classification::INTERSECTING;
+}
+
+void CullingBvh::cull(Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& frustum, size_t bit) const noexcept {
+    SYSTRACE_CALL();
+    cullSubtrees(results, frustum, bit, 0, uint32_t(mNodes.size()));
+}
+
+void CullingBvh::cull(utils::JobSystem& js, Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& frustum, size_t bit) const noexcept {
+    SYSTRACE_CALL();
+
+    const size_t grain = std::max(PARALLEL_CULL_MIN_BOXES,
+            mCount / std::min(PARALLEL_CULL_MAX_SUBTREES / 2,
+                    size_t(2) << js.getParallelSplitCount()));
+    if (mCount < 2 * grain) {
+        cullSubtrees(results, frustum, bit, 0, uint32_t(mNodes.size()));
+        return;
+    }
+
+    // Walk the top of the hierarchy, down to the subtrees of at most 'grain' boxes, which are
+    // then culled in parallel. Each box belongs to a single subtree, so the jobs never write the
+    // same results.
+    float4 const* const planes = frustum.getNormalizedPlanes();
+    Node const* const nodes = mNodes.data();
+    uint32_t subtrees[PARALLEL_CULL_MAX_SUBTREES];
+    size_t subtreeCount = 0;
+    for (uint32_t i = 0, n = uint32_t(mNodes.size()); i < n;) {
+        Node const& node = nodes[i];
+        if (node.count > grain) {
+            const Classification c = classify(planes, node.center, node.extent);
+            if (c == Classification::OUTSIDE) {
+                i = node.next;
+                continue;
+            }
+            if (c == Classification::INTERSECTING) {
+                i++;
+                continue;
+            }
+        }
+        if (UTILS_LIKELY(subtreeCount < PARALLEL_CULL_MAX_SUBTREES)) {
+            subtrees[subtreeCount++] = i;
+        } else {
+            cullSubtrees(results, frustum, bit, i, node.next);
+        }
+        i = node.next;
+    }
+
+    auto functor = [this, results, &frustum, bit, nodes, &subtrees](uint32_t index, uint32_t c) {
+        for (uint32_t k = index; k < index + c; k++) {
+            const uint32_t root = subtrees[k];
+            cullSubtrees(results, frustum, bit, root, nodes[root].next);
+        }
+    };
+    auto* job = utils::jobs::parallel_for(js, nullptr, 0, uint32_t(subtreeCount),
+            std::ref(functor), utils::jobs::CountSplitter<1, 8>());
+    js.runAndWait(job);
+}
+
+void CullingBvh::cullSubtrees(Culler::result_type* UTILS_RESTRICT results,
+        Frustum const& frustum, size_t bit, uint32_t first, uint32_t last) const noexcept {
+    float4 const* const planes = frustum.getNormalizedPlanes();
+    Node const* const nodes = mNodes.data();
+    uint32_t const* const indices = mIndices.data();
+    const Culler::result_type visible = Culler::result_type(1u << bit);
+
+    // stack-less depth-first traversal, skipping the subtrees that are entirely outside or
+    // entirely inside the frustum
+    for (uint32_t i = first; i < last;) {
+        Node const& node = nodes[i];
+        const Classification c = classify(planes, node.center, node.extent);
+        if (c == Classification::INTERSECTING && node.next != i + 1) {
+            i++;
+            continue;
+        }
+        if (c == Classification::INSIDE) {
+            for (uint32_t s = node.first, e = node.first + node.count; s < e; s++) {
+                results[indices[s]] |= visible;
+            }
+        } else if (c == Classification::INTERSECTING) {
+            // this is a leaf, test its boxes individually
+            Culler::result_type leafResults[LEAF_SIZE] = {};
+            Culler::intersects(leafResults, frustum,
+                    mCenter.data() + node.first, mExtent.data() + node.first, node.count, bit);
+            for (uint32_t k = 0; k < node.count; k++) {
+                results[indices[node.first + k]] |= leafResults[k];
+            }
+        }
+        i = node.next;
+    }
+}
+
+// For testing...
+
+void CullingBvh::Test::build(CullingBvh& bvh,
+        float3 const* center, float3 const* extent, size_t count) {
+    bvh.build(center, extent, count);
+}
+
+void CullingBvh::Test::refit(CullingBvh& bvh,
+        float3 const* center, float3 const* extent, size_t count) noexcept {
+    bvh.refit(center, extent, count);
+}
+
+void CullingBvh::Test::cull(CullingBvh const& bvh,
+        Culler::result_type* results, Frustum const& frustum, size_t bit) noexcept {
+    bvh.cull(results, frustum, bit);
+}
+
+void CullingBvh::Test::cull(CullingBvh const& bvh, utils::JobSystem& js,
+        Culler::result_type* results, Frustum const& frustum, size_t bit) noexcept {
+    bvh.cull(js, results, frustum, bit);
+}
+
+} // namespace filament
@@ -179,6 +179,7 @@ FEngine::FEngine(Backend backend, Platform* platform, void* sharedGLContext) :
     // we're assuming we're on the main thread here.
     // (it may not be the case)
     mJobSystem.adopt();
+    mTransformManager.setJobSystem(&mJobSystem);
 
     slog.i << "FEngine (" << sizeof(void*) * 8 << " bits) created at " << this << " "
            << "(threading is " << (UTILS_HAS_THREADING ? "enabled)" : "disabled)") << io::endl;
@@ -240,6 +241,7 @@ void FEngine::init() {
             .irradiance(3, reinterpret_cast<const float3*>(sh))
             .build(*this));
 
+    mColorGradingLutCache = FColorGrading::createLutCache();
     mDefaultColorGrading = upcast(ColorGrading::Builder().build(*this));
 
     // Always initialize the default material, most materials' depth shaders fallback on it.
@@ -314,6 +316,8 @@ void FEngine::shutdown() {
     cleanupResourceList(mScenes);
     cleanupResourceList(mSkyboxes);
     cleanupResourceList(mColorGradings);
+    FColorGrading::destroyLutCache(mColorGradingLutCache);
+    mColorGradingLutCache = nullptr;
 
     // this must be done after Skyboxes and before materials
     destroy(mSkyboxMaterial);
@@ -377,6 +381,11 @@ void FEngine::prepare() {
     for (const auto& material : mMaterials) {
         material->getDefaultInstance()->commit(driver);
     }
+
+    // Upload the LUTs of the color gradings generated asynchronously, if they're ready.
+    for (const auto& colorGrading : mColorGradings) {
+        colorGrading->commit(*this);
+    }
 }
 
 void FEngine::gc() {
@@ -1021,6 +1030,14 @@ utils::JobSystem& Engine::getJobSystem() noexcept {
     return upcast(this)->getJobSystem();
 }
 
+void Engine::setResourceCacheCapacity(size_t capacity) noexcept {
+    upcast(this)->getResourceAllocator().setCacheCapacity(capacity);
+}
+
+size_t Engine::getResourceCacheCapacity() const noexcept {
+    return upcast(this)->getResourceAllocator().getCacheCapacity();
+}
+
 DebugRegistry& Engine::getDebugRegistry() noexcept {
     return upcast(this)->getDebugRegistry();
 }
@@ -31,6 +31,7 @@
 #include <math/scalar.h>
 
 #include <algorithm>
+#include <array>
 
 #include <stddef.h>
 
@@ -164,6 +165,16 @@ bool Froxelizer::prepare(
             driverApi.allocatePod<RecordBufferType>(RECORD_BUFFER_ENTRY_COUNT),
             RECORD_BUFFER_ENTRY_COUNT };
 
+    assert(mFroxelBufferUser.begin());
+    assert(mRecordBufferUser.begin());
+
+    if (mBinningEnabled) {
+        // the binned froxelization uses its own persistent storage
+        mLightRecords.clear();
+        mFroxelShardedData.clear();
+        return uniformsNeedUpdating;
+    }
+
     /*
      * Temporary allocations for processing all froxel data
      */
@@ -179,8 +190,6 @@ bool Froxelizer::prepare(
             uint32_t(GROUP_COUNT)
     };
 
-    assert(mFroxelBufferUser.begin());
-    assert(mRecordBufferUser.begin());
     assert(mLightRecords.begin());
     assert(mFroxelShardedData.begin());
 
@@ -525,8 +534,16 @@ void Froxelizer::froxelizeLights(FEngine& engine,
         CameraInfo const& UTILS_RESTRICT camera,
         const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
     // note: this is called asynchronously
-    froxelizeLoop(engine, camera, lightData);
-    froxelizeAssignRecordsCompress();
+    if (mBinningEnabled) {
+        froxelizeBinned(engine, camera, lightData);
+        froxelizeAssignRecordsBinned();
+    } else {
+        // the bitsets can't hold more than CONFIG_MAX_LIGHT_COUNT lights, FScene::prepare()
+        // drops the excess lights.
+        assert(lightData.size() <= CONFIG_MAX_LIGHT_COUNT + FScene::DIRECTIONAL_LIGHTS_COUNT);
+        froxelizeLoop(engine, camera, lightData);
+        froxelizeAssignRecordsCompress();
+    }
 
 #ifndef NDEBUG
     if (lightData.size()) {
@@ -730,8 +747,7 @@ static inline float2 project(mat4f const& p, float3 const& v) noexcept {
     return float2{ x, y } * (1 / w);
 }
 
-void Froxelizer::froxelizePointAndSpotLight(
-        FroxelThreadData& froxelThread, size_t bit,
+Froxelizer::LightBounds Froxelizer::computeLightBounds(
         mat4f const& UTILS_RESTRICT p,
         const Froxelizer::LightParams& UTILS_RESTRICT light) const noexcept {
 
@@ -739,12 +755,9 @@ void Froxelizer::froxelizePointAndSpotLight(
         // This light is fully behind LightFar, it doesn't light anything
         // (we could avoid this check if we culled lights using LightFar instead of the
         // culling camera's far plane)
-        return;
+        return { 0, 0, 0, 0, 0, 0, 0, false };
     }
 
-    // the code below works with radius^2
-    const float4 s = { light.position, light.radius * light.radius };
-
 #ifdef DEBUG_FROXEL
     const size_t x0 = 0;
     const size_t x1 = mFroxelCountX;
@@ -785,7 +798,30 @@ void Froxelizer::froxelizePointAndSpotLight(
     assert(z0 <= z1);
 #endif
 
-    const size_t zcenter = findSliceZ(s.z);
+    return { uint16_t(x0), uint16_t(x1), uint16_t(y0), uint16_t(y1),
+             uint8_t(z0), uint8_t(z1), uint8_t(findSliceZ(light.position.z)), true };
+}
+
+void Froxelizer::froxelizePointAndSpotLight(
+        FroxelThreadData& froxelThread, size_t bit,
+        mat4f const& UTILS_RESTRICT p,
+        const Froxelizer::LightParams& UTILS_RESTRICT light) const noexcept {
+
+    const LightBounds bounds = computeLightBounds(p, light);
+    if (UTILS_UNLIKELY(!bounds.visible)) {
+        return;
+    }
+
+    // the code below works with radius^2
+    const float4 s = { light.position, light.radius * light.radius };
+
+    const size_t x0 = bounds.x0;
+    const size_t x1 = bounds.x1;
+    const size_t y0 = bounds.y0;
+    const size_t y1 = bounds.y1;
+    const size_t z0 = bounds.z0;
+    const size_t z1 = bounds.z1;
+    const size_t zcenter = bounds.zcenter;
     float4 const * const UTILS_RESTRICT planesX = mPlanesX;
     float4 const * const UTILS_RESTRICT planesY = mPlanesY;
     float const * const UTILS_RESTRICT planesZ = mDistancesZ;
@@ -872,6 +908,262 @@ void Froxelizer::froxelizePointAndSpotLight(
     }
 }
 
+void Froxelizer::froxelizeBinned(FEngine& engine,
+        const CameraInfo& UTILS_RESTRICT camera,
+        const FScene::LightSoa& UTILS_RESTRICT lightData) noexcept {
+    SYSTRACE_CALL();
+
+    const size_t lightCount = lightData.size() - FScene::DIRECTIONAL_LIGHTS_COUNT;
+    // light indices are stored on 16 bits
+    assert(lightCount <= std::numeric_limits<uint16_t>::max() + 1u);
+
+    const size_t froxelCountX = mFroxelCountX;
+    const size_t froxelCountZ = mFroxelCountZ;
+    const size_t rowCount = mFroxelCountY * froxelCountZ;
+    const size_t froxelCount = getFroxelCount();
+
+    mBinnedLights.resize(lightCount);
+    mBinnedBounds.resize(lightCount);
+    mRowEntries.resize(rowCount);
+    mRowLights.resize(rowCount);
+    mFroxelLightOffsets.assign(froxelCount + 1, 0);
+
+    JobSystem& js = engine.getJobSystem();
+    const mat4f& projection = mProjection;
+
+    // 1. compute the view-space parameters and the froxel-space bounds of each light
+    auto& lcm = engine.getLightManager();
+    auto const* UTILS_RESTRICT spheres      = lightData.data<FScene::POSITION_RADIUS>();
+    auto const* UTILS_RESTRICT directions   = lightData.data<FScene::DIRECTION>();
+    auto const* UTILS_RESTRICT instances    = lightData.data<FScene::LIGHT_INSTANCE>();
+    auto prepareLights = [this, spheres, directions, instances, &camera, &lcm, &projection]
+            (uint32_t start, uint32_t count) {
+        const mat3f& vn = camera.view.upperLeft();
+        for (size_t i = start, e = start + count; i < e; i++) {
+            const size_t j = i + FScene::DIRECTIONAL_LIGHTS_COUNT;
+            FLightManager::Instance li = instances[j];
+            LightParams light = {
+                    .position = (camera.view * float4{ spheres[j].xyz, 1 }).xyz, // to view-space
+                    .cosSqr = lcm.getCosOuterSquared(li),   // spot only
+                    .axis = vn * directions[j],             // spot only
+                    .invSin = lcm.getSinInverse(li),        // spot only
+                    .radius = spheres[j].w,
+            };
+            mBinnedLights[i] = light;
+            mBinnedBounds[i] = computeLightBounds(projection, light);
+        }
+    };
+    js.runAndWait(jobs::parallel_for(js, nullptr, 0, uint32_t(lightCount),
+            std::ref(prepareLights), jobs::CountSplitter<64, 8>()));
+
+    // 2. bin the lights per Z slice, this keeps them sorted by index within each slice
+    std::array<uint32_t, FEngine::CONFIG_FROXEL_SLICE_COUNT + 1> cursor{};
+    assert(froxelCountZ <= FEngine::CONFIG_FROXEL_SLICE_COUNT);
+    for (LightBounds const& bounds : mBinnedBounds) {
+        if (bounds.visible) {
+            for (size_t iz = bounds.z0; iz <= bounds.z1; iz++) {
+                cursor[iz + 1]++;
+            }
+        }
+    }
+    for (size_t iz = 0; iz < froxelCountZ; iz++) {
+        cursor[iz + 1] += cursor[iz];
+    }
+    mSliceLightOffsets.assign(cursor.begin(), cursor.begin() + froxelCountZ + 1);
+    mSliceLights.resize(cursor[froxelCountZ]);
+    for (size_t i = 0; i < lightCount; i++) {
+        LightBounds const& bounds = mBinnedBounds[i];
+        if (bounds.visible) {
+            for (size_t iz = bounds.z0; iz <= bounds.z1; iz++) {
+                mSliceLights[cursor[iz]++] = uint16_t(i);
+            }
+        }
+    }
+
+    // 3. find the lights of each froxel, one row of froxels at a time
+    auto processRows = [this, &projection](uint32_t start, uint32_t count) {
+        for (size_t row = start, e = start + count; row < e; row++) {
+            froxelizeRowBinned(row, projection);
+        }
+    };
+    js.runAndWait(jobs::parallel_for(js, nullptr, 0, uint32_t(rowCount),
+            std::ref(processRows), jobs::CountSplitter<8, 8>()));
+
+    // 4. compute the offset of each froxel's light list, froxelizeRowBinned() stored the
+    //    light count of froxel i at offset i + 1.
+    uint32_t* const UTILS_RESTRICT offsets = mFroxelLightOffsets.data();
+    for (size_t i = 0; i < froxelCount; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    // 5. gather the rows' light lists, froxels of a row are contiguous
+    mFroxelLights.resize(offsets[froxelCount]);
+    for (size_t row = 0; row < rowCount; row++) {
+        std::vector<uint16_t> const& lights = mRowLights[row];
+        std::copy(lights.begin(), lights.end(), mFroxelLights.begin() + offsets[row * froxelCountX]);
+    }
+}
+
+void Froxelizer::froxelizeRowBinned(size_t row, mat4f const& UTILS_RESTRICT p) noexcept {
+    const size_t froxelCountX = mFroxelCountX;
+    const size_t iy = row % mFroxelCountY;
+    const size_t iz = row / mFroxelCountY;
+    const size_t fi0 = getFroxelIndex(0, iy, iz);
+    assert(fi0 == row * froxelCountX);
+
+    float4 const * const UTILS_RESTRICT planesX = mPlanesX;
+    float4 const * const UTILS_RESTRICT planesY = mPlanesY;
+    float const * const UTILS_RESTRICT planesZ = mDistancesZ;
+    float4 const * const UTILS_RESTRICT boundingSpheres = mBoundingSpheres;
+    LightParams const * const UTILS_RESTRICT lights = mBinnedLights.data();
+    LightBounds const * const UTILS_RESTRICT bounds = mBinnedBounds.data();
+
+    // this is the same test as froxelizePointAndSpotLight(), restricted to a single row
+    std::vector<uint32_t>& entries = mRowEntries[row];
+    entries.clear();
+    for (size_t k = mSliceLightOffsets[iz], ke = mSliceLightOffsets[iz + 1]; k < ke; k++) {
+        const size_t l = mSliceLights[k];
+        LightBounds const& b = bounds[l];
+        if (iy < b.y0 || iy > b.y1) {
+            continue;
+        }
+
+        LightParams const& light = lights[l];
+        const float4 s = { light.position, light.radius * light.radius };
+        float4 cz(s);
+        if (UTILS_LIKELY(iz != b.zcenter)) {
+            cz = spherePlaneIntersection(s, (iz < b.zcenter) ? planesZ[iz + 1] : planesZ[iz]);
+        }
+        if (!(cz.w > 0)) {
+            continue;
+        }
+
+        const auto indices = clipToIndices(project(p, cz.xyz));
+        const size_t xcenter = indices.first;
+        const size_t ycenter = indices.second;
+
+        float4 cy(cz);
+        if (UTILS_LIKELY(iy != ycenter)) {
+            float4 const& plane = iy < ycenter ? planesY[iy + 1] : planesY[iy];
+            cy = spherePlaneIntersection(cz, plane.y, plane.z);
+        }
+        if (!(cy.w > 0)) {
+            continue;
+        }
+
+        size_t bx = std::numeric_limits<size_t>::max();
+        size_t ex = 0;
+        for (size_t ix = b.x0; ix < b.x1; ++ix) {
+            if (UTILS_LIKELY(ix != xcenter)) {
+                float4 const& plane = ix < xcenter ? planesX[ix + 1] : planesX[ix];
+                if (spherePlaneDistanceSquared(cy, plane.x, plane.z) > 0) {
+                    bx = std::min(bx, ix);
+                    ex = std::max(ex, ix);
+                }
+            } else {
+                bx = std::min(bx, ix);
+                ex = std::max(ex, ix);
+            }
+        }
+        if (UTILS_UNLIKELY(bx > ex)) {
+            continue;
+        }
+
+        if (light.invSin != std::numeric_limits<float>::infinity()) {
+            for (size_t ix = bx; ix <= ex; ix++) {
+                if (sphereConeIntersectionFast(boundingSpheres[fi0 + ix],
+                        light.position, light.axis, light.invSin, light.cosSqr)) {
+                    entries.push_back(uint32_t(ix << 16u) | uint32_t(l));
+                }
+            }
+        } else {
+            for (size_t ix = bx; ix <= ex; ix++) {
+                entries.push_back(uint32_t(ix << 16u) | uint32_t(l));
+            }
+        }
+    }
+
+    // counting sort of the entries by froxel, which keeps each froxel's lights sorted
+    uint32_t* const UTILS_RESTRICT counts = mFroxelLightOffsets.data() + fi0 + 1;
+    for (uint32_t entry : entries) {
+        counts[entry >> 16u]++;
+    }
+
+    // froxelCountX is bounded by the number of froxels in a slice
+    uint32_t cursor[FROXEL_BUFFER_ENTRY_COUNT_MAX / FEngine::CONFIG_FROXEL_SLICE_COUNT];
+    assert(froxelCountX <= sizeof(cursor) / sizeof(*cursor));
+    for (size_t ix = 0, offset = 0; ix < froxelCountX; ix++) {
+        cursor[ix] = uint32_t(offset);
+        offset += counts[ix];
+    }
+
+    std::vector<uint16_t>& rowLights = mRowLights[row];
+    rowLights.resize(entries.size());
+    for (uint32_t entry : entries) {
+        rowLights[cursor[entry >> 16u]++] = uint16_t(entry);
+    }
+}
+
+void Froxelizer::froxelizeAssignRecordsBinned() noexcept {
+    SYSTRACE_CALL();
+
+    FroxelEntry* const UTILS_RESTRICT froxels = mFroxelBufferUser.data();
+    RecordBufferType* const UTILS_RESTRICT froxelRecords = mRecordBufferUser.data();
+    uint32_t const* const UTILS_RESTRICT offsets = mFroxelLightOffsets.data();
+    uint16_t const* const UTILS_RESTRICT lights = mFroxelLights.data();
+    const size_t froxelCountX = mFroxelCountX;
+
+    // Only the lights that fit in the light UBO can be used by the GPU, these come first since
+    // light lists are sorted. We also have a limitation of 255 lights per froxel.
+    auto getGpuLightCount = [offsets, lights](size_t i) -> size_t {
+        uint16_t const* const first = lights + offsets[i];
+        uint16_t const* const last = lights + offsets[i + 1];
+        const size_t count = size_t(std::lower_bound(first, last, CONFIG_MAX_LIGHT_COUNT) - first);
+        return std::min(size_t(255), count);
+    };
+
+    auto hasSameLights = [offsets, lights, &getGpuLightCount](size_t i, size_t j, size_t count) {
+        return getGpuLightCount(j) == count &&
+               std::equal(lights + offsets[i], lights + offsets[i] + count, lights + offsets[j]);
+    };
+
+    size_t offset = 0;
+    for (size_t i = 0, c = getFroxelCount(); i < c; i++) {
+        const size_t lightCount = getGpuLightCount(i);
+        if (lightCount == 0) {
+            froxels[i].u32 = 0;
+            continue;
+        }
+
+        // reuse the record of the froxel on the left or above if it has the same lights
+        if (i > 0 && hasSameLights(i, i - 1, lightCount)) {
+            froxels[i].u32 = froxels[i - 1].u32;
+            continue;
+        }
+        if (i >= froxelCountX && hasSameLights(i, i - froxelCountX, lightCount)) {
+            froxels[i].u32 = froxels[i - froxelCountX].u32;
+            continue;
+        }
+
+        if (UTILS_UNLIKELY(offset + lightCount >= RECORD_BUFFER_ENTRY_COUNT)) {
+#ifndef NDEBUG
+            slog.d << "out of space: " << i << ", at " << offset << io::endl;
+#endif
+            std::fill(froxels + i, froxels + c, FroxelEntry{});
+            break;
+        }
+
+        // note: initializer list for union cannot have more than one element
+        FroxelEntry entry;
+        entry.offset = uint16_t(offset);
+        entry.count = uint8_t(lightCount);
+        froxels[i].u32 = entry.u32;
+
+        std::copy_n(lights + offsets[i], lightCount, froxelRecords + offset);
+        offset += lightCount;
+    }
+}
+
 /*
  *
  * lightTree            output the light tree structure there (must be large enough to hold a complete tree)
@@ -284,6 +284,7 @@ FMaterial::FMaterial(FEngine& engine, const Material::Builder& builder)
 
     parser->getTransparencyMode(&mTransparencyMode);
     parser->hasCustomDepthShader(&mHasCustomDepthShader);
+    parser->isInstanced(&mIsInstanced);
     mIsDefaultMaterial = builder->mDefaultMaterial;
 
     // pre-cache the shared variants -- these variants are shared with the default material.
@@ -335,6 +336,21 @@ bool FMaterial::isSampler(const char* name) const noexcept {
     return mSamplerInterfaceBlock.hasSampler(name);
 }
 
+Material::ParameterHandle FMaterial::getParameterHandle(const char* name) const noexcept {
+    ParameterHandle handle;
+    if (UniformInterfaceBlock::UniformInfo const* info = mUniformInterfaceBlock.getUniformInfo(name)) {
+        handle.mMaterial = this;
+        handle.mOffset = uint32_t(info->getBufferOffset());
+        handle.mCount = info->size;
+        handle.mType = info->type;
+    } else if (mSamplerInterfaceBlock.hasSampler(name)) {
+        handle.mMaterial = this;
+        handle.mOffset = mSamplerInterfaceBlock.getSamplerInfo(name)->offset;
+        handle.mIsSampler = true;
+    }
+    return handle;
+}
+
 UniformInterfaceBlock::UniformInfo const* FMaterial::reflect(
         utils::StaticString const& name) const noexcept {
     auto const& list = mUniformInterfaceBlock.getUniformInfoList();
@@ -378,6 +394,12 @@ Handle<HwProgram> FMaterial::getSurfaceProgramSlow(uint8_t variantKey)
                 UibGenerator::getPerRenderableBonesUib().getName());
     }
 
+    if (mIsInstanced) {
+        // instanced materials don't have skinning variants, the binding point is free
+        pb.setUniformBlock(BindingPoints::PER_RENDERABLE_BONES,
+                UibGenerator::getPerRenderableInstancesUib().getName());
+    }
+
     addSamplerGroup(pb, BindingPoints::PER_VIEW, SibGenerator::getPerViewSib(variantKey), mSamplerBindings);
     addSamplerGroup(pb, BindingPoints::PER_MATERIAL_INSTANCE, mSamplerInterfaceBlock, mSamplerBindings);
 
@@ -620,6 +642,10 @@ bool Material::hasShadowMultiplier() const noexcept {
     return upcast(this)->hasShadowMultiplier();
 }
 
+bool Material::isInstanced() const noexcept {
+    return upcast(this)->isInstanced();
+}
+
 bool Material::hasSpecularAntiAliasing() const noexcept {
     return upcast(this)->hasSpecularAntiAliasing();
 }
@@ -660,6 +686,10 @@ bool Material::isSampler(const char* name) const noexcept {
     return upcast(this)->isSampler(name);
 }
 
+Material::ParameterHandle Material::getParameterHandle(const char* name) const noexcept {
+    return upcast(this)->getParameterHandle(name);
+}
+
 MaterialInstance* Material::getDefaultInstance() noexcept {
     return upcast(this)->getDefaultInstance();
 }
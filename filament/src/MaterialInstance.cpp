@@ -116,13 +116,17 @@ void FMaterialInstance::initialize(FMaterial const* material) {
 }
 
 void FMaterialInstance::commitSlow(DriverApi& driver) const {
-    // update uniforms if needed
+    // update uniforms if needed, only the modified range is uploaded
     if (mUniforms.isDirty()) {
-        driver.loadUniformBuffer(mUbHandle, mUniforms.toBufferDescriptor(driver));
+        const size_t offset = mUniforms.getDirtyOffset();
+        const size_t size = mUniforms.getDirtySize();
+        driver.updateUniformBuffer(mUbHandle,
+                mUniforms.toBufferDescriptor(driver, offset, size), uint32_t(offset));
     }
     if (mSamplers.isDirty()) {
         driver.updateSamplerGroup(mSbHandle, std::move(mSamplers.toCommandStream()));
     }
+    mParametersVersion++;
 }
 
 template<typename T, typename>
@@ -152,6 +156,23 @@ void FMaterialInstance::setParameter(const char* name,
     mSamplers.setSampler(index, { texture, params });
 }
 
+void FMaterialInstance::setParameter(ParameterHandle handle,
+        Texture const* texture, TextureSampler const& sampler) noexcept {
+    if (ASSERT_PRECONDITION_NON_FATAL(handle.mMaterial == mMaterial && handle.mIsSampler,
+            "invalid sampler parameter handle")) {
+        mSamplers.setSampler(handle.mOffset,
+                { upcast(texture)->getHwHandle(), sampler.getSamplerParams() });
+    }
+}
+
+template <typename T, typename>
+void FMaterialInstance::setParameters(MaterialInstance* const* instances, ParameterHandle handle,
+        const T* values, size_t count) noexcept {
+    for (size_t i = 0; i < count; i++) {
+        upcast(instances[i])->setParameter<T>(handle, values[i]);
+    }
+}
+
 void FMaterialInstance::setDoubleSided(bool doubleSided) noexcept {
     if (!mMaterial->hasDoubleSidedCapability()) {
         slog.w << "Parent material does not have double-sided capability." << io::endl;
@@ -165,18 +186,22 @@ void FMaterialInstance::setDoubleSided(bool doubleSided) noexcept {
 
 void FMaterialInstance::setCullingMode(CullingMode culling) noexcept {
     mCulling = culling;
+    mMaterial->getEngine().invalidateMaterialInstanceState();
 }
 
 void FMaterialInstance::setColorWrite(bool enable) noexcept {
     mColorWrite = enable;
+    mMaterial->getEngine().invalidateMaterialInstanceState();
 }
 
 void FMaterialInstance::setDepthWrite(bool enable) noexcept {
     mDepthWrite = enable;
+    mMaterial->getEngine().invalidateMaterialInstanceState();
 }
 
 void FMaterialInstance::setDepthCulling(bool enable) noexcept {
     mDepthFunc = enable ? RasterState::DepthFunc::GE : RasterState::DepthFunc::A;
+    mMaterial->getEngine().invalidateMaterialInstanceState();
 }
 
 const char* FMaterialInstance::getName() const noexcept {
@@ -227,6 +252,25 @@ template UTILS_NOINLINE void FMaterialInstance::setParameter<float4>  (const cha
 template UTILS_NOINLINE void FMaterialInstance::setParameter<mat3f>   (const char* name, const mat3f    *v, size_t c) noexcept;
 template UTILS_NOINLINE void FMaterialInstance::setParameter<mat4f>   (const char* name, const mat4f    *v, size_t c) noexcept;
 
+template UTILS_NOINLINE void FMaterialInstance::setParameters<bool>    (MaterialInstance* const* i, ParameterHandle h, const bool    *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<float>   (MaterialInstance* const* i, ParameterHandle h, const float   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<int32_t> (MaterialInstance* const* i, ParameterHandle h, const int32_t *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<uint32_t>(MaterialInstance* const* i, ParameterHandle h, const uint32_t*v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<bool2>   (MaterialInstance* const* i, ParameterHandle h, const bool2   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<bool3>   (MaterialInstance* const* i, ParameterHandle h, const bool3   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<bool4>   (MaterialInstance* const* i, ParameterHandle h, const bool4   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<int2>    (MaterialInstance* const* i, ParameterHandle h, const int2    *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<int3>    (MaterialInstance* const* i, ParameterHandle h, const int3    *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<int4>    (MaterialInstance* const* i, ParameterHandle h, const int4    *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<uint2>   (MaterialInstance* const* i, ParameterHandle h, const uint2   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<uint3>   (MaterialInstance* const* i, ParameterHandle h, const uint3   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<uint4>   (MaterialInstance* const* i, ParameterHandle h, const uint4   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<float2>  (MaterialInstance* const* i, ParameterHandle h, const float2  *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<float3>  (MaterialInstance* const* i, ParameterHandle h, const float3  *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<float4>  (MaterialInstance* const* i, ParameterHandle h, const float4  *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<mat3f>   (MaterialInstance* const* i, ParameterHandle h, const mat3f   *v, size_t c) noexcept;
+template UTILS_NOINLINE void FMaterialInstance::setParameters<mat4f>   (MaterialInstance* const* i, ParameterHandle h, const mat4f   *v, size_t c) noexcept;
+
 Material const* MaterialInstance::getMaterial() const noexcept {
     return upcast(this)->getMaterial();
 }
@@ -283,6 +327,83 @@ template UTILS_PUBLIC void MaterialInstance::setParameter<float4>  (const char*
 template UTILS_PUBLIC void MaterialInstance::setParameter<mat3f>   (const char* name, const mat3f    *v, size_t c) noexcept;
 template UTILS_PUBLIC void MaterialInstance::setParameter<mat4f>   (const char* name, const mat4f    *v, size_t c) noexcept;
 
+template <typename T, typename>
+void MaterialInstance::setParameter(ParameterHandle handle, T value) noexcept {
+    upcast(this)->setParameter<T>(handle, value);
+}
+
+template <typename T, typename>
+void MaterialInstance::setParameter(ParameterHandle handle, const T* value, size_t count) noexcept {
+    upcast(this)->setParameter<T>(handle, value, count);
+}
+
+template <typename T, typename>
+void MaterialInstance::setParameters(MaterialInstance* const* instances, ParameterHandle handle,
+        const T* values, size_t count) noexcept {
+    FMaterialInstance::setParameters<T>(instances, handle, values, count);
+}
+
+// explicit template instantiation of our supported types
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool>    (ParameterHandle h, bool     v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float>   (ParameterHandle h, float    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int32_t> (ParameterHandle h, int32_t  v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint32_t>(ParameterHandle h, uint32_t v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool2>   (ParameterHandle h, bool2    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool3>   (ParameterHandle h, bool3    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool4>   (ParameterHandle h, bool4    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int2>    (ParameterHandle h, int2     v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int3>    (ParameterHandle h, int3     v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int4>    (ParameterHandle h, int4     v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint2>   (ParameterHandle h, uint2    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint3>   (ParameterHandle h, uint3    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint4>   (ParameterHandle h, uint4    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float2>  (ParameterHandle h, float2   v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float3>  (ParameterHandle h, float3   v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float4>  (ParameterHandle h, float4   v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<mat3f>   (ParameterHandle h, mat3f    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<mat4f>   (ParameterHandle h, mat4f    v) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool>    (ParameterHandle h, const bool    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float>   (ParameterHandle h, const float   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int32_t> (ParameterHandle h, const int32_t *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint32_t>(ParameterHandle h, const uint32_t*v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool2>   (ParameterHandle h, const bool2   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool3>   (ParameterHandle h, const bool3   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<bool4>   (ParameterHandle h, const bool4   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int2>    (ParameterHandle h, const int2    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int3>    (ParameterHandle h, const int3    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<int4>    (ParameterHandle h, const int4    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint2>   (ParameterHandle h, const uint2   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint3>   (ParameterHandle h, const uint3   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<uint4>   (ParameterHandle h, const uint4   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float2>  (ParameterHandle h, const float2  *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float3>  (ParameterHandle h, const float3  *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<float4>  (ParameterHandle h, const float4  *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<mat3f>   (ParameterHandle h, const mat3f   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameter<mat4f>   (ParameterHandle h, const mat4f   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<bool>    (MaterialInstance* const* i, ParameterHandle h, const bool    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<float>   (MaterialInstance* const* i, ParameterHandle h, const float   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<int32_t> (MaterialInstance* const* i, ParameterHandle h, const int32_t *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<uint32_t>(MaterialInstance* const* i, ParameterHandle h, const uint32_t*v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<bool2>   (MaterialInstance* const* i, ParameterHandle h, const bool2   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<bool3>   (MaterialInstance* const* i, ParameterHandle h, const bool3   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<bool4>   (MaterialInstance* const* i, ParameterHandle h, const bool4   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<int2>    (MaterialInstance* const* i, ParameterHandle h, const int2    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<int3>    (MaterialInstance* const* i, ParameterHandle h, const int3    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<int4>    (MaterialInstance* const* i, ParameterHandle h, const int4    *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<uint2>   (MaterialInstance* const* i, ParameterHandle h, const uint2   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<uint3>   (MaterialInstance* const* i, ParameterHandle h, const uint3   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<uint4>   (MaterialInstance* const* i, ParameterHandle h, const uint4   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<float2>  (MaterialInstance* const* i, ParameterHandle h, const float2  *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<float3>  (MaterialInstance* const* i, ParameterHandle h, const float3  *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<float4>  (MaterialInstance* const* i, ParameterHandle h, const float4  *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<mat3f>   (MaterialInstance* const* i, ParameterHandle h, const mat3f   *v, size_t c) noexcept;
+template UTILS_PUBLIC void MaterialInstance::setParameters<mat4f>   (MaterialInstance* const* i, ParameterHandle h, const mat4f   *v, size_t c) noexcept;
+
+void MaterialInstance::setParameter(ParameterHandle handle, Texture const* texture,
+        TextureSampler const& sampler) noexcept {
+    upcast(this)->setParameter(handle, texture, sampler);
+}
+
 void MaterialInstance::setParameter(const char* name, Texture const* texture,
         TextureSampler const& sampler) noexcept {
     return upcast(this)->setParameter(name, texture, sampler);
@@ -233,6 +233,10 @@ bool MaterialParser::hasCustomDepthShader(bool* value) const noexcept {
     return mImpl.getFromSimpleChunk(ChunkType::MaterialHasCustomDepthShader, value);
 }
 
+bool MaterialParser::isInstanced(bool* value) const noexcept {
+    return mImpl.getFromSimpleChunk(ChunkType::MaterialInstanced, value);
+}
+
 bool MaterialParser::hasSpecularAntiAliasing(bool* value) const noexcept {
     return mImpl.getFromSimpleChunk(ChunkType::MaterialSpecularAntiAliasing, value);
 }
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "details/OcclusionCuller.h"
+
+#include <utils/Systrace.h>
+
+#include <math/scalar.h>
+#include <math/vec2.h>
+#include <math/vec4.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include <assert.h>
+#include <math.h>
+
+using namespace filament::math;
+
+namespace filament {
+
+// Computes the clip-space coordinates of the 8 corners of a box. Corner i is at
+// center + extent * (i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1)
+static void computeClipSpaceCorners(float4 corners[8], mat4f const& clipFromWorld,
+        float3 const& center, float3 const& extent) noexcept {
+    const float4 c = clipFromWorld * float4{ center, 1.0f };
+    const float4 dx = clipFromWorld[0] * extent.x;
+    const float4 dy = clipFromWorld[1] * extent.y;
+    const float4 dz = clipFromWorld[2] * extent.z;
+    for (size_t i = 0; i < 8; i++) {
+        corners[i] = c + ((i & 1u) ? dx : -dx) + ((i & 2u) ? dy : -dy) + ((i & 4u) ? dz : -dz);
+    }
+}
+
+// a corner is usable if it's in front of the near plane
+static inline bool isInFrontOfNearPlane(float4 const& p) noexcept {
+    return p.w > 0.0f && p.z >= -p.w;
+}
+
+void OcclusionCuller::begin(mat4f const& clipFromWorld, uint32_t width, uint32_t height) {
+    assert(width > 0 && height > 0);
+
+    mClipFromWorld = clipFromWorld;
+    if (width != mWidth || height != mHeight) {
+        mWidth = width;
+        mHeight = height;
+        mLevels.clear();
+        uint32_t offset = 0;
+        uint32_t w = width;
+        uint32_t h = height;
+        mLevels.push_back({ offset, w, h });
+        while (w > 1 || h > 1) {
+            offset += w * h;
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+            mLevels.push_back({ offset, w, h });
+        }
+        mDepth.resize(offset + w * h);
+    }
+
+    // only the depth buffer needs to be cleared, the other levels are computed from it
+    std::fill_n(mDepth.data(), width * height, std::numeric_limits<float>::infinity());
+}
+
+bool OcclusionCuller::rasterize(mat4f const& worldFromModel, Box const& occluder) noexcept {
+    float4 clip[8];
+    computeClipSpaceCorners(clip, mClipFromWorld * worldFromModel,
+            occluder.center, occluder.halfExtent);
+
+    // to keep things simple and avoid clipping, we ignore occluders crossing the near plane
+    float3 screen[8];
+    const float2 scale{ 0.5f * float(mWidth), 0.5f * float(mHeight) };
+    for (size_t i = 0; i < 8; i++) {
+        if (!isInFrontOfNearPlane(clip[i])) {
+            return false;
+        }
+        const float3 ndc = clip[i].xyz / clip[i].w;
+        screen[i] = { (ndc.xy + 1.0f) * scale, ndc.z };
+    }
+
+    // each face projects to a convex quad, the winding doesn't matter
+    static constexpr uint8_t faces[6][4] = {
+            { 0, 2, 6, 4 }, { 1, 3, 7, 5 },     // -x, +x
+            { 0, 1, 5, 4 }, { 2, 3, 7, 6 },     // -y, +y
+            { 0, 1, 3, 2 }, { 4, 5, 7, 6 },     // -z, +z
+    };
+    for (auto const& face : faces) {
+        rasterizeQuad({ screen[face[0]], screen[face[1]], screen[face[2]], screen[face[3]] });
+    }
+    return true;
+}
+
+void OcclusionCuller::rasterizeQuad(std::array<float3, 4> v) noexcept {
+    // we want a counter-clockwise quad
+    const float area = 0.5f * (
+            (v[0].x * v[1].y - v[1].x * v[0].y) + (v[1].x * v[2].y - v[2].x * v[1].y) +
+            (v[2].x * v[3].y - v[3].x * v[2].y) + (v[3].x * v[0].y - v[0].x * v[3].y));
+    if (area < 0.0f) {
+        std::swap(v[1], v[3]);
+    }
+    if (std::abs(area) < std::numeric_limits<float>::min()) {
+        return;
+    }
+
+    const float xmin = std::min({ v[0].x, v[1].x, v[2].x, v[3].x });
+    const float ymin = std::min({ v[0].y, v[1].y, v[2].y, v[3].y });
+    const float xmax = std::max({ v[0].x, v[1].x, v[2].x, v[3].x });
+    const float ymax = std::max({ v[0].y, v[1].y, v[2].y, v[3].y });
+    if (xmax < 0.0f || ymax < 0.0f || xmin >= float(mWidth) || ymin >= float(mHeight)) {
+        return;
+    }
+
+    // the vertices can be far off-screen, so clamp to the viewport before converting to integers
+    const float w = float(mWidth - 1);
+    const float h = float(mHeight - 1);
+    const int32_t x0 = int32_t(clamp(std::floor(xmin), 0.0f, w));
+    const int32_t y0 = int32_t(clamp(std::floor(ymin), 0.0f, h));
+    const int32_t x1 = int32_t(clamp(std::ceil(xmax), 0.0f, w));
+    const int32_t y1 = int32_t(clamp(std::ceil(ymax), 0.0f, h));
+
+    // edge functions e(p) = a * p.x + b * p.y + c of the edge from v[i] to v[i+1], positive
+    // inside the quad
+    float a[4], b[4], c[4];
+    for (size_t i = 0; i < 4; i++) {
+        float3 const& p0 = v[i];
+        float3 const& p1 = v[(i + 1) % 4];
+        a[i] = p0.y - p1.y;
+        b[i] = p1.x - p0.x;
+        c[i] = p0.x * p1.y - p0.y * p1.x;
+    }
+
+    // The quad is planar, so its depth is linear in screen space after the perspective divide.
+    // We compute it from the largest of the two triangles (v0, v1, v2) and (v2, v3, v0), whose
+    // edge functions normalized by their area are the barycentric coordinates.
+    const float area012 = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+    const float area230 = (v[3].x - v[2].x) * (v[0].y - v[2].y) - (v[3].y - v[2].y) * (v[0].x - v[2].x);
+    const size_t t = area012 >= area230 ? 0 : 2;
+    float3 const& t0 = v[t];
+    float3 const& t1 = v[t + 1];
+    float3 const& t2 = v[(t + 2) % 4];
+    const float ta0 = t1.y - t2.y, tb0 = t2.x - t1.x, tc0 = t1.x * t2.y - t1.y * t2.x;
+    const float ta1 = t2.y - t0.y, tb1 = t0.x - t2.x, tc1 = t2.x * t0.y - t2.y * t0.x;
+    const float ta2 = t0.y - t1.y, tb2 = t1.x - t0.x, tc2 = t0.x * t1.y - t0.y * t1.x;
+    const float oneOverArea = 1.0f / std::max(area012, area230);
+    const float za = (ta0 * t0.z + ta1 * t1.z + ta2 * t2.z) * oneOverArea;
+    const float zb = (tb0 * t0.z + tb1 * t1.z + tb2 * t2.z) * oneOverArea;
+    const float zc = (tc0 * t0.z + tc1 * t1.z + tc2 * t2.z) * oneOverArea;
+
+    // Occluders must be rasterized conservatively: a pixel is written only if the quad covers
+    // it entirely, and with the farthest depth of the quad over the pixel. We still evaluate
+    // everything at the pixel centers, but offset the edge functions by their largest decrease
+    // (and the depth by its largest increase) within half a pixel.
+    for (size_t i = 0; i < 4; i++) {
+        c[i] -= 0.5f * (std::abs(a[i]) + std::abs(b[i]));
+    }
+    const float zOffset = 0.5f * (std::abs(za) + std::abs(zb));
+
+    float* const UTILS_RESTRICT depth = mDepth.data();
+    for (int32_t y = y0; y <= y1; y++) {
+        const float py = float(y) + 0.5f;
+        const float e0y = b[0] * py + c[0];
+        const float e1y = b[1] * py + c[1];
+        const float e2y = b[2] * py + c[2];
+        const float e3y = b[3] * py + c[3];
+        const float zy = zb * py + zc + zOffset;
+        float* const UTILS_RESTRICT row = depth + size_t(y) * mWidth;
+
+        // this loop is written so that the compiler can vectorize it
+        #pragma clang loop vectorize(enable)
+        for (int32_t x = x0; x <= x1; x++) {
+            const float px = float(x) + 0.5f;
+            const float e0 = a[0] * px + e0y;
+            const float e1 = a[1] * px + e1y;
+            const float e2 = a[2] * px + e2y;
+            const float e3 = a[3] * px + e3y;
+            const float z = za * px + zy;
+            const bool inside = (e0 >= 0.0f) & (e1 >= 0.0f) & (e2 >= 0.0f) & (e3 >= 0.0f);
+            const float d = row[x];
+            row[x] = (inside & (z < d)) ? z : d;
+        }
+    }
+}
+
+void OcclusionCuller::buildHierarchy() noexcept {
+    SYSTRACE_CALL();
+
+    float* const UTILS_RESTRICT depth = mDepth.data();
+    for (size_t l = 1, c = mLevels.size(); l < c; l++) {
+        Level const& src = mLevels[l - 1];
+        Level const& dst = mLevels[l];
+        float const* const UTILS_RESTRICT s = depth + src.offset;
+        float* const UTILS_RESTRICT d = depth + dst.offset;
+        for (uint32_t y = 0; y < dst.height; y++) {
+            const uint32_t sy0 = 2 * y;
+            const uint32_t sy1 = std::min(sy0 + 1, src.height - 1);
+            for (uint32_t x = 0; x < dst.width; x++) {
+                const uint32_t sx0 = 2 * x;
+                const uint32_t sx1 = std::min(sx0 + 1, src.width - 1);
+                d[y * dst.width + x] = std::max(
+                        std::max(s[sy0 * src.width + sx0], s[sy0 * src.width + sx1]),
+                        std::max(s[sy1 * src.width + sx0], s[sy1 * src.width + sx1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(float3 const& center, float3 const& extent) const noexcept {
+    float4 clip[8];
+    computeClipSpaceCorners(clip, mClipFromWorld, center, extent);
+
+    float2 lo{ std::numeric_limits<float>::max() };
+    float2 hi{ std::numeric_limits<float>::lowest() };
+    float nearest = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < 8; i++) {
+        if (!isInFrontOfNearPlane(clip[i])) {
+            return true;
+        }
+        const float3 ndc = clip[i].xyz / clip[i].w;
+        lo = min(lo, ndc.xy);
+        hi = max(hi, ndc.xy);
+        nearest = std::min(nearest, ndc.z);
+    }
+
+    // the screen-space rectangle covered by the box, in pixels
+    const float2 scale{ 0.5f * float(mWidth), 0.5f * float(mHeight) };
+    lo = (lo + 1.0f) * scale;
+    hi = (hi + 1.0f) * scale;
+    if (hi.x < 0.0f || hi.y < 0.0f || lo.x >= float(mWidth) || lo.y >= float(mHeight)) {
+        // entirely off-screen, this is the frustum culler's business
+        return true;
+    }
+    // clamp in float, the corners can be far off-screen
+    uint32_t x0 = uint32_t(std::max(0.0f, lo.x));
+    uint32_t y0 = uint32_t(std::max(0.0f, lo.y));
+    uint32_t x1 = uint32_t(std::min(float(mWidth  - 1), hi.x));
+    uint32_t y1 = uint32_t(std::min(float(mHeight - 1), hi.y));
+
+    // find the level where the rectangle covers at most 2x2 texels
+    size_t l = 0;
+    while (x1 - x0 > 1 || y1 - y0 > 1) {
+        x0 >>= 1u;
+        y0 >>= 1u;
+        x1 >>= 1u;
+        y1 >>= 1u;
+        l++;
+    }
+
+    Level const& level = mLevels[l];
+    float const* const d = mDepth.data() + level.offset;
+    float farthest = std::max(
+            std::max(d[y0 * level.width + x0], d[y0 * level.width + x1]),
+            std::max(d[y1 * level.width + x0], d[y1 * level.width + x1]));
+
+    return nearest <= farthest;
+}
+
+size_t OcclusionCuller::cull(Culler::result_type* UTILS_RESTRICT results,
+        float3 const* UTILS_RESTRICT center, float3 const* UTILS_RESTRICT extent,
+        size_t count, size_t bit) const noexcept {
+    const Culler::result_type mask = Culler::result_type(1u << bit);
+    size_t culled = 0;
+    for (size_t i = 0; i < count; i++) {
+        if ((results[i] & mask) && !isVisible(center[i], extent[i])) {
+            results[i] = Culler::result_type(results[i] & ~mask);
+            culled++;
+        }
+    }
+    return culled;
+}
+
+// For testing...
+
+void OcclusionCuller::Test::begin(OcclusionCuller& culler,
+        mat4f const& clipFromWorld, uint32_t width, uint32_t height) {
+    culler.begin(clipFromWorld, width, height);
+}
+
+bool OcclusionCuller::Test::rasterize(OcclusionCuller& culler,
+        mat4f const& worldFromModel, Box const& occluder) noexcept {
+    return culler.rasterize(worldFromModel, occluder);
+}
+
+void OcclusionCuller::Test::buildHierarchy(OcclusionCuller& culler) noexcept {
+    culler.buildHierarchy();
+}
+
+size_t OcclusionCuller::Test::cull(OcclusionCuller const& culler, Culler::result_type* results,
+        float3 const* center, float3 const* extent, size_t count, size_t bit) noexcept {
+    return culler.cull(results, center, extent, count, bit);
+}
+
+} // namespace filament
@@ -30,6 +30,7 @@
 #include <utils/JobSystem.h>
 #include <utils/Systrace.h>
 
+#include <algorithm>
 #include <utility>
 
 using namespace utils;
@@ -159,19 +160,351 @@ RenderPass::Command* RenderPass::sortCommands() noexcept {
 
     GrowingSlice<Command>& commands = mCommands;
 
-    std::sort(commands.begin(), commands.end());
-
-    // find the last command
-    Command const* const last = std::partition_point(commands.begin(), commands.end(),
+    // Trim the sentinels before sorting, there are a lot of them (e.g. the color pass generates
+    // one for each opaque primitive), and they'd all end-up at the end anyway.
+    Command* const last = std::remove_if(commands.begin(), commands.end(),
             [](Command const& c) {
-                return c.key != uint64_t(Pass::SENTINEL);
+                return c.key == uint64_t(Pass::SENTINEL);
             });
 
-    commands.resize(uint32_t(last - commands.begin()));
+    const size_t count = last - commands.begin();
+
+    // The storage past the last command is unused at this point (newCommandBuffer() would
+    // start there), so the radix and parallel sorts can use it as their scratch buffer.
+    const size_t available = commands.capacity() - count;
+    const int parallelSortMinCommands = mEngine.debug.renderer.parallelSortMinCommands;
+    if (UTILS_UNLIKELY(available < count)) {
+        std::sort(commands.begin(), last);
+    } else if (parallelSortMinCommands > 0 && count >= size_t(parallelSortMinCommands)) {
+        parallelSortCommands(mEngine.getJobSystem(), commands.begin(), last, last);
+    } else {
+        sortCommandsChunk(commands.begin(), last, last);
+    }
+
+    commands.resize(uint32_t(count));
 
     return commands.end();
 }
 
+/* static */
+void RenderPass::sortCommandsChunk(Command* first, Command* last, Command* scratch) noexcept {
+    if (size_t(last - first) >= RADIX_SORT_MIN_COMMANDS_COUNT) {
+        radixSortCommands(first, last, scratch);
+    } else {
+        std::sort(first, last);
+    }
+}
+
+/* static */
+void RenderPass::parallelSortCommands(JobSystem& js,
+        Command* const first, Command* const last, Command* const scratch) noexcept {
+    SYSTRACE_CALL();
+
+    const size_t count = last - first;
+
+    // one chunk per thread (roughly), rounded to a power of two so we can merge them pairwise
+    const size_t chunkCount = std::min(PARALLEL_SORT_MAX_CHUNK_COUNT,
+            size_t(1) << js.getParallelSplitCount());
+    if (chunkCount < 2 || count < chunkCount * RADIX_SORT_MIN_COMMANDS_COUNT) {
+        sortCommandsChunk(first, last, scratch);
+        return;
+    }
+
+    size_t bounds[PARALLEL_SORT_MAX_CHUNK_COUNT + 1];
+    for (size_t i = 0; i <= chunkCount; i++) {
+        bounds[i] = (count * i) / chunkCount;
+    }
+
+    // sort each chunk independently, each one uses its own part of the scratch buffer
+    JobSystem::Job* sortJobs = js.createJob();
+    for (size_t i = 0; i < chunkCount; i++) {
+        const size_t b = bounds[i];
+        const size_t e = bounds[i + 1];
+        js.run(js.createJob(sortJobs, [first, scratch, b, e](JobSystem&, JobSystem::Job*) {
+            sortCommandsChunk(first + b, first + e, scratch + b);
+        }));
+    }
+    { // scope for systrace
+        SYSTRACE_NAME("sortChunks");
+        js.runAndWait(sortJobs);
+    }
+
+    // merge the sorted chunks pairwise, ping-ponging between the commands and scratch buffers
+    Command* src = first;
+    Command* dst = scratch;
+    for (size_t width = 1; width < chunkCount; width *= 2) {
+        SYSTRACE_NAME("mergeChunks");
+        JobSystem::Job* mergeJobs = js.createJob();
+        for (size_t i = 0; i < chunkCount; i += 2 * width) {
+            const size_t b = bounds[i];
+            const size_t m = bounds[i + width];
+            const size_t e = bounds[i + 2 * width];
+            js.run(js.createJob(mergeJobs, [src, dst, b, m, e](JobSystem&, JobSystem::Job*) {
+                std::merge(src + b, src + m, src + m, src + e, dst + b);
+            }));
+        }
+        js.runAndWait(mergeJobs);
+        std::swap(src, dst);
+    }
+
+    if (src != first) {
+        std::copy(src, src + count, first);
+    }
+}
+
+/* static */
+UTILS_NOINLINE
+void RenderPass::radixSortCommands(Command* const UTILS_RESTRICT first,
+        Command* const UTILS_RESTRICT last, Command* const UTILS_RESTRICT scratch) noexcept {
+    SYSTRACE_CALL();
+
+    constexpr size_t DIGIT_COUNT = sizeof(CommandKey);
+    constexpr size_t RADIX = 256;
+
+    const size_t count = last - first;
+    if (count < 2) {
+        return;
+    }
+
+    // compute the histograms of all digits in a single pass
+    uint32_t histograms[DIGIT_COUNT][RADIX] = {};
+    for (Command const* UTILS_RESTRICT curr = first; curr != last; ++curr) {
+        const CommandKey key = curr->key;
+        #pragma clang loop unroll(full)
+        for (size_t d = 0; d < DIGIT_COUNT; d++) {
+            histograms[d][(key >> (d * 8u)) & 0xFFu]++;
+        }
+    }
+
+    const CommandKey firstKey = first->key;
+    Command* UTILS_RESTRICT src = first;
+    Command* UTILS_RESTRICT dst = scratch;
+    for (size_t d = 0; d < DIGIT_COUNT; d++) {
+        uint32_t* const UTILS_RESTRICT histogram = histograms[d];
+        const unsigned shift = d * 8u;
+
+        // if all the commands have the same digit, this pass wouldn't change the order
+        if (histogram[(firstKey >> shift) & 0xFFu] == count) {
+            continue;
+        }
+
+        // turn the histogram into the starting offsets of each bucket
+        uint32_t offset = 0;
+        for (size_t i = 0; i < RADIX; i++) {
+            const uint32_t c = histogram[i];
+            histogram[i] = offset;
+            offset += c;
+        }
+
+        // scatter, this is stable which is what makes LSD radix sort work
+        Command const* const end = src + count;
+        for (Command const* UTILS_RESTRICT curr = src; curr != end; ++curr) {
+            dst[histogram[(curr->key >> shift) & 0xFFu]++] = *curr;
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != first) {
+        std::copy(src, src + count, first);
+    }
+}
+
+RenderPass::Command* RenderPass::appendSortedCommands(CommandTypeFlags const commandTypeFlags,
+        CommandCache* const cache) noexcept {
+    assert(mCommands.empty());
+
+    if (!cache) {
+        appendCommands(commandTypeFlags);
+        return sortCommands();
+    }
+
+    SYSTRACE_CALL();
+
+    if (UTILS_UNLIKELY(mVisibleRenderables.empty())) {
+        cache->invalidate();
+        return mCommands.end();
+    }
+    assert(mRenderableSoa);
+
+    updateCommandCacheState(*cache, commandTypeFlags);
+    if (!patchCachedCommands(*cache, commandTypeFlags)) {
+        appendCommands(commandTypeFlags);
+        sortCommands();
+        storeCommandCache(*cache, commandTypeFlags);
+    }
+    return mCommands.end();
+}
+
+void RenderPass::updateCommandCacheState(CommandCache& cache,
+        uint32_t commandTypeFlags) const noexcept {
+    FScene::RenderableSoa const& soa = *mRenderableSoa;
+    FRenderableManager const& rcm = mEngine.getRenderableManager();
+    utils::Range<uint32_t> const vr = mVisibleRenderables;
+
+    const uint32_t materialInstanceStateVersion = mEngine.getMaterialInstanceStateVersion();
+    cache.mValid = cache.mValid &&
+            cache.mFirst == vr.first &&
+            cache.mRenderables.size() == vr.size() &&
+            cache.mCommandTypeFlags == commandTypeFlags &&
+            cache.mRenderFlags == mFlags &&
+            cache.mVisibilityMask == mVisibilityMask &&
+            cache.mMaterialInstanceStateVersion == materialInstanceStateVersion;
+
+    auto const* const UTILS_RESTRICT soaInstance        = soa.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* const UTILS_RESTRICT soaWorldAABBCenter = soa.data<FScene::WORLD_AABB_CENTER>();
+    auto const* const UTILS_RESTRICT soaReversedWinding = soa.data<FScene::REVERSED_WINDING_ORDER>();
+    auto const* const UTILS_RESTRICT soaVisibility      = soa.data<FScene::VISIBILITY_STATE>();
+    auto const* const UTILS_RESTRICT soaPrimitives      = soa.data<FScene::PRIMITIVES>();
+    auto const* const UTILS_RESTRICT soaBonesUbh        = soa.data<FScene::BONES_UBH>();
+    auto const* const UTILS_RESTRICT soaVisibilityMask  = soa.data<FScene::VISIBLE_MASK>();
+
+    const float3 cameraPosition(mCamera.getPosition());
+    const float3 cameraForward(mCamera.getForwardVector());
+
+    cache.mCurrent.resize(vr.size());
+    CommandCache::Renderable* const UTILS_RESTRICT current = cache.mCurrent.data();
+    for (uint32_t i : vr) {
+        CommandCache::Renderable& r = current[i - vr.first];
+        r.primitives = soaPrimitives[i].data();
+        r.primitiveCount = uint32_t(soaPrimitives[i].size());
+        r.instance = soaInstance[i].asValue();
+        r.version = rcm.getVersion(soaInstance[i]);
+        r.distanceBits = computeDistanceBits(soaWorldAABBCenter[i], cameraPosition, cameraForward);
+        r.bonesUbh = soaBonesUbh[i];
+        r.visibility = soaVisibility[i];
+        r.visibleMask = soaVisibilityMask[i];
+        r.reversedWinding = soaReversedWinding[i];
+        r.blended = false;
+    }
+
+    cache.mDirty.clear();
+    if (cache.mValid) {
+        CommandCache::Renderable const* const UTILS_RESTRICT cached = cache.mRenderables.data();
+        for (uint32_t j = 0, c = uint32_t(vr.size()); j < c; j++) {
+            if (CommandCache::isDirty(cached[j], current[j], commandTypeFlags)) {
+                cache.mDirty.push_back(j);
+            }
+        }
+    }
+}
+
+void RenderPass::storeCommandCache(CommandCache& cache, uint32_t commandTypeFlags) const noexcept {
+    utils::Range<uint32_t> const vr = mVisibleRenderables;
+
+    std::swap(cache.mRenderables, cache.mCurrent);
+    cache.mCommands.assign(mCommands.begin(), mCommands.end());
+
+    // remember which renderables are blended, their distance to the camera must be exact
+    CommandCache::Renderable* const UTILS_RESTRICT renderables = cache.mRenderables.data();
+    for (Command const& command : mCommands) {
+        if ((command.key & PASS_MASK) == uint64_t(Pass::BLENDED)) {
+            renderables[command.primitive.index - vr.first].blended = true;
+        }
+    }
+
+    cache.mFirst = vr.first;
+    cache.mCommandTypeFlags = commandTypeFlags;
+    cache.mRenderFlags = mFlags;
+    cache.mVisibilityMask = mVisibilityMask;
+    cache.mMaterialInstanceStateVersion = mEngine.getMaterialInstanceStateVersion();
+    cache.mRegeneratedCount = vr.size();
+    cache.mValid = true;
+}
+
+bool RenderPass::patchCachedCommands(CommandCache& cache, uint32_t commandTypeFlags) noexcept {
+    utils::Range<uint32_t> const vr = mVisibleRenderables;
+    std::vector<uint32_t> const& dirty = cache.mDirty;
+
+    if (!cache.mValid || dirty.size() > size_t(float(vr.size()) * COMMAND_CACHE_MAX_DIRTY_RATIO)) {
+        return false;
+    }
+
+    SYSTRACE_VALUE32("dirtyRenderables", dirty.size());
+
+    GrowingSlice<Command>& commands = mCommands;
+    CommandCache::Renderable const* const UTILS_RESTRICT current = cache.mCurrent.data();
+
+    const bool colorPass  = bool(commandTypeFlags & CommandTypeFlags::COLOR);
+    const bool depthPass  = bool(commandTypeFlags & CommandTypeFlags::DEPTH);
+    const size_t commandsPerPrimitive = colorPass * 2 + depthPass;
+
+    size_t generatedCount = 0;
+    for (uint32_t j : dirty) {
+        generatedCount += current[j].primitiveCount * commandsPerPrimitive;
+    }
+
+    // The command buffer is laid out as follows:
+    // [ merged commands | new commands | sort scratch ]
+    // the merged commands can't overwrite the new commands before they're consumed, because
+    // there are at most (cached + new) merged commands.
+    const size_t cachedCount = cache.mCommands.size();
+    if (commands.capacity() < cachedCount + 3 * generatedCount) {
+        return false;
+    }
+
+    Command* const base = commands.begin();
+    Command* const generated = base + cachedCount + generatedCount;
+
+    // generate the commands of the renderables that changed
+    const float3 cameraPosition(mCamera.getPosition());
+    const float3 cameraForward(mCamera.getForwardVector());
+    FScene::RenderableSoa const& soa = *mRenderableSoa;
+    Command* curr = generated;
+    for (uint32_t j : dirty) {
+        const uint32_t i = vr.first + j;
+        generateCommandsAt(commandTypeFlags, curr, soa, { i, i + 1 },
+                mFlags, mVisibilityMask, cameraPosition, cameraForward);
+        curr += current[j].primitiveCount * commandsPerPrimitive;
+    }
+
+    Command* const generatedLast = std::remove_if(generated, curr,
+            [](Command const& c) {
+                return c.key == uint64_t(Pass::SENTINEL);
+            });
+    sortCommandsChunk(generated, generatedLast, generatedLast);
+
+    // and merge them with the cached commands, skipping the stale ones
+    std::vector<uint8_t>& dirtyMask = cache.mDirtyMask;
+    dirtyMask.assign(vr.size(), 0);
+    for (uint32_t j : dirty) {
+        dirtyMask[j] = 1;
+    }
+
+    Command const* UTILS_RESTRICT a = cache.mCommands.data();
+    Command const* const aLast = a + cachedCount;
+    Command const* UTILS_RESTRICT b = generated;
+    Command const* const bLast = generatedLast;
+    Command* UTILS_RESTRICT out = base;
+    for (; a != aLast; ++a) {
+        if (dirtyMask[a->primitive.index - vr.first]) {
+            continue;
+        }
+        while (b != bLast && b->key < a->key) {
+            *out++ = *b++;
+        }
+        *out++ = *a;
+    }
+    out = std::copy(b, bLast, out);
+
+    commands.resize(uint32_t(out - base));
+    mCommandsHighWatermark = std::max(mCommandsHighWatermark, size_t(commands.size()));
+
+    // finally update the cache
+    cache.mCommands.assign(base, out);
+    CommandCache::Renderable* const UTILS_RESTRICT renderables = cache.mRenderables.data();
+    for (uint32_t j : dirty) {
+        renderables[j] = current[j];
+    }
+    for (Command const* c = generated; c != generatedLast; ++c) {
+        if ((c->key & PASS_MASK) == uint64_t(Pass::BLENDED)) {
+            renderables[c->primitive.index - vr.first].blended = true;
+        }
+    }
+    cache.mRegeneratedCount = dirty.size();
+    return true;
+}
+
 void RenderPass::execute(const char* name,
         backend::Handle<backend::HwRenderTarget> renderTarget,
         backend::RenderPassParams params) const noexcept {
@@ -234,10 +567,28 @@ void RenderPass::recordDriverCommands(FEngine::DriverApi& driver, const Command*
             driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE,
                     uboHandle, offset, sizeof(PerRenderableUib));
             if (UTILS_UNLIKELY(info.perRenderableBones)) {
+                FScene::InstanceBatches const& batches =
+                        mRenderableSoa->elementAt<FScene::INSTANCES>(info.index);
+                if (batches.count) {
+                    // instanced renderables are drawn in batches of up to CONFIG_MAX_INSTANCES,
+                    // each batch is bound in place of the bones.
+                    constexpr size_t batchSize =
+                            CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance);
+                    auto const instancesUbh =
+                            mRenderableSoa->elementAt<FScene::BONES_UBH>(info.index);
+                    uint32_t batch = batches.batch;
+                    for (uint32_t i = 0; i < batches.count; i += CONFIG_MAX_INSTANCES, batch++) {
+                        driver.bindUniformBufferRange(BindingPoints::PER_RENDERABLE_BONES,
+                                instancesUbh, batch * batchSize, batchSize);
+                        driver.draw(pipeline, info.primitiveHandle,
+                                std::min(batches.count - i, uint32_t(CONFIG_MAX_INSTANCES)));
+                    }
+                    continue;
+                }
                 driver.bindUniformBuffer(BindingPoints::PER_RENDERABLE_BONES,
                         info.perRenderableBones);
             }
-            driver.draw(pipeline, info.primitiveHandle);
+            driver.draw(pipeline, info.primitiveHandle, 1);
         }
         mCustomCommands.clear();
     }
@@ -285,6 +636,42 @@ void RenderPass::setupColorCommand(Command& cmdDraw,
     // we keep "RasterState::colorWrite" to the value set by material (could be disabled)
 }
 
+/* static */
+UTILS_ALWAYS_INLINE
+inline
+uint32_t RenderPass::computeDistanceBits(float3 center,
+        float3 cameraPosition, float3 cameraForward) noexcept {
+    // Signed distance from camera to object's center. Positive distances are in front of
+    // the camera. Some objects with a center behind the camera can still be visible
+    // so their distance will be negative (this happens a lot for the shadow map).
+
+    // Using the center is not very good with large AABBs. Instead we can try to use
+    // the closest point on the bounding sphere instead:
+    //      d = center - cameraPosition;
+    //      d -= normalize(d) * length(soaWorldAABB[i].halfExtent);
+    // However this doesn't work well at all for large planes.
+
+    // Code below is equivalent to:
+    // float3 d = center - cameraPosition;
+    // float distance = dot(d, cameraForward);
+    // but saves a couple of instruction, because part of the math can be hoisted out of the
+    // caller's loop once inlined.
+    float distance = dot(center, cameraForward) - dot(cameraPosition, cameraForward);
+
+    // We negate the distance to the camera in order to create a bit pattern that will
+    // be sorted properly, this works because:
+    // - positive distances (now negative), will still be sorted by their absolute value
+    //   due to float representation.
+    // - negative distances (now positive) will be sorted BEFORE everything else, and we
+    //   don't care too much about their order (i.e. should objects far behind the camera
+    //   be sorted first? -- unclear, and probably irrelevant).
+    //   Here, objects close to the camera (but behind) will be drawn first.
+    // An alternative that keeps the mathematical ordering is given here:
+    //   distanceBits ^= ((int32_t(distanceBits) >> 31) | 0x80000000u);
+    distance = -distance;
+    return reinterpret_cast<uint32_t&>(distance);
+}
+
 /* static */
 UTILS_NOINLINE
 void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const commands,
@@ -304,6 +691,17 @@ void RenderPass::generateCommands(uint32_t commandTypeFlags, Command* const comm
     offset *= uint32_t(colorPass * 2 + depthPass);
     Command* const curr = commands + offset;
 
+    generateCommandsAt(commandTypeFlags, curr,
+            soa, range, renderFlags, visibilityMask, cameraPosition, cameraForward);
+}
+
+/* static */
+UTILS_ALWAYS_INLINE
+inline
+void RenderPass::generateCommandsAt(uint32_t commandTypeFlags, Command* const curr,
+        FScene::RenderableSoa const& soa, Range<uint32_t> range, RenderFlags renderFlags,
+        FScene::VisibleMaskType visibilityMask, float3 cameraPosition, float3 cameraForward) noexcept {
+
     /*
      * The switch {} below is to coerce the compiler into generating different versions of
      * "generateCommandsImpl" based on which pass we're processing.
@@ -394,35 +792,8 @@ void RenderPass::generateCommandsImpl(uint32_t extraFlags,
             continue;
         }
 
-        // Signed distance from camera to object's center. Positive distances are in front of
-        // the camera. Some objects with a center behind the camera can still be visible
-        // so their distance will be negative (this happens a lot for the shadow map).
-
-        // Using the center is not very good with large AABBs. Instead we can try to use
-        // the closest point on the bounding sphere instead:
-        //      d = soaWorldAABBCenter[i] - cameraPosition;
-        //      d -= normalize(d) * length(soaWorldAABB[i].halfExtent);
-        // However this doesn't work well at all for large planes.
-
-        // Code below is equivalent to:
-        // float3 d = soaWorldAABBCenter[i] - cameraPosition;
-        // float distance = dot(d, cameraForward);
-        // but saves a couple of instruction, because part of the math is done outside of the loop.
-        float distance = dot(soaWorldAABBCenter[i], cameraForward) - dot(cameraPosition, cameraForward);
-
-
-        // We negate the distance to the camera in order to create a bit pattern that will
-        // be sorted properly, this works because:
-        // - positive distances (now negative), will still be sorted by their absolute value
-        //   due to float representation.
-        // - negative distances (now positive) will be sorted BEFORE everything else, and we
-        //   don't care too much about their order (i.e. should objects far behind the camera
-        //   be sorted first? -- unclear, and probably irrelevant).
-        //   Here, objects close to the camera (but behind) will be drawn first.
-        // An alternative that keeps the mathematical ordering is given here:
-        //   distanceBits ^= ((int32_t(distanceBits) >> 31) | 0x80000000u);
-        distance = -distance;
-        const uint32_t distanceBits = reinterpret_cast<uint32_t&>(distance);
+        const uint32_t distanceBits = computeDistanceBits(soaWorldAABBCenter[i],
+                cameraPosition, cameraForward);
 
         // calculate the per-primitive face winding order inversion
         const bool inverseFrontFaces = viewInverseFrontFaces ^ soaReversedWinding[i];
@@ -577,4 +948,63 @@ void RenderPass::updateSummedPrimitiveCounts(
     summedPrimitiveCount[vr.last] = count;
 }
 
+// ------------------------------------------------------------------------------------------------
+
+RenderPass::CommandCache::CommandCache() noexcept = default;
+
+RenderPass::CommandCache::~CommandCache() noexcept = default;
+
+void RenderPass::CommandCache::clear() noexcept {
+    mValid = false;
+    mCommands = {};
+    mRenderables = {};
+    mCurrent = {};
+    mDirty = {};
+    mDirtyMask = {};
+}
+
+uint32_t RenderPass::CommandCache::getDistanceBitsMask(
+        uint32_t commandTypeFlags, bool blended) noexcept {
+    // Depth commands and blended color commands are sorted by the full distance to the camera.
+    // Other color commands only use the part of the distance that makes the Z-bucket (the top
+    // 10 bits).
+    constexpr uint32_t Z_BUCKET_DISTANCE_MASK = uint32_t(Z_BUCKET_MASK >> Z_BUCKET_SHIFT) << 22u;
+    const bool depthPass = commandTypeFlags & CommandTypeFlags::DEPTH;
+    return (depthPass || blended) ? 0xFFFFFFFFu : Z_BUCKET_DISTANCE_MASK;
+}
+
+bool RenderPass::CommandCache::isDirty(Renderable const& cached, Renderable const& current,
+        uint32_t commandTypeFlags) noexcept {
+    const uint32_t distanceMask = getDistanceBitsMask(commandTypeFlags, cached.blended);
+    return cached.primitives != current.primitives ||
+           cached.primitiveCount != current.primitiveCount ||
+           cached.instance != current.instance ||
+           cached.version != current.version ||
+           cached.bonesUbh != current.bonesUbh ||
+           cached.visibility.priority != current.visibility.priority ||
+           cached.visibility.castShadows != current.visibility.castShadows ||
+           cached.visibility.receiveShadows != current.visibility.receiveShadows ||
+           cached.visibility.skinning != current.visibility.skinning ||
+           cached.visibility.morphing != current.visibility.morphing ||
+           cached.visibleMask != current.visibleMask ||
+           cached.reversedWinding != current.reversedWinding ||
+           ((cached.distanceBits ^ current.distanceBits) & distanceMask);
+}
+
+// For testing...
+
+void RenderPass::Test::sortCommands(Command* first, Command* last) noexcept {
+    std::sort(first, last);
+}
+
+void RenderPass::Test::radixSortCommands(Command* first, Command* last,
+        Command* scratch) noexcept {
+    RenderPass::radixSortCommands(first, last, scratch);
+}
+
+void RenderPass::Test::parallelSortCommands(JobSystem& js, Command* first, Command* last,
+        Command* scratch) noexcept {
+    RenderPass::parallelSortCommands(js, first, last, scratch);
+}
+
 } // namespace filament
@@ -31,6 +31,7 @@
 #include <utils/Slice.h>
 
 #include <limits>
+#include <vector>
 
 namespace utils {
 class JobSystem;
@@ -240,6 +241,72 @@ public:
     static constexpr RenderFlags HAS_FOG                 = 0x10;
     static constexpr RenderFlags HAS_VSM                 = 0x20;
 
+    /*
+     * CommandCache keeps the sorted and trimmed commands of a pass across frames. On the next
+     * frame, only the commands of the renderables that changed are regenerated and merged back
+     * into the cached commands. A renderable is considered changed when its per-frame state in
+     * the scene's RenderableSoa changes (visibility, winding order, bones, selected primitives),
+     * when its primitives are modified (see FRenderableManager::getVersion()), or when the part
+     * of its distance to the camera that is baked in the sorting keys changes (all of it for the
+     * depth commands and the blended commands, only the Z-bucket for the other color commands).
+     *
+     * Everything is regenerated when the set of visible renderables, the pass configuration or
+     * any MaterialInstance state changes.
+     *
+     * A CommandCache must always be used with the same pass (e.g. the color pass of a View).
+     */
+    class CommandCache {
+    public:
+        CommandCache() noexcept;
+        CommandCache(CommandCache const& rhs) = delete;
+        CommandCache& operator=(CommandCache const& rhs) = delete;
+        ~CommandCache() noexcept;
+
+        // forces all commands to be regenerated next time
+        void invalidate() noexcept { mValid = false; }
+
+        // invalidates the cache and frees its memory
+        void clear() noexcept;
+
+        // number of renderables regenerated the last time the cache was used
+        size_t getRegeneratedRenderableCount() const noexcept { return mRegeneratedCount; }
+
+    private:
+        friend class RenderPass;
+
+        struct Renderable {
+            FRenderPrimitive const* primitives = nullptr;
+            uint32_t primitiveCount = 0;
+            uint32_t instance = 0;
+            uint32_t version = 0;
+            uint32_t distanceBits = 0;
+            backend::Handle<backend::HwUniformBuffer> bonesUbh;
+            FRenderableManager::Visibility visibility{};
+            FScene::VisibleMaskType visibleMask = 0;
+            bool reversedWinding = false;
+            bool blended = false;   // whether this renderable generated BLENDED commands
+        };
+
+        // the bits of the distance to the camera that are baked in the sorting keys
+        static uint32_t getDistanceBitsMask(uint32_t commandTypeFlags, bool blended) noexcept;
+
+        static bool isDirty(Renderable const& cached, Renderable const& current,
+                uint32_t commandTypeFlags) noexcept;
+
+        std::vector<Command> mCommands;
+        std::vector<Renderable> mRenderables;
+        std::vector<Renderable> mCurrent;
+        std::vector<uint32_t> mDirty;
+        std::vector<uint8_t> mDirtyMask;
+        size_t mRegeneratedCount = 0;
+        uint32_t mFirst = 0;
+        uint32_t mCommandTypeFlags = 0;
+        uint32_t mMaterialInstanceStateVersion = 0;
+        FScene::VisibleMaskType mVisibilityMask = 0;
+        RenderFlags mRenderFlags = 0;
+        bool mValid = false;
+    };
+
 
     RenderPass(FEngine& engine, utils::GrowingSlice<Command> commands) noexcept;
     RenderPass(RenderPass const& rhs);
@@ -280,6 +347,12 @@ public:
     // the new mCommands.end()
     Command* sortCommands() noexcept;
 
+    // Equivalent to appendCommands() followed by sortCommands() when cache is null. Otherwise,
+    // the cached commands are reused and only the ones that changed are regenerated.
+    // This must be called on an empty command buffer (i.e. after newCommandBuffer()).
+    // returns mCommands.end()
+    Command* appendSortedCommands(CommandTypeFlags commandTypeFlags, CommandCache* cache) noexcept;
+
     void execute(const char* name,
             backend::Handle<backend::HwRenderTarget> renderTarget,
             backend::RenderPassParams params) const noexcept;
@@ -293,6 +366,19 @@ public:
         return mCommandsHighWatermark * sizeof(Command);
     }
 
+    struct UTILS_PUBLIC Test {
+        // sorts [first, last) with std::sort, this is the reference implementation
+        static void sortCommands(Command* first, Command* last) noexcept;
+
+        // sorts [first, last) with the radix sort, scratch must hold at least (last - first)
+        // commands and must not overlap [first, last)
+        static void radixSortCommands(Command* first, Command* last, Command* scratch) noexcept;
+
+        // sorts [first, last) with the parallel sort, scratch has the same requirements as above
+        static void parallelSortCommands(utils::JobSystem& js,
+                Command* first, Command* last, Command* scratch) noexcept;
+    };
+
 private:
     friend class FRenderer;
 
@@ -305,10 +391,47 @@ private:
     static_assert(JOBS_PARALLEL_FOR_COMMANDS_SIZE % utils::CACHELINE_SIZE == 0,
             "Size of Commands jobs must be multiple of a cache-line size");
 
+    // below this many commands, std::sort is faster than the radix sort because we have to
+    // build and scan the histograms
+    static constexpr size_t RADIX_SORT_MIN_COMMANDS_COUNT = 512;
+
+    // the parallel sort splits the commands in at most this many chunks (must be a power of two)
+    static constexpr size_t PARALLEL_SORT_MAX_CHUNK_COUNT = 16;
+
+    // LSD radix sort of the commands by key, 8-bits at a time. Digits that are the same for
+    // all commands (e.g. the pass) are skipped. The result is always stored in [first, last).
+    static void radixSortCommands(Command* first, Command* last, Command* scratch) noexcept;
+
+    // Sorts chunks of the commands in parallel, then merges them pairwise (also in parallel).
+    // scratch must hold at least (last - first) commands. The result is stored in [first, last).
+    static void parallelSortCommands(utils::JobSystem& js,
+            Command* first, Command* last, Command* scratch) noexcept;
+
+    // sorts a single chunk, using the radix sort if it's worth it
+    static void sortCommandsChunk(Command* first, Command* last, Command* scratch) noexcept;
+
+    // above this ratio of changed renderables, it's cheaper to regenerate and sort everything
+    static constexpr float COMMAND_CACHE_MAX_DIRTY_RATIO = 0.25f;
+
     static inline void generateCommands(uint32_t commandTypeFlags, Command* commands,
             FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
             FScene::VisibleMaskType visibilityMask, math::float3 cameraPosition, math::float3 cameraForward) noexcept;
 
+    // same as generateCommands() but writes the commands at 'curr' instead of at their offset
+    // in the command buffer
+    static inline void generateCommandsAt(uint32_t commandTypeFlags, Command* curr,
+            FScene::RenderableSoa const& soa, utils::Range<uint32_t> range, RenderFlags renderFlags,
+            FScene::VisibleMaskType visibilityMask, math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+
+    static inline uint32_t computeDistanceBits(math::float3 center,
+            math::float3 cameraPosition, math::float3 cameraForward) noexcept;
+
+    void updateCommandCacheState(CommandCache& cache, uint32_t commandTypeFlags) const noexcept;
+
+    void storeCommandCache(CommandCache& cache, uint32_t commandTypeFlags) const noexcept;
+
+    bool patchCachedCommands(CommandCache& cache, uint32_t commandTypeFlags) noexcept;
+
     template<uint32_t commandTypeFlags>
     static inline void generateCommandsImpl(uint32_t, Command* commands,
             FScene::RenderableSoa const& soa, utils::Range<uint32_t> range,
@@ -64,6 +64,8 @@ FRenderer::FRenderer(FEngine& engine) :
 
     debugRegistry.registerProperty("d.renderer.doFrameCapture",
             &engine.debug.renderer.doFrameCapture);
+    debugRegistry.registerProperty("d.renderer.parallelSortMinCommands",
+            &engine.debug.renderer.parallelSortMinCommands);
 }
 
 void FRenderer::init() noexcept {
@@ -358,8 +360,8 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
 
     // TODO: this should be a FrameGraph pass to participate to automatic culling
     pass.newCommandBuffer();
-    pass.appendCommands(RenderPass::CommandTypeFlags::SSAO);
-    pass.sortCommands();
+    pass.appendSortedCommands(RenderPass::CommandTypeFlags::SSAO,
+            view.getStructurePassCommandCache());
 
     // TODO: the scaling should depends on all passes that need the structure pass
     ppm.structure(fg, pass, svp.width, svp.height, aoOptions.resolution);
@@ -393,8 +395,7 @@ void FRenderer::renderJob(ArenaScope& arena, FView& view) {
 
     // TODO: ideally this should be a FrameGraph pass to participate to automatic culling
     pass.newCommandBuffer();
-    pass.appendCommands(RenderPass::COLOR);
-    pass.sortCommands();
+    pass.appendSortedCommands(RenderPass::COLOR, view.getColorPassCommandCache());
 
     FrameGraphTexture::Descriptor desc = {
             .width = config.svp.width,
@@ -22,6 +22,8 @@
 
 #include <utils/Log.h>
 
+#include <limits>
+
 using namespace utils;
 
 namespace filament {
@@ -62,7 +64,8 @@ void ResourceAllocator::AssociativeContainer<K, V, H>::emplace(ARGS&& ... args)
 // ------------------------------------------------------------------------------------------------
 ResourceAllocatorInterface::~ResourceAllocatorInterface() = default;
 
-size_t ResourceAllocator::TextureKey::getSize() const noexcept {
+size_t ResourceAllocatorInterface::getTextureSize(TextureFormat format, uint8_t levels,
+        uint8_t samples, uint32_t width, uint32_t height, uint32_t depth) noexcept {
     size_t pixelCount = width * height * depth;
     size_t size = pixelCount * FTexture::getFormatSize(format);
     size_t s = std::max(uint8_t(1), samples);
@@ -77,21 +80,48 @@ size_t ResourceAllocator::TextureKey::getSize() const noexcept {
     return size;
 }
 
+size_t ResourceAllocator::TextureKey::getSize() const noexcept {
+    return getTextureSize(format, levels, samples, width, height, depth);
+}
+
+bool ResourceAllocator::TextureKey::isSizeFlexible() const noexcept {
+#if !defined(__EMSCRIPTEN__)
+    // Sampling, uploading or reading it as a subpass input would expose the extra texels.
+    constexpr TextureUsage attachments = TextureUsage::COLOR_ATTACHMENT |
+            TextureUsage::DEPTH_ATTACHMENT | TextureUsage::STENCIL_ATTACHMENT;
+    return none(usage & ~attachments);
+#else
+    // see createTexture()
+    return false;
+#endif
+}
+
+bool ResourceAllocator::TextureKey::canServe(const TextureKey& other) const noexcept {
+    assert(other.isSizeFlexible());
+    if (target != other.target || levels != other.levels || format != other.format ||
+        samples != other.samples || depth != other.depth || usage != other.usage) {
+        return false;
+    }
+    // We limit how much larger the texture can be, to not waste memory.
+    return width  >= other.width  && width  <= other.width  + (other.width  >> SIZE_BUCKET_SHIFT) &&
+           height >= other.height && height <= other.height + (other.height >> SIZE_BUCKET_SHIFT);
+}
+
 ResourceAllocator::ResourceAllocator(DriverApi& driverApi) noexcept
         : mBackend(driverApi) {
 }
 
 ResourceAllocator::~ResourceAllocator() noexcept {
-    assert(!mTextureCache.size());
+    assert(!mCacheCount);
     assert(!mInUseTextures.size());
 }
 
 void ResourceAllocator::terminate() noexcept {
     assert(!mInUseTextures.size());
-    auto& textureCache = mTextureCache;
-    for (auto it = textureCache.begin(); it != textureCache.end();) {
-        mBackend.destroyTexture(it->second.handle);
-        it = textureCache.erase(it);
+    while (mCacheHead != NONE) {
+        const uint32_t index = mCacheHead;
+        mBackend.destroyTexture(mCacheEntries[index].handle);
+        removeCacheEntry(index);
     }
 }
 
@@ -131,16 +161,20 @@ backend::TextureHandle ResourceAllocator::createTexture(const char* name,
     // do we have a suitable texture in the cache?
     TextureHandle handle;
     if (mEnabled) {
-        auto& textureCache = mTextureCache;
-        const TextureKey key{ name, target, levels, format, samples, width, height, depth, usage };
-        auto it = textureCache.find(key);
-        if (UTILS_LIKELY(it != textureCache.end())) {
+        TextureKey key{ name, target, levels, format, samples, width, height, depth, usage };
+        const uint32_t index = findCacheEntry(key);
+        if (UTILS_LIKELY(index != NONE)) {
             // we do, move the entry to the in-use list, and remove from the cache
-            handle = it->second.handle;
-            mCacheSize -= it->second.size;
-            textureCache.erase(it);
+            mCacheStats.hits++;
+            CacheEntry const& entry = mCacheEntries[index];
+            handle = entry.handle;
+            // the texture could be larger than requested
+            key.width = entry.key.width;
+            key.height = entry.key.height;
+            removeCacheEntry(index);
         } else {
             // we don't, allocate a new texture and populate the in-use list
+            mCacheStats.misses++;
             handle = mBackend.createTexture(
                     target, levels, format, samples, width, height, depth, usage);
         }
@@ -159,11 +193,7 @@ void ResourceAllocator::destroyTexture(TextureHandle h) noexcept {
         assert(it != mInUseTextures.end());
 
         // move it to the cache
-        const TextureKey key = it->second;
-        uint32_t size = key.getSize();
-
-        mTextureCache.emplace(key, TextureCachePayload{ h, mAge, size });
-        mCacheSize += size;
+        insertCacheEntry(it->second, h);
 
         // remove it from the in-use list
         mInUseTextures.erase(it);
@@ -179,78 +209,133 @@ void ResourceAllocator::gc() noexcept {
     const size_t age = mAge++;
 
     // Purging strategy:
-    //  - remove entries that are older than a certain age
-    //      - remove only one entry per gc(),
-    //      - unless we're at capacity
-    // - remove LRU entries until we're below capacity
-
-    auto& textureCache = mTextureCache;
-    for (auto it = textureCache.begin(); it != textureCache.end();) {
-        const size_t ageDiff = age - it->second.age;
-        if (ageDiff >= CACHE_MAX_AGE) {
-            it = purge(it);
-            if (mCacheSize < CACHE_CAPACITY) {
-                // if we're not at capacity, only purge a single entry per gc, trying to
-                // avoid a burst of work.
-                break;
+    //  - remove the least recently used entry if it's older than a certain age
+    //      - remove only one entry per gc(), trying to avoid a burst of work
+    //  - remove LRU entries until we're below capacity
+    // The least recently used entry is also the oldest, so we only ever look at the tail.
+
+    if (mCacheTail != NONE && age - mCacheEntries[mCacheTail].age >= CACHE_MAX_AGE) {
+        evictCacheEntry(mCacheTail);
+    }
+
+    while (UTILS_UNLIKELY(mCacheSize >= mCacheCapacity && mCacheTail != NONE)) {
+        evictCacheEntry(mCacheTail);
+    }
+}
+
+uint32_t ResourceAllocator::findCacheEntry(TextureKey const& key) const noexcept {
+    // Look for the most recently used entry with the same key.
+    auto it = mCacheIndex.find(key);
+    if (it != mCacheIndex.end()) {
+        return it->second;
+    }
+
+    // Otherwise, if it's allowed, use the smallest texture that can serve this key.
+    if (!key.isSizeFlexible()) {
+        return NONE;
+    }
+    CacheEntry const* const entries = mCacheEntries.data();
+    uint32_t best = NONE;
+    size_t bestArea = std::numeric_limits<size_t>::max();
+    for (uint32_t i = mCacheHead; i != NONE; i = entries[i].next) {
+        TextureKey const& k = entries[i].key;
+        if (k.canServe(key)) {
+            const size_t area = size_t(k.width) * k.height;
+            if (area < bestArea) {
+                bestArea = area;
+                best = i;
             }
-        } else {
-            ++it;
         }
     }
+    return best;
+}
 
-    if (UTILS_UNLIKELY(mCacheSize >= CACHE_CAPACITY)) {
-        // make a copy of our cache to a vector
-        std::vector<std::pair<TextureKey, TextureCachePayload>> cache;
-        cache.reserve(textureCache.size());
-        for (auto const& item : textureCache) {
-            cache.push_back(item);
-        }
+void ResourceAllocator::insertCacheEntry(TextureKey const& key, TextureHandle handle) noexcept {
+    uint32_t index = mCacheFree;
+    if (index != NONE) {
+        mCacheFree = mCacheEntries[index].next;
+    } else {
+        index = uint32_t(mCacheEntries.size());
+        mCacheEntries.emplace_back();
+    }
 
-        // sort by least recently used
-        std::sort(cache.begin(), cache.end(), [](auto const& lhs, auto const& rhs) {
-            return lhs.second.age < rhs.second.age;
-        });
-
-        // now remove entries until we're at capacity
-        auto curr = cache.begin();
-        while (mCacheSize >= CACHE_CAPACITY) {
-            // by construction this entry must exist
-            purge(textureCache.find(curr->first));
-            ++curr;
-        }
+    // insert at the head, i.e. this is the most recently used entry
+    const uint32_t size = uint32_t(key.getSize());
+    uint32_t nextSameKey = NONE;
+    auto it = mCacheIndex.find(key);
+    if (it != mCacheIndex.end()) {
+        nextSameKey = it->second;
+        mCacheEntries[nextSameKey].prevSameKey = index;
+        it.value() = index;
+    } else {
+        mCacheIndex.emplace(key, index);
+    }
+    mCacheEntries[index] = { key, handle, mAge, size, NONE, mCacheHead, NONE, nextSameKey };
+    if (mCacheHead != NONE) {
+        mCacheEntries[mCacheHead].prev = index;
+    } else {
+        mCacheTail = index;
+    }
+    mCacheHead = index;
+    mCacheSize += size;
+    mCacheCount++;
+}
 
-        // Since we're sorted already, reset the oldestAge of the whole system
-        size_t oldestAge = cache.front().second.age;
-        for (auto& it : textureCache) {
-            it.second.age -= oldestAge;
-        }
-        mAge -= oldestAge;
+void ResourceAllocator::removeCacheEntry(uint32_t index) noexcept {
+    CacheEntry& entry = mCacheEntries[index];
+    if (entry.prev != NONE) {
+        mCacheEntries[entry.prev].next = entry.next;
+    } else {
+        mCacheHead = entry.next;
+    }
+    if (entry.next != NONE) {
+        mCacheEntries[entry.next].prev = entry.prev;
+    } else {
+        mCacheTail = entry.prev;
+    }
+    if (entry.prevSameKey != NONE) {
+        mCacheEntries[entry.prevSameKey].nextSameKey = entry.nextSameKey;
+    } else if (entry.nextSameKey != NONE) {
+        mCacheIndex[entry.key] = entry.nextSameKey;
+    } else {
+        mCacheIndex.erase(entry.key);
     }
-    //if (mAge % 60 == 0) dump();
+    if (entry.nextSameKey != NONE) {
+        mCacheEntries[entry.nextSameKey].prevSameKey = entry.prevSameKey;
+    }
+    mCacheSize -= entry.size;
+    mCacheCount--;
+
+    // add the entry to the free list
+    entry.handle.clear();
+    entry.prev = NONE;
+    entry.next = mCacheFree;
+    entry.prevSameKey = NONE;
+    entry.nextSameKey = NONE;
+    mCacheFree = index;
+}
+
+void ResourceAllocator::evictCacheEntry(uint32_t index) noexcept {
+    mCacheStats.evictions++;
+    mBackend.destroyTexture(mCacheEntries[index].handle);
+    removeCacheEntry(index);
 }
 
 UTILS_NOINLINE
 void ResourceAllocator::dump(bool brief) const noexcept {
-    slog.d << "# entries=" << mTextureCache.size() << ", sz=" << mCacheSize / float(1u << 20u)
-           << " MiB" << io::endl;
+    slog.d << "# entries=" << mCacheCount << ", sz=" << mCacheSize / float(1u << 20u)
+           << " MiB, hits=" << mCacheStats.hits << ", misses=" << mCacheStats.misses
+           << ", evictions=" << mCacheStats.evictions << io::endl;
     if (!brief) {
-        for (auto const& it : mTextureCache) {
-            auto w = it.first.width;
-            auto h = it.first.height;
-            auto f = FTexture::getFormatSize(it.first.format);
-            slog.d << it.first.name << ": w=" << w << ", h=" << h << ", f=" << f << ", sz="
-                   << it.second.size / float(1u << 20u) << io::endl;
+        for (uint32_t i = mCacheHead; i != NONE; i = mCacheEntries[i].next) {
+            CacheEntry const& entry = mCacheEntries[i];
+            auto w = entry.key.width;
+            auto h = entry.key.height;
+            auto f = FTexture::getFormatSize(entry.key.format);
+            slog.d << entry.key.name << ": w=" << w << ", h=" << h << ", f=" << f << ", sz="
+                   << entry.size / float(1u << 20u) << io::endl;
         }
     }
 }
 
-ResourceAllocator::CacheContainer::iterator ResourceAllocator::purge(
-        ResourceAllocator::CacheContainer::iterator const& pos) {
-    //slog.d << "purging " << pos->second.handle.getId() << ", age=" << pos->second.age << io::endl;
-    mBackend.destroyTexture(pos->second.handle);
-    mCacheSize -= pos->second.size;
-    return mTextureCache.erase(pos);
-}
-
 } // namespace filament
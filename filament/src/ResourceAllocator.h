@@ -25,6 +25,8 @@
 
 #include <utils/Hash.h>
 
+#include <tsl/robin_map.h>
+
 #include <vector>
 
 #include <stdint.h>
@@ -53,6 +55,10 @@ public:
 
     virtual void destroyTexture(backend::TextureHandle h) noexcept = 0;
 
+    // estimated memory used by a texture, MSAA and mip-maps included
+    static size_t getTextureSize(backend::TextureFormat format, uint8_t levels, uint8_t samples,
+            uint32_t width, uint32_t height, uint32_t depth) noexcept;
+
 protected:
     virtual ~ResourceAllocatorInterface();
 };
@@ -85,11 +91,30 @@ public:
 
     void gc() noexcept;
 
+    // Sets the maximum memory used by the textures kept in the cache. If the cache is over
+    // capacity, the least recently used textures are destroyed by the next gc().
+    void setCacheCapacity(size_t capacity) noexcept { mCacheCapacity = capacity; }
+
+    size_t getCacheCapacity() const noexcept { return mCacheCapacity; }
+
+    // memory currently used by the textures kept in the cache
+    size_t getCacheSize() const noexcept { return mCacheSize; }
+
+    struct CacheStats {
+        uint32_t hits = 0;          // textures served from the cache
+        uint32_t misses = 0;        // textures created by the backend
+        uint32_t evictions = 0;     // textures destroyed by the cache
+    };
+
+    CacheStats const& getCacheStats() const noexcept { return mCacheStats; }
+
 private:
-    // TODO: these should be settings of the engine
-    static constexpr size_t CACHE_CAPACITY = 64u << 20u;   // 64 MiB
+    static constexpr size_t DEFAULT_CACHE_CAPACITY = 64u << 20u;   // 64 MiB
     static constexpr size_t CACHE_MAX_AGE  = 30u;
 
+    // an attachment can be served a cached texture up to 1/8th larger in each dimension
+    static constexpr uint32_t SIZE_BUCKET_SHIFT = 3u;
+
     struct TextureKey {
         const char* name; // doesn't participate in the hash
         backend::SamplerType target;
@@ -103,6 +128,14 @@ private:
 
         size_t getSize() const noexcept;
 
+        // whether a larger texture can be used instead, i.e. the texture is only ever used as
+        // an attachment, and the render target sets the size that's actually rendered to
+        bool isSizeFlexible() const noexcept;
+
+        // whether a texture with this key can be used instead of one with the 'other' key, which
+        // must be size flexible
+        bool canServe(const TextureKey& other) const noexcept;
+
         bool operator==(const TextureKey& other) const noexcept {
             return target == other.target &&
                    levels == other.levels &&
@@ -128,10 +161,21 @@ private:
         }
     };
 
-    struct TextureCachePayload {
+    // The cache is a doubly-linked list of entries ordered from the most recently to the least
+    // recently used, so that evicting is O(1). Entries are stored in a vector and recycled.
+    // The entries with the same key are also linked together in the same order, and the most
+    // recent one is found with a hash map, so that looking up a key is O(1).
+    static constexpr uint32_t NONE = uint32_t(-1);
+
+    struct CacheEntry {
+        TextureKey key;
         backend::TextureHandle handle;
-        size_t age = 0;
+        size_t age = 0;             // value of mAge when the texture was returned to the cache
         uint32_t size = 0;
+        uint32_t prev = NONE;       // more recently used entry
+        uint32_t next = NONE;       // less recently used entry, or next free entry
+        uint32_t prevSameKey = NONE;    // more recently used entry with the same key
+        uint32_t nextSameKey = NONE;    // less recently used entry with the same key
     };
 
     template<typename T>
@@ -176,15 +220,23 @@ private:
         void emplace(ARGS&&... args);
     };
 
-    using CacheContainer = AssociativeContainer<TextureKey, TextureCachePayload>;
-
-    CacheContainer::iterator purge(CacheContainer::iterator const& pos);
+    uint32_t findCacheEntry(TextureKey const& key) const noexcept;
+    void insertCacheEntry(TextureKey const& key, backend::TextureHandle handle) noexcept;
+    void removeCacheEntry(uint32_t index) noexcept;
+    void evictCacheEntry(uint32_t index) noexcept;
 
     backend::DriverApi& mBackend;
-    CacheContainer mTextureCache;
+    std::vector<CacheEntry> mCacheEntries;
+    tsl::robin_map<TextureKey, uint32_t, Hasher<TextureKey>> mCacheIndex; // most recent of each key
+    uint32_t mCacheHead = NONE;     // most recently used entry
+    uint32_t mCacheTail = NONE;     // least recently used entry
+    uint32_t mCacheFree = NONE;     // first free entry
+    uint32_t mCacheCount = 0;
     AssociativeContainer<backend::TextureHandle, TextureKey> mInUseTextures;
     size_t mAge = 0;
-    uint32_t mCacheSize = 0;
+    size_t mCacheSize = 0;
+    size_t mCacheCapacity = DEFAULT_CACHE_CAPACITY;
+    CacheStats mCacheStats;
     const bool mEnabled = true;
 };
 
@@ -19,18 +19,22 @@
 #include "components/LightManager.h"
 #include "components/RenderableManager.h"
 
+#include "UniformBuffer.h"
+
 #include <private/filament/UibGenerator.h>
 
 #include "details/Engine.h"
 #include "details/IndirectLight.h"
 #include "details/Skybox.h"
+#include "details/View.h"
 
 #include <utils/compiler.h>
 #include <utils/EntityManager.h>
 #include <utils/Range.h>
-#include <utils/Zip2Iterator.h>
+#include <utils/Systrace.h>
 
 #include <algorithm>
+#include <numeric>
 
 using namespace filament::math;
 using namespace utils;
@@ -114,7 +118,8 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
         // because one is always created when creating a Renderable component).
         if (ri && ti) {
             // compute the world AABB so we can perform culling
-            const Box worldAABB = rigidTransform(rcm.getAABB(ri), worldTransform);
+            // for instanced renderables, this encloses all the instances
+            const Box worldAABB = rigidTransform(rcm.getInstancesAABB(ri), worldTransform);
 
             // we know there is enough space in the array
             sceneData.push_back_unsafe(
@@ -129,7 +134,8 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
                     rcm.getLayerMask(ri),     // LAYERS
                     worldAABB.halfExtent,     // WORLD_AABB_EXTENT
                     {},                       // PRIMITIVES
-                    0                         // SUMMED_PRIMITIVE_COUNT
+                    0,                        // SUMMED_PRIMITIVE_COUNT
+                    {}                        // INSTANCES
             );
         }
 
@@ -167,80 +173,278 @@ void FScene::prepare(const mat4f& worldOriginTransform) {
     for (size_t i = lightData.size(), e = (lightData.size() + 3u) & ~3u; i < e; i++) {
         new(lightData.data<POSITION_RADIUS>() + i) float4{ 0, 0, 0, 1 };
     }
+
+    if (mHierarchicalCullingEnabled) {
+        updateCullingBvh();
+    }
+}
+
+void FScene::updateCullingBvh() {
+    SYSTRACE_CALL();
+
+    auto const& sceneData = mRenderableData;
+    const size_t count = sceneData.size();
+    auto const* const instances = sceneData.data<RENDERABLE_INSTANCE>();
+    float3 const* const center = sceneData.data<WORLD_AABB_CENTER>();
+    float3 const* const extent = sceneData.data<WORLD_AABB_EXTENT>();
+
+    // the hierarchy refers to renderables by their index in the SoA, which is stable as long
+    // as the set of renderables in the scene doesn't change.
+    const bool rebuild = mCullingBvhInstances.size() != count ||
+            !std::equal(instances, instances + count, mCullingBvhInstances.begin());
+
+    if (UTILS_UNLIKELY(rebuild)) {
+        mCullingBvhInstances.assign(instances, instances + count);
+        mCullingBvh.build(center, extent, count);
+    } else {
+        mCullingBvh.refit(center, extent, count);
+    }
 }
 
-void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Handle<backend::HwUniformBuffer> renderableUbh) noexcept {
+void FScene::setHierarchicalCullingEnabled(bool enabled) noexcept {
+    mHierarchicalCullingEnabled = enabled;
+    if (!enabled) {
+        mCullingBvh.clear();
+        mCullingBvhInstances.clear();
+    }
+}
+
+mat3f FScene::computeNormalMatrix(mat4f const& model, bool reversedWindingOrder) noexcept {
+    // Using mat3f::getTransformForNormals handles non-uniform scaling, but DOESN'T guarantee that
+    // the transformed normals will have unit-length, therefore they need to be normalized
+    // in the shader (that's already the case anyways, since normalization is needed after
+    // interpolation).
+    //
+    // We pre-scale normals by the inverse of the largest scale factor to avoid
+    // large post-transform magnitudes in the shader, especially in the fragment shader, where
+    // we use medium precision.
+    //
+    // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
+
+    mat3f m = mat3f::getTransformForNormals(model.upperLeft());
+    m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
+
+    // The shading normal must be flipped for mirror transformations.
+    // Basically we're shading the other side of the polygon and therefore need to negate the
+    // normal, similar to what we already do to support double-sided lighting.
+    if (reversedWindingOrder) {
+        m = -m;
+    }
+    return m;
+}
+
+void FScene::updateUBOs(utils::Range<uint32_t> visibleRenderables,
+        backend::Handle<backend::HwUniformBuffer> renderableUbh,
+        UniformBuffer& renderableUb) noexcept {
     FEngine::DriverApi& driver = mEngine.getDriverApi();
-    const size_t size = visibleRenderables.size() * sizeof(PerRenderableUib);
+    assert(visibleRenderables.last * sizeof(PerRenderableUib) <= renderableUb.getSize());
+
+    // Changed renderables are uploaded in spans of contiguous slots; two spans separated by
+    // fewer than this many unchanged slots are merged, to limit the number of commands.
+    constexpr uint32_t MAX_SPAN_GAP = 4;
+
+    // if the whole buffer is dirty (i.e. it's new), it's uploaded in full at the end
+    const bool uploadAll = renderableUb.isDirty();
+    uint32_t spanBegin = visibleRenderables.first;
+    uint32_t spanEnd = visibleRenderables.first;
+    bool hasSpan = false;
 
-    // allocate space into the command stream directly
-    void* const buffer = driver.allocate(size);
+    auto flush = [&]() {
+        const size_t offset = spanBegin * sizeof(PerRenderableUib);
+        const size_t size = (spanEnd - spanBegin) * sizeof(PerRenderableUib);
+        driver.updateUniformBuffer(renderableUbh,
+                renderableUb.toBufferDescriptor(driver, offset, size), uint32_t(offset));
+    };
+
+    // the uniforms of a renderable are built in here, then compared to its slot in renderableUb
+    alignas(16) uint8_t block[sizeof(PerRenderableUib)];
 
     bool hasContactShadows = false;
     auto& sceneData = mRenderableData;
     for (uint32_t i : visibleRenderables) {
         mat4f const& model = sceneData.elementAt<WORLD_TRANSFORM>(i);
-        const size_t offset = i * sizeof(PerRenderableUib);
 
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelMatrix), model);
-
-        // Using mat3f::getTransformForNormals handles non-uniform scaling, but DOESN'T guarantee that
-        // the transformed normals will have unit-length, therefore they need to be normalized
-        // in the shader (that's already the case anyways, since normalization is needed after
-        // interpolation).
-        //
-        // We pre-scale normals by the inverse of the largest scale factor to avoid
-        // large post-transform magnitudes in the shader, especially in the fragment shader, where
-        // we use medium precision.
-        //
-        // Note: if the model matrix is known to be a rigid-transform, we could just use it directly.
-
-        mat3f m = mat3f::getTransformForNormals(model.upperLeft());
-        m *= mat3f(1.0f / std::sqrt(max(float3{length2(m[0]), length2(m[1]), length2(m[2])})));
-
-        // The shading normal must be flipped for mirror transformations.
-        // Basically we're shading the other side of the polygon and therefore need to negate the
-        // normal, similar to what we already do to support double-sided lighting.
-        if (sceneData.elementAt<REVERSED_WINDING_ORDER>(i)) {
-            m = -m;
-        }
+        // unused bytes (e.g.: padding) must be initialized for the comparison below
+        memset(block, 0, sizeof(block));
+
+        UniformBuffer::setUniform(block,
+                offsetof(PerRenderableUib, worldFromModelMatrix), model);
 
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, worldFromModelNormalMatrix), m);
+        UniformBuffer::setUniform(block,
+                offsetof(PerRenderableUib, worldFromModelNormalMatrix),
+                computeNormalMatrix(model, sceneData.elementAt<REVERSED_WINDING_ORDER>(i)));
 
         // Note that we cast bool to uint32_t. Booleans are byte-sized in C++, but we need to
         // initialize all 32 bits in the UBO field.
 
         FRenderableManager::Visibility visibility = sceneData.elementAt<VISIBILITY_STATE>(i);
         hasContactShadows = hasContactShadows || visibility.screenSpaceContactShadows;
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, skinningEnabled),
+        UniformBuffer::setUniform(block,
+                offsetof(PerRenderableUib, skinningEnabled),
                 uint32_t(visibility.skinning));
 
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, morphingEnabled),
+        UniformBuffer::setUniform(block,
+                offsetof(PerRenderableUib, morphingEnabled),
                 uint32_t(visibility.morphing));
 
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, screenSpaceContactShadows),
+        UniformBuffer::setUniform(block,
+                offsetof(PerRenderableUib, screenSpaceContactShadows),
                 uint32_t(visibility.screenSpaceContactShadows));
 
-        UniformBuffer::setUniform(buffer,
-                offset + offsetof(PerRenderableUib, morphWeights),
+        UniformBuffer::setUniform(block,
+                offsetof(PerRenderableUib, morphWeights),
                 sceneData.elementAt<MORPH_WEIGHTS>(i));
+
+        // static renderables keep the same slot and content from frame to frame, and are
+        // not uploaded again.
+        const size_t offset = i * sizeof(PerRenderableUib);
+        void const* const slot = static_cast<char const*>(renderableUb.getBuffer()) + offset;
+        if (!uploadAll && !memcmp(slot, block, sizeof(block))) {
+            continue;
+        }
+        memcpy(renderableUb.invalidateUniforms(offset, sizeof(block)), block, sizeof(block));
+        if (uploadAll) {
+            continue;
+        }
+
+        if (hasSpan && i > spanEnd + MAX_SPAN_GAP) {
+            flush();
+            hasSpan = false;
+        }
+        if (!hasSpan) {
+            spanBegin = i;
+            hasSpan = true;
+        }
+        spanEnd = i + 1;
+    }
+    if (uploadAll) {
+        driver.updateUniformBuffer(renderableUbh, renderableUb.toBufferDescriptor(driver), 0);
+    } else if (hasSpan) {
+        flush();
     }
+    renderableUb.clean();
 
-    // TODO: handle static objects separately
     mHasContactShadows = hasContactShadows;
     mRenderableViewUbh = renderableUbh;
-    driver.loadUniformBuffer(renderableUbh, { buffer, size });
 
     if (mSkybox) {
         mSkybox->commit(driver);
     }
 }
 
+size_t FScene::cullInstances(utils::Range<uint32_t> visibleRenderables,
+        Frustum const* frustum) noexcept {
+    SYSTRACE_CALL();
+
+    FRenderableManager const& rcm = mEngine.getRenderableManager();
+    auto& sceneData = mRenderableData;
+    mInstanceTransforms.clear();
+    mInstanceIndices.clear();
+
+    uint32_t batchCount = 0;
+    for (uint32_t i : visibleRenderables) {
+        auto const ri = sceneData.elementAt<RENDERABLE_INSTANCE>(i);
+        const size_t count = rcm.getInstanceCount(ri);
+        if (UTILS_LIKELY(count == 0 || !sceneData.elementAt<VISIBLE_MASK>(i))) {
+            continue;
+        }
+
+        mat4f const& worldTransform = sceneData.elementAt<WORLD_TRANSFORM>(i);
+        mat4f const* const transforms = rcm.getInstanceTransforms(ri);
+        Box const& aabb = rcm.getAABB(ri);
+
+        // the culler processes multiples of Culler::MODULO boxes, the padding is never visible
+        const size_t paddedCount = Culler::round(count);
+        mInstanceCenters.resize(paddedCount);
+        mInstanceExtents.resize(paddedCount);
+        mInstanceVisibility.assign(paddedCount, 0);
+
+        // The instances of a shadow caster are shared by the color and the shadow passes, so
+        // they're not culled against the camera frustum, which would lose off-screen shadows.
+        const bool casting = sceneData.elementAt<VISIBLE_MASK>(i) & ~VISIBLE_RENDERABLE;
+        const bool culling = frustum && !casting &&
+                sceneData.elementAt<VISIBILITY_STATE>(i).culling;
+        if (culling) {
+            for (size_t k = 0; k < count; k++) {
+                const Box box = rigidTransform(aabb, worldTransform * transforms[k]);
+                mInstanceCenters[k] = box.center;
+                mInstanceExtents[k] = box.halfExtent;
+            }
+            Culler::intersects(mInstanceVisibility.data(), *frustum,
+                    mInstanceCenters.data(), mInstanceExtents.data(), paddedCount, 0);
+        } else {
+            std::fill_n(mInstanceVisibility.begin(), count, 1);
+        }
+
+        // the visible instances are packed, starting at a new batch
+        const size_t first = mInstanceTransforms.size();
+        for (size_t k = 0; k < count; k++) {
+            if (mInstanceVisibility[k] & 1u) {
+                mInstanceTransforms.push_back(worldTransform * transforms[k]);
+                mInstanceIndices.push_back(uint32_t(k));
+            }
+        }
+
+        const uint32_t visibleCount = uint32_t(mInstanceTransforms.size() - first);
+        if (visibleCount == 0) {
+            // none of the instances are visible
+            sceneData.elementAt<VISIBLE_MASK>(i) = 0;
+            continue;
+        }
+        sceneData.elementAt<INSTANCES>(i) = { batchCount, visibleCount };
+        batchCount += (visibleCount + CONFIG_MAX_INSTANCES - 1) / CONFIG_MAX_INSTANCES;
+    }
+    return batchCount;
+}
+
+void FScene::updateInstanceUBOs(utils::Range<uint32_t> visibleRenderables,
+        backend::Handle<backend::HwUniformBuffer> instancesUbh) noexcept {
+    SYSTRACE_CALL();
+
+    FEngine::DriverApi& driver = mEngine.getDriverApi();
+    auto& sceneData = mRenderableData;
+
+    size_t batchCount = 0;
+    for (uint32_t i : visibleRenderables) {
+        InstanceBatches const& batches = sceneData.elementAt<INSTANCES>(i);
+        if (batches.count) {
+            // the instances are bound in place of the bones
+            sceneData.elementAt<BONES_UBH>(i) = instancesUbh;
+            batchCount = batches.batch +
+                    (batches.count + CONFIG_MAX_INSTANCES - 1) / CONFIG_MAX_INSTANCES;
+        }
+    }
+    if (batchCount == 0) {
+        return;
+    }
+
+    // unused slots at the end of each batch are never read, but they're still uploaded
+    // because each batch is bound in its entirety. This can be too large for the command
+    // stream, so it's allocated on the heap.
+    const size_t size = batchCount * CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance);
+    auto* const UTILS_RESTRICT out = (PerRenderableUibInstance*)malloc(size);
+
+    size_t source = 0;
+    for (uint32_t i : visibleRenderables) {
+        InstanceBatches const& batches = sceneData.elementAt<INSTANCES>(i);
+        const bool reversedWindingOrder = sceneData.elementAt<REVERSED_WINDING_ORDER>(i);
+        PerRenderableUibInstance* const UTILS_RESTRICT dst =
+                out + batches.batch * CONFIG_MAX_INSTANCES;
+        for (size_t k = 0; k < batches.count; k++, source++) {
+            mat4f const& model = mInstanceTransforms[source];
+            const mat3f m = computeNormalMatrix(model, reversedWindingOrder);
+            dst[k].worldFromModelMatrix = model;
+            dst[k].worldFromModelNormalMatrix[0] = { m[0], float(mInstanceIndices[source]) };
+            dst[k].worldFromModelNormalMatrix[1] = { m[1], 0.0f };
+            dst[k].worldFromModelNormalMatrix[2] = { m[2], 0.0f };
+        }
+    }
+    assert(source == mInstanceTransforms.size());
+
+    driver.updateUniformBuffer(instancesUbh, { out, size,
+            [](void* buffer, size_t, void*) { free(buffer); } }, 0);
+}
+
 void FScene::terminate(FEngine& engine) {
     // DO NOT destroy this UBO, it's owned by the View
     mRenderableViewUbh.clear();
@@ -265,23 +469,25 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
     size_t const size = lightData.size();
 
     // always allocate at least 4 entries, because the vectorized loops below rely on that
-    float* const UTILS_RESTRICT distances = arena.allocate<float>((size + 3u) & 3u, CACHELINE_SIZE);
+    float* const UTILS_RESTRICT distances = arena.allocate<float>((size + 3u) & ~3u, CACHELINE_SIZE);
 
     // pre-compute the lights' distance to the camera plane, for sorting below
     // - we don't skip the directional light, because we don't care, it's ignored during sorting
     float4 const* const UTILS_RESTRICT spheres = lightData.data<FScene::POSITION_RADIUS>();
-    computeLightCameraPlaneDistances(distances, camera, spheres, size);
 
-    // skip directional light
-    Zip2Iterator<FScene::LightSoa::iterator, float*> b = { lightData.begin(), distances };
-    std::sort(b + DIRECTIONAL_LIGHTS_COUNT, b + size,
-            [](auto const& lhs, auto const& rhs) { return lhs.second < rhs.second; });
+    // the order only matters for choosing which lights to drop, so we don't need to sort at all
+    // when they all fit. Otherwise, we reuse the previous order while the camera and the lights
+    // don't move much, since the sort dominates this function with thousands of lights.
+    if (size > CONFIG_MAX_LIGHT_COUNT + DIRECTIONAL_LIGHTS_COUNT && !reuseLightOrder(camera)) {
+        computeLightCameraPlaneDistances(distances, camera, spheres, size);
+        sortLights(distances, camera);
+    }
 
     // drop excess lights
     lightData.resize(std::min(size, CONFIG_MAX_LIGHT_COUNT + DIRECTIONAL_LIGHTS_COUNT));
 
     // number of point/spot lights
-    size_t positionalLightCount = size - DIRECTIONAL_LIGHTS_COUNT;
+    size_t positionalLightCount = lightData.size() - DIRECTIONAL_LIGHTS_COUNT;
 
     // compute the light ranges (needed when building light trees)
     float2* const zrange = lightData.data<FScene::SCREEN_SPACE_Z_RANGE>();
@@ -292,7 +498,7 @@ void FScene::prepareDynamicLights(const CameraInfo& camera, ArenaScope& rootAren
     auto const* UTILS_RESTRICT directions       = lightData.data<FScene::DIRECTION>();
     auto const* UTILS_RESTRICT instances        = lightData.data<FScene::LIGHT_INSTANCE>();
     auto const* UTILS_RESTRICT shadowInfo       = lightData.data<FScene::SHADOW_INFO>();
-    for (size_t i = DIRECTIONAL_LIGHTS_COUNT, c = size; i < c; ++i) {
+    for (size_t i = DIRECTIONAL_LIGHTS_COUNT, c = lightData.size(); i < c; ++i) {
         const size_t gpuIndex = i - DIRECTIONAL_LIGHTS_COUNT;
         auto li = instances[i];
         lp[gpuIndex].positionFalloff      = { spheres[i].xyz, lcm.getSquaredFalloffInv(li) };
@@ -314,15 +520,21 @@ inline void FScene::computeLightCameraPlaneDistances(
         float* UTILS_RESTRICT const distances,
         CameraInfo const& UTILS_RESTRICT camera,
         float4 const* UTILS_RESTRICT const spheres, size_t count) noexcept {
+    // we only need the z row of the view matrix, which saves 3/4 of the work of a full
+    // matrix-vector product.
+    const float vx = camera.view[0].z;
+    const float vy = camera.view[1].z;
+    const float vz = camera.view[2].z;
+    const float vw = camera.view[3].z;
 
     // without this, the vectorization is less efficient
     // we're guaranteed to have a multiple of 4 lights (at least)
     count = uint32_t(count + 3u) & ~3u;
-
     for (size_t i = 0 ; i < count; i++) {
         const float4 sphere = spheres[i];
-        const float4 center = camera.view * sphere.xyz; // camera points towards the -z axis
-        distances[i] = -center.z > 0.0f ? -center.z : 0.0f; // std::max() prevents vectorization (???)
+        // camera points towards the -z axis
+        const float z = vx * sphere.x + vy * sphere.y + vz * sphere.z + vw;
+        distances[i] = -z > 0.0f ? -z : 0.0f; // std::max() prevents vectorization (???)
     }
 }
 
@@ -335,6 +547,17 @@ inline void FScene::computeLightRanges(
         CameraInfo const& UTILS_RESTRICT camera,
         float4 const* UTILS_RESTRICT const spheres, size_t count) noexcept {
 
+    // Only the z and w rows of the clip-space position are needed. The near and far points of
+    // the sphere are offset along the view-space z axis, so they only differ from the center
+    // by +/- radius times the 3rd column of the projection.
+    const mat4f clipFromWorld = camera.projection * camera.view;
+    const float4 rz{ clipFromWorld[0].z, clipFromWorld[1].z, clipFromWorld[2].z, clipFromWorld[3].z };
+    const float4 rw{ clipFromWorld[0].w, clipFromWorld[1].w, clipFromWorld[2].w, clipFromWorld[3].w };
+    const float pz = camera.projection[2].z;
+    const float pw = camera.projection[2].w;
+    const float zn = camera.zn;
+    const float zf = camera.zf;
+
     // without this clang seems to assume the src and dst might overlap even if they're
     // restricted.
     // we're guaranteed to have a multiple of 4 lights (at least)
@@ -343,21 +566,103 @@ inline void FScene::computeLightRanges(
     for (size_t i = 0 ; i < count; i++) {
         // this loop gets vectorized x4
         const float4 sphere = spheres[i];
-        const float4 center = camera.view * sphere.xyz; // camera points towards the -z axis
-        float4 n = center + float4{ 0, 0, sphere.w, 0 };
-        float4 f = center - float4{ 0, 0, sphere.w, 0 };
-        // project to clip space
-        n = camera.projection * n;
-        f = camera.projection * f;
+        const float cz = rz.x * sphere.x + rz.y * sphere.y + rz.z * sphere.z + rz.w;
+        const float cw = rw.x * sphere.x + rw.y * sphere.y + rw.z * sphere.z + rw.w;
+        // camera points towards the -z axis
+        const float nz = cz + sphere.w * pz;
+        const float nw = cw + sphere.w * pw;
+        const float fz = cz - sphere.w * pz;
+        const float fw = cw - sphere.w * pw;
         // convert to NDC
-        const float min = (n.w > camera.zn) ? (n.z / n.w) : -1.0f;
-        const float max = (f.w < camera.zf) ? (f.z / f.w) :  1.0f;
+        const float min = (nw > zn) ? (nz / nw) : -1.0f;
+        const float max = (fw < zf) ? (fz / fw) :  1.0f;
         // convert to screen space
         zrange[i].x = (min + 1.0f) * 0.5f;
         zrange[i].y = (max + 1.0f) * 0.5f;
     }
 }
 
+// Reorders the positional lights so that the light at index i moves to the index k where
+// order[k] == i. order is used as scratch space and destroyed.
+static void applyLightOrder(FScene::LightSoa& lightData, uint32_t* order, size_t count) noexcept {
+    auto const first = lightData.begin() + FScene::DIRECTIONAL_LIGHTS_COUNT;
+    // follow each cycle of the permutation, so that each light is swapped at most once
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t current = i;
+        while (order[current] != i) {
+            const uint32_t next = order[current];
+            std::iter_swap(first + current, first + next);
+            order[current] = current;
+            current = next;
+        }
+        order[current] = current;
+    }
+}
+
+bool FScene::reuseLightOrder(CameraInfo const& camera) noexcept {
+    SYSTRACE_CALL();
+
+    // The lights are gathered in the same order every frame as long as the scene doesn't change,
+    // so the order found by the last sort still applies as long as the camera and the lights
+    // didn't move much. It doesn't need to be exact, it's only used to drop the farthest lights.
+    LightOrder& cache = mLightOrder;
+    FScene::LightSoa& lightData = mLightData;
+    const size_t count = lightData.size() - DIRECTIONAL_LIGHTS_COUNT;
+    auto const* const instances = lightData.data<LIGHT_INSTANCE>() + DIRECTIONAL_LIGHTS_COUNT;
+    float4 const* const UTILS_RESTRICT spheres =
+            lightData.data<POSITION_RADIUS>() + DIRECTIONAL_LIGHTS_COUNT;
+
+    const float3 position = camera.worldOffset;
+    if (cache.instances.size() != count ||
+            length2(position - cache.position) > LIGHT_ORDER_MAX_DISTANCE_SQUARED ||
+            dot(camera.getForwardVector(), cache.forward) < LIGHT_ORDER_MIN_COS_ANGLE ||
+            !std::equal(instances, instances + count, cache.instances.begin())) {
+        return false;
+    }
+
+    // this loop is written so that the compiler can vectorize it
+    float4 const* const UTILS_RESTRICT positions = cache.positions.data();
+    float maxDistanceSquared = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const float3 d = spheres[i].xyz - positions[i].xyz;
+        maxDistanceSquared = std::max(maxDistanceSquared, dot(d, d));
+    }
+    if (maxDistanceSquared > LIGHT_ORDER_MAX_DISTANCE_SQUARED) {
+        return false;
+    }
+
+    cache.scratch.assign(cache.order.begin(), cache.order.end());
+    applyLightOrder(lightData, cache.scratch.data(), count);
+    return true;
+}
+
+void FScene::sortLights(float const* distances, CameraInfo const& camera) noexcept {
+    SYSTRACE_CALL();
+
+    LightOrder& cache = mLightOrder;
+    FScene::LightSoa& lightData = mLightData;
+    const size_t count = lightData.size() - DIRECTIONAL_LIGHTS_COUNT;
+    auto const* const instances = lightData.data<LIGHT_INSTANCE>() + DIRECTIONAL_LIGHTS_COUNT;
+    float4 const* const spheres = lightData.data<POSITION_RADIUS>() + DIRECTIONAL_LIGHTS_COUNT;
+
+    // remember the lights in scene order, so we can recognize them next frame
+    cache.instances.assign(instances, instances + count);
+    cache.positions.assign(spheres, spheres + count);
+    cache.position = camera.worldOffset;
+    cache.forward = camera.getForwardVector();
+
+    // sorting indices is cheaper than moving whole lights around, the stable sort keeps the
+    // order deterministic between lights at the same distance.
+    float const* const d = distances + DIRECTIONAL_LIGHTS_COUNT;
+    cache.order.resize(count);
+    std::iota(cache.order.begin(), cache.order.end(), 0u);
+    std::stable_sort(cache.order.begin(), cache.order.end(),
+            [d](uint32_t lhs, uint32_t rhs) { return d[lhs] < d[rhs]; });
+
+    cache.scratch.assign(cache.order.begin(), cache.order.end());
+    applyLightOrder(lightData, cache.scratch.data(), count);
+}
+
 void FScene::addEntity(Entity entity) {
     mEntities.insert(entity);
 }
@@ -482,4 +787,12 @@ bool Scene::hasEntity(Entity entity) const noexcept {
     return upcast(this)->hasEntity(entity);
 }
 
+void Scene::setHierarchicalCullingEnabled(bool enabled) noexcept {
+    upcast(this)->setHierarchicalCullingEnabled(enabled);
+}
+
+bool Scene::isHierarchicalCullingEnabled() const noexcept {
+    return upcast(this)->isHierarchicalCullingEnabled();
+}
+
 } // namespace filament
@@ -14,15 +14,21 @@
  * limitations under the License.
  */
 
+#include "details/Culler.h"
+#include "details/MaterialInstance.h"
+#include "details/RenderPrimitive.h"
 #include "details/ShadowMap.h"
 #include "details/ShadowMapManager.h"
 #include "details/Texture.h"
 #include "details/View.h"
 
 #include "RenderPass.h"
+#include "ResourceAllocator.h"
 
 #include <private/filament/SibGenerator.h>
 
+#include <algorithm>
+
 namespace filament {
 
 using namespace backend;
@@ -73,10 +79,12 @@ void ShadowMapManager::addSpotShadowMap(size_t lightIndex) noexcept {
     mSpotShadowMaps.emplace_back(mSpotShadowMapCache[maps].get(), lightIndex);
 }
 
+void ShadowMapManager::terminate(FEngine& engine) noexcept {
+    destroyCachedTexture(engine);
+}
+
 void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
         backend::DriverApi& driver, RenderPass& pass) noexcept {
-    constexpr size_t MAX_SHADOW_LAYERS =
-        CONFIG_MAX_SHADOW_CASCADES + CONFIG_MAX_SHADOW_CASTING_SPOTS;
     struct ShadowPassData {
         FrameGraphId<FrameGraphTexture> shadows;
         FrameGraphId<FrameGraphTexture> tempDepth;
@@ -87,9 +95,49 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
     std::vector<ShadowPass> passes;
     passes.reserve(MAX_SHADOW_LAYERS);
     uint8_t layerSampleCount[MAX_SHADOW_LAYERS] = {};
+    bool layerRendered[MAX_SHADOW_LAYERS] = {};
 
     assert(mTextureRequirements.layers <= MAX_SHADOW_LAYERS);
 
+    const bool fillWithCheckerboard = engine.debug.shadowmap.checkerboard && !view.hasVsm();
+
+    FrameGraphTexture::Descriptor shadowTextureDesc {
+        .width = mTextureRequirements.size, .height = mTextureRequirements.size,
+        .depth = mTextureRequirements.layers,
+        .levels = mTextureRequirements.levels,
+        .type = SamplerType::SAMPLER_2D_ARRAY,
+        .format = mTextureFormat,
+        .usage = TextureUsage::DEPTH_ATTACHMENT | TextureUsage::SAMPLEABLE
+            | (fillWithCheckerboard ? TextureUsage::UPLOADABLE : (TextureUsage) 0)
+    };
+
+    if (view.hasVsm()) {
+        // TODO: support 16-bit VSM depth textures.
+        shadowTextureDesc.format = TextureFormat::RG32F;
+        shadowTextureDesc.usage = TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE;
+    }
+
+    // With shadow caching, the shadow texture of the previous frame is reused and only the
+    // shadow maps that changed are rendered again. The debug pattern overwrites the shadow maps,
+    // so they can't be cached.
+    const bool caching = view.isShadowCachingEnabled() && !fillWithCheckerboard;
+    auto const& cachedDesc = mCachedTextureDesc;
+    if (!caching || !mCachedTexture.texture ||
+            cachedDesc.width != shadowTextureDesc.width ||
+            cachedDesc.height != shadowTextureDesc.height ||
+            cachedDesc.depth != shadowTextureDesc.depth ||
+            cachedDesc.levels != shadowTextureDesc.levels ||
+            cachedDesc.format != shadowTextureDesc.format ||
+            cachedDesc.usage != shadowTextureDesc.usage) {
+        destroyCachedTexture(engine);
+    }
+    if (mMaterialInstanceStateVersion != engine.getMaterialInstanceStateVersion()) {
+        // the rasterization state of some material instance changed, e.g. its culling mode
+        invalidateCachedShadowMaps();
+        mMaterialInstanceStateVersion = engine.getMaterialInstanceStateVersion();
+    }
+    const bool imported = bool(mCachedTexture.texture);
+
     // These loops fill render passes with appropriate rendering commands for each shadow map.
     // The actual render pass execution is deferred to the frame graph.
     for (const auto& map : mCascadeShadowMaps) {
@@ -97,14 +145,18 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
             continue;
         }
 
+        const uint8_t layer = map.getLayout().layer;
+        assert(layer < mTextureRequirements.layers);
+        if (caching && !updateCachedShadowMap(engine, view, map,
+                VISIBLE_DIR_SHADOW_RENDERABLE, true)) {
+            continue;
+        }
+
         map.getShadowMap()->render(driver, view.getVisibleDirectionalShadowCasters(), pass, view);
 
-        assert(map.getLayout().layer < mTextureRequirements.layers);
         passes.emplace_back(&map, pass);
-
-        const uint8_t layer = map.getLayout().layer;
-        assert(layer < MAX_SHADOW_LAYERS);
         layerSampleCount[layer] = map.getLayout().vsmSamples;
+        layerRendered[layer] = true;
     }
     for (size_t i = 0; i < mSpotShadowMaps.size(); i++) {
         const auto& map = mSpotShadowMaps[i];
@@ -112,115 +164,127 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
             continue;
         }
 
+        const uint8_t layer = map.getLayout().layer;
+        assert(layer < mTextureRequirements.layers);
+        if (caching && !updateCachedShadowMap(engine, view, map,
+                VISIBLE_SPOT_SHADOW_RENDERABLE_N(i), false)) {
+            continue;
+        }
+
         pass.setVisibilityMask(VISIBLE_SPOT_SHADOW_RENDERABLE_N(i));
         map.getShadowMap()->render(driver, view.getVisibleSpotShadowCasters(), pass, view);
         pass.clearVisibilityMask();
 
-        assert(map.getLayout().layer < mTextureRequirements.layers);
         passes.emplace_back(&map, pass);
-
-        const uint8_t layer = map.getLayout().layer;
-        assert(layer < MAX_SHADOW_LAYERS);
         layerSampleCount[layer] = map.getLayout().vsmSamples;
+        layerRendered[layer] = true;
     }
     assert(passes.size() <= mTextureRequirements.layers);
 
-    const bool fillWithCheckerboard = engine.debug.shadowmap.checkerboard && !view.hasVsm();
+    FrameGraphId<FrameGraphTexture> shadows;
+    if (imported) {
+        shadows = fg.import("Shadow Texture", mCachedTextureDesc, mCachedTexture);
+    }
 
-    auto& shadowPass = fg.addPass<ShadowPassData>("Shadow Pass",
-            [&](FrameGraph::Builder& builder, auto& data) {
-                FrameGraphTexture::Descriptor shadowTextureDesc {
-                    .width = mTextureRequirements.size, .height = mTextureRequirements.size,
-                    .depth = mTextureRequirements.layers,
-                    .levels = mTextureRequirements.levels,
-                    .type = SamplerType::SAMPLER_2D_ARRAY,
-                    .format = mTextureFormat,
-                    .usage = TextureUsage::DEPTH_ATTACHMENT | TextureUsage::SAMPLEABLE
-                        | (fillWithCheckerboard ? TextureUsage::UPLOADABLE : (TextureUsage) 0)
-                };
-
-                if (view.hasVsm()) {
-                    // TODO: support 16-bit VSM depth textures.
-                    shadowTextureDesc.format = TextureFormat::RG32F;
-                    shadowTextureDesc.usage = TextureUsage::COLOR_ATTACHMENT |
-                            TextureUsage::SAMPLEABLE;
-                }
-
-                data.shadows = builder.createTexture("Shadow Texture", shadowTextureDesc);
-                data.shadows = builder.write(data.shadows);
-
-                if (view.hasVsm()) {
-                    // When rendering VSM shadow maps, we still need a depth texture for correct
-                    // sorting. The texture is cleared before each pass and discarded afterwards.
-                    data.tempDepth = builder.createTexture("Temporary VSM Depth Texture", {
-                        .width = mTextureRequirements.size, .height = mTextureRequirements.size,
-                        .depth = 1,
-                        .levels = 1,
-                        // Each shadow pass has its own sample count. We specify samples = 1 here to
-                        // force the frame graph to create the "magic resolve" textures with correct
-                        // sample counts automatically.
-                        .samples = 1,
-                        .type = SamplerType::SAMPLER_2D,
-                        .format = TextureFormat::DEPTH16,
-                        .usage = TextureUsage::DEPTH_ATTACHMENT
-                    });
-                    // We specify "read" for the temporary shadow texture, so it isn't culled.
-                    data.tempDepth = builder.write(builder.read(data.tempDepth));
-                }
-
-                // Create a render target for each layer of the texture array.
-                for (uint8_t i = 0u; i < mTextureRequirements.layers; i++) {
-                    FrameGraphRenderTarget::Descriptor renderTargetDesc {};
-                    if (view.hasVsm()) {
-                        renderTargetDesc.attachments = { { data.shadows, 0u, i }, { data.tempDepth } };
-                        renderTargetDesc.clearFlags = TargetBufferFlags::COLOR |
-                            TargetBufferFlags::DEPTH;
-                        renderTargetDesc.clearColor = { 1.0f, 1.0f, 0.0f, 0.0f };
-                        renderTargetDesc.samples = layerSampleCount[i];
+    // when all the shadow maps are cached, the imported texture is used as is
+    if (!imported || !passes.empty()) {
+        auto& shadowPass = fg.addPass<ShadowPassData>("Shadow Pass",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    if (imported) {
+                        data.shadows = builder.write(shadows);
                     } else {
-                        renderTargetDesc.attachments = { {}, { data.shadows, 0u, i } };
-                        renderTargetDesc.clearFlags = TargetBufferFlags::DEPTH;
+                        data.shadows = builder.createTexture("Shadow Texture", shadowTextureDesc);
+                        data.shadows = builder.write(data.shadows);
                     }
 
-                    data.rt[i] = builder.createRenderTarget("Shadow RT", renderTargetDesc);
-                }
-            },
-            [=, passes = std::move(passes), &view, &engine](FrameGraphPassResources const& resources,
-                    auto const& data, DriverApi& driver) mutable {
-                for (auto& [map, pass] : passes) {
-                    FCamera const& camera = map->getShadowMap()->getCamera();
-                    filament::CameraInfo cameraInfo(camera);
-                    view.prepareCamera(cameraInfo);
-
-                    // we set a viewport with a 1-texel border for when we index outside of the
-                    // texture
-                    // DON'T CHANGE this unless ShadowMap::getTextureCoordsMapping() is updated too.
-                    // see: ShadowMap::getTextureCoordsMapping()
-                    // For floating-point depth textures, the 1-texel border could be set to
-                    // FLOAT_MAX to avoid clamping in the shadow shader (see sampleDepth inside
-                    // shadowing.fs). Unfortunately, the APIs don't seem let us clear depth
-                    // attachments to anything greater than 1.0, so we'd need a way to do this other
-                    // than clearing.
-                    const uint32_t dim = map->getLayout().size;
-                    filament::Viewport viewport { 1, 1, dim - 2, dim - 2 };
-                    view.prepareViewport(viewport);
-
-                    view.commitUniforms(driver);
-
-                    const auto layer = map->getLayout().layer;
-                    auto rt = resources.get(data.rt[layer]);
-                    rt.params.viewport = viewport;
-
-                    auto polygonOffset = map->getShadowMap()->getPolygonOffset();
-                    pass.overridePolygonOffset(&polygonOffset);
-
-                    pass.execute("Shadow Pass", rt.target, rt.params);
-                }
-
-                engine.flush(); // Wake-up the driver thread
-            });
-
-    auto shadows = shadowPass.getData().shadows;
+                    if (view.hasVsm()) {
+                        // When rendering VSM shadow maps, we still need a depth texture for correct
+                        // sorting. The texture is cleared before each pass and discarded afterwards.
+                        data.tempDepth = builder.createTexture("Temporary VSM Depth Texture", {
+                            .width = mTextureRequirements.size, .height = mTextureRequirements.size,
+                            .depth = 1,
+                            .levels = 1,
+                            // Each shadow pass has its own sample count. We specify samples = 1 here to
+                            // force the frame graph to create the "magic resolve" textures with correct
+                            // sample counts automatically.
+                            .samples = 1,
+                            .type = SamplerType::SAMPLER_2D,
+                            .format = TextureFormat::DEPTH16,
+                            .usage = TextureUsage::DEPTH_ATTACHMENT
+                        });
+                        // We specify "read" for the temporary shadow texture, so it isn't culled.
+                        data.tempDepth = builder.write(builder.read(data.tempDepth));
+                    }
+
+                    // Create a render target for each rendered layer of the texture array, the
+                    // other layers are left untouched.
+                    for (uint8_t i = 0u; i < mTextureRequirements.layers; i++) {
+                        if (!layerRendered[i]) {
+                            continue;
+                        }
+                        FrameGraphRenderTarget::Descriptor renderTargetDesc {};
+                        if (view.hasVsm()) {
+                            renderTargetDesc.attachments = { { data.shadows, 0u, i }, { data.tempDepth } };
+                            renderTargetDesc.clearFlags = TargetBufferFlags::COLOR |
+                                TargetBufferFlags::DEPTH;
+                            renderTargetDesc.clearColor = { 1.0f, 1.0f, 0.0f, 0.0f };
+                            renderTargetDesc.samples = layerSampleCount[i];
+                        } else {
+                            renderTargetDesc.attachments = { {}, { data.shadows, 0u, i } };
+                            renderTargetDesc.clearFlags = TargetBufferFlags::DEPTH;
+                        }
+
+                        data.rt[i] = builder.createRenderTarget("Shadow RT", renderTargetDesc);
+                    }
+                },
+                [=, passes = std::move(passes), &view, &engine](FrameGraphPassResources const& resources,
+                        auto const& data, DriverApi& driver) mutable {
+                    // the shadow maps must survive the end of the pass to be reused next frame
+                    const TargetBufferFlags keep = caching ?
+                            (view.hasVsm() ? TargetBufferFlags::COLOR : TargetBufferFlags::DEPTH) :
+                            TargetBufferFlags::NONE;
+
+                    for (auto& [map, pass] : passes) {
+                        FCamera const& camera = map->getShadowMap()->getCamera();
+                        filament::CameraInfo cameraInfo(camera);
+                        view.prepareCamera(cameraInfo);
+
+                        // we set a viewport with a 1-texel border for when we index outside of the
+                        // texture
+                        // DON'T CHANGE this unless ShadowMap::getTextureCoordsMapping() is updated too.
+                        // see: ShadowMap::getTextureCoordsMapping()
+                        // For floating-point depth textures, the 1-texel border could be set to
+                        // FLOAT_MAX to avoid clamping in the shadow shader (see sampleDepth inside
+                        // shadowing.fs). Unfortunately, the APIs don't seem let us clear depth
+                        // attachments to anything greater than 1.0, so we'd need a way to do this other
+                        // than clearing.
+                        const uint32_t dim = map->getLayout().size;
+                        filament::Viewport viewport { 1, 1, dim - 2, dim - 2 };
+                        view.prepareViewport(viewport);
+
+                        view.commitUniforms(driver);
+
+                        const auto layer = map->getLayout().layer;
+                        auto rt = resources.get(data.rt[layer]);
+                        rt.params.viewport = viewport;
+                        rt.params.flags.discardEnd &= ~keep;
+
+                        auto polygonOffset = map->getShadowMap()->getPolygonOffset();
+                        pass.overridePolygonOffset(&polygonOffset);
+
+                        pass.execute("Shadow Pass", rt.target, rt.params);
+                    }
+
+                    if (caching && !imported) {
+                        // the new shadow texture is kept, it's imported again next frame
+                        resources.detach(data.shadows, &mCachedTexture, &mCachedTextureDesc);
+                    }
+
+                    engine.flush(); // Wake-up the driver thread
+                });
+
+        shadows = shadowPass.getData().shadows;
+    }
 
     if (UTILS_UNLIKELY(fillWithCheckerboard)) {
         struct DebugPatternData {
@@ -242,10 +306,13 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
     }
 
     // If the shadow texture has more than one level, then anisotropy was specified and we should
-    // generate VSM mipmaps.
+    // generate VSM mipmaps. The mipmaps of the cached layers are still valid.
     if (mTextureRequirements.levels > 1) {
         auto& ppm = engine.getPostProcessManager();
         for (uint8_t layer = 0; layer < mTextureRequirements.layers; layer++) {
+            if (!layerRendered[layer]) {
+                continue;
+            }
             for (size_t level = 0; level < mTextureRequirements.levels - 1; level++) {
                 shadows = ppm.vsmMipmapPass(fg, shadows, layer, level);
             }
@@ -255,6 +322,103 @@ void ShadowMapManager::render(FrameGraph& fg, FEngine& engine, FView& view,
     fg.getBlackboard().put("shadows", shadows);
 }
 
+bool ShadowMapManager::updateCachedShadowMap(FEngine& engine, FView& view,
+        ShadowMapEntry const& entry, uint8_t visibilityMask, bool cascade) noexcept {
+    FRenderableManager const& rcm = engine.getRenderableManager();
+    FScene::RenderableSoa const& soa = view.getScene()->getRenderableData();
+    FView::Range const& range = cascade ?
+            view.getVisibleDirectionalShadowCasters() : view.getVisibleSpotShadowCasters();
+
+    auto const* const UTILS_RESTRICT soaInstance        = soa.data<FScene::RENDERABLE_INSTANCE>();
+    auto const* const UTILS_RESTRICT soaWorldTransform  = soa.data<FScene::WORLD_TRANSFORM>();
+    auto const* const UTILS_RESTRICT soaReversedWinding = soa.data<FScene::REVERSED_WINDING_ORDER>();
+    auto const* const UTILS_RESTRICT soaVisibility      = soa.data<FScene::VISIBILITY_STATE>();
+    auto const* const UTILS_RESTRICT soaWorldAABBCenter = soa.data<FScene::WORLD_AABB_CENTER>();
+    auto const* const UTILS_RESTRICT soaVisibleMask     = soa.data<FScene::VISIBLE_MASK>();
+    auto const* const UTILS_RESTRICT soaMorphWeights    = soa.data<FScene::MORPH_WEIGHTS>();
+    auto const* const UTILS_RESTRICT soaWorldAABBExtent = soa.data<FScene::WORLD_AABB_EXTENT>();
+    auto const* const UTILS_RESTRICT soaPrimitives      = soa.data<FScene::PRIMITIVES>();
+    auto const* const UTILS_RESTRICT soaInstances       = soa.data<FScene::INSTANCES>();
+
+    ShadowMap const& shadowMap = *entry.getShadowMap();
+    FCamera const& camera = shadowMap.getCamera();
+    Frustum const& frustum = camera.getFrustum();
+
+    // All the cascades are culled against the whole camera frustum, but a cascade only depends
+    // on the casters inside its own frustum.
+    bool animated = false;
+    std::vector<ShadowCaster>& casters = mShadowCasters;
+    casters.clear();
+    for (uint32_t i : range) {
+        if (!(soaVisibleMask[i] & visibilityMask)) {
+            continue;
+        }
+        if (cascade && !Culler::intersects(frustum,
+                Box{ soaWorldAABBCenter[i], soaWorldAABBExtent[i] })) {
+            continue;
+        }
+        // the content of the bones and the transforms of the instances are not tracked, so these
+        // renderables are considered changed every frame
+        if (soaVisibility[i].skinning || soaInstances[i].count) {
+            animated = true;
+            break;
+        }
+        // the parameters of masked or custom vertex materials can change the shadow; versions
+        // only increase, so their sum changes when any of them does
+        uint32_t materialVersion = 0;
+        for (FRenderPrimitive const& primitive : soaPrimitives[i]) {
+            materialVersion += primitive.getMaterialInstance()->getParametersVersion();
+        }
+        casters.push_back({
+                .worldTransform = soaWorldTransform[i],
+                .morphWeights = soaMorphWeights[i],
+                .primitives = soaPrimitives[i].data(),
+                .primitiveCount = uint32_t(soaPrimitives[i].size()),
+                .instance = soaInstance[i].asValue(),
+                .version = rcm.getVersion(soaInstance[i]),
+                .materialVersion = materialVersion,
+                .reversedWinding = soaReversedWinding[i] });
+    }
+
+    CachedShadowMap& cached = mCachedShadowMaps[entry.getLayout().layer];
+    const mat4f projection(camera.getProjectionMatrix());
+    mat4f const& model = camera.getModelMatrix();
+    const PolygonOffset polygonOffset = shadowMap.getPolygonOffset();
+    const ShadowLayout& layout = entry.getLayout();
+
+    const bool dirty = animated || !cached.valid ||
+            cached.projection != projection ||
+            cached.model != model ||
+            cached.polygonOffset.slope != polygonOffset.slope ||
+            cached.polygonOffset.constant != polygonOffset.constant ||
+            cached.size != layout.size ||
+            cached.vsmSamples != layout.vsmSamples ||
+            cached.casters.size() != casters.size() ||
+            !std::equal(casters.begin(), casters.end(), cached.casters.begin());
+
+    cached.projection = projection;
+    cached.model = model;
+    cached.polygonOffset = polygonOffset;
+    cached.size = layout.size;
+    cached.vsmSamples = layout.vsmSamples;
+    cached.valid = !animated;
+    std::swap(cached.casters, casters);
+    return dirty;
+}
+
+void ShadowMapManager::invalidateCachedShadowMaps() noexcept {
+    for (auto& cached : mCachedShadowMaps) {
+        cached.valid = false;
+    }
+}
+
+void ShadowMapManager::destroyCachedTexture(FEngine& engine) noexcept {
+    mCachedTexture.destroy(engine.getResourceAllocator());
+    mCachedTexture = {};
+    mCachedTextureDesc = {};
+    invalidateCachedShadowMaps();
+}
+
 void ShadowMapManager::prepareShadow(backend::Handle<backend::HwTexture> texture,
         FView const& view) const noexcept {
     uint8_t anisotropy = 0;
@@ -308,8 +472,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateCascadeShadowMaps(
         map.update(lightData, 0, scene, viewingCameraInfo, visibleLayers,
                 layout, cascadeParams);
         Frustum const& frustum = map.getCamera().getFrustum();
-        FView::cullRenderables(engine.getJobSystem(), renderableData, frustum,
-                VISIBLE_DIR_SHADOW_RENDERABLE_BIT);
+        FView::cullRenderables(engine.getJobSystem(), renderableData, scene->getCullingBvh(),
+                frustum, VISIBLE_DIR_SHADOW_RENDERABLE_BIT);
 
         // Set shadowBias, using the first directional cascade.
         const float texelSizeWorldSpace = map.getTexelSizeWorldSpace();
@@ -467,8 +631,8 @@ ShadowMapManager::ShadowTechnique ShadowMapManager::updateSpotShadowMaps(
             // Cull shadow casters
             UniformBuffer& u = shadowUb;
             Frustum const& frustum = shadowMap.getCamera().getFrustum();
-            FView::cullRenderables(engine.getJobSystem(), renderableData, frustum,
-                    VISIBLE_SPOT_SHADOW_RENDERABLE_N_BIT(i));
+            FView::cullRenderables(engine.getJobSystem(), renderableData, scene->getCullingBvh(),
+                    frustum, VISIBLE_SPOT_SHADOW_RENDERABLE_N_BIT(i));
 
             mat4f const& lightFromWorldMatrix =
                 view.hasVsm() ? shadowMap.getLightSpaceMatrixVsm() : shadowMap.getLightSpaceMatrix();
@@ -18,6 +18,7 @@
 #define TNT_FILAMENT_DRIVER_UNIFORMBUFFER_H
 
 #include <algorithm>
+#include <limits>
 
 #include "private/backend/DriverApi.h"
 
@@ -69,7 +70,8 @@ public:
     // invalidate a range of uniforms and return a pointer to it. offset and size given in bytes
     void* invalidateUniforms(size_t offset, size_t size) {
         assert(offset + size <= mSize);
-        mSomethingDirty = true;
+        mDirtyBegin = std::min(mDirtyBegin, uint32_t(offset));
+        mDirtyEnd = std::max(mDirtyEnd, uint32_t(offset + size));
         return static_cast<char*>(mBuffer) + offset;
     }
 
@@ -84,10 +86,17 @@ public:
     size_t getSize() const noexcept { return mSize; }
 
     // return if any uniform has been changed
-    bool isDirty() const noexcept { return mSomethingDirty; }
+    bool isDirty() const noexcept { return mDirtyBegin < mDirtyEnd; }
+
+    // the smallest range of bytes containing all the changed uniforms, only valid if isDirty()
+    size_t getDirtyOffset() const noexcept { return mDirtyBegin; }
+    size_t getDirtySize() const noexcept { return mDirtyEnd - mDirtyBegin; }
 
     // mark the whole buffer as clean (no modified uniforms)
-    void clean() const noexcept { mSomethingDirty = false; }
+    void clean() const noexcept {
+        mDirtyBegin = std::numeric_limits<uint32_t>::max();
+        mDirtyEnd = 0;
+    }
 
     /*
      * -----------------------------------------------
@@ -196,7 +205,9 @@ private:
     char mStorage[96];
     void *mBuffer = nullptr;
     uint32_t mSize = 0;
-    mutable bool mSomethingDirty = false;
+    // range of changed bytes, empty when mDirtyBegin >= mDirtyEnd
+    mutable uint32_t mDirtyBegin = std::numeric_limits<uint32_t>::max();
+    mutable uint32_t mDirtyEnd = 0;
 };
 
 // specialization for mat3f (which has a different alignment, see std140 layout rules)
@@ -225,6 +236,12 @@ inline void UniformBuffer::setUniform(void* addr, size_t offset, const math::mat
     temp.v[2][3] = 0; // not needed, but doesn't cost anything
 }
 
+// a mat3f is stored as three float4 columns, the whole 48 bytes must be uploaded
+template<>
+inline void UniformBuffer::setUniform(size_t offset, const math::mat3f& v) noexcept {
+    setUniform(invalidateUniforms(offset, sizeof(math::float4) * 3), 0, v);
+}
+
 template<>
 inline math::mat3f UniformBuffer::getUniform(size_t offset) const noexcept {
     math::float4 const* p = reinterpret_cast<math::float4 const*>(
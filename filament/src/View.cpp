@@ -41,6 +41,7 @@
 #include <math/scalar.h>
 #include <math/fast.h>
 
+#include <atomic>
 #include <memory>
 #include <filament/View.h>
 
@@ -62,6 +63,8 @@ FView::FView(FEngine& engine)
     FDebugRegistry& debugRegistry = engine.getDebugRegistry();
     debugRegistry.registerProperty("d.view.camera_at_origin",
             &engine.debug.view.camera_at_origin);
+    debugRegistry.registerProperty("d.view.binned_froxelization",
+            &engine.debug.view.binned_froxelization);
 
     // set-up samplers
     mFroxelizer.getRecordBuffer().setSampler(PerViewSib::RECORDS, mPerViewSb);
@@ -97,8 +100,31 @@ void FView::terminate(FEngine& engine) {
     driver.destroyUniformBuffer(mShadowUbh);
     driver.destroySamplerGroup(mPerViewSbh);
     driver.destroyUniformBuffer(mRenderableUbh);
+    driver.destroyUniformBuffer(mInstancesUbh);
     drainFrameHistory(engine);
     mFroxelizer.terminate(driver);
+    mShadowMapManager.terminate(engine);
+}
+
+void FView::setCommandCachingEnabled(bool enabled) noexcept {
+    mCommandCachingEnabled = enabled;
+    if (!enabled) {
+        mStructurePassCommandCache.clear();
+        mColorPassCommandCache.clear();
+    }
+}
+
+void FView::setShadowCachingEnabled(bool enabled) noexcept {
+    mShadowCachingEnabled = enabled;
+    if (!enabled) {
+        // the cached shadow texture itself is freed the next time shadows are rendered
+        mShadowMapManager.invalidateCachedShadowMaps();
+    }
+}
+
+void FView::setOcclusionCullingEnabled(bool enabled) noexcept {
+    mOcclusionCullingEnabled = enabled;
+    mOcclusionCullingStats = {};
 }
 
 void FView::setViewport(filament::Viewport const& viewport) noexcept {
@@ -349,6 +375,7 @@ void FView::prepareLighting(FEngine& engine, FEngine::DriverApi& driver, ArenaSc
     mHasDynamicLighting = scene->getLightData().size() > FScene::DIRECTIONAL_LIGHTS_COUNT;
     if (mHasDynamicLighting) {
         Froxelizer& froxelizer = mFroxelizer;
+        froxelizer.setBinningEnabled(engine.debug.view.binned_froxelization);
         if (froxelizer.prepare(driver, arena, viewport, camera.projection, camera.zn, camera.zf)) {
             froxelizer.updateUniforms(u); // update our uniform buffer if needed
         }
@@ -431,7 +458,17 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
          * (this will set the VISIBLE_RENDERABLE bit)
          */
 
-        prepareVisibleRenderables(js, mCullingFrustum, renderableData);
+        prepareVisibleRenderables(js, mCullingFrustum, renderableData, scene->getCullingBvh());
+
+        /*
+         * Occlusion culling: clears the VISIBLE_RENDERABLE bit of the renderables hidden behind
+         * occluders
+         */
+
+        if (mOcclusionCullingEnabled && isFrustumCullingEnabled()) {
+            cullOccludedRenderables(js, engine.getRenderableManager(), worldOriginScene, viewport,
+                    renderableData);
+        }
 
 
         /*
@@ -496,12 +533,33 @@ void FView::prepare(FEngine& engine, backend::DriverApi& driver, ArenaScope& are
                 mRenderableUBOSize = uint32_t(count * sizeof(PerRenderableUib));
                 driver.destroyUniformBuffer(mRenderableUbh);
                 mRenderableUbh = driver.createUniformBuffer(mRenderableUBOSize,
-                        backend::BufferUsage::STREAM);
+                        backend::BufferUsage::DYNAMIC);
+                // a new UniformBuffer is entirely dirty, so it'll be uploaded in full
+                mRenderableUb = UniformBuffer(mRenderableUBOSize);
             } else {
                 // TODO: should we shrink the underlying UBO at some point?
             }
             assert(mRenderableUbh);
-            scene->updateUBOs(merged, mRenderableUbh);
+            scene->updateUBOs(merged, mRenderableUbh, mRenderableUb);
+
+            // the instances of instanced renderables are culled individually, only the visible
+            // ones are uploaded, in batches
+            const size_t batchCount = scene->cullInstances(merged,
+                    isFrustumCullingEnabled() ? &mCullingFrustum : nullptr);
+            const size_t instancesSize =
+                    batchCount * CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance);
+            if (instancesSize) {
+                if (mInstancesUBOSize < instancesSize) {
+                    // allocate 1/3 extra, like the renderables UBO
+                    const size_t count = (4u * batchCount + 2u) / 3u;
+                    mInstancesUBOSize = uint32_t(
+                            count * CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance));
+                    driver.destroyUniformBuffer(mInstancesUbh);
+                    mInstancesUbh = driver.createUniformBuffer(mInstancesUBOSize,
+                            backend::BufferUsage::DYNAMIC);
+                }
+                scene->updateInstanceUBOs(merged, mInstancesUbh);
+            }
         }
     }
 
@@ -720,19 +778,25 @@ void FView::commitFroxels(backend::DriverApi& driverApi) const noexcept {
 }
 
 UTILS_NOINLINE
-void FView::prepareVisibleRenderables(JobSystem& js,
-        Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept {
+void FView::prepareVisibleRenderables(JobSystem& js, Frustum const& frustum,
+        FScene::RenderableSoa& renderableData, CullingBvh const* bvh) const noexcept {
     SYSTRACE_CALL();
     if (UTILS_LIKELY(isFrustumCullingEnabled())) {
-        FView::cullRenderables(js, renderableData, frustum, VISIBLE_RENDERABLE_BIT);
+        FView::cullRenderables(js, renderableData, bvh, frustum, VISIBLE_RENDERABLE_BIT);
     } else {
         std::uninitialized_fill(renderableData.begin<FScene::VISIBLE_MASK>(),
                   renderableData.end<FScene::VISIBLE_MASK>(), VISIBLE_RENDERABLE);
     }
 }
 
-void FView::cullRenderables(JobSystem& js,
-        FScene::RenderableSoa& renderableData, Frustum const& frustum, size_t bit) noexcept {
+void FView::cullRenderables(JobSystem& js, FScene::RenderableSoa& renderableData,
+        CullingBvh const* bvh, Frustum const& frustum, size_t bit) noexcept {
+
+    if (bvh) {
+        assert(bvh->getCount() == renderableData.size());
+        bvh->cull(js, renderableData.data<FScene::VISIBLE_MASK>(), frustum, bit);
+        return;
+    }
 
     float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
     float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
@@ -754,6 +818,70 @@ void FView::cullRenderables(JobSystem& js,
     js.runAndWait(job);
 }
 
+void FView::cullOccludedRenderables(JobSystem& js, FRenderableManager const& rcm,
+        mat4f const& worldOriginScene, filament::Viewport const& viewport,
+        FScene::RenderableSoa& renderableData) noexcept {
+    SYSTRACE_CALL();
+
+    const mat4f clipFromWorld{ mCullingCamera->getCullingProjectionMatrix() *
+            FCamera::getViewMatrix(worldOriginScene * mCullingCamera->getModelMatrix()) };
+
+    // the depth buffer has the aspect ratio of the viewport
+    const uint32_t width = OcclusionCuller::PREFERRED_WIDTH;
+    const uint32_t height = viewport.width ? uint32_t(clamp(
+            float(width) * float(viewport.height) / float(viewport.width), 1.0f, float(width))) : 1;
+    OcclusionCuller& culler = mOcclusionCuller;
+    culler.begin(clipFromWorld, width, height);
+
+    auto const* const instances = renderableData.data<FScene::RENDERABLE_INSTANCE>();
+    mat4f const* const worldTransforms = renderableData.data<FScene::WORLD_TRANSFORM>();
+    uint8_t const* const layers = renderableData.data<FScene::LAYERS>();
+    FScene::VisibleMaskType* const visibleArray = renderableData.data<FScene::VISIBLE_MASK>();
+    const uint8_t visibleLayers = getVisibleLayers();
+
+    // rasterize the occluders that survived frustum culling
+    uint32_t occluderCount = 0;
+    uint32_t testedCount = 0;
+    for (size_t i = 0, c = renderableData.size(); i < c; i++) {
+        if ((visibleArray[i] & VISIBLE_RENDERABLE) && (layers[i] & visibleLayers)) {
+            testedCount++;
+            Box const& occluder = rcm.getOccluder(instances[i]);
+            if (!occluder.isEmpty()) {
+                occluderCount += culler.rasterize(worldTransforms[i], occluder) ? 1 : 0;
+            }
+        }
+    }
+
+    if (occluderCount == 0) {
+        mOcclusionCullingStats = {};
+        return;
+    }
+
+    culler.buildHierarchy();
+
+    float3 const* worldAABBCenter = renderableData.data<FScene::WORLD_AABB_CENTER>();
+    float3 const* worldAABBExtent = renderableData.data<FScene::WORLD_AABB_EXTENT>();
+
+    // occlusion test job (this runs on multiple threads)
+    std::atomic<uint32_t> culledCount{ 0 };
+    auto functor = [&culler, &culledCount, worldAABBCenter, worldAABBExtent, visibleArray]
+            (uint32_t index, uint32_t c) {
+        const size_t culled = culler.cull(visibleArray + index,
+                worldAABBCenter + index, worldAABBExtent + index, c, VISIBLE_RENDERABLE_BIT);
+        culledCount.fetch_add(uint32_t(culled), std::memory_order_relaxed);
+    };
+
+    auto *job = jobs::parallel_for(js, nullptr, 0, (uint32_t)renderableData.size(),
+            std::ref(functor), jobs::CountSplitter<64, 8>());
+    js.runAndWait(job);
+
+    mOcclusionCullingStats = {
+            .occluderCount = occluderCount,
+            .testedCount = testedCount,
+            .culledCount = culledCount.load(std::memory_order_relaxed)
+    };
+}
+
 void FView::prepareVisibleLights(FLightManager const& lcm, utils::JobSystem&,
         Frustum const& frustum, FScene::LightSoa& lightData) noexcept {
     SYSTRACE_CALL();
@@ -1080,4 +1208,32 @@ bool View::isScreenSpaceRefractionEnabled() const noexcept {
     return upcast(this)->isScreenSpaceRefractionEnabled();
 }
 
+void View::setCommandCachingEnabled(bool enabled) noexcept {
+    upcast(this)->setCommandCachingEnabled(enabled);
+}
+
+bool View::isCommandCachingEnabled() const noexcept {
+    return upcast(this)->isCommandCachingEnabled();
+}
+
+void View::setShadowCachingEnabled(bool enabled) noexcept {
+    upcast(this)->setShadowCachingEnabled(enabled);
+}
+
+bool View::isShadowCachingEnabled() const noexcept {
+    return upcast(this)->isShadowCachingEnabled();
+}
+
+void View::setOcclusionCullingEnabled(bool enabled) noexcept {
+    upcast(this)->setOcclusionCullingEnabled(enabled);
+}
+
+bool View::isOcclusionCullingEnabled() const noexcept {
+    return upcast(this)->isOcclusionCullingEnabled();
+}
+
+View::OcclusionCullingStats View::getOcclusionCullingStats() const noexcept {
+    return upcast(this)->getOcclusionCullingStats();
+}
+
 } // namespace filament
@@ -29,6 +29,9 @@
 #include <utils/Log.h>
 #include <utils/Panic.h>
 
+#include <algorithm>
+#include <limits>
+
 using namespace filament::math;
 using namespace utils;
 
@@ -38,6 +41,7 @@ struct RenderableManager::BuilderDetails {
     using Entry = RenderableManager::Builder::Entry;
     std::vector<Entry> mEntries;
     Box mAABB;
+    Box mOccluder;
     uint8_t mLayerMask = 0x1;
     uint8_t mPriority = 0x4;
     bool mCulling : 1;
@@ -48,6 +52,8 @@ struct RenderableManager::BuilderDetails {
     size_t mSkinningBoneCount = 0;
     Bone const* mUserBones = nullptr;
     mat4f const* mUserBoneMatrices = nullptr;
+    size_t mInstanceCount = 0;
+    mat4f const* mUserInstanceTransforms = nullptr;
 
     explicit BuilderDetails(size_t count)
             : mEntries(count), mCulling(true), mCastShadows(false), mReceiveShadows(true),
@@ -109,6 +115,11 @@ RenderableManager::Builder& RenderableManager::Builder::boundingBox(const Box& a
     return *this;
 }
 
+RenderableManager::Builder& RenderableManager::Builder::occluder(const Box& occluder) noexcept {
+    mImpl->mOccluder = occluder;
+    return *this;
+}
+
 RenderableManager::Builder& RenderableManager::Builder::layerMask(uint8_t select, uint8_t values) noexcept {
     mImpl->mLayerMask = (mImpl->mLayerMask & ~select) | (values & select);
     return *this;
@@ -163,6 +174,13 @@ RenderableManager::Builder& RenderableManager::Builder::morphing(bool enable) no
     return *this;
 }
 
+RenderableManager::Builder& RenderableManager::Builder::instances(
+        size_t instanceCount, mat4f const* transforms) noexcept {
+    mImpl->mInstanceCount = instanceCount;
+    mImpl->mUserInstanceTransforms = transforms;
+    return *this;
+}
+
 RenderableManager::Builder& RenderableManager::Builder::blendOrder(size_t index, uint16_t blendOrder) noexcept {
     if (index < mImpl->mEntries.size()) {
         mImpl->mEntries[index].blendOrder = blendOrder;
@@ -178,6 +196,15 @@ RenderableManager::Builder::Result RenderableManager::Builder::build(Engine& eng
         return Error;
     }
 
+    const bool instanced = mImpl->mInstanceCount > 0;
+
+    if (!ASSERT_PRECONDITION_NON_FATAL(!instanced ||
+            (mImpl->mSkinningBoneCount == 0 && !mImpl->mMorphingEnabled),
+            "[entity=%u] instanced renderables can't use skinning or morphing",
+            entity.getId())) {
+        return Error;
+    }
+
     for (size_t i = 0, c = mImpl->mEntries.size(); i < c; i++) {
         auto& entry = mImpl->mEntries[i];
 
@@ -195,6 +222,15 @@ RenderableManager::Builder::Result RenderableManager::Builder::build(Engine& eng
             continue;
         }
 
+        // instanced renderables need instanced materials and vice versa, because the
+        // instance transforms replace the bones uniform block
+        if (!ASSERT_PRECONDITION_NON_FATAL(material->isInstanced() == instanced,
+                "[entity=%u, primitive @ %u] material \"%s\" is %sinstanced",
+                entity.getId(), i, material->getName().c_str_safe(),
+                instanced ? "not " : "")) {
+            return Error;
+        }
+
         // reject invalid geometry parameters
         if (!ASSERT_PRECONDITION_NON_FATAL(entry.offset + entry.count <= entry.indices->getIndexCount(),
                 "[entity=%u, primitive @ %u] offset (%u) + count (%u) > indexCount (%u)",
@@ -276,6 +312,7 @@ void FRenderableManager::create(
         setPrimitives(ci, { rp, size_type(builder->mEntries.size()) });
 
         setAxisAlignedBoundingBox(ci, builder->mAABB);
+        setOccluder(ci, builder->mOccluder);
         setLayerMask(ci, builder->mLayerMask);
         setPriority(ci, builder->mPriority);
         setCastShadows(ci, builder->mCastShadows);
@@ -321,6 +358,18 @@ void FRenderableManager::create(
                 }
             }
         }
+
+        const size_t instanceCount = builder->mInstanceCount;
+        if (UTILS_UNLIKELY(instanceCount > 0)) {
+            // the instance transforms are uploaded by the View after culling, so there is nothing
+            // to allocate on the GPU here.
+            std::unique_ptr<Instances>& instances = manager[ci].instances;
+            instances = std::unique_ptr<Instances>(new Instances{
+                    std::vector<mat4f>(instanceCount), {}, true });
+            if (builder->mUserInstanceTransforms) {
+                setInstanceTransforms(ci, builder->mUserInstanceTransforms, instanceCount);
+            }
+        }
     }
 }
 
@@ -386,8 +435,13 @@ void FRenderableManager::prepare(
         size_t i = instances[index].asValue();
         assert(i);  // we should never get the null instance here
         if (UTILS_UNLIKELY(bones[i])) {
-            if (bones[i]->bones.isDirty()) {
-                driver.loadUniformBuffer(bones[i]->handle, bones[i]->bones.toBufferDescriptor(driver));
+            UniformBuffer const& ub = bones[i]->bones;
+            if (ub.isDirty()) {
+                // only upload the bones that changed
+                const size_t offset = ub.getDirtyOffset();
+                const size_t size = ub.getDirtySize();
+                driver.updateUniformBuffer(bones[i]->handle,
+                        ub.toBufferDescriptor(driver, offset, size), uint32_t(offset));
             }
         }
     }
@@ -399,6 +453,7 @@ void FRenderableManager::setMaterialInstanceAt(Instance instance, uint8_t level,
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setMaterialInstance(upcast(mi));
+            invalidateVersion(instance);
             AttributeBitset required = mi->getMaterial()->getRequiredAttributes();
             AttributeBitset declared = primitives[primitiveIndex].getEnabledAttributes();
             if (UTILS_UNLIKELY((declared & required) != required)) {
@@ -429,6 +484,7 @@ void FRenderableManager::setBlendOrderAt(Instance instance, uint8_t level,
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].setBlendOrder(order);
+            invalidateVersion(instance);
         }
     }
 }
@@ -452,6 +508,7 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, vertices, indices, offset,
                     0, vertices->getVertexCount() - 1, count);
+            invalidateVersion(instance);
         }
     }
 }
@@ -462,6 +519,7 @@ void FRenderableManager::setGeometryAt(Instance instance, uint8_t level, size_t
         Slice<FRenderPrimitive>& primitives = getRenderPrimitives(instance, level);
         if (primitiveIndex < primitives.size()) {
             primitives[primitiveIndex].set(mEngine, type, offset, 0, 0, count);
+            invalidateVersion(instance);
         }
     }
 }
@@ -502,6 +560,61 @@ void FRenderableManager::setBones(Instance ci,
     }
 }
 
+void FRenderableManager::setBones(Instance const* UTILS_RESTRICT instances,
+        size_t const* UTILS_RESTRICT boneCounts, size_t count,
+        mat4f const* UTILS_RESTRICT transforms) noexcept {
+    std::unique_ptr<Bones> const* const UTILS_RESTRICT bones = mManager.raw_array<BONES>();
+    for (size_t i = 0; i < count; transforms += boneCounts[i], ++i) {
+        const Instance ci = instances[i];
+        if (!ci) {
+            continue;
+        }
+        std::unique_ptr<Bones> const& b = bones[ci.asValue()];
+        assert(b && boneCounts[i] <= b->count);
+        if (b) {
+            const size_t boneCount = std::min(boneCounts[i], b->count);
+            PerRenderableUibBone* UTILS_RESTRICT out = (PerRenderableUibBone*)b->bones.invalidateUniforms(
+                    0, boneCount * sizeof(PerRenderableUibBone));
+            for (size_t j = 0; j < boneCount; ++j) {
+                makeBone(&out[j], transforms[j]);
+            }
+        }
+    }
+}
+
+void FRenderableManager::setInstanceTransforms(Instance ci,
+        mat4f const* UTILS_RESTRICT transforms, size_t count, size_t offset) noexcept {
+    if (ci) {
+        std::unique_ptr<Instances> const& instances = mManager[ci].instances;
+        assert(instances && offset + count <= instances->transforms.size());
+        if (instances && offset < instances->transforms.size()) {
+            count = std::min(count, instances->transforms.size() - offset);
+            std::copy_n(transforms, count, instances->transforms.data() + offset);
+            instances->aabbDirty = true;
+        }
+    }
+}
+
+Box const& FRenderableManager::getInstancesAABB(Instance ci) const noexcept {
+    std::unique_ptr<Instances> const& instances = mManager[ci].instances;
+    Box const& aabb = mManager[ci].aabb;
+    if (!instances) {
+        return aabb;
+    }
+    if (instances->aabbDirty) {
+        instances->aabbDirty = false;
+        float3 lo{ std::numeric_limits<float>::max() };
+        float3 hi{ std::numeric_limits<float>::lowest() };
+        for (mat4f const& transform : instances->transforms) {
+            const Box box = rigidTransform(aabb, transform);
+            lo = min(lo, box.getMin());
+            hi = max(hi, box.getMax());
+        }
+        instances->aabb.set(lo, hi);
+    }
+    return instances->aabb;
+}
+
 void FRenderableManager::setMorphWeights(Instance ci, const float4& weights) noexcept {
     if (ci) {
         mManager[ci].morphWeights = weights;
@@ -552,6 +665,10 @@ void RenderableManager::setAxisAlignedBoundingBox(Instance instance, const Box&
     upcast(this)->setAxisAlignedBoundingBox(instance, aabb);
 }
 
+void RenderableManager::setOccluder(Instance instance, const Box& occluder) noexcept {
+    upcast(this)->setOccluder(instance, occluder);
+}
+
 void RenderableManager::setLayerMask(Instance instance, uint8_t select, uint8_t values) noexcept {
     upcast(this)->setLayerMask(instance, select, values);
 }
@@ -588,6 +705,10 @@ const Box& RenderableManager::getAxisAlignedBoundingBox(Instance instance) const
     return upcast(this)->getAxisAlignedBoundingBox(instance);
 }
 
+const Box& RenderableManager::getOccluder(Instance instance) const noexcept {
+    return upcast(this)->getOccluder(instance);
+}
+
 uint8_t RenderableManager::getLayerMask(Instance instance) const noexcept {
     return upcast(this)->getLayerMask(instance);
 }
@@ -636,6 +757,20 @@ void RenderableManager::setBones(Instance instance,
     upcast(this)->setBones(instance, transforms, boneCount, offset);
 }
 
+void RenderableManager::setBones(Instance const* instances, size_t const* boneCounts,
+        size_t count, mat4f const* transforms) noexcept {
+    upcast(this)->setBones(instances, boneCounts, count, transforms);
+}
+
+void RenderableManager::setInstanceTransforms(Instance instance,
+        mat4f const* transforms, size_t count, size_t offset) noexcept {
+    upcast(this)->setInstanceTransforms(instance, transforms, count, offset);
+}
+
+size_t RenderableManager::getInstanceCount(Instance instance) const noexcept {
+    return upcast(this)->getInstanceCount(instance);
+}
+
 void RenderableManager::setMorphWeights(Instance instance, float4 const& weights) noexcept {
     upcast(this)->setMorphWeights(instance, weights);
 }
@@ -35,6 +35,11 @@
 #include <utils/Slice.h>
 #include <utils/Range.h>
 
+#include <math/mat4.h>
+
+#include <memory>
+#include <vector>
+
 // for gtest
 class FilamentTest_Bones_Test;
 
@@ -96,6 +101,8 @@ public:
 
     inline void setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept;
 
+    inline void setOccluder(Instance instance, const Box& occluder) noexcept;
+
     inline void setLayerMask(Instance instance, uint8_t select, uint8_t values) noexcept;
 
     // The priority is clamped to the range [0..7]
@@ -112,7 +119,11 @@ public:
     inline void setPrimitives(Instance instance, utils::Slice<FRenderPrimitive> const& primitives) noexcept;
     inline void setBones(Instance instance, Bone const* transforms, size_t boneCount, size_t offset = 0) noexcept;
     inline void setBones(Instance instance, math::mat4f const* transforms, size_t boneCount, size_t offset = 0) noexcept;
+    void setBones(Instance const* instances, size_t const* boneCounts, size_t count,
+            math::mat4f const* transforms) noexcept;
     inline void setMorphWeights(Instance instance, const math::float4& weights) noexcept;
+    void setInstanceTransforms(Instance instance, math::mat4f const* transforms,
+            size_t count, size_t offset = 0) noexcept;
 
 
     inline bool isShadowCaster(Instance instance) const noexcept;
@@ -122,6 +133,7 @@ public:
 
     inline Box const& getAABB(Instance instance) const noexcept;
     inline Box const& getAxisAlignedBoundingBox(Instance instance) const noexcept { return getAABB(instance); }
+    inline Box const& getOccluder(Instance instance) const noexcept;
     inline Visibility getVisibility(Instance instance) const noexcept;
     inline uint8_t getLayerMask(Instance instance) const noexcept;
     inline uint8_t getPriority(Instance instance) const noexcept;
@@ -130,6 +142,18 @@ public:
     inline backend::Handle<backend::HwUniformBuffer> getBonesUbh(Instance instance) const noexcept;
     inline uint32_t getBoneCount(Instance instance) const noexcept;
 
+    // Instance transforms, empty unless the renderable is instanced.
+    inline size_t getInstanceCount(Instance instance) const noexcept;
+    inline math::mat4f const* getInstanceTransforms(Instance instance) const noexcept;
+
+    // The object-space AABB of all the instances, recomputed lazily when the transforms change.
+    Box const& getInstancesAABB(Instance instance) const noexcept;
+
+    // Returns a value that changes each time the primitives of this renderable are modified
+    // (material instance, geometry or blend order). Versions are unique across all instances,
+    // so they also change when an instance is reused by another component.
+    inline uint32_t getVersion(Instance instance) const noexcept;
+
 
     inline size_t getLevelCount(Instance instance) const noexcept { return 1; }
     inline size_t getPrimitiveCount(Instance instance, uint8_t level) const noexcept;
@@ -157,6 +181,12 @@ private:
         size_t count;
     };
 
+    struct Instances {
+        std::vector<math::mat4f> transforms;
+        mutable Box aabb;           // union of all the instances' AABBs
+        mutable bool aabbDirty;     // aabb needs to be recomputed
+    };
+
     friend class ::FilamentTest_Bones_Test;
 
     static void makeBone(PerRenderableUibBone* out, math::mat4f const& transforms) noexcept;
@@ -168,6 +198,9 @@ private:
         VISIBILITY,         // user data
         PRIMITIVES,         // user data
         BONES,              // filament data, UBO storing a pointer to the bones information
+        VERSION,            // filament data, see getVersion()
+        OCCLUDER,           // user data
+        INSTANCES,          // user data, per-instance transforms
     };
 
     using Base = utils::SingleInstanceComponentManager<
@@ -176,7 +209,10 @@ private:
             filament::math::float4,          // MORPH_WEIGHTS
             Visibility,                      // VISIBILITY
             utils::Slice<FRenderPrimitive>,  // PRIMITIVES
-            std::unique_ptr<Bones>           // BONES
+            std::unique_ptr<Bones>,          // BONES
+            uint32_t,                        // VERSION
+            Box,                             // OCCLUDER
+            std::unique_ptr<Instances>       // INSTANCES
     >;
 
     struct Sim : public Base {
@@ -197,6 +233,9 @@ private:
                 Field<VISIBILITY>   visibility;
                 Field<PRIMITIVES>   primitives;
                 Field<BONES>        bones;
+                Field<VERSION>      version;
+                Field<OCCLUDER>     occluder;
+                Field<INSTANCES>    instances;
             };
         };
 
@@ -208,8 +247,11 @@ private:
         }
     };
 
+    inline void invalidateVersion(Instance instance) noexcept;
+
     Sim mManager;
     FEngine& mEngine;
+    uint32_t mVersion = 0;
 };
 
 FILAMENT_UPCAST(RenderableManager)
@@ -217,6 +259,16 @@ FILAMENT_UPCAST(RenderableManager)
 void FRenderableManager::setAxisAlignedBoundingBox(Instance instance, const Box& aabb) noexcept {
     if (instance) {
         mManager[instance].aabb = aabb;
+        std::unique_ptr<Instances> const& instances = mManager[instance].instances;
+        if (UTILS_UNLIKELY(instances)) {
+            instances->aabbDirty = true;
+        }
+    }
+}
+
+void FRenderableManager::setOccluder(Instance instance, const Box& occluder) noexcept {
+    if (instance) {
+        mManager[instance].occluder = occluder;
     }
 }
 
@@ -287,9 +339,18 @@ void FRenderableManager::setPrimitives(Instance instance,
         utils::Slice<FRenderPrimitive> const& primitives) noexcept {
     if (instance) {
         mManager[instance].primitives = primitives;
+        invalidateVersion(instance);
     }
 }
 
+void FRenderableManager::invalidateVersion(Instance instance) noexcept {
+    mManager[instance].version = ++mVersion;
+}
+
+uint32_t FRenderableManager::getVersion(Instance instance) const noexcept {
+    return mManager[instance].version;
+}
+
 FRenderableManager::Visibility
 FRenderableManager::getVisibility(Instance instance) const noexcept {
     return mManager[instance].visibility;
@@ -323,6 +384,10 @@ Box const& FRenderableManager::getAABB(Instance instance) const noexcept {
     return mManager[instance].aabb;
 }
 
+Box const& FRenderableManager::getOccluder(Instance instance) const noexcept {
+    return mManager[instance].occluder;
+}
+
 backend::Handle<backend::HwUniformBuffer> FRenderableManager::getBonesUbh(Instance instance) const noexcept {
     std::unique_ptr<Bones> const& bones = mManager[instance].bones;
     return bones ? bones->handle : backend::Handle<backend::HwUniformBuffer>{};
@@ -333,6 +398,16 @@ inline uint32_t FRenderableManager::getBoneCount(Instance instance) const noexce
     return bones ? bones->count : 0;
 }
 
+size_t FRenderableManager::getInstanceCount(Instance instance) const noexcept {
+    std::unique_ptr<Instances> const& instances = mManager[instance].instances;
+    return instances ? instances->transforms.size() : 0;
+}
+
+math::mat4f const* FRenderableManager::getInstanceTransforms(Instance instance) const noexcept {
+    std::unique_ptr<Instances> const& instances = mManager[instance].instances;
+    return instances ? instances->transforms.data() : nullptr;
+}
+
 utils::Slice<FRenderPrimitive> const& FRenderableManager::getRenderPrimitives(
         Instance instance, uint8_t level) const noexcept {
     return mManager[instance].primitives;
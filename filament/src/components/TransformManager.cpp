@@ -16,8 +16,12 @@
 
 #include "components/TransformManager.h"
 
+#include <utils/JobSystem.h>
+
 #include <math/mat4.h>
 
+#include <algorithm>
+
 using namespace utils;
 using namespace filament::math;
 
@@ -178,6 +182,11 @@ void FTransformManager::commitLocalTransformTransaction() noexcept {
         auto& soa = manager.getSoA();
         soa.ensureCapacity(soa.size() + 1);
 
+        if (UTILS_UNLIKELY(mParallelCommitEnabled && mJobSystem)) {
+            transformLevels(*mJobSystem);
+            return;
+        }
+
         mat4f const* const UTILS_RESTRICT world = manager.raw_array<WORLD>();
         for (Instance i = manager.begin(), e = manager.end(); i != e; ++i) {
             // Ensure that children are always sorted after their parent.
@@ -191,6 +200,72 @@ void FTransformManager::commitLocalTransformTransaction() noexcept {
     }
 }
 
+void FTransformManager::transformLevels(JobSystem& js) noexcept {
+    // levels smaller than this are processed on the calling thread
+    constexpr size_t PARALLEL_LEVEL_SIZE = 1024;
+
+    auto& manager = mManager;
+    const Instance begin = manager.begin();
+    const Instance end = manager.end();
+
+    // Sort children after their parent like the serial path does, which lets us compute
+    // the depth of each node in the same pass.
+    mDepths.resize(end);
+    uint32_t* const UTILS_RESTRICT depths = mDepths.data();
+    uint32_t levelCount = 0;
+    for (Instance i = begin; i != end; ++i) {
+        while (UTILS_UNLIKELY(Instance(manager[i].parent) > i)) {
+            swapNode(i, manager[i].parent);
+        }
+        Instance parent = manager[i].parent;
+        assert(parent < i);
+        const uint32_t depth = parent ? depths[parent] + 1 : 0;
+        depths[i] = depth;
+        levelCount = std::max(levelCount, depth + 1);
+    }
+
+    // bucket the nodes by depth
+    mLevelOffsets.assign(levelCount + 1, 0);
+    uint32_t* const UTILS_RESTRICT offsets = mLevelOffsets.data();
+    for (Instance i = begin; i != end; ++i) {
+        offsets[depths[i] + 1]++;
+    }
+    for (size_t l = 0; l < levelCount; l++) {
+        offsets[l + 1] += offsets[l];
+    }
+    mLevelNodes.resize(end - begin);
+    Instance* const UTILS_RESTRICT nodes = mLevelNodes.data();
+    for (Instance i = begin; i != end; ++i) {
+        nodes[offsets[depths[i]]++] = i;
+    }
+    // the loop above moved each offset to the beginning of the next level
+    std::copy_backward(offsets, offsets + levelCount, offsets + levelCount + 1);
+    offsets[0] = 0;
+
+    // all the nodes of a level depend only on the previous level
+    mat4f* const world = manager.getSoA().data<WORLD>();
+    mat4f const* const local = manager.raw_array<LOCAL>();
+    Instance const* const parents = manager.raw_array<PARENT>();
+    auto transform = [world, local, parents, nodes](uint32_t start, uint32_t count) {
+        for (uint32_t k = start, e = start + count; k < e; k++) {
+            const Instance i = nodes[k];
+            world[i] = world[parents[i]] * local[i];
+        }
+    };
+
+    for (size_t l = 0; l < levelCount; l++) {
+        const uint32_t start = offsets[l];
+        const uint32_t count = offsets[l + 1] - start;
+        if (count < PARALLEL_LEVEL_SIZE) {
+            transform(start, count);
+        } else {
+            auto* job = jobs::parallel_for(js, nullptr, start, count,
+                    std::cref(transform), jobs::CountSplitter<256, 8>());
+            js.runAndWait(job);
+        }
+    }
+}
+
 // Inserts a parentless node in the hierarchy
 void FTransformManager::insertNode(Instance i, Instance parent) noexcept {
     auto& manager = mManager;
@@ -446,6 +521,14 @@ void TransformManager::commitLocalTransformTransaction() noexcept {
     upcast(this)->commitLocalTransformTransaction();
 }
 
+void TransformManager::setParallelCommitEnabled(bool enabled) noexcept {
+    upcast(this)->setParallelCommitEnabled(enabled);
+}
+
+bool TransformManager::isParallelCommitEnabled() const noexcept {
+    return upcast(this)->isParallelCommitEnabled();
+}
+
 TransformManager::children_iterator TransformManager::getChildrenBegin(
         TransformManager::Instance parent) const noexcept {
     return upcast(this)->getChildrenBegin(parent);
@@ -28,6 +28,12 @@
 
 #include <math/mat4.h>
 
+#include <vector>
+
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace filament {
 
 class UTILS_PRIVATE FTransformManager : public TransformManager {
@@ -75,6 +81,19 @@ public:
 
     void commitLocalTransformTransaction() noexcept;
 
+    // the JobSystem used when parallel commits are enabled
+    void setJobSystem(utils::JobSystem* js) noexcept {
+        mJobSystem = js;
+    }
+
+    void setParallelCommitEnabled(bool enabled) noexcept {
+        mParallelCommitEnabled = enabled;
+    }
+
+    bool isParallelCommitEnabled() const noexcept {
+        return mParallelCommitEnabled;
+    }
+
     void gc(utils::EntityManager& em) noexcept;
 
     utils::Slice<const math::mat4f> getWorldTransforms() const noexcept {
@@ -101,6 +120,7 @@ private:
     void insertNode(Instance i, Instance p) noexcept;
     void swapNode(Instance i, Instance j) noexcept;
     static void transformChildren(Sim& manager, Instance firstChild) noexcept;
+    void transformLevels(utils::JobSystem& js) noexcept;
 
     friend class TransformManager::children_iterator;
 
@@ -155,6 +175,13 @@ private:
 
     Sim mManager;
     bool mLocalTransformTransactionOpen = false;
+    bool mParallelCommitEnabled = false;
+    utils::JobSystem* mJobSystem = nullptr;
+
+    // scratch data for parallel commits: the depth of each node, and the nodes sorted by depth
+    std::vector<uint32_t> mDepths;
+    std::vector<Instance> mLevelNodes;
+    std::vector<uint32_t> mLevelOffsets;
 };
 
 FILAMENT_UPCAST(TransformManager)
@@ -19,6 +19,8 @@
 
 #include "upcast.h"
 
+#include "private/backend/DriverApiForward.h"
+
 #include <backend/DriverEnums.h>
 #include <backend/Handle.h>
 
@@ -26,12 +28,21 @@
 
 #include <math/mathfwd.h>
 
+#include <utils/JobSystem.h>
+
+#include <memory>
+
 namespace filament {
 
 class FEngine;
 
 class FColorGrading : public ColorGrading {
 public:
+    // Intermediate results of the last LUT generated, owned by the Engine. See ColorGrading.cpp.
+    class LutCache;
+    static LutCache* createLutCache();
+    static void destroyLutCache(LutCache* cache) noexcept;
+
     FColorGrading(FEngine& engine, const Builder& builder);
     FColorGrading(const FColorGrading& rhs) = delete;
     FColorGrading& operator=(const FColorGrading& rhs) = delete;
@@ -41,10 +52,24 @@ public:
     // frees driver resources, object becomes invalid
     void terminate(FEngine& engine);
 
+    // uploads the LUT of an asynchronous build if it's ready, called once per frame
+    void commit(FEngine& engine) noexcept;
+
     backend::TextureHandle getHwHandle() const noexcept { return mLutHandle; }
 
 private:
+    struct AsyncBuild;
+
+    void upload(backend::DriverApi& driver, void const* lut) noexcept;
+
     backend::TextureHandle mLutHandle;
+    size_t mLutDimension = 0;
+    backend::PixelDataFormat mFormat = {};
+    backend::PixelDataType mType = {};
+
+    // asynchronous build in flight, if any
+    std::unique_ptr<AsyncBuild> mAsyncBuild;
+    utils::JobSystem::Job* mAsyncJob = nullptr;
 };
 
 FILAMENT_UPCAST(ColorGrading)
@@ -47,6 +47,20 @@ public:
 
     using result_type = uint8_t;
 
+    // The implementations of the array versions of intersects(). The best one supported by
+    // the CPU is selected at runtime.
+    // The kernels don't evaluate the plane equations in the same order (and AVX2 uses FMA),
+    // so objects within rounding error of a frustum plane can be classified differently.
+    enum class Kernel : uint8_t {
+        SCALAR,     // portable C++, relies on the compiler's auto-vectorization
+        SSE2,       // 4-wide, x86 baseline
+        AVX2,       // 8-wide, with FMA
+        NEON        // 4-wide, ARM
+    };
+
+    // returns the kernel used by intersects()
+    static Kernel getKernel() noexcept;
+
     /*
      * returns whether each AABB in an array intersects with the frustum
      */
@@ -91,7 +105,39 @@ public:
                 Frustum const& frustum,
                 math::float4 const* b,
                 size_t count) noexcept;
+
+        // whether the given kernel is compiled-in and supported by this CPU
+        static bool isSupported(Kernel kernel) noexcept;
+
+        // same as above, but using a specific kernel, which must be supported
+        static void intersects(Kernel kernel, result_type* results,
+                Frustum const& frustum,
+                math::float3 const* c,
+                math::float3 const* e,
+                size_t count) noexcept;
+
+        static void intersects(Kernel kernel, result_type* results,
+                Frustum const& frustum,
+                math::float4 const* b,
+                size_t count) noexcept;
     };
+
+private:
+    using BoxesKernel = void(*)(result_type* results, math::float4 const* planes,
+            math::float3 const* center, math::float3 const* extent,
+            size_t count, size_t bit) noexcept;
+
+    using SpheresKernel = void(*)(result_type* results, math::float4 const* planes,
+            math::float4 const* b, size_t count) noexcept;
+
+    struct Kernels {
+        BoxesKernel boxes;
+        SpheresKernel spheres;
+        Kernel kernel;
+    };
+
+    static Kernels getKernels(Kernel kernel) noexcept;
+    static Kernels const& getBestKernels() noexcept;
 };
 
 } // namespace filament
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_CULLINGBVH_H
+#define TNT_FILAMENT_DETAILS_CULLINGBVH_H
+
+#include "details/Culler.h"
+
+#include <filament/Frustum.h>
+
+#include <utils/compiler.h>
+#include <utils/JobSystem.h>
+
+#include <math/vec3.h>
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * A bounding volume hierarchy over an array of world-space AABBs, used to cull whole groups of
+ * renderables at once.
+ *
+ * The AABBs are given as the center/half-extent arrays used by Culler, and the culling results
+ * use the same conventions as Culler::intersects(): a bit is set for each visible box, in the
+ * caller's array order. The results are the same as Culler's, except for boxes within rounding
+ * error of a frustum plane: a node entirely inside or outside the frustum decides for all the
+ * boxes it contains, which are then not tested individually.
+ *
+ * The hierarchy is built once with build(), and can then be refit cheaply with refit() when the
+ * boxes move, as long as the number and order of the boxes don't change. Only the subtrees
+ * containing boxes that actually moved are updated. Refitting doesn't change the topology of
+ * the tree, so its quality degrades if the boxes move a lot, in which case it should be rebuilt.
+ */
+class CullingBvh {
+public:
+    // maximum number of boxes in a leaf, leaves are tested with Culler
+    static constexpr size_t LEAF_SIZE = Culler::MODULO;
+
+    CullingBvh() noexcept = default;
+    ~CullingBvh() noexcept = default;
+
+    CullingBvh(CullingBvh const& rhs) = delete;
+    CullingBvh& operator=(CullingBvh const& rhs) = delete;
+
+    // builds the hierarchy from scratch
+    void build(math::float3 const* center, math::float3 const* extent, size_t count);
+
+    // updates the bounds of the hierarchy, count must be the same as in build()
+    void refit(math::float3 const* center, math::float3 const* extent, size_t count) noexcept;
+
+    // ORs (1 << bit) into results[i] for each box i intersecting the frustum
+    void cull(Culler::result_type* results, Frustum const& frustum, size_t bit) const noexcept;
+
+    // same as above, but the subtrees are culled in parallel, the calling thread must be adopted
+    void cull(utils::JobSystem& js,
+            Culler::result_type* results, Frustum const& frustum, size_t bit) const noexcept;
+
+    void clear() noexcept;
+
+    size_t getCount() const noexcept { return mCount; }
+    size_t getNodeCount() const noexcept { return mNodes.size(); }
+
+    // For testing...
+    struct UTILS_PUBLIC Test {
+        static void build(CullingBvh& bvh,
+                math::float3 const* center, math::float3 const* extent, size_t count);
+        static void refit(CullingBvh& bvh,
+                math::float3 const* center, math::float3 const* extent, size_t count) noexcept;
+        static void cull(CullingBvh const& bvh,
+                Culler::result_type* results, Frustum const& frustum, size_t bit) noexcept;
+        static void cull(CullingBvh const& bvh, utils::JobSystem& js,
+                Culler::result_type* results, Frustum const& frustum, size_t bit) noexcept;
+    };
+
+private:
+    // Nodes are stored in depth-first order: the first child of an internal node immediately
+    // follows it, and 'next' is the index of the first node after its subtree, i.e. the node to
+    // continue with when the subtree is skipped. Leaves are the nodes for which next == index+1.
+    // Each node covers the boxes [first, first + count) of mCenter/mExtent.
+    struct Node {
+        math::float3 center;
+        math::float3 extent;
+        uint32_t first;
+        uint32_t count;
+        uint32_t next;
+        uint32_t parent;
+    };
+
+    enum class Classification : uint8_t { OUTSIDE, INSIDE, INTERSECTING };
+
+    // the parallel cull() splits the hierarchy in subtrees of at least this many boxes
+    static constexpr size_t PARALLEL_CULL_MIN_BOXES = 1024;
+
+    // maximum number of subtrees culled in parallel
+    static constexpr size_t PARALLEL_CULL_MAX_SUBTREES = 64;
+
+    static Classification classify(math::float4 const* planes,
+            math::float3 const& center, math::float3 const& extent) noexcept;
+
+    // culls the nodes [first, last), which must be a sequence of whole subtrees
+    void cullSubtrees(Culler::result_type* results, Frustum const& frustum, size_t bit,
+            uint32_t first, uint32_t last) const noexcept;
+
+    uint32_t buildRecursive(math::float3 const* center,
+            uint32_t first, uint32_t count, uint32_t parent);
+    void computeLeafBounds(Node& node) const noexcept;
+    void computeInternalBounds(Node& node, Node const& left, Node const& right) const noexcept;
+
+    // boxes in hierarchy order, padded because Culler reads MODULO boxes at a time
+    std::vector<math::float3> mCenter;
+    std::vector<math::float3> mExtent;
+    // for each box in hierarchy order, its index in the caller's arrays
+    std::vector<uint32_t> mIndices;
+    std::vector<Node> mNodes;
+    std::vector<uint8_t> mDirty;
+    size_t mCount = 0;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_CULLINGBVH_H
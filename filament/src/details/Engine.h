@@ -154,11 +154,19 @@ public:
     // Material IDs...
     uint32_t getMaterialId() const noexcept { return mMaterialId++; }
 
+    // The version of the MaterialInstance states that are baked into the RenderPass commands
+    // (e.g. culling mode). It changes each time any of these states change, on any instance.
+    uint32_t getMaterialInstanceStateVersion() const noexcept {
+        return mMaterialInstanceStateVersion;
+    }
+    void invalidateMaterialInstanceState() noexcept { mMaterialInstanceStateVersion++; }
+
     const FMaterial* getDefaultMaterial() const noexcept { return mDefaultMaterial; }
     const FMaterial* getSkyboxMaterial() const noexcept;
     const FIndirectLight* getDefaultIndirectLight() const noexcept { return mDefaultIbl; }
     const FTexture* getDummyCubemap() const noexcept { return mDefaultIblTexture; }
     const FColorGrading* getDefaultColorGrading() const noexcept { return mDefaultColorGrading; }
+    FColorGrading::LutCache& getColorGradingLutCache() noexcept { return *mColorGradingLutCache; }
 
     backend::Handle<backend::HwRenderPrimitive> getFullScreenRenderPrimitive() const noexcept {
         return mFullScreenTriangleRph;
@@ -213,6 +221,11 @@ public:
         return *mResourceAllocator;
     }
 
+    ResourceAllocator const& getResourceAllocator() const noexcept {
+        assert(mResourceAllocator);
+        return *mResourceAllocator;
+    }
+
     void* streamAlloc(size_t size, size_t alignment) noexcept;
 
     Epoch getEngineEpoch() const { return mEngineEpoch; }
@@ -356,6 +369,7 @@ private:
     ResourceList<FRenderTarget> mRenderTargets{ "RenderTarget" };
 
     mutable uint32_t mMaterialId = 0;
+    uint32_t mMaterialInstanceStateVersion = 0;
 
     // FMaterialInstance are handled directly by FMaterial
     std::unordered_map<const FMaterial*, ResourceList<FMaterialInstance>> mMaterialInstances;
@@ -382,6 +396,7 @@ private:
     mutable FIndirectLight* mDefaultIbl = nullptr;
 
     mutable FColorGrading* mDefaultColorGrading = nullptr;
+    FColorGrading::LutCache* mColorGradingLutCache = nullptr;
 
     mutable utils::CountDownLatch mDriverBarrier;
 
@@ -409,11 +424,15 @@ public:
         } ssao;
         struct {
             bool camera_at_origin = true;
+            bool binned_froxelization = false;
         } view;
         struct {
             // When set to true, the backend will attempt to capture the next frame and write the
             // capture to file. At the moment, only supported by the Metal backend.
             bool doFrameCapture = false;
+            // Render passes with at least this many commands are sorted in parallel on the
+            // JobSystem. Zero or negative values disable the parallel sort.
+            int parallelSortMinCommands = 16384;
         } renderer;
         matdbg::DebugServer* server = nullptr;
     } debug;
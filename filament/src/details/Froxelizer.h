@@ -76,6 +76,17 @@ public:
 // 256 lights max
 //
 
+// The GPU only sees CONFIG_MAX_LIGHT_COUNT dynamic lights, because of:
+// - the light UBO, which stores one mat4 per light: 256 x 64 bytes is 16 KiB, the minimum
+//   GL_MAX_UNIFORM_BLOCK_SIZE guaranteed by OpenGL ES 3.0. Going beyond requires storage buffers.
+// - the record buffer, which stores light indices as R_U8 (see RecordBufferType), and the 8-bit
+//   light count of FroxelEntry.
+// FScene::prepareDynamicLights() drops the excess lights, roughly the ones farthest from the
+// camera plane: the order of the last sort is reused while the camera and the lights move little.
+// The default froxelization also has one bit per light in its LightRecord bitsets. The binned
+// froxelization (see setBinningEnabled()) doesn't, and produces 16-bit light lists of any length
+// on the CPU; only their first CONFIG_MAX_LIGHT_COUNT lights are uploaded.
+
 // Max number of froxels limited by:
 // - max texture size [min 2048]
 // - chosen texture width [64]
@@ -101,6 +112,16 @@ public:
 
     void setOptions(float zLightNear, float zLightFar) noexcept;
 
+    /*
+     * Enables the binned froxelization. Instead of one bit per light and per froxel, lights are
+     * binned per Z slice, then each row of froxels is processed by its own job, and each froxel
+     * gets a variable-length list of 16-bit light indices. It handles up to 65536 lights, but
+     * the light UBO and the 8-bit records still limit the GPU to the first
+     * CONFIG_MAX_LIGHT_COUNT lights, which is all FScene::prepare() keeps.
+     */
+    void setBinningEnabled(bool enabled) noexcept { mBinningEnabled = enabled; }
+    bool isBinningEnabled() const noexcept { return mBinningEnabled; }
+
     /*
      * Allocate per-frame data structures for froxelization.
      *
@@ -158,6 +179,12 @@ public:
     const utils::Slice<FroxelEntry>& getFroxelBufferUser() const { return mFroxelBufferUser; }
     const utils::Slice<RecordBufferType>& getRecordBufferUser() const { return mRecordBufferUser; }
 
+    // Variable-length light lists computed by the binned froxelization, the lights of froxel i
+    // are getFroxelLights()[getFroxelLightOffsets()[i] ... getFroxelLightOffsets()[i + 1]].
+    // These are only valid after froxelizeLights() used the binned froxelization.
+    std::vector<uint32_t> const& getFroxelLightOffsets() const noexcept { return mFroxelLightOffsets; }
+    std::vector<uint16_t> const& getFroxelLights() const noexcept { return mFroxelLights; }
+
     // this is chosen so froxelizePointAndSpotLight() vectorizes 4 froxel tests / spotlight
     // with 256 lights this implies 8 jobs (256 / 32) for froxelization.
     using LightGroupType = uint32_t;
@@ -190,6 +217,16 @@ private:
         uint16_t reserved;
     };
 
+    // froxel-space bounding box of a light, x1 is one past the last value, y1 and z1 are the
+    // last values.
+    struct LightBounds {
+        uint16_t x0, x1;
+        uint16_t y0, y1;
+        uint8_t z0, z1;
+        uint8_t zcenter;
+        bool visible;
+    };
+
     using FroxelThreadData = std::array<LightGroupType, FROXEL_BUFFER_ENTRY_COUNT_MAX>;
 
     void setViewport(Viewport const& viewport) noexcept;
@@ -201,6 +238,16 @@ private:
 
     void froxelizeAssignRecordsCompress() noexcept;
 
+    void froxelizeBinned(FEngine& engine,
+            const CameraInfo& camera, const FScene::LightSoa& lightData) noexcept;
+
+    void froxelizeRowBinned(size_t row, math::mat4f const& projection) noexcept;
+
+    void froxelizeAssignRecordsBinned() noexcept;
+
+    LightBounds computeLightBounds(math::mat4f const& projection,
+            const LightParams& light) const noexcept;
+
     void froxelizePointAndSpotLight(FroxelThreadData& froxelThread, size_t bit,
             math::mat4f const& projection, const LightParams& light) const noexcept;
 
@@ -235,6 +282,16 @@ private:
     utils::Slice<RecordBufferType> mRecordBufferUser;   //  64 KiB
     utils::Slice<LightRecord> mLightRecords;            // 256 KiB w/ 256 lights
 
+    // binned froxelization, these persist across frames to avoid reallocating them
+    std::vector<LightParams> mBinnedLights;             // per light
+    std::vector<LightBounds> mBinnedBounds;             // per light
+    std::vector<uint32_t> mSliceLightOffsets;           // per Z slice + 1
+    std::vector<uint16_t> mSliceLights;                 // lights of each Z slice
+    std::vector<std::vector<uint32_t>> mRowEntries;     // per row of froxels, (x << 16) | light
+    std::vector<std::vector<uint16_t>> mRowLights;      // per row of froxels
+    std::vector<uint32_t> mFroxelLightOffsets;          // per froxel + 1
+    std::vector<uint16_t> mFroxelLights;                // lights of each froxel
+
     uint16_t mFroxelCountX = 0;
     uint16_t mFroxelCountY = 0;
     uint16_t mFroxelCountZ = 0;
@@ -258,6 +315,8 @@ private:
     float mZLightFar = FEngine::CONFIG_Z_LIGHT_FAR;
     float mZLightNear = FEngine::CONFIG_Z_LIGHT_NEAR;  // light near (first slice)
 
+    bool mBinningEnabled = false;
+
     // track if we need to update our internal state before froxelizing
     uint8_t mDirtyFlags = 0;
     enum {
@@ -70,6 +70,8 @@ public:
 
     bool isSampler(const char* name) const noexcept;
 
+    ParameterHandle getParameterHandle(const char* name) const noexcept;
+
     UniformInterfaceBlock::UniformInfo const* reflect(utils::StaticString const& name) const noexcept;
 
     FMaterialInstance const* getDefaultInstance() const noexcept { return &mDefaultInstance; }
@@ -114,6 +116,7 @@ public:
     bool hasDoubleSidedCapability() const noexcept { return mDoubleSidedCapability; }
     float getMaskThreshold() const noexcept { return mMaskThreshold; }
     bool hasShadowMultiplier() const noexcept { return mHasShadowMultiplier; }
+    bool isInstanced() const noexcept { return mIsInstanced; }
     AttributeBitset getRequiredAttributes() const noexcept { return mRequiredAttributes; }
     RefractionMode getRefractionMode() const noexcept { return mRefractionMode; }
     RefractionType getRefractionType() const noexcept { return mRefractionType; }
@@ -187,6 +190,7 @@ private:
     bool mDoubleSidedCapability = false;
     bool mHasShadowMultiplier = false;
     bool mHasCustomDepthShader = false;
+    bool mIsInstanced = false;
     bool mIsDefaultMaterial = false;
     bool mSpecularAntiAliasing = false;
 
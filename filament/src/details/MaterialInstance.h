@@ -28,9 +28,14 @@
 #include <math/scalar.h>
 
 #include <utils/compiler.h>
+#include <utils/Panic.h>
 
 #include <filament/MaterialInstance.h>
 
+#include <type_traits>
+
+#include <assert.h>
+
 namespace filament {
 
 class FMaterial;
@@ -72,10 +77,34 @@ public:
     void setParameter(const char* name,
             backend::Handle<backend::HwTexture> texture, backend::SamplerParams params) noexcept;
 
+    template <typename T, typename = is_supported_parameter_t<T>>
+    void setParameter(ParameterHandle handle, T value) noexcept {
+        if (isValidUniform<T>(handle, 1)) {
+            mUniforms.setUniform<T>(handle.mOffset, value);  // handles specialization for mat3f
+        }
+    }
+
+    template <typename T, typename = is_supported_parameter_t<T>>
+    void setParameter(ParameterHandle handle, const T* value, size_t count) noexcept {
+        if (isValidUniform<T>(handle, count)) {
+            mUniforms.setUniformArray<T>(handle.mOffset, value, count);
+        }
+    }
+
+    void setParameter(ParameterHandle handle,
+            Texture const* texture, TextureSampler const& sampler) noexcept;
+
+    template <typename T, typename = is_supported_parameter_t<T>>
+    static void setParameters(MaterialInstance* const* instances, ParameterHandle handle,
+            const T* values, size_t count) noexcept;
+
     FMaterial const* getMaterial() const noexcept { return mMaterial; }
 
     uint64_t getSortingKey() const noexcept { return mMaterialSortingKey; }
 
+    // incremented each time modified uniforms or samplers are committed
+    uint32_t getParametersVersion() const noexcept { return mParametersVersion; }
+
     UniformBuffer const& getUniformBuffer() const noexcept { return mUniforms; }
     backend::SamplerGroup const& getSamplerGroup() const noexcept { return mSamplers; }
 
@@ -144,6 +173,38 @@ private:
 
     void commitSlow(FEngine::DriverApi& driver) const;
 
+    template <typename T>
+    static constexpr backend::UniformType getUniformType() noexcept {
+        using namespace math;
+        using Type = backend::UniformType;
+        return std::is_same<T, bool>::value     ? Type::BOOL  :
+               std::is_same<T, bool2>::value    ? Type::BOOL2 :
+               std::is_same<T, bool3>::value    ? Type::BOOL3 :
+               std::is_same<T, bool4>::value    ? Type::BOOL4 :
+               std::is_same<T, float>::value    ? Type::FLOAT  :
+               std::is_same<T, float2>::value   ? Type::FLOAT2 :
+               std::is_same<T, float3>::value   ? Type::FLOAT3 :
+               std::is_same<T, float4>::value   ? Type::FLOAT4 :
+               std::is_same<T, int32_t>::value  ? Type::INT  :
+               std::is_same<T, int2>::value     ? Type::INT2 :
+               std::is_same<T, int3>::value     ? Type::INT3 :
+               std::is_same<T, int4>::value     ? Type::INT4 :
+               std::is_same<T, uint32_t>::value ? Type::UINT  :
+               std::is_same<T, uint2>::value    ? Type::UINT2 :
+               std::is_same<T, uint3>::value    ? Type::UINT3 :
+               std::is_same<T, uint4>::value    ? Type::UINT4 :
+               std::is_same<T, mat3f>::value    ? Type::MAT3 : Type::MAT4;
+    }
+
+    template <typename T>
+    bool isValidUniform(ParameterHandle const& handle, size_t count) const noexcept {
+        // the type of the value is only checked in debug builds
+        assert(!handle.isValid() || handle.mIsSampler || handle.mType == getUniformType<T>());
+        return ASSERT_PRECONDITION_NON_FATAL(handle.mMaterial == mMaterial &&
+                !handle.mIsSampler && count <= handle.mCount,
+                "invalid uniform parameter handle");
+    }
+
     // keep these grouped, they're accessed together in the render-loop
     FMaterial const* mMaterial = nullptr;
     backend::Handle<backend::HwUniformBuffer> mUbHandle;
@@ -158,6 +219,7 @@ private:
     backend::RasterState::DepthFunc mDepthFunc;
 
     uint64_t mMaterialSortingKey = 0;
+    mutable uint32_t mParametersVersion = 0;
 
     // Scissor rectangle is specified as: Left Bottom Width Height.
     backend::Viewport mScissorRect = { 0, 0,
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_DETAILS_OCCLUSIONCULLER_H
+#define TNT_FILAMENT_DETAILS_OCCLUSIONCULLER_H
+
+#include "details/Culler.h"
+
+#include <filament/Box.h>
+
+#include <utils/compiler.h>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+
+#include <array>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace filament {
+
+/*
+ * A CPU occlusion culler.
+ *
+ * Occluders are boxes that are entirely contained in opaque geometry. They're rasterized
+ * conservatively into a small depth buffer: only the pixels a face covers entirely are written,
+ * with the farthest depth of the face within the pixel. A hierarchical-Z pyramid is then built,
+ * each texel holding the farthest depth of the texels below it. Bounding boxes are then tested
+ * against the level of the pyramid where they cover at most 2x2 texels: a box is occluded if its
+ * nearest point is farther than the farthest occluder depth in these texels.
+ *
+ * Depths are NDC z values (i.e. after the perspective divide) of the culling projection, which
+ * works for both perspective and orthographic projections. Occluders crossing the near plane are
+ * ignored and boxes crossing it are always visible, so no clipping is needed.
+ *
+ * Usage:
+ *   begin(clipFromWorld, width, height);
+ *   rasterize(...);  // for each occluder
+ *   buildHierarchy();
+ *   cull(...);       // can be called from several threads
+ */
+class OcclusionCuller {
+public:
+    // a good trade-off between speed and accuracy for the width of the depth buffer
+    static constexpr uint32_t PREFERRED_WIDTH = 256;
+
+    OcclusionCuller() noexcept = default;
+    ~OcclusionCuller() noexcept = default;
+
+    OcclusionCuller(OcclusionCuller const& rhs) = delete;
+    OcclusionCuller& operator=(OcclusionCuller const& rhs) = delete;
+
+    // clears the depth buffer and sets the transform used by rasterize() and cull()
+    void begin(math::mat4f const& clipFromWorld, uint32_t width, uint32_t height);
+
+    // rasterizes an occluder, returns false if it was ignored
+    bool rasterize(math::mat4f const& worldFromModel, Box const& occluder) noexcept;
+
+    // must be called after all occluders are rasterized and before cull()
+    void buildHierarchy() noexcept;
+
+    // clears (1 << bit) in results[i] for each box i that has it set and is occluded.
+    // returns the number of boxes occluded.
+    size_t cull(Culler::result_type* results,
+            math::float3 const* center, math::float3 const* extent,
+            size_t count, size_t bit) const noexcept;
+
+    // whether the given world-space box is visible
+    bool isVisible(math::float3 const& center, math::float3 const& extent) const noexcept;
+
+    uint32_t getWidth() const noexcept { return mWidth; }
+    uint32_t getHeight() const noexcept { return mHeight; }
+
+    // For testing...
+    struct UTILS_PUBLIC Test {
+        static void begin(OcclusionCuller& culler,
+                math::mat4f const& clipFromWorld, uint32_t width, uint32_t height);
+        static bool rasterize(OcclusionCuller& culler,
+                math::mat4f const& worldFromModel, Box const& occluder) noexcept;
+        static void buildHierarchy(OcclusionCuller& culler) noexcept;
+        static size_t cull(OcclusionCuller const& culler, Culler::result_type* results,
+                math::float3 const* center, math::float3 const* extent,
+                size_t count, size_t bit) noexcept;
+    };
+
+private:
+    struct Level {
+        uint32_t offset;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // v are the screen-space vertices of a convex quad, in either winding order
+    void rasterizeQuad(std::array<math::float3, 4> v) noexcept;
+
+    math::mat4f mClipFromWorld;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    // all the levels of the pyramid, level 0 is the depth buffer
+    std::vector<float> mDepth;
+    std::vector<Level> mLevels;
+};
+
+} // namespace filament
+
+#endif // TNT_FILAMENT_DETAILS_OCCLUSIONCULLER_H
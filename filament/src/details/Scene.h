@@ -23,6 +23,7 @@
 #include "components/TransformManager.h"
 
 #include "details/Culler.h"
+#include "details/CullingBvh.h"
 
 #include "Allocators.h"
 
@@ -35,9 +36,11 @@
 #include <utils/StructureOfArrays.h>
 #include <utils/Range.h>
 
-#include <cstddef>
 #include <tsl/robin_set.h>
 
+#include <cstddef>
+#include <vector>
+
 namespace filament {
 
 struct CameraInfo;
@@ -45,6 +48,7 @@ class FEngine;
 class FIndirectLight;
 class FRenderer;
 class FSkybox;
+class UniformBuffer;
 
 
 class FScene : public Scene {
@@ -70,6 +74,9 @@ public:
     size_t getLightCount() const noexcept;
     bool hasEntity(utils::Entity entity) const noexcept;
 
+    void setHierarchicalCullingEnabled(bool enabled) noexcept;
+    bool isHierarchicalCullingEnabled() const noexcept { return mHierarchicalCullingEnabled; }
+
 public:
     /*
      * Filaments-scope Public API
@@ -114,6 +121,15 @@ public:
         // These are temporaries and should be stored out of line
         PRIMITIVES,             //  8 | level-of-detail'ed primitives
         SUMMED_PRIMITIVE_COUNT, //  4 | summed visible primitive counts
+        INSTANCES,              //  8 | visible instances of instanced renderables
+    };
+
+    // The visible instances of an instanced renderable are stored in the instances UBO starting
+    // at the given batch, each batch holds up to CONFIG_MAX_INSTANCES instances. count is 0 for
+    // renderables that are not instanced.
+    struct InstanceBatches {
+        uint32_t batch;
+        uint32_t count;
     };
 
     using RenderableSoa = utils::StructureOfArrays<
@@ -128,7 +144,8 @@ public:
             uint8_t,                                    // LAYERS
             math::float3,                               // WORLD_AABB_EXTENT
             utils::Slice<FRenderPrimitive>,             // PRIMITIVES
-            uint32_t                                    // SUMMED_PRIMITIVE_COUNT
+            uint32_t,                                   // SUMMED_PRIMITIVE_COUNT
+            InstanceBatches                             // INSTANCES
     >;
 
     RenderableSoa const& getRenderableData() const noexcept { return mRenderableData; }
@@ -196,17 +213,54 @@ public:
     LightSoa const& getLightData() const noexcept { return mLightData; }
     LightSoa& getLightData() noexcept { return mLightData; }
 
-    void updateUBOs(utils::Range<uint32_t> visibleRenderables, backend::Handle<backend::HwUniformBuffer> renderableUbh) noexcept;
+    // Updates the per-renderable uniforms. renderableUb is a CPU copy of the content of
+    // renderableUbh, only the renderables that changed since the last call are uploaded.
+    void updateUBOs(utils::Range<uint32_t> visibleRenderables,
+            backend::Handle<backend::HwUniformBuffer> renderableUbh,
+            UniformBuffer& renderableUb) noexcept;
+
+    // Culls the instances of the visible instanced renderables against the frustum (all are
+    // visible if it's null) and returns the number of batches needed to store the visible ones.
+    // The instances of shadow casters are never culled. Instanced renderables without visible
+    // instances are made invisible.
+    size_t cullInstances(utils::Range<uint32_t> visibleRenderables,
+            Frustum const* frustum) noexcept;
+
+    // Uploads the visible instances found by cullInstances() to instancesUbh, which must be large
+    // enough to hold all the batches.
+    void updateInstanceUBOs(utils::Range<uint32_t> visibleRenderables,
+            backend::Handle<backend::HwUniformBuffer> instancesUbh) noexcept;
 
     bool hasContactShadows() const noexcept;
 
+    // The culling hierarchy over the renderables' world AABBs, valid after prepare(). Returns
+    // nullptr if hierarchical culling is disabled.
+    CullingBvh const* getCullingBvh() const noexcept {
+        return mHierarchicalCullingEnabled ? &mCullingBvh : nullptr;
+    }
+
 private:
+    void updateCullingBvh();
+
+    static inline math::mat3f computeNormalMatrix(math::mat4f const& model,
+            bool reversedWindingOrder) noexcept;
+
     static inline void computeLightRanges(math::float2* zrange,
             CameraInfo const& camera, const math::float4* spheres, size_t count) noexcept;
 
     static inline void computeLightCameraPlaneDistances(float* distances,
             const CameraInfo& camera, const math::float4* spheres, size_t count) noexcept;
 
+    // reorders the lights like the last sort if nothing moved much, returns false otherwise
+    bool reuseLightOrder(CameraInfo const& camera) noexcept;
+
+    // sorts the lights by distance to the camera plane and remembers the order
+    void sortLights(float const* distances, CameraInfo const& camera) noexcept;
+
+    // the camera can move by 5cm or turn by ~2.5 degrees before the lights are sorted again
+    static constexpr float LIGHT_ORDER_MAX_DISTANCE_SQUARED = 0.05f * 0.05f;
+    static constexpr float LIGHT_ORDER_MIN_COS_ANGLE = 0.999f;
+
     FEngine& mEngine;
     FSkybox* mSkybox = nullptr;
     FIndirectLight const* mIndirectLight = nullptr;
@@ -229,6 +283,36 @@ private:
     LightSoa mLightData;
     backend::Handle<backend::HwUniformBuffer> mRenderableViewUbh; // This is actually owned by the view.
     bool mHasContactShadows = false;
+
+    /*
+     * World transforms of the visible instances, in batch order, and culling scratch buffers.
+     */
+    std::vector<math::mat4f> mInstanceTransforms;
+    std::vector<uint32_t> mInstanceIndices;
+    std::vector<math::float3> mInstanceCenters;
+    std::vector<math::float3> mInstanceExtents;
+    std::vector<Culler::result_type> mInstanceVisibility;
+
+    /*
+     * The culling hierarchy is rebuilt when the list of renderables changes, and refit otherwise.
+     */
+    bool mHierarchicalCullingEnabled = false;
+    CullingBvh mCullingBvh;
+    std::vector<FRenderableManager::Instance> mCullingBvhInstances;
+
+    /*
+     * The order of the positional lights found by the last sort, reused while the camera and
+     * the lights don't move much. order[k] is the index, in scene order, of the k-th light.
+     */
+    struct LightOrder {
+        math::float3 position;
+        math::float3 forward;
+        std::vector<FLightManager::Instance> instances;
+        std::vector<math::float4> positions;
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> scratch;
+    };
+    LightOrder mLightOrder;
 };
 
 FILAMENT_UPCAST(Scene)
@@ -32,7 +32,9 @@
 #include "fg/FrameGraph.h"
 #include "fg/FrameGraphPassResources.h"
 
+#include <math/mat4.h>
 #include <math/vec3.h>
+#include <math/vec4.h>
 
 #include <array>
 #include <memory>
@@ -42,6 +44,7 @@ namespace filament {
 
 class FView;
 
+class FRenderPrimitive;
 class ShadowMap;
 class RenderPass;
 
@@ -55,9 +58,18 @@ public:
     };
 
 
+    static constexpr size_t MAX_SHADOW_LAYERS =
+            CONFIG_MAX_SHADOW_CASCADES + CONFIG_MAX_SHADOW_CASTING_SPOTS;
+
     explicit ShadowMapManager(FEngine& engine);
     ~ShadowMapManager();
 
+    // Frees the shadow texture kept across frames, if any.
+    void terminate(FEngine& engine) noexcept;
+
+    // Forces all the shadow maps to be rendered again next time.
+    void invalidateCachedShadowMaps() noexcept;
+
     // Reset shadow map layout.
     void reset() noexcept;
 
@@ -69,7 +81,8 @@ public:
     ShadowTechnique update(FEngine& engine, FView& view, UniformBuffer& perViewUb, UniformBuffer& shadowUb,
             FScene::RenderableSoa& renderableData, FScene::LightSoa& lightData) noexcept;
 
-    // Renders all of the shadow maps.
+    // Renders all of the shadow maps. When shadow caching is enabled on the view, the shadow
+    // texture is kept across frames and only the shadow maps that changed are rendered.
     void render(FrameGraph& fg, FEngine& engine, FView& view, backend::DriverApi& driver,
             RenderPass& pass) noexcept;
 
@@ -95,6 +108,40 @@ private:
         uint8_t levels = 0;
     } mTextureRequirements;
 
+    // The state of a shadow caster that affects the content of a shadow map
+    struct ShadowCaster {
+        math::mat4f worldTransform;
+        math::float4 morphWeights;
+        FRenderPrimitive const* primitives = nullptr;
+        uint32_t primitiveCount = 0;
+        uint32_t instance = 0;
+        uint32_t version = 0;
+        uint32_t materialVersion = 0;   // sum of the parameters versions of its materials
+        bool reversedWinding = false;
+
+        bool operator==(ShadowCaster const& rhs) const noexcept {
+            return instance == rhs.instance &&
+                   version == rhs.version &&
+                   materialVersion == rhs.materialVersion &&
+                   primitives == rhs.primitives &&
+                   primitiveCount == rhs.primitiveCount &&
+                   reversedWinding == rhs.reversedWinding &&
+                   worldTransform == rhs.worldTransform &&
+                   morphWeights == rhs.morphWeights;
+        }
+    };
+
+    // What a layer of the cached shadow texture was rendered with
+    struct CachedShadowMap {
+        math::mat4f projection;
+        math::mat4f model;
+        backend::PolygonOffset polygonOffset{};
+        uint32_t size = 0;
+        uint8_t vsmSamples = 0;
+        bool valid = false;
+        std::vector<ShadowCaster> casters;
+    };
+
     ShadowTechnique updateCascadeShadowMaps(FEngine& engine, FView& view, UniformBuffer& perViewUb,
             FScene::RenderableSoa& renderableData, FScene::LightSoa& lightData) noexcept;
     ShadowTechnique updateSpotShadowMaps(FEngine& engine, FView& view, UniformBuffer& shadowUb,
@@ -129,6 +176,12 @@ private:
         bool mHasVisibleShadows = false;
     };
 
+    // Returns whether the given shadow map must be rendered again, and updates its cached state.
+    bool updateCachedShadowMap(FEngine& engine, FView& view, ShadowMapEntry const& entry,
+            uint8_t visibilityMask, bool cascade) noexcept;
+
+    void destroyCachedTexture(FEngine& engine) noexcept;
+
     class CascadeSplits {
     public:
         constexpr static size_t SPLIT_COUNT = CONFIG_MAX_SHADOW_CASCADES + 1;
@@ -180,6 +233,14 @@ private:
 
     std::array<std::unique_ptr<ShadowMap>, CONFIG_MAX_SHADOW_CASCADES> mCascadeShadowMapCache;
     std::array<std::unique_ptr<ShadowMap>, CONFIG_MAX_SHADOW_CASTING_SPOTS> mSpotShadowMapCache;
+
+    // Shadow caching: the shadow texture is detached from the FrameGraph and imported again on
+    // the next frame, each of its layers is rendered again only when its content changed.
+    FrameGraphTexture mCachedTexture;
+    FrameGraphTexture::Descriptor mCachedTextureDesc;
+    std::array<CachedShadowMap, MAX_SHADOW_LAYERS> mCachedShadowMaps;
+    std::vector<ShadowCaster> mShadowCasters;   // scratch
+    uint32_t mMaterialInstanceStateVersion = 0;
 };
 
 } // namespace filament
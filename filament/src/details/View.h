@@ -23,12 +23,14 @@
 
 #include "FrameInfo.h"
 #include "FrameHistory.h"
+#include "RenderPass.h"
 #include "UniformBuffer.h"
 
 #include "details/Allocators.h"
 #include "details/Camera.h"
 #include "details/ColorGrading.h"
 #include "details/Froxelizer.h"
+#include "details/OcclusionCuller.h"
 #include "details/RenderTarget.h"
 #include "details/ShadowMap.h"
 #include "details/ShadowMapManager.h"
@@ -194,6 +196,31 @@ public:
 
     bool isScreenSpaceRefractionEnabled() const noexcept { return mScreenSpaceRefractionEnabled; }
 
+    void setCommandCachingEnabled(bool enabled) noexcept;
+
+    bool isCommandCachingEnabled() const noexcept { return mCommandCachingEnabled; }
+
+    // these return nullptr when command caching is disabled
+    RenderPass::CommandCache* getStructurePassCommandCache() noexcept {
+        return mCommandCachingEnabled ? &mStructurePassCommandCache : nullptr;
+    }
+
+    RenderPass::CommandCache* getColorPassCommandCache() noexcept {
+        return mCommandCachingEnabled ? &mColorPassCommandCache : nullptr;
+    }
+
+    void setOcclusionCullingEnabled(bool enabled) noexcept;
+
+    bool isOcclusionCullingEnabled() const noexcept { return mOcclusionCullingEnabled; }
+
+    void setShadowCachingEnabled(bool enabled) noexcept;
+
+    bool isShadowCachingEnabled() const noexcept { return mShadowCachingEnabled; }
+
+    OcclusionCullingStats getOcclusionCullingStats() const noexcept {
+        return mOcclusionCullingStats;
+    }
+
     FCamera const* getDirectionalLightCamera() const noexcept {
         return &mShadowMapManager.getCascadeShadowMap(0)->getDebugCamera();
     }
@@ -407,8 +434,9 @@ public:
         return mRenderTarget == nullptr ? kEmptyHandle : mRenderTarget->getHwHandle();
     }
 
+    // bvh, if not null, must be the culling hierarchy of renderableData
     static void cullRenderables(utils::JobSystem& js, FScene::RenderableSoa& renderableData,
-            Frustum const& frustum, size_t bit) noexcept;
+            CullingBvh const* bvh, Frustum const& frustum, size_t bit) noexcept;
 
     UniformBuffer& getViewUniforms() const { return mPerViewUb; }
     backend::SamplerGroup& getViewSamplers() const { return mPerViewSb; }
@@ -425,8 +453,12 @@ public:
     void commitFrameHistory(FEngine& engine) noexcept;
 
 private:
-    void prepareVisibleRenderables(utils::JobSystem& js,
-            Frustum const& frustum, FScene::RenderableSoa& renderableData) const noexcept;
+    void prepareVisibleRenderables(utils::JobSystem& js, Frustum const& frustum,
+            FScene::RenderableSoa& renderableData, CullingBvh const* bvh) const noexcept;
+
+    void cullOccludedRenderables(utils::JobSystem& js, FRenderableManager const& rcm,
+            math::mat4f const& worldOriginScene, filament::Viewport const& viewport,
+            FScene::RenderableSoa& renderableData) noexcept;
 
     static void prepareVisibleLights(
             FLightManager const& lcm, utils::JobSystem& js, Frustum const& frustum,
@@ -461,6 +493,7 @@ private:
     backend::Handle<backend::HwUniformBuffer> mLightUbh;
     backend::Handle<backend::HwUniformBuffer> mShadowUbh;
     backend::Handle<backend::HwUniformBuffer> mRenderableUbh;
+    backend::Handle<backend::HwUniformBuffer> mInstancesUbh;
 
     FScene* mScene = nullptr;
     FCamera* mCullingCamera = nullptr;
@@ -506,6 +539,7 @@ private:
 
     mutable UniformBuffer mPerViewUb;
     mutable UniformBuffer mShadowUb;
+    UniformBuffer mRenderableUb;    // CPU copy of mRenderableUbh
     mutable backend::SamplerGroup mPerViewSb;
 
     mutable FrameHistory mFrameHistory{};
@@ -517,12 +551,23 @@ private:
     Range mVisibleDirectionalShadowCasters;
     Range mSpotLightShadowCasters;
     uint32_t mRenderableUBOSize = 0;
+    uint32_t mInstancesUBOSize = 0;
     mutable bool mHasDirectionalLight = false;
     mutable bool mHasDynamicLighting = false;
     mutable bool mHasShadowing = false;
     mutable bool mNeedsShadowMap = false;
 
     ShadowMapManager mShadowMapManager;
+    bool mShadowCachingEnabled = false;
+
+    // sorted commands kept across frames when command caching is enabled
+    bool mCommandCachingEnabled = false;
+    RenderPass::CommandCache mStructurePassCommandCache;
+    RenderPass::CommandCache mColorPassCommandCache;
+
+    bool mOcclusionCullingEnabled = false;
+    OcclusionCuller mOcclusionCuller;
+    OcclusionCullingStats mOcclusionCullingStats;
 };
 
 FILAMENT_UPCAST(View)
@@ -25,12 +25,16 @@
 
 #include "details/Engine.h"
 
+#include "ResourceAllocator.h"
+
 #include <backend/DriverEnums.h>
 #include <backend/Handle.h>
 
 #include <utils/Panic.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+
 using namespace utils;
 
 namespace filament {
@@ -365,6 +369,10 @@ FrameGraph& FrameGraph::compile() noexcept {
         }
     }
 
+    // share concrete textures between transient textures that are not alive at the same time,
+    // this must happen after resolve(), which updates the textures' usage.
+    aliasTransientTextures();
+
     // add resource to de-virtualize or destroy to the corresponding list for each active pass
     // but add them in priority order (this is so that rendertargets are added after textures)
     for (size_t priority = 0; priority < 2; priority++) {
@@ -384,6 +392,109 @@ FrameGraph& FrameGraph::compile() noexcept {
     return *this;
 }
 
+// Two textures can share the same concrete texture if they're identical except for their usage.
+// The SAMPLEABLE bit must match though, because it affects the actual levels and sample count.
+static bool isAliasable(FrameGraphTexture::Descriptor const& lhs,
+        FrameGraphTexture::Descriptor const& rhs) noexcept {
+    return lhs.width == rhs.width &&
+           lhs.height == rhs.height &&
+           lhs.depth == rhs.depth &&
+           lhs.levels == rhs.levels &&
+           lhs.samples == rhs.samples &&
+           lhs.type == rhs.type &&
+           lhs.format == rhs.format &&
+           any(lhs.usage & TextureUsage::SAMPLEABLE) == any(rhs.usage & TextureUsage::SAMPLEABLE);
+}
+
+// this must match what FrameGraphTexture::create() asks the ResourceAllocator
+static size_t getTransientSize(FrameGraphTexture::Descriptor const& desc) noexcept {
+    const bool sampleable = any(desc.usage & TextureUsage::SAMPLEABLE);
+    const uint8_t levels = sampleable ? desc.levels : uint8_t(1);
+    const uint8_t samples = sampleable ? std::min(desc.samples, uint8_t(1)) : desc.samples;
+    return ResourceAllocatorInterface::getTextureSize(desc.format, levels, samples,
+            desc.width, desc.height, desc.depth);
+}
+
+void FrameGraph::aliasTransientTextures() noexcept {
+    // A slot is a concrete texture, shared by a chain of transient textures with
+    // non-overlapping lifetimes. The first texture of the chain creates the concrete texture and
+    // each texture hands it over to the next one instead of destroying it.
+    struct Slot {
+        ResourceEntry<FrameGraphTexture>* owner;    // creates the concrete texture
+        ResourceEntry<FrameGraphTexture>* last;     // last texture of the chain
+        uint32_t begin;                             // first pass using the concrete texture
+        uint32_t end;                               // last pass using the concrete texture
+        size_t size;
+        TextureUsage usage;                         // usages of all the textures of the chain
+    };
+
+    Vector<ResourceEntry<FrameGraphTexture>*> textures(mArena);
+    for (UniquePtr<fg::ResourceEntryBase> const& resource : mResourceEntries) {
+        auto* const texture = resource->asTextureResourceEntry();
+        // textures without usage are never created, see FrameGraphTexture::create()
+        if (texture && !texture->imported && texture->refs && texture->first &&
+                any(texture->descriptor.usage)) {
+            textures.push_back(texture);
+        }
+    }
+
+    // passes are executed in the order of their id
+    std::stable_sort(textures.begin(), textures.end(), [](auto const* lhs, auto const* rhs) {
+        return lhs->first->id < rhs->first->id;
+    });
+
+    // Greedily assign each texture to the compatible slot that was released the most recently,
+    // which keeps the other slots available for textures starting earlier.
+    Vector<Slot> slots(mArena);
+    size_t total = 0;
+    for (ResourceEntry<FrameGraphTexture>* texture : textures) {
+        auto const& desc = texture->descriptor;
+        Slot* best = nullptr;
+        for (Slot& slot : slots) {
+            if (slot.end < texture->first->id && isAliasable(slot.owner->descriptor, desc)) {
+                if (!best || slot.end > best->end) {
+                    best = &slot;
+                }
+            }
+        }
+        const size_t size = getTransientSize(desc);
+        total += size;
+        if (best) {
+            best->last->aliasNext = texture;
+            best->last = texture;
+            best->end = texture->last->id;
+            best->usage |= desc.usage;
+        } else {
+            slots.push_back({ texture, texture, texture->first->id, texture->last->id, size,
+                    desc.usage });
+        }
+    }
+
+    // The concrete texture must allow all the usages of the chain. Any texture of the chain can
+    // create it, not just the first one, e.g. if the previous texture was detached and took the
+    // concrete texture with it.
+    for (Slot const& slot : slots) {
+        for (auto* texture = slot.owner; texture; texture = texture->aliasNext) {
+            texture->aliasUsage = slot.usage;
+        }
+    }
+
+    size_t peak = 0;
+    for (PassNode const& pass : mPassNodes) {
+        if (pass.refCount) {
+            size_t size = 0;
+            for (Slot const& slot : slots) {
+                if (slot.begin <= pass.id && pass.id <= slot.end) {
+                    size += slot.size;
+                }
+            }
+            peak = std::max(peak, size);
+        }
+    }
+
+    mTransientMemory = { peak, total, uint32_t(textures.size()), uint32_t(slots.size()) };
+}
+
 void FrameGraph::executeInternal(PassNode const& node, DriverApi& driver) noexcept {
     assert(node.base);
     // create concrete resources and rendertargets
@@ -459,7 +570,16 @@ void FrameGraph::export_graphviz(utils::io::ostream& out, const char* viewName)
     out << "digraph \"" << label << "\" {\n";
     out << "rankdir = LR\n";
     out << "bgcolor = black\n";
-    out << "node [shape=rectangle, fontname=\"helvetica\", fontsize=10]\n\n";
+    out << "node [shape=rectangle, fontname=\"helvetica\", fontsize=10]\n";
+
+    // transient memory statistics
+    TransientMemory const& memory = mTransientMemory;
+    out << "label = \"transient textures: " << memory.textureCount
+        << " (" << memory.backingCount << " allocated)"
+        << "\\npeak memory: " << memory.peak / 1024 << " KiB"
+        << " (" << memory.total / 1024 << " KiB without aliasing)\"\n";
+    out << "fontname = \"helvetica\"\n";
+    out << "fontcolor = white\n\n";
 
     auto const& registry = mResourceNodes;
     auto const& frameGraphPasses = mPassNodes;
@@ -239,6 +239,16 @@ public:
     // allocates concrete resources and culls unreferenced passes
     FrameGraph& compile() noexcept;
 
+    // transient textures statistics, computed by compile()
+    struct TransientMemory {
+        size_t peak = 0;            // peak memory used by the concrete textures during the frame
+        size_t total = 0;           // memory needed if each texture had its own concrete texture
+        uint32_t textureCount = 0;  // number of transient textures
+        uint32_t backingCount = 0;  // number of concrete textures backing them
+    };
+
+    TransientMemory const& getTransientMemory() const noexcept { return mTransientMemory; }
+
     // execute all referenced passes and flush the command queue after each pass
     void execute(FEngine& engine, backend::DriverApi& driver) noexcept;
 
@@ -284,6 +294,8 @@ private:
 
     void reset() noexcept;
 
+    void aliasTransientTextures() noexcept;
+
     void moveResourceBase(FrameGraphHandle from, FrameGraphHandle to);
 
     FrameGraphHandle create(fg::ResourceEntryBase* pResourceEntry) noexcept;
@@ -327,6 +339,7 @@ private:
     Vector<UniquePtr<fg::ResourceNode>> mResourceNodeEntries;
     Vector<UniquePtr<fg::ResourceEntryBase>> mResourceEntries;
     uint16_t mId = 0;
+    TransientMemory mTransientMemory;
 };
 
 } // namespace filament
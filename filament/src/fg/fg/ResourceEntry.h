@@ -19,17 +19,23 @@
 
 #include "fg/fg/VirtualResource.h"
 
+#include <backend/DriverEnums.h>
+
+#include <type_traits>
+
 #include <stdint.h>
 
 namespace filament {
 
 class FrameGraph;
 class ResourceAllocatorInterface;
+struct FrameGraphTexture;
 
 namespace fg {
 
 struct PassNode;
 class RenderTargetResourceEntry;
+template<typename T> class ResourceEntry;
 
 class ResourceEntryBase : public VirtualResource {
 public:
@@ -41,6 +47,10 @@ public:
         return nullptr;
     }
 
+    virtual ResourceEntry<FrameGraphTexture>* asTextureResourceEntry() noexcept {
+        return nullptr;
+    }
+
     void preExecuteDestroy(FrameGraph& fg) noexcept override {
         discardEnd = true;
     }
@@ -86,21 +96,55 @@ public:
             : ResourceEntryBase(name, id, true, priority), resource(r), descriptor(desc) {
     }
 
+    // computed during compile(), the next resource to use our concrete resource once we're
+    // done with it (i.e. both resources are aliased)
+    ResourceEntry* aliasNext = nullptr;
+
+    // updated during execute(), whether the previous resource aliased to us gave us its
+    // concrete resource
+    bool aliasReceived = false;
+
+    // computed during compile(), the usages of all the textures aliased with us. Any of them
+    // can end-up creating the concrete texture, e.g. if the previous one was detached, so they
+    // all create it with these usages. Our descriptor is left untouched.
+    backend::TextureUsage aliasUsage{};
+
     T const& getResource() const noexcept { return resource; }
 
     T& getResource() noexcept { return resource; }
 
+    ResourceEntry<FrameGraphTexture>* asTextureResourceEntry() noexcept override {
+        if constexpr (std::is_same<T, FrameGraphTexture>::value) {
+            return this;
+        } else {
+            return nullptr;
+        }
+    }
+
     void resolve(FrameGraph& fg) noexcept override { }
 
     void preExecuteDevirtualize(FrameGraph& fg) noexcept override {
-        if (!imported) {
-            resource.create(getResourceAllocator(fg), name, descriptor);
+        // the concrete resource could be missing if the previous resource was detached
+        if (!imported && !aliasReceived) {
+            if constexpr (std::is_same<T, FrameGraphTexture>::value) {
+                Descriptor desc = descriptor;
+                desc.usage |= aliasUsage;
+                resource.create(getResourceAllocator(fg), name, desc);
+            } else {
+                resource.create(getResourceAllocator(fg), name, descriptor);
+            }
         }
     }
 
     void postExecuteDestroy(FrameGraph& fg) noexcept override {
         if (!imported) {
-            resource.destroy(getResourceAllocator(fg));
+            if (aliasNext) {
+                // hand our concrete resource over instead of destroying it
+                aliasNext->resource = resource;
+                aliasNext->aliasReceived = true;
+            } else {
+                resource.destroy(getResourceAllocator(fg));
+            }
             // make sure to clear the resource as some code might rely on e.g. handles to know
             // if they need to be set or not
             resource = {};
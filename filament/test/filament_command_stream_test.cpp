@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "details/Engine.h"
+
+#include <private/backend/CommandStream.h>
+
+#include <thread>
+#include <vector>
+
+using namespace filament;
+using namespace filament::backend;
+
+namespace {
+
+// identifies a queued command by the stream that recorded it and its rank in that stream
+struct Record {
+    int stream;
+    int rank;
+    bool operator==(Record const& rhs) const noexcept {
+        return stream == rhs.stream && rank == rhs.rank;
+    }
+};
+
+constexpr int PARENT_BEFORE = -1;
+constexpr int PARENT_AFTER = -2;
+
+constexpr size_t COMMAND_SIZE = CustomCommand::align(sizeof(CustomCommand));
+constexpr size_t LINK_SIZE = CommandBase::align(sizeof(NoopCommand));
+
+// number of queueCommand() calls that fit in a block, leaving room for the link to the next one
+constexpr size_t COMMANDS_PER_BLOCK = (CommandSubBuffers::BLOCK_SIZE - LINK_SIZE) / COMMAND_SIZE;
+
+class CommandStreamTest : public testing::Test {
+protected:
+    FEngine* engine = nullptr;
+
+    // only accessed from the driver thread until flushAndWait() returns
+    std::vector<Record> executed;
+
+    void SetUp() override {
+        engine = FEngine::create(Engine::Backend::NOOP);
+        engine->getDriverApi().debugThreading();
+    }
+
+    void TearDown() override {
+        Engine::destroy((Engine**)&engine);
+    }
+
+    void record(CommandStream& stream, int id, size_t count, std::vector<Record>& expected) {
+        for (size_t i = 0; i < count; i++) {
+            const int rank = int(i);
+            stream.queueCommand([this, id, rank]() { executed.push_back({ id, rank }); });
+            expected.push_back({ id, rank });
+        }
+    }
+};
+
+} // anonymous namespace
+
+TEST_F(CommandStreamTest, SubBuffersOrder) {
+    DriverApi& driver = engine->getDriverApi();
+    std::vector<Record> expected;
+
+    record(driver, PARENT_BEFORE, 3, expected);
+
+    // sub-stream 0 fills several blocks, 1 is empty, 2 only fits in one block, and 3 allocates
+    // more than a block at once
+    constexpr size_t STREAM_COUNT = 4;
+    const size_t counts[STREAM_COUNT] = { 3 * COMMANDS_PER_BLOCK + 1, 0, 10, 5 };
+    std::vector<Record> expectedPerStream[STREAM_COUNT];
+
+    CommandSubBuffers subBuffers(driver, STREAM_COUNT, 16 * CommandSubBuffers::BLOCK_SIZE);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < STREAM_COUNT; i++) {
+        threads.emplace_back([&, i]() {
+            CommandStream& stream = subBuffers[i];
+            if (i == 3) {
+                stream.allocate(CommandSubBuffers::BLOCK_SIZE);
+            }
+            record(stream, int(i), counts[i], expectedPerStream[i]);
+        });
+    }
+
+    // commands recorded on the parent stream while the sub-streams are recording
+    std::vector<Record> expectedAfter;
+    record(driver, PARENT_AFTER, 2, expectedAfter);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    subBuffers.submit();
+
+    // and after the sub-streams were submitted
+    for (int i = 2; i < 4; i++) {
+        driver.queueCommand([this, i]() { executed.push_back({ PARENT_AFTER, i }); });
+        expectedAfter.push_back({ PARENT_AFTER, i });
+    }
+
+    for (auto const& e : expectedPerStream) {
+        expected.insert(expected.end(), e.begin(), e.end());
+    }
+    expected.insert(expected.end(), expectedAfter.begin(), expectedAfter.end());
+
+    engine->flushAndWait();
+
+    ASSERT_EQ(executed.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(executed[i], expected[i]) << "at index " << i;
+    }
+}
+
+TEST_F(CommandStreamTest, SubBuffersBlockChaining) {
+    DriverApi& driver = engine->getDriverApi();
+    std::vector<Record> expected;
+
+    CommandSubBuffers subBuffers(driver, 1, 4 * CommandSubBuffers::BLOCK_SIZE);
+    CommandStream& stream = subBuffers[0];
+    EXPECT_EQ(subBuffers.getUsedSize(), 0u);
+
+    // the first block holds as many commands as it can while keeping room for the link
+    record(stream, 0, COMMANDS_PER_BLOCK, expected);
+    EXPECT_EQ(subBuffers.getUsedSize(), CommandSubBuffers::BLOCK_SIZE);
+
+    // the next command goes in a new block
+    record(stream, 1, 1, expected);
+    EXPECT_EQ(subBuffers.getUsedSize(), 2 * CommandSubBuffers::BLOCK_SIZE);
+
+    subBuffers.submit();
+    engine->flushAndWait();
+
+    ASSERT_EQ(executed.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(executed[i], expected[i]) << "at index " << i;
+    }
+}
+
+TEST_F(CommandStreamTest, SubBuffersAllEmpty) {
+    DriverApi& driver = engine->getDriverApi();
+    std::vector<Record> expected;
+
+    record(driver, PARENT_BEFORE, 2, expected);
+    CommandSubBuffers subBuffers(driver, 3, CommandSubBuffers::BLOCK_SIZE);
+    record(driver, PARENT_AFTER, 2, expected);
+    subBuffers.submit();
+    EXPECT_EQ(subBuffers.getUsedSize(), 0u);
+
+    engine->flushAndWait();
+
+    ASSERT_EQ(executed.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_EQ(executed[i], expected[i]) << "at index " << i;
+    }
+}
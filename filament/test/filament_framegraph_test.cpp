@@ -24,6 +24,8 @@
 
 #include "private/backend/CommandStream.h"
 
+#include <vector>
+
 using namespace filament;
 using namespace backend;
 
@@ -38,6 +40,10 @@ protected:
 class MockResourceAllocator : public ResourceAllocatorInterface {
     uint32_t handle = 0;
 public:
+    uint32_t createdTextures = 0;
+    uint32_t destroyedTextures = 0;
+    std::vector<backend::TextureUsage> createdUsages;
+
     backend::RenderTargetHandle createRenderTarget(const char* name,
             backend::TargetBufferFlags targetBufferFlags,
             uint32_t width,
@@ -56,10 +62,13 @@ public:
             uint8_t levels,
             backend::TextureFormat format, uint8_t samples, uint32_t width, uint32_t height,
             uint32_t depth, backend::TextureUsage usage) noexcept override {
+        createdTextures++;
+        createdUsages.push_back(usage);
         return backend::TextureHandle(++handle);
     }
 
     void destroyTexture(backend::TextureHandle h) noexcept override {
+        destroyedTextures++;
     }
 };
 
@@ -447,3 +456,267 @@ TEST_F(FrameGraphTest, MoveGenericResource) {
     EXPECT_EQ(h[1], h[3]);
     EXPECT_EQ(h[3], h[0]);
 }
+
+TEST_F(FrameGraphTest, TransientTextureAliasing) {
+    // This checks that:
+    // - textures with non-overlapping lifetimes and the same descriptor share a concrete texture
+    // - textures used by the same pass never share a concrete texture
+    // - textures with a different format never share a concrete texture
+    // - the peak transient memory only accounts for the concrete textures
+
+    MockResourceAllocator resourceAllocator;
+    FrameGraph fg(resourceAllocator);
+
+    const FrameGraphTexture::Descriptor colorDesc{
+            .width = 128, .height = 128,
+            .format = TextureFormat::RGBA8,
+            .usage = TextureUsage::COLOR_ATTACHMENT };
+
+    const FrameGraphTexture::Descriptor depthDesc{
+            .width = 128, .height = 128,
+            .format = TextureFormat::DEPTH24,
+            .usage = TextureUsage::DEPTH_ATTACHMENT };
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> input;
+        FrameGraphId<FrameGraphTexture> output;
+        FrameGraphId<FrameGraphTexture> depth;
+    };
+
+    // t[0]: A -> B, t[1]: B -> C, t[2]: C -> D, t[3] (depth): C -> D
+    uint32_t t[4] = {};
+
+    auto& a = fg.addPass<PassData>("A",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.output = builder.write(builder.createTexture("t0", colorDesc));
+            },
+            [&](FrameGraphPassResources const& resources,
+                    auto const& data, backend::DriverApi& driver) {
+                t[0] = resources.getTexture(data.output).getId();
+            });
+
+    auto& b = fg.addPass<PassData>("B",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.input = builder.sample(a.getData().output);
+                data.output = builder.write(builder.createTexture("t1", colorDesc));
+            },
+            [&](FrameGraphPassResources const& resources,
+                    auto const& data, backend::DriverApi& driver) {
+                EXPECT_EQ(t[0], resources.getTexture(data.input).getId());
+                t[1] = resources.getTexture(data.output).getId();
+            });
+
+    auto& c = fg.addPass<PassData>("C",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.input = builder.sample(b.getData().output);
+                data.output = builder.write(builder.createTexture("t2", colorDesc));
+                data.depth = builder.write(builder.createTexture("t3", depthDesc));
+            },
+            [&](FrameGraphPassResources const& resources,
+                    auto const& data, backend::DriverApi& driver) {
+                EXPECT_EQ(t[1], resources.getTexture(data.input).getId());
+                t[2] = resources.getTexture(data.output).getId();
+                t[3] = resources.getTexture(data.depth).getId();
+            });
+
+    fg.addPass<PassData>("D",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.input = builder.sample(c.getData().output);
+                data.depth = builder.sample(c.getData().depth);
+                builder.sideEffect();
+            },
+            [&](FrameGraphPassResources const& resources,
+                    auto const& data, backend::DriverApi& driver) {
+                EXPECT_EQ(t[2], resources.getTexture(data.input).getId());
+                EXPECT_EQ(t[3], resources.getTexture(data.depth).getId());
+            });
+
+    fg.compile();
+
+    const size_t colorSize = ResourceAllocatorInterface::getTextureSize(
+            TextureFormat::RGBA8, 1, 0, 128, 128, 1);
+    const size_t depthSize = ResourceAllocatorInterface::getTextureSize(
+            TextureFormat::DEPTH24, 1, 0, 128, 128, 1);
+
+    FrameGraph::TransientMemory const& memory = fg.getTransientMemory();
+    EXPECT_EQ(4u, memory.textureCount);
+    EXPECT_EQ(3u, memory.backingCount);
+    EXPECT_EQ(3 * colorSize + depthSize, memory.total);
+    // all concrete textures are alive during C
+    EXPECT_EQ(2 * colorSize + depthSize, memory.peak);
+
+    fg.execute(driverApi);
+
+    EXPECT_EQ(3u, resourceAllocator.createdTextures);
+    EXPECT_EQ(3u, resourceAllocator.destroyedTextures);
+    EXPECT_TRUE(t[0]);
+    EXPECT_TRUE(t[1]);
+    EXPECT_TRUE(t[3]);
+    EXPECT_EQ(t[0], t[2]);
+    EXPECT_NE(t[0], t[1]);
+    EXPECT_NE(t[0], t[3]);
+    EXPECT_NE(t[1], t[3]);
+}
+
+TEST_F(FrameGraphTest, TransientTextureAliasingDetached) {
+    // This checks that:
+    // - a detached texture doesn't hand its concrete texture over to the next texture aliased
+    //   with it, which creates a new one instead
+    // - any texture of an aliasing chain creates the concrete texture with the usages of the
+    //   whole chain, not just the first one
+    // - the detached descriptor keeps its own usage
+
+    MockResourceAllocator resourceAllocator;
+    FrameGraph fg(resourceAllocator);
+
+    const FrameGraphTexture::Descriptor desc{
+            .width = 128, .height = 128,
+            .format = TextureFormat::RGBA8,
+            .usage = TextureUsage::COLOR_ATTACHMENT };
+
+    struct PassData {
+        FrameGraphId<FrameGraphTexture> input;
+        FrameGraphId<FrameGraphTexture> output;
+    };
+
+    FrameGraphTexture detached;
+    FrameGraphTexture::Descriptor detachedDesc;
+
+    // each pass samples the texture of the previous pass and writes t[i], which makes t0, t2, t4
+    // and t1, t3 share a concrete texture. t0 is detached by its last user.
+    uint32_t t[5] = {};
+    FrameGraphId<FrameGraphTexture> previous;
+    for (uint32_t i = 0; i < 5; i++) {
+        FrameGraphTexture::Descriptor d = desc;
+        if (i == 4) {
+            // only the last texture of the chain needs to be uploadable
+            d.usage |= TextureUsage::UPLOADABLE;
+        }
+        auto& pass = fg.addPass<PassData>("pass",
+                [&](FrameGraph::Builder& builder, auto& data) {
+                    if (previous.isValid()) {
+                        data.input = builder.sample(previous);
+                    }
+                    data.output = builder.write(builder.createTexture("t", d));
+                },
+                [&t, &detached, &detachedDesc, i](FrameGraphPassResources const& resources,
+                        auto const& data, backend::DriverApi& driver) {
+                    t[i] = resources.getTexture(data.output).getId();
+                    if (i == 1) {
+                        resources.detach(data.input, &detached, &detachedDesc);
+                    }
+                });
+        previous = pass.getData().output;
+    }
+
+    fg.addPass<PassData>("end",
+            [&](FrameGraph::Builder& builder, auto& data) {
+                data.input = builder.sample(previous);
+                builder.sideEffect();
+            },
+            [&](FrameGraphPassResources const& resources,
+                    auto const& data, backend::DriverApi& driver) {
+            });
+
+    fg.compile();
+    EXPECT_EQ(5u, fg.getTransientMemory().textureCount);
+    EXPECT_EQ(2u, fg.getTransientMemory().backingCount);
+
+    fg.execute(driverApi);
+
+    // t2 creates a new concrete texture, which is handed over to t4
+    EXPECT_EQ(3u, resourceAllocator.createdTextures);
+    EXPECT_EQ(2u, resourceAllocator.destroyedTextures);
+    EXPECT_EQ(t[0], detached.texture.getId());
+    EXPECT_NE(t[0], t[2]);
+    EXPECT_EQ(t[2], t[4]);
+    EXPECT_EQ(t[1], t[3]);
+    EXPECT_EQ(TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE, detachedDesc.usage);
+
+    const TextureUsage usage = TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE;
+    ASSERT_EQ(3u, resourceAllocator.createdUsages.size());
+    EXPECT_EQ(usage | TextureUsage::UPLOADABLE, resourceAllocator.createdUsages[0]);
+    EXPECT_EQ(usage, resourceAllocator.createdUsages[1]);
+    EXPECT_EQ(usage | TextureUsage::UPLOADABLE, resourceAllocator.createdUsages[2]);
+}
+
+TEST_F(FrameGraphTest, ResourceAllocatorCache) {
+    // This checks that:
+    // - a render target can be served a cached texture that is slightly larger
+    // - a sampleable texture is only served a cached texture of the same size
+    // - the least recently used textures are evicted when the cache is over capacity
+
+    ResourceAllocator resourceAllocator(driverApi);
+
+    auto create = [&](uint32_t width, uint32_t height, TextureUsage usage) {
+        return resourceAllocator.createTexture("texture", SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, width, height, 1, usage);
+    };
+
+    resourceAllocator.destroyTexture(create(1920, 1080, TextureUsage::COLOR_ATTACHMENT));
+    resourceAllocator.destroyTexture(create(1900, 1060, TextureUsage::COLOR_ATTACHMENT));
+    resourceAllocator.destroyTexture(create(960, 540, TextureUsage::COLOR_ATTACHMENT));
+    resourceAllocator.destroyTexture(create(1900, 1060,
+            TextureUsage::COLOR_ATTACHMENT | TextureUsage::SAMPLEABLE));
+
+    auto stats = resourceAllocator.getCacheStats();
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(3u, stats.misses);
+    EXPECT_EQ(0u, stats.evictions);
+
+    // the 1920x1080 texture is the least recently used
+    resourceAllocator.setCacheCapacity(resourceAllocator.getCacheSize() - 1);
+    resourceAllocator.gc();
+    stats = resourceAllocator.getCacheStats();
+    EXPECT_EQ(1u, stats.evictions);
+    EXPECT_LT(resourceAllocator.getCacheSize(), resourceAllocator.getCacheCapacity());
+
+    resourceAllocator.destroyTexture(create(1900, 1060, TextureUsage::COLOR_ATTACHMENT));
+    stats = resourceAllocator.getCacheStats();
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(4u, stats.misses);
+
+    resourceAllocator.terminate();
+}
+
+TEST_F(FrameGraphTest, ResourceAllocatorCacheExactKey) {
+    // This checks that:
+    // - a texture with the same key is always reused, most recently used first
+    // - a texture that isn't only an attachment is never served a larger texture
+
+    ResourceAllocator resourceAllocator(driverApi);
+
+    auto create = [&](uint32_t width, uint32_t height, TextureUsage usage) {
+        return resourceAllocator.createTexture("texture", SamplerType::SAMPLER_2D, 1,
+                TextureFormat::RGBA8, 1, width, height, 1, usage);
+    };
+
+    const TextureUsage uploadable = TextureUsage::COLOR_ATTACHMENT | TextureUsage::UPLOADABLE;
+    const TextureUsage subpass = TextureUsage::COLOR_ATTACHMENT | TextureUsage::SUBPASS_INPUT;
+    auto a = create(1920, 1080, uploadable);
+    auto b = create(1920, 1080, uploadable);
+    resourceAllocator.destroyTexture(a);
+    resourceAllocator.destroyTexture(b);
+    resourceAllocator.destroyTexture(create(1920, 1080, subpass));
+
+    // none of them can be used for a smaller texture
+    auto c = create(1900, 1060, uploadable);
+    auto d = create(1900, 1060, subpass);
+    auto stats = resourceAllocator.getCacheStats();
+    EXPECT_EQ(0u, stats.hits);
+    EXPECT_EQ(5u, stats.misses);
+    EXPECT_NE(a, c);
+    EXPECT_NE(b, c);
+
+    // the same key is served the most recently used texture, then the other one
+    EXPECT_EQ(b, create(1920, 1080, uploadable));
+    EXPECT_EQ(a, create(1920, 1080, uploadable));
+    stats = resourceAllocator.getCacheStats();
+    EXPECT_EQ(2u, stats.hits);
+
+    resourceAllocator.destroyTexture(a);
+    resourceAllocator.destroyTexture(b);
+    resourceAllocator.destroyTexture(c);
+    resourceAllocator.destroyTexture(d);
+    resourceAllocator.terminate();
+}
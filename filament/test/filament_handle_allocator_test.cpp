@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "private/backend/HandleAllocator.h"
+
+#include <vector>
+
+using namespace filament::backend;
+
+namespace {
+
+struct SmallObject { uint32_t value; };                 // 1st size class
+struct MediumObject { uint32_t value; char pad[60]; };  // 2nd size class
+struct LargeObject { uint32_t value; char pad[200]; };  // 3rd size class
+
+} // anonymous namespace
+
+TEST(HandleAllocatorTest, PoolSlabBoundaries) {
+    HandlePool pool;
+    pool.init(16, 64, 1u << 24);
+
+    // slabs are [0, 64), [64, 128), [128, 256), [256, 512), [512, 1024)
+    constexpr uint32_t COUNT = 1000;
+    std::vector<void*> slots;
+    for (uint32_t i = 0; i < COUNT; i++) {
+        const uint32_t index = pool.allocate();
+        ASSERT_EQ(index, i);
+        slots.push_back(pool.getSlot(index));
+        *static_cast<uint32_t*>(slots.back()) = i;
+        if (i == 63 || i == 127 || i == 255 || i == 511) {
+            // the last slot of a slab is right before the first slot of the next one
+            EXPECT_EQ(pool.getCapacity(), i + 1);
+        }
+    }
+    EXPECT_EQ(pool.getCapacity(), 1024);
+    EXPECT_EQ(pool.getCount(), COUNT);
+    EXPECT_EQ(pool.getHighWatermark(), COUNT);
+
+    // growing doesn't move the slots already allocated
+    for (uint32_t i = 0; i < COUNT; i++) {
+        EXPECT_EQ(pool.getSlot(i), slots[i]);
+        EXPECT_EQ(*static_cast<uint32_t*>(slots[i]), i);
+        EXPECT_EQ(uintptr_t(slots[i]) % 16, 0);
+    }
+}
+
+TEST(HandleAllocatorTest, PoolFreeList) {
+    HandlePool pool;
+    pool.init(16, 64, 1u << 24);
+    for (uint32_t i = 0; i < 200; i++) {
+        pool.allocate();
+    }
+
+    // freed slots are reused in LIFO order, including across slabs
+    pool.free(10);
+    pool.free(150);
+    pool.free(64);
+    EXPECT_EQ(pool.getCount(), 197);
+    EXPECT_EQ(pool.allocate(), 64);
+    EXPECT_EQ(pool.allocate(), 150);
+    EXPECT_EQ(pool.allocate(), 10);
+
+    // then new slots are used
+    EXPECT_EQ(pool.allocate(), 200);
+    EXPECT_EQ(pool.getCount(), 201);
+    EXPECT_EQ(pool.getHighWatermark(), 201);
+
+    // the generation of a slot changes when it's freed
+    const uint8_t generation = pool.getGeneration(150);
+    pool.free(150);
+    EXPECT_EQ(pool.getGeneration(150), uint8_t(generation + 1));
+    EXPECT_EQ(pool.getHighWatermark(), 201);
+}
+
+TEST(HandleAllocatorTest, PoolMaxCount) {
+    HandlePool pool;
+    pool.init(16, 64, 128);
+    for (uint32_t i = 0; i < 128; i++) {
+        ASSERT_EQ(pool.allocate(), i);
+    }
+    EXPECT_EQ(pool.allocate(), HandlePool::INVALID);
+    pool.free(3);
+    EXPECT_EQ(pool.allocate(), 3);
+}
+
+TEST(HandleAllocatorTest, Generations) {
+    HandleAllocatorGL allocator("HandleAllocatorTest", 4096);
+
+    Handle<SmallObject> h = allocator.allocateAndConstruct<SmallObject>(SmallObject{ 42 });
+    const HandleBase::HandleId first = h.getId();
+    EXPECT_EQ(allocator.handle_cast<SmallObject*>(h)->value, 42);
+    allocator.deallocate(h, allocator.handle_cast<SmallObject*>(h));
+
+    // the slot is reused, but the id isn't the same
+    h = allocator.allocateAndConstruct<SmallObject>(SmallObject{ 43 });
+    EXPECT_NE(h.getId(), first);
+    EXPECT_EQ(h.getId() & 0x00FFFFFFu, first & 0x00FFFFFFu);
+    EXPECT_EQ(allocator.handle_cast<SmallObject*>(h)->value, 43);
+
+    // the generation is stored on 6 bits, it wraps after 64 frees
+    for (uint32_t i = 1; i < 64; i++) {
+        allocator.deallocate(h);
+        h = allocator.allocate<SmallObject>();
+        EXPECT_EQ(h.getId() == first, i == 63) << "after " << i + 1 << " frees";
+    }
+    allocator.construct<SmallObject>(h, SmallObject{ 44 });
+    EXPECT_EQ(allocator.handle_cast<SmallObject*>(h)->value, 44);
+    allocator.deallocate(h);
+}
+
+TEST(HandleAllocatorTest, SizeClassesAndStats) {
+    HandleAllocatorGL allocator("HandleAllocatorTest", 4096);
+
+    std::vector<Handle<SmallObject>> small;
+    std::vector<Handle<MediumObject>> medium;
+    std::vector<Handle<LargeObject>> large;
+    for (uint32_t i = 0; i < 300; i++) {
+        small.push_back(allocator.allocateAndConstruct<SmallObject>(SmallObject{ i }));
+        if (i % 2 == 0) {
+            medium.push_back(allocator.allocateAndConstruct<MediumObject>());
+        }
+        if (i % 3 == 0) {
+            large.push_back(allocator.allocateAndConstruct<LargeObject>());
+            allocator.handle_cast<LargeObject*>(large.back())->value = i;
+        }
+    }
+
+    // ids are [pool:2][generation:6][index:24], the null id would be in a 4th pool
+    for (auto const& h : small) {
+        EXPECT_NE(h.getId(), HandleBase::nullid);
+        EXPECT_EQ(h.getId() >> 30u, 0);
+    }
+    for (auto const& h : medium) {
+        EXPECT_NE(h.getId(), HandleBase::nullid);
+        EXPECT_EQ(h.getId() >> 30u, 1);
+    }
+    for (auto const& h : large) {
+        EXPECT_NE(h.getId(), HandleBase::nullid);
+        EXPECT_EQ(h.getId() >> 30u, 2);
+    }
+
+    // handles of different size classes don't share storage
+    for (uint32_t i = 0; i < 300; i++) {
+        EXPECT_EQ(allocator.handle_cast<SmallObject*>(small[i])->value, i);
+        if (i % 3 == 0) {
+            EXPECT_EQ(allocator.handle_cast<LargeObject*>(large[i / 3])->value, i);
+        }
+    }
+
+    auto stats = allocator.getStats();
+    EXPECT_EQ(stats.pools[0].slotSize, 16);
+    EXPECT_EQ(stats.pools[1].slotSize, 64);
+    EXPECT_EQ(stats.pools[2].slotSize, 208);
+    EXPECT_EQ(stats.pools[0].count, 300);
+    EXPECT_EQ(stats.pools[1].count, 150);
+    EXPECT_EQ(stats.pools[2].count, 100);
+    for (auto const& pool : stats.pools) {
+        EXPECT_EQ(pool.highWatermark, pool.count);
+        EXPECT_GE(pool.capacity, pool.count);
+    }
+    EXPECT_GT(stats.bytes, 300 * 16 + 150 * 64 + 100 * 208);
+
+    for (auto& h : small) {
+        allocator.deallocate(h, allocator.handle_cast<SmallObject*>(h));
+    }
+    for (size_t i = 0; i < 50; i++) {
+        allocator.deallocate(medium[i]);
+    }
+
+    // freeing doesn't release memory nor lower the high watermark
+    const auto before = stats;
+    stats = allocator.getStats();
+    EXPECT_EQ(stats.pools[0].count, 0);
+    EXPECT_EQ(stats.pools[1].count, 100);
+    EXPECT_EQ(stats.pools[2].count, 100);
+    for (size_t i = 0; i < 3; i++) {
+        EXPECT_EQ(stats.pools[i].highWatermark, before.pools[i].highWatermark);
+        EXPECT_EQ(stats.pools[i].capacity, before.pools[i].capacity);
+    }
+    EXPECT_EQ(stats.bytes, before.bytes);
+
+    for (size_t i = 50; i < medium.size(); i++) {
+        allocator.deallocate(medium[i]);
+    }
+    for (auto& h : large) {
+        allocator.deallocate(h);
+    }
+}
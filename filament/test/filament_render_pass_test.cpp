@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "RenderPass.h"
+
+#include "details/Camera.h"
+#include "details/Engine.h"
+#include "details/Material.h"
+#include "details/RenderPrimitive.h"
+#include "details/Scene.h"
+
+#include <utils/JobSystem.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace filament;
+using namespace filament::math;
+
+using Command = RenderPass::Command;
+
+class RenderPassTest : public testing::Test {
+protected:
+    static constexpr size_t COMMAND_COUNT = 20000;
+
+    // Keys that look like a typical color pass. The index of each command is its original
+    // position, which tells us where each command ended-up.
+    static std::vector<Command> createRandomCommands(size_t count) {
+        std::default_random_engine gen(82828); // NOLINT
+        std::uniform_int_distribution<uint32_t> material(0, 63);
+        std::uniform_int_distribution<uint32_t> instance(0, 255);
+        std::uniform_int_distribution<uint32_t> zbucket(0, 1023);
+        std::uniform_int_distribution<uint32_t> priority(0, 7);
+        std::vector<Command> commands(count);
+        for (size_t i = 0; i < count; i++) {
+            Command& cmd = commands[i];
+            cmd.key = uint64_t(RenderPass::Pass::COLOR);
+            cmd.key |= uint64_t(RenderPass::CustomCommand::PASS);
+            cmd.key |= RenderPass::makeField(priority(gen),
+                    RenderPass::PRIORITY_MASK, RenderPass::PRIORITY_SHIFT);
+            cmd.key |= RenderPass::makeField(zbucket(gen),
+                    RenderPass::Z_BUCKET_MASK, RenderPass::Z_BUCKET_SHIFT);
+            cmd.key |= RenderPass::makeMaterialSortingKey(material(gen), instance(gen));
+            cmd.primitive.index = uint16_t(i);
+        }
+        return commands;
+    }
+
+    // Only a handful of distinct keys, which differ in several digits.
+    static std::vector<Command> createDuplicateCommands(size_t count) {
+        std::default_random_engine gen(82828); // NOLINT
+        std::uniform_int_distribution<uint32_t> distribution(0, 3);
+        const uint64_t keys[] = {
+                uint64_t(RenderPass::Pass::DEPTH) | 0x12345678u,
+                uint64_t(RenderPass::Pass::COLOR) | 0x00000042u,
+                uint64_t(RenderPass::Pass::COLOR) | 0x00FF0000u,
+                uint64_t(RenderPass::Pass::BLENDED) };
+        std::vector<Command> commands(count);
+        for (size_t i = 0; i < count; i++) {
+            commands[i].key = keys[distribution(gen)];
+            commands[i].primitive.index = uint16_t(i);
+        }
+        return commands;
+    }
+
+    static void expectSameKeys(std::vector<Command> const& expected,
+            std::vector<Command> const& actual) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(expected[i].key, actual[i].key) << "at index " << i;
+        }
+    }
+
+    // Both the radix sort and the parallel sort are stable, so on top of matching std::sort's
+    // keys, equal keys must keep their original order.
+    template<typename SORT>
+    static void testSort(std::vector<Command> commands, SORT sort) {
+        std::vector<Command> expected(commands);
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<Command> stable(commands);
+        std::stable_sort(stable.begin(), stable.end());
+
+        std::vector<Command> scratch(commands.size());
+        sort(commands.data(), commands.data() + commands.size(), scratch.data());
+
+        expectSameKeys(expected, commands);
+        for (size_t i = 0; i < commands.size(); i++) {
+            ASSERT_EQ(stable[i].primitive.index, commands[i].primitive.index) << "at index " << i;
+        }
+    }
+
+    static void testRadixSort(std::vector<Command> commands) {
+        testSort(std::move(commands), RenderPass::Test::radixSortCommands);
+    }
+
+    static void testParallelSort(std::vector<Command> commands) {
+        // the calling thread must be adopted to wait on the jobs
+        utils::JobSystem js(3);
+        js.adopt();
+        testSort(std::move(commands), [&js](Command* first, Command* last, Command* scratch) {
+            RenderPass::Test::parallelSortCommands(js, first, last, scratch);
+        });
+        js.emancipate();
+    }
+};
+
+TEST_F(RenderPassTest, RadixSortRandomKeys) {
+    for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(511), COMMAND_COUNT }) {
+        testRadixSort(createRandomCommands(count));
+    }
+}
+
+TEST_F(RenderPassTest, RadixSortDuplicateKeys) {
+    testRadixSort(createDuplicateCommands(COMMAND_COUNT));
+
+    // all keys identical, every digit is skipped
+    std::vector<Command> commands = createDuplicateCommands(COMMAND_COUNT);
+    for (Command& cmd : commands) {
+        cmd.key = uint64_t(RenderPass::Pass::COLOR);
+    }
+    testRadixSort(commands);
+}
+
+TEST_F(RenderPassTest, ParallelSortRandomKeys) {
+    // small counts fall back to a single chunk
+    for (size_t count : { size_t(0), size_t(1), size_t(511), size_t(4096), COMMAND_COUNT }) {
+        testParallelSort(createRandomCommands(count));
+    }
+}
+
+TEST_F(RenderPassTest, ParallelSortDuplicateKeys) {
+    testParallelSort(createDuplicateCommands(COMMAND_COUNT));
+}
+
+TEST_F(RenderPassTest, CommandCacheMovedRenderable) {
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    FMaterialInstance const* mi = engine->getDefaultMaterial()->getDefaultInstance();
+
+    // a row of renderables in front of the camera, 1m apart
+    constexpr uint32_t RENDERABLE_COUNT = 16;
+    std::vector<FRenderPrimitive> primitives(RENDERABLE_COUNT);
+    FScene::RenderableSoa soa;
+    soa.setCapacity(RENDERABLE_COUNT + 1); // the summed primitive count needs one more entry
+    for (uint32_t i = 0; i < RENDERABLE_COUNT; i++) {
+        primitives[i].set(*engine, RenderableManager::PrimitiveType::TRIANGLES, 0, 0, 2, 3);
+        primitives[i].setMaterialInstance(mi);
+        soa.push_back_unsafe({}, {}, false, FRenderableManager::Visibility{}, {},
+                float3{ 0, 0, -2.0f - float(i) }, FScene::VisibleMaskType(1), {}, 1, {},
+                utils::Slice<FRenderPrimitive>{ &primitives[i], 1 }, 0, {});
+    }
+
+    CameraInfo camera;
+    camera.model = mat4f{};
+
+    std::vector<Command> buffer(1024);
+    auto generate = [&](RenderPass::CommandTypeFlags flags, RenderPass::CommandCache* cache) {
+        RenderPass pass(*engine, utils::GrowingSlice<Command>(buffer.data(), buffer.size()));
+        pass.setGeometry(soa, { 0, RENDERABLE_COUNT }, {});
+        pass.setCamera(camera);
+        pass.appendSortedCommands(flags, cache);
+        return std::vector<Command>(pass.begin(), pass.end());
+    };
+
+    RenderPass::CommandCache depthCache;
+    RenderPass::CommandCache colorCache;
+    const std::vector<Command> depth = generate(RenderPass::DEPTH, &depthCache);
+    const std::vector<Command> color = generate(RenderPass::COLOR, &colorCache);
+    expectSameKeys(generate(RenderPass::DEPTH, nullptr), depth);
+    expectSameKeys(generate(RenderPass::COLOR, nullptr), color);
+    ASSERT_EQ(depth.size(), RENDERABLE_COUNT);
+
+    // move one renderable by a few millimeters, only the low bits of its distance change
+    soa.data<FScene::WORLD_AABB_CENTER>()[5].z -= 0.005f;
+
+    // the depth keys use the whole distance, the cached commands must be regenerated
+    const std::vector<Command> movedDepth = generate(RenderPass::DEPTH, &depthCache);
+    EXPECT_EQ(depthCache.getRegeneratedRenderableCount(), 1);
+    expectSameKeys(generate(RenderPass::DEPTH, nullptr), movedDepth);
+    auto findKey = [](std::vector<Command> const& commands, uint16_t index) {
+        auto pos = std::find_if(commands.begin(), commands.end(),
+                [index](Command const& c) { return c.primitive.index == index; });
+        return pos != commands.end() ? pos->key : uint64_t(RenderPass::Pass::SENTINEL);
+    };
+    EXPECT_NE(findKey(depth, 5), findKey(movedDepth, 5));
+
+    // the opaque color keys only use the Z-bucket, which didn't change
+    const std::vector<Command> movedColor = generate(RenderPass::COLOR, &colorCache);
+    EXPECT_EQ(colorCache.getRegeneratedRenderableCount(), 0);
+    expectSameKeys(generate(RenderPass::COLOR, nullptr), movedColor);
+
+    Engine::destroy((Engine **)&engine);
+}
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <random>
 
@@ -28,18 +29,27 @@
 #include <filament/Box.h>
 #include <filament/Camera.h>
 #include <filament/Color.h>
+#include <filament/ColorGrading.h>
 #include <filament/Frustum.h>
 #include <filament/Material.h>
 #include <filament/Engine.h>
+#include <filament/TextureSampler.h>
 
 #include <private/filament/UniformInterfaceBlock.h>
 #include <private/filament/UibGenerator.h>
 #include <private/backend/BackendUtils.h>
 
+#include <utils/JobSystem.h>
+
 #include "details/Allocators.h"
 #include "details/Material.h"
+#include "details/MaterialInstance.h"
+#include "details/Texture.h"
 #include "details/Camera.h"
+#include "details/CullingBvh.h"
 #include "details/Froxelizer.h"
+#include "details/OcclusionCuller.h"
+#include "details/View.h"
 #include "details/Engine.h"
 #include "components/RenderableManager.h"
 #include "components/TransformManager.h"
@@ -277,6 +287,56 @@ TEST(FilamentTest, TransformManager) {
     EXPECT_EQ(c, tcm.getChildCount(newParent));
 }
 
+TEST(FilamentTest, TransformManagerParallelCommit) {
+    JobSystem js;
+    js.adopt();
+
+    constexpr size_t COUNT = 4096;
+    EntityManager& em = EntityManager::get();
+    std::vector<Entity> entities(COUNT);
+    em.create(entities.size(), entities.data());
+
+    // a binary tree, where each parent is created after its children to test the reordering
+    filament::FTransformManager serial;
+    filament::FTransformManager parallel;
+    parallel.setJobSystem(&js);
+    parallel.setParallelCommitEnabled(true);
+    for (FTransformManager* tcm : { &serial, &parallel }) {
+        for (size_t i = COUNT; i-- > 0;) {
+            tcm->create(entities[i]);
+        }
+        for (size_t i = 1; i < COUNT; i++) {
+            tcm->setParent(tcm->getInstance(entities[i]), tcm->getInstance(entities[(i - 1) / 2]));
+        }
+    }
+
+    std::default_random_engine generator(82828); // NOLINT
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<mat4f> transforms(COUNT);
+    for (mat4f& m : transforms) {
+        m = mat4f::translation(float3{ distribution(generator), distribution(generator), 0 }) *
+            mat4f::rotation(distribution(generator), float3{ 0, 0, 1 });
+    }
+
+    for (FTransformManager* tcm : { &serial, &parallel }) {
+        tcm->openLocalTransformTransaction();
+        for (size_t i = 0; i < COUNT; i++) {
+            tcm->setTransform(tcm->getInstance(entities[i]), transforms[i]);
+        }
+        tcm->commitLocalTransformTransaction();
+    }
+
+    for (size_t i = 0; i < COUNT; i++) {
+        auto si = serial.getInstance(entities[i]);
+        auto pi = parallel.getInstance(entities[i]);
+        EXPECT_EQ(serial.getWorldTransform(si), parallel.getWorldTransform(pi));
+        EXPECT_LT(parallel.getInstance(parallel.getParent(pi)), pi);
+    }
+
+    em.destroy(entities.size(), entities.data());
+    js.emancipate();
+}
+
 TEST(FilamentTest, UniformInterfaceBlock) {
 
     UniformInterfaceBlock::Builder b;
@@ -501,6 +561,153 @@ TEST(FilamentTest, UniformBufferSize2) {
     buffer.invalidate();
 }
 
+TEST(FilamentTest, UniformBufferDirtyRange) {
+    UniformBuffer buffer(64);
+
+    // a new buffer must be uploaded entirely
+    EXPECT_TRUE(buffer.isDirty());
+    EXPECT_EQ(0, buffer.getDirtyOffset());
+    EXPECT_EQ(64, buffer.getDirtySize());
+
+    buffer.clean();
+    EXPECT_FALSE(buffer.isDirty());
+
+    // the dirty range grows to contain every modified uniform
+    buffer.setUniform(16, float4{ 1.0f });
+    EXPECT_TRUE(buffer.isDirty());
+    EXPECT_EQ(16, buffer.getDirtyOffset());
+    EXPECT_EQ(16, buffer.getDirtySize());
+
+    buffer.setUniform(40, 2.0f);
+    EXPECT_EQ(16, buffer.getDirtyOffset());
+    EXPECT_EQ(28, buffer.getDirtySize());
+
+    buffer.setUniform(8, 3.0f);
+    EXPECT_EQ(8, buffer.getDirtyOffset());
+    EXPECT_EQ(36, buffer.getDirtySize());
+
+    // the range starts over once cleaned
+    buffer.clean();
+    buffer.setUniform(60, 4.0f);
+    EXPECT_EQ(60, buffer.getDirtyOffset());
+    EXPECT_EQ(4, buffer.getDirtySize());
+
+    // moving the buffer keeps its range
+    UniformBuffer moved(std::move(buffer));
+    EXPECT_EQ(60, moved.getDirtyOffset());
+    EXPECT_EQ(4, moved.getDirtySize());
+
+    moved.invalidate();
+    EXPECT_EQ(0, moved.getDirtyOffset());
+    EXPECT_EQ(64, moved.getDirtySize());
+
+    // a mat3 takes three float4 columns, its last column must be part of the range
+    moved.clean();
+    const mat3f m{ float3{ 1, 2, 3 }, float3{ 4, 5, 6 }, float3{ 7, 8, 9 } };
+    moved.setUniform(16, m);
+    EXPECT_EQ(16, moved.getDirtyOffset());
+    EXPECT_EQ(48, moved.getDirtySize());
+    EXPECT_EQ(m, moved.getUniform<mat3f>(16));
+}
+
+TEST(FilamentTest, MaterialParameterHandles) {
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+
+    // the skybox material has a few uniforms and a sampler, the default material is another one
+    FMaterial const* material = engine->getSkyboxMaterial();
+    FMaterialInstance* byName = material->createInstance(nullptr);
+    FMaterialInstance* byHandle = material->createInstance(nullptr);
+
+    auto expectSameParameters = [](FMaterialInstance const* a, FMaterialInstance const* b) {
+        UniformBuffer const& ua = a->getUniformBuffer();
+        UniformBuffer const& ub = b->getUniformBuffer();
+        ASSERT_EQ(ua.getSize(), ub.getSize());
+        EXPECT_EQ(0, memcmp(ua.getBuffer(), ub.getBuffer(), ua.getSize()));
+        backend::SamplerGroup const& sa = a->getSamplerGroup();
+        backend::SamplerGroup const& sb = b->getSamplerGroup();
+        ASSERT_EQ(sa.getSize(), sb.getSize());
+        for (size_t i = 0; i < sa.getSize(); i++) {
+            EXPECT_EQ(sa.getSamplers()[i].t, sb.getSamplers()[i].t);
+            EXPECT_EQ(sa.getSamplers()[i].s.u, sb.getSamplers()[i].s.u);
+        }
+    };
+
+    // unknown names give invalid handles
+    EXPECT_FALSE(material->getParameterHandle("doesNotExist").isValid());
+    EXPECT_FALSE(Material::ParameterHandle{}.isValid());
+
+    const Material::ParameterHandle color = material->getParameterHandle("color");
+    const Material::ParameterHandle showSun = material->getParameterHandle("showSun");
+    const Material::ParameterHandle skybox = material->getParameterHandle("skybox");
+    ASSERT_TRUE(color.isValid());
+    ASSERT_TRUE(showSun.isValid());
+    ASSERT_TRUE(skybox.isValid());
+    EXPECT_FALSE(color.isSampler());
+    EXPECT_TRUE(skybox.isSampler());
+
+    // a handle writes the same bytes as the name
+    byName->setParameter("color", float4{ 1, 2, 3, 4 });
+    byName->setParameter("showSun", int32_t(1));
+    byHandle->setParameter(color, float4{ 1, 2, 3, 4 });
+    byHandle->setParameter(showSun, int32_t(1));
+    expectSameParameters(byName, byHandle);
+    EXPECT_TRUE(byHandle->getUniformBuffer().isDirty());
+
+    FTexture* texture = upcast(Texture::Builder()
+            .width(1).height(1)
+            .sampler(Texture::Sampler::SAMPLER_CUBEMAP)
+            .format(Texture::InternalFormat::RGBA8)
+            .build(*engine));
+    const TextureSampler sampler(TextureSampler::MagFilter::NEAREST,
+            TextureSampler::WrapMode::MIRRORED_REPEAT);
+    byName->setParameter("skybox", texture, sampler);
+    byHandle->setParameter(skybox, texture, sampler);
+    expectSameParameters(byName, byHandle);
+    EXPECT_EQ(byHandle->getSamplerGroup().getSamplers()[0].t, texture->getHwHandle());
+
+    // batched updates are equivalent to one update per instance
+    constexpr size_t COUNT = 4;
+    MaterialInstance* instances[COUNT];
+    float4 colors[COUNT];
+    for (size_t i = 0; i < COUNT; i++) {
+        instances[i] = material->createInstance(nullptr);
+        colors[i] = float4{ float(i), 1, 2, 3 };
+    }
+    MaterialInstance::setParameters(instances, color, colors, COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        byName->setParameter("color", colors[i]);
+        expectSameParameters(byName, upcast(instances[i]));
+        engine->destroy(upcast(instances[i]));
+    }
+
+    // invalid handles, handles of another material and handles of the wrong kind are rejected
+    FMaterialInstance* other = engine->getDefaultMaterial()->createInstance(nullptr);
+#if defined(UTILS_EXCEPTIONS) || !defined(NDEBUG)
+    // the engine has threads running, the death tests must not fork them
+    testing::GTEST_FLAG(death_test_style) = "threadsafe";
+    EXPECT_DEATH(byHandle->setParameter(Material::ParameterHandle{}, 1.0f), "");
+    EXPECT_DEATH(byHandle->setParameter(material->getParameterHandle("doesNotExist"),
+            1.0f), "");
+    EXPECT_DEATH(other->setParameter(color, float4{ 5, 6, 7, 8 }), "");
+    EXPECT_DEATH(byHandle->setParameter(skybox, float4{ 5, 6, 7, 8 }), "");
+    EXPECT_DEATH(byHandle->setParameter(color, texture, sampler), "");
+#else
+    // without exceptions, release builds only log the error and ignore the call
+    byHandle->setParameter(Material::ParameterHandle{}, 1.0f);
+    other->setParameter(color, float4{ 5, 6, 7, 8 });
+    byHandle->setParameter(skybox, float4{ 5, 6, 7, 8 });
+    byHandle->setParameter(color, texture, sampler);
+    byName->setParameter("color", float4{ 1, 2, 3, 4 });
+    expectSameParameters(byName, byHandle);
+#endif
+
+    engine->destroy(other);
+    engine->destroy(byHandle);
+    engine->destroy(byName);
+    engine->destroy(texture);
+    Engine::destroy((Engine **)&engine);
+}
+
 TEST(FilamentTest, BoxCulling) {
     Frustum frustum(mat4f::frustum(-1, 1, -1, 1, 1, 100));
 
@@ -581,6 +788,206 @@ TEST(FilamentTest, SphereCulling) {
     EXPECT_TRUE(frustum.intersects({ 0, 200 }));
 }
 
+TEST(FilamentTest, CullingKernels) {
+    // The SIMD kernels don't evaluate the plane equations like the scalar one (e.g. they may use
+    // FMA), which can only make a difference within rounding error of a plane. Here, the planes
+    // are axis aligned and all coordinates are multiples of 1/64, so all the computations are
+    // exact and the kernels must agree, even for objects exactly touching a plane.
+    // The planes are set directly because normalizing them in Frustum isn't exact.
+    Frustum frustum;
+    float4* const planes = const_cast<float4*>(frustum.getNormalizedPlanes());
+    planes[0] = { -1,  0,  0, -4 };     // left
+    planes[1] = {  1,  0,  0, -4 };     // right
+    planes[2] = {  0, -1,  0, -4 };     // bottom
+    planes[3] = {  0,  1,  0, -4 };     // top
+    planes[4] = {  0,  0, -1, -9 };     // far
+    planes[5] = {  0,  0,  1,  1 };     // near
+
+    constexpr size_t COUNT = 1024;
+    std::vector<float4> spheres;
+    std::vector<float3> centers;
+    std::vector<float3> extents;
+    spheres.reserve(COUNT);
+    centers.reserve(COUNT);
+    extents.reserve(COUNT);
+
+    // objects overlapping each plane, touching it from the outside, and just outside of it
+    auto addObject = [&](float3 p, float size) {
+        spheres.push_back({ p, size });
+        centers.push_back(p);
+        extents.push_back(size);
+    };
+    for (float offset : { -0.25f, 0.0f, 0.25f }) {
+        const float d = 4.5f + offset;
+        addObject({ -d, 0, -5 }, 0.5f);
+        addObject({  d, 0, -5 }, 0.5f);
+        addObject({ 0, -d, -5 }, 0.5f);
+        addObject({ 0,  d, -5 }, 0.5f);
+        addObject({ 1, 2, -0.5f + offset }, 0.5f);
+        addObject({ 1, 2, -9.5f - offset }, 0.5f);
+    }
+
+    // and random objects, many of which intersect the frustum's planes
+    std::default_random_engine generator(82828); // NOLINT
+    std::uniform_int_distribution<int> position(-384, 384);
+    std::uniform_int_distribution<int> size(0, 128);
+    auto random = [&](std::uniform_int_distribution<int>& distribution) {
+        return float(distribution(generator)) / 64.0f;
+    };
+    while (spheres.size() < COUNT) {
+        const float3 p{ random(position), random(position), random(position) - 5.0f };
+        spheres.push_back({ p, random(size) });
+        centers.push_back(p);
+        extents.push_back({ random(size), random(size), random(size) });
+    }
+
+    constexpr Culler::Kernel kernels[] = {
+            Culler::Kernel::SSE2, Culler::Kernel::AVX2, Culler::Kernel::NEON };
+
+    std::vector<Culler::result_type> expected(COUNT, 0);
+    std::vector<Culler::result_type> results(COUNT, 0);
+    Culler::Test::intersects(Culler::Kernel::SCALAR,
+            expected.data(), frustum, spheres.data(), COUNT);
+    for (Culler::Kernel kernel : kernels) {
+        if (Culler::Test::isSupported(kernel)) {
+            std::fill(results.begin(), results.end(), 0);
+            Culler::Test::intersects(kernel, results.data(), frustum, spheres.data(), COUNT);
+            EXPECT_EQ(expected, results) << "kernel " << int(kernel);
+        }
+    }
+
+    // an object touching a plane is not visible
+    for (size_t i = 0; i < 18; i++) {
+        EXPECT_EQ(expected[i], i < 6 ? 1 : 0) << "sphere " << i;
+    }
+
+    std::fill(expected.begin(), expected.end(), 0);
+    Culler::Test::intersects(Culler::Kernel::SCALAR,
+            expected.data(), frustum, centers.data(), extents.data(), COUNT);
+    for (Culler::Kernel kernel : kernels) {
+        if (Culler::Test::isSupported(kernel)) {
+            std::fill(results.begin(), results.end(), 0);
+            Culler::Test::intersects(kernel, results.data(), frustum,
+                    centers.data(), extents.data(), COUNT);
+            EXPECT_EQ(expected, results) << "kernel " << int(kernel);
+        }
+    }
+
+    for (size_t i = 0; i < 18; i++) {
+        EXPECT_EQ(expected[i], i < 6 ? 1 : 0) << "box " << i;
+    }
+}
+
+TEST(FilamentTest, HierarchicalCulling) {
+    Frustum frustum(mat4f::perspective(45.0f, 1.0f, 0.1f, 100.0f));
+
+    // a scene much larger than the frustum
+    constexpr size_t COUNT = 100000;
+    std::default_random_engine generator(82828); // NOLINT
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.1f, 5.0f);
+    std::vector<float3> centers(Culler::round(COUNT));
+    std::vector<float3> extents(Culler::round(COUNT));
+    for (size_t i = 0; i < COUNT; i++) {
+        centers[i] = { position(generator), position(generator), position(generator) };
+        extents[i] = { size(generator), size(generator), size(generator) };
+    }
+
+    CullingBvh bvh;
+    CullingBvh::Test::build(bvh, centers.data(), extents.data(), COUNT);
+
+    std::vector<Culler::result_type> expected(Culler::round(COUNT), 0);
+    Culler::intersects(expected.data(), frustum, centers.data(), extents.data(), COUNT, 0);
+
+    std::vector<Culler::result_type> serial(Culler::round(COUNT), 0);
+    CullingBvh::Test::cull(bvh, serial.data(), frustum, 0);
+
+    JobSystem js(3);
+    js.adopt();
+    std::vector<Culler::result_type> parallel(Culler::round(COUNT), 0);
+    CullingBvh::Test::cull(bvh, js, parallel.data(), frustum, 0);
+    js.emancipate();
+
+    // none of these boxes is within rounding error of a plane
+    EXPECT_EQ(expected, serial);
+    EXPECT_EQ(serial, parallel);
+    EXPECT_GT(std::count(serial.begin(), serial.end(), 1), 0);
+}
+
+TEST(FilamentTest, OcclusionCulling) {
+    const mat4f clipFromWorld = mat4f::frustum(-1, 1, -1, 1, 1, 100);
+
+    OcclusionCuller culler;
+    OcclusionCuller::Test::begin(culler, clipFromWorld, 64, 64);
+
+    // a wall 10 units away, covering the center of the screen
+    EXPECT_TRUE(OcclusionCuller::Test::rasterize(culler, mat4f{}, { { 0, 0, -10 }, { 5, 5, 0.5f } }));
+
+    // an occluder crossing the near plane is ignored
+    EXPECT_FALSE(OcclusionCuller::Test::rasterize(culler, mat4f{}, { { 0, 0, -1 }, { 1, 1, 1 } }));
+
+    OcclusionCuller::Test::buildHierarchy(culler);
+
+    float3 const center[] = {
+            { 0, 0, -20 },      // behind the wall
+            { 0, 0, -5 },       // in front of the wall
+            { 8, 0, -10 },      // beside the wall
+            { 0, 0, -10.2f },   // intersecting the wall
+            { 0, 0, -0.5f },    // crossing the near plane
+            { 2, 2, -50 },      // behind the wall
+    };
+    float3 const extent[] = {
+            { 1, 1, 1 }, { 1, 1, 1 }, { 1, 1, 1 }, { 1, 1, 1 }, { 1, 1, 1 }, { 1, 1, 1 },
+    };
+    Culler::result_type results[] = { 1, 1, 1, 1, 1, 1 };
+
+    const size_t culled = OcclusionCuller::Test::cull(culler, results, center, extent, 6, 0);
+
+    EXPECT_EQ(2, culled);
+    EXPECT_EQ(0, results[0]);
+    EXPECT_EQ(1, results[1]);
+    EXPECT_EQ(1, results[2]);
+    EXPECT_EQ(1, results[3]);
+    EXPECT_EQ(1, results[4]);
+    EXPECT_EQ(0, results[5]);
+}
+
+TEST(FilamentTest, OcclusionCullingConservative) {
+    const mat4f clipFromWorld = mat4f::frustum(-1, 1, -1, 1, 1, 100);
+
+    OcclusionCuller culler;
+    OcclusionCuller::Test::begin(culler, clipFromWorld, 64, 64);
+
+    // a thin wall 10 units away, whose right edge covers the left 3/4 of the pixel column 40
+    // (at that distance, one unit is 3.2 pixels)
+    EXPECT_TRUE(OcclusionCuller::Test::rasterize(culler, mat4f{},
+            { { 0, 0, -10 }, { 8.75f / 3.2f, 5, 0.01f } }));
+
+    // an occluder far off-screen
+    EXPECT_TRUE(OcclusionCuller::Test::rasterize(culler, mat4f{},
+            { { 1e9f, 0, -10 }, { 1, 1, 0.5f } }));
+
+    OcclusionCuller::Test::buildHierarchy(culler);
+
+    // at 20 units, one unit is 1.6 pixels
+    float3 const center[] = {
+            { 8.85f / 1.6f, 0, -20 },   // behind the uncovered part of the pixel column 40
+            { 3.5f / 1.6f, 0, -20 },    // behind fully covered pixels
+            { 0, 0, -20 },              // much wider than the screen
+    };
+    float3 const extent[] = {
+            { 0.04f, 0.04f, 0.1f }, { 0.04f, 0.04f, 0.1f }, { 1e12f, 0.04f, 0.1f },
+    };
+    Culler::result_type results[] = { 1, 1, 1 };
+
+    const size_t culled = OcclusionCuller::Test::cull(culler, results, center, extent, 3, 0);
+
+    EXPECT_EQ(1, culled);
+    EXPECT_EQ(1, results[0]);
+    EXPECT_EQ(0, results[1]);
+    EXPECT_EQ(1, results[2]);
+}
+
 TEST(FilamentTest, ColorConversion) {
     // Linear to Gamma
     // 0.0 stays 0.0
@@ -623,6 +1030,194 @@ TEST(FilamentTest, ColorConversion) {
 }
 
 
+TEST(FilamentTest, InstanceCullingShadowCasters) {
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    FScene* scene = engine->createScene();
+
+    // one instance in front of the camera, one far off-screen
+    const mat4f transforms[2] = {
+            mat4f::translation(float3{ 0, 0, -5 }),
+            mat4f::translation(float3{ 100, 0, -5 }) };
+    Entity entity = engine->getEntityManager().create();
+    engine->getTransformManager().create(entity);
+    RenderableManager::Builder(1)
+            .boundingBox({{ 0, 0, 0 }, { 0.5f, 0.5f, 0.5f }})
+            .castShadows(true)
+            .instances(2, transforms)
+            .build(*engine, entity);
+    scene->addEntity(entity);
+    scene->prepare(mat4f{});
+
+    auto& soa = scene->getRenderableData();
+    ASSERT_EQ(soa.size(), 1);
+    const Frustum frustum(mat4f::perspective(60, 1, 0.1, 100));
+
+    auto cull = [&](uint8_t visibleMask) {
+        soa.elementAt<FScene::VISIBLE_MASK>(0) = visibleMask;
+        soa.elementAt<FScene::INSTANCES>(0) = {};
+        scene->cullInstances({ 0, 1 }, &frustum);
+        return soa.elementAt<FScene::INSTANCES>(0).count;
+    };
+
+    // only visible by the camera, the off-screen instance is culled
+    EXPECT_EQ(1, cull(VISIBLE_RENDERABLE));
+
+    // the off-screen instance may cast a shadow in view, whether the renderable is visible or not
+    EXPECT_EQ(2, cull(VISIBLE_RENDERABLE | VISIBLE_DIR_SHADOW_RENDERABLE));
+    EXPECT_EQ(2, cull(VISIBLE_DIR_SHADOW_RENDERABLE));
+    EXPECT_EQ(VISIBLE_DIR_SHADOW_RENDERABLE, soa.elementAt<FScene::VISIBLE_MASK>(0));
+    EXPECT_EQ(2, cull(VISIBLE_SPOT_SHADOW_RENDERABLE_N(0)));
+
+    // when no instance is visible by the camera, a renderable that doesn't cast shadows is hidden
+    const mat4f offscreen[2] = {
+            mat4f::translation(float3{ -100, 0, -5 }),
+            mat4f::translation(float3{ 100, 0, -5 }) };
+    FRenderableManager& rcm = engine->getRenderableManager();
+    rcm.setInstanceTransforms(rcm.getInstance(entity), offscreen, 2);
+    EXPECT_EQ(2, cull(VISIBLE_DIR_SHADOW_RENDERABLE));
+    cull(VISIBLE_RENDERABLE);
+    EXPECT_EQ(0, soa.elementAt<FScene::VISIBLE_MASK>(0));
+
+    engine->getRenderableManager().destroy(entity);
+    engine->getEntityManager().destroy(entity);
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, DynamicLightOrder) {
+    FEngine* engine = FEngine::create(Engine::Backend::NOOP);
+    FScene* scene = engine->createScene();
+    FLightManager& lcm = engine->getLightManager();
+    auto& driver = engine->getDriverApi();
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+    utils::ArenaScope<LinearAllocatorArena> scope(arena);
+    auto lightUbh = driver.createUniformBuffer(CONFIG_MAX_LIGHT_COUNT * sizeof(LightsUib),
+            backend::BufferUsage::DYNAMIC);
+
+    // more positional lights than the GPU can handle, in front of the camera and shuffled so
+    // that the scene order isn't the distance order
+    constexpr size_t LIGHT_COUNT = CONFIG_MAX_LIGHT_COUNT + 64;
+    std::vector<float> distances(LIGHT_COUNT - 2);
+    for (size_t i = 0; i < distances.size(); i++) {
+        distances[i] = 3.0f + 0.25f * float(i);
+    }
+    std::shuffle(distances.begin(), distances.end(), std::default_random_engine(82828)); // NOLINT
+
+    // the first two lights are closer than all the others, 2cm apart
+    distances.insert(distances.begin(), { 2.00f, 2.02f });
+
+    std::vector<Entity> entities(LIGHT_COUNT);
+    engine->getEntityManager().create(LIGHT_COUNT, entities.data());
+    for (size_t i = 0; i < LIGHT_COUNT; i++) {
+        engine->getTransformManager().create(entities[i]);
+        LightManager::Builder(LightManager::Type::POINT)
+                .position({ 0, 0, -distances[i] })
+                .falloff(1.0f + float(i % 8))
+                .build(*engine, entities[i]);
+    }
+    scene->addEntities(entities.data(), entities.size());
+
+    const CameraInfo camera;
+
+    // gathers the lights like each frame, then returns the ones kept, in order
+    auto prepareLights = [&]() {
+        scene->prepare(mat4f{});
+        scene->prepareDynamicLights(camera, scope, lightUbh);
+        auto const& lightData = scene->getLightData();
+        std::vector<FLightManager::Instance> result;
+        for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT; i < lightData.size(); i++) {
+            // all the columns must have been permuted together
+            const auto li = lightData.elementAt<FScene::LIGHT_INSTANCE>(i);
+            const float4 sphere = lightData.elementAt<FScene::POSITION_RADIUS>(i);
+            EXPECT_EQ(sphere.xyz, lcm.getLocalPosition(li));
+            EXPECT_EQ(sphere.w, lcm.getRadius(li));
+            result.push_back(li);
+        }
+        return result;
+    };
+
+    auto getDistance = [&](FLightManager::Instance li) { return -lcm.getLocalPosition(li).z; };
+    auto indexOf = [&](std::vector<FLightManager::Instance> const& lights, Entity e) {
+        return std::find(lights.begin(), lights.end(), lcm.getInstance(e)) - lights.begin();
+    };
+
+    // the nearest lights are kept, sorted by distance
+    const auto sorted = prepareLights();
+    ASSERT_EQ(sorted.size(), CONFIG_MAX_LIGHT_COUNT);
+    for (size_t i = 1; i < sorted.size(); i++) {
+        EXPECT_LT(getDistance(sorted[i - 1]), getDistance(sorted[i]));
+    }
+    EXPECT_EQ(getDistance(sorted.back()), 3.0f + 0.25f * float(CONFIG_MAX_LIGHT_COUNT - 3));
+    EXPECT_EQ(indexOf(sorted, entities[0]), 0);
+    EXPECT_EQ(indexOf(sorted, entities[1]), 1);
+
+    // nothing moved, the previous order is reused
+    EXPECT_EQ(sorted, prepareLights());
+
+    // a light moves by 3cm, which changes the exact order, but isn't enough to sort again
+    lcm.setPosition(lcm.getInstance(entities[1]), { 0, 0, -1.99f });
+    const auto reused = prepareLights();
+    EXPECT_EQ(indexOf(reused, entities[0]), 0);
+    EXPECT_EQ(indexOf(reused, entities[1]), 1);
+
+    // the same light moves by more than 5cm since the last sort, the lights are sorted again
+    lcm.setPosition(lcm.getInstance(entities[1]), { 0, 0, -1.90f });
+    const auto resorted = prepareLights();
+    EXPECT_EQ(indexOf(resorted, entities[1]), 0);
+    EXPECT_EQ(indexOf(resorted, entities[0]), 1);
+
+    // when all the lights fit, they're not sorted and stay in the scene order
+    scene->removeEntities(entities.data() + CONFIG_MAX_LIGHT_COUNT, LIGHT_COUNT - CONFIG_MAX_LIGHT_COUNT);
+    scene->prepare(mat4f{});
+    std::vector<FLightManager::Instance> sceneOrder;
+    auto const& lightData = scene->getLightData();
+    for (size_t i = FScene::DIRECTIONAL_LIGHTS_COUNT; i < lightData.size(); i++) {
+        sceneOrder.push_back(lightData.elementAt<FScene::LIGHT_INSTANCE>(i));
+    }
+    ASSERT_EQ(sceneOrder.size(), CONFIG_MAX_LIGHT_COUNT);
+    EXPECT_EQ(sceneOrder, prepareLights());
+
+    driver.destroyUniformBuffer(lightUbh);
+    for (Entity e : entities) {
+        lcm.destroy(e);
+        engine->getTransformManager().destroy(e);
+    }
+    engine->getEntityManager().destroy(entities.size(), entities.data());
+    engine->destroy(scene);
+    Engine::destroy((Engine **)&engine);
+}
+
+TEST(FilamentTest, ColorGradingAsyncBuilds) {
+    Engine* engine = Engine::create(Engine::Backend::NOOP);
+
+    // the asynchronous builds need a LUT of the same size as a placeholder
+    ColorGrading* initial = ColorGrading::Builder().build(*engine);
+
+    // While a build waits for its jobs, its thread can run the other build, which must not wait
+    // for the first one to finish.
+    ColorGrading* first = ColorGrading::Builder()
+            .contrast(1.2f)
+            .asynchronous(true)
+            .build(*engine);
+    ColorGrading* second = ColorGrading::Builder()
+            .contrast(0.8f)
+            .asynchronous(true)
+            .build(*engine);
+
+    // and neither must a synchronous build made in the meantime
+    ColorGrading* synchronous = ColorGrading::Builder()
+            .saturation(0.5f)
+            .build(*engine);
+
+    // destroying the objects waits for their builds
+    engine->destroy(second);
+    engine->destroy(first);
+    engine->destroy(synchronous);
+    engine->destroy(initial);
+    Engine::destroy(&engine);
+}
+
 TEST(FilamentTest, FroxelData) {
     using namespace filament;
 
@@ -727,6 +1322,113 @@ TEST(FilamentTest, FroxelData) {
     Engine::destroy((Engine **)&engine);
 }
 
+TEST(FilamentTest, FroxelBinning) {
+    using namespace filament;
+
+    FEngine* engine = FEngine::create();
+
+    LinearAllocatorArena arena("FRenderer: per-frame allocator", FEngine::CONFIG_PER_RENDER_PASS_ARENA_SIZE);
+    utils::ArenaScope<LinearAllocatorArena> scope(arena);
+
+    Viewport vp(0, 0, 1280, 640);
+    mat4f p = mat4f::perspective(90, 1.0f, 0.1, 100, mat4f::Fov::HORIZONTAL);
+
+    // a mix of point and spot lights, more than the GPU can handle
+    constexpr size_t LIGHT_COUNT = CONFIG_MAX_LIGHT_COUNT + 64;
+    std::default_random_engine generator(82828); // NOLINT
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    auto random = [&]() { return distribution(generator); };
+
+    std::vector<Entity> entities(LIGHT_COUNT);
+    engine->getEntityManager().create(LIGHT_COUNT, entities.data());
+
+    FScene::LightSoa lights;
+    lights.push_back({}, {}, {}, {}, {}, {});   // first one is always skipped
+    for (size_t i = 0; i < LIGHT_COUNT; i++) {
+        const bool spot = (i % 2) == 1;
+        LightManager::Builder(spot ? LightManager::Type::SPOT : LightManager::Type::POINT)
+                .spotLightCone(0.2f, 0.5f)
+                .build(*engine, entities[i]);
+        LightManager::Instance instance = engine->getLightManager().getInstance(entities[i]);
+        float4 sphere{ 20.0f * random(), 10.0f * random(), -50.0f + 45.0f * random(), 4.0f + 3.0f * random() };
+        float3 direction = normalize(float3{ random(), random(), -1.0f });
+        lights.push_back(sphere, direction, instance, 1, {}, {});
+    }
+
+    auto getRecords = [](Froxelizer const& froxelizer, size_t i) {
+        auto const& entry = froxelizer.getFroxelBufferUser()[i];
+        auto const& records = froxelizer.getRecordBufferUser();
+        std::vector<size_t> result(records.begin() + entry.offset,
+                records.begin() + entry.offset + entry.count);
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+
+    // with as many lights as the bitsets can hold, both modes give the same records
+    lights.resize(CONFIG_MAX_LIGHT_COUNT + FScene::DIRECTIONAL_LIGHTS_COUNT);
+
+    Froxelizer bitset(*engine);
+    bitset.setOptions(5, 100);
+    bitset.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    bitset.froxelizeLights(*engine, {}, lights);
+
+    Froxelizer binned(*engine);
+    binned.setOptions(5, 100);
+    binned.setBinningEnabled(true);
+    binned.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    binned.froxelizeLights(*engine, {}, lights);
+
+    ASSERT_EQ(bitset.getFroxelCount(), binned.getFroxelCount());
+    auto const& offsets = binned.getFroxelLightOffsets();
+    auto const& froxelLights = binned.getFroxelLights();
+    ASSERT_EQ(offsets.size(), binned.getFroxelCount() + 1);
+    size_t total = 0;
+    for (size_t i = 0, c = binned.getFroxelCount(); i < c; i++) {
+        auto records = getRecords(bitset, i);
+        EXPECT_EQ(records, getRecords(binned, i));
+        std::vector<size_t> list(froxelLights.begin() + offsets[i], froxelLights.begin() + offsets[i + 1]);
+        EXPECT_EQ(records, list);
+        total += records.size();
+    }
+    EXPECT_GT(total, 0);
+
+    // when given more lights, the binned mode only sends the ones that fit in the light UBO
+    // to the GPU
+    lights.resize(1);
+    for (size_t i = 0; i < LIGHT_COUNT; i++) {
+        LightManager::Instance instance = engine->getLightManager().getInstance(entities[i]);
+        float4 sphere{ 20.0f * random(), 10.0f * random(), -50.0f + 45.0f * random(), 4.0f + 3.0f * random() };
+        lights.push_back(sphere, float3{ 0, 0, -1 }, instance, 1, {}, {});
+    }
+
+    binned.prepare(engine->getDriverApi(), scope, vp, p, 0.1, 100);
+    binned.froxelizeLights(*engine, {}, lights);
+
+    size_t beyondLimit = 0;
+    for (size_t i = 0, c = binned.getFroxelCount(); i < c; i++) {
+        auto const& list = binned.getFroxelLights();
+        auto const& froxelOffsets = binned.getFroxelLightOffsets();
+        std::vector<size_t> expected;
+        for (size_t k = froxelOffsets[i]; k < froxelOffsets[i + 1]; k++) {
+            if (list[k] < CONFIG_MAX_LIGHT_COUNT) {
+                expected.push_back(list[k]);
+            } else {
+                beyondLimit++;
+            }
+        }
+        EXPECT_EQ(expected, getRecords(binned, i));
+    }
+    EXPECT_GT(beyondLimit, 0);
+
+    bitset.terminate(engine->getDriverApi());
+    binned.terminate(engine->getDriverApi());
+    for (Entity e : entities) {
+        engine->getLightManager().destroy(e);
+    }
+
+    Engine::destroy((Engine **)&engine);
+}
+
 TEST(FilamentTest, Bones) {
 
     struct Shader {
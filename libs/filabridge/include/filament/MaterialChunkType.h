@@ -74,6 +74,7 @@ enum UTILS_PUBLIC ChunkType : uint64_t {
     MaterialCullingMode = charTo64bitNum("MAT_CUMO"),
 
     MaterialHasCustomDepthShader =charTo64bitNum("MAT_CSDP"),
+    MaterialInstanced = charTo64bitNum("MAT_INST"),
 
     MaterialVertexDomain = charTo64bitNum("MAT_VEDO"),
     MaterialInterpolation = charTo64bitNum("MAT_INTR"),
@@ -62,6 +62,10 @@ constexpr size_t CONFIG_MAX_SHADOW_CASCADES = 4;
 // We store 64 bytes per bone.
 constexpr size_t CONFIG_MAX_BONE_COUNT = 256;
 
+// This value is also limited by UBO size, ES3.0 only guarantees 16 KiB.
+// We store 112 bytes per instance, instanced renderables are drawn in batches of this size.
+constexpr size_t CONFIG_MAX_INSTANCES = 128;
+
 } // namespace filament
 
 #endif // TNT_FILAMENT_driver/EngineEnums.h
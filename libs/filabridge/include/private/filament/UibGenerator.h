@@ -33,6 +33,7 @@ public:
     static UniformInterfaceBlock const& getLightsUib() noexcept;
     static UniformInterfaceBlock const& getShadowUib() noexcept;
     static UniformInterfaceBlock const& getPerRenderableBonesUib() noexcept;
+    static UniformInterfaceBlock const& getPerRenderableInstancesUib() noexcept;
 };
 
 /*
@@ -178,6 +179,17 @@ struct PerRenderableUibBone {
     filament::math::float4 ns = { 1, 1, 1, 0 };
 };
 
+// This is not the UBO proper, but just an element of an instance array. The instances UBO
+// shares the binding point of the bones UBO, instanced renderables can't be skinned.
+struct PerRenderableUibInstance {
+    filament::math::mat4f worldFromModelMatrix;
+    filament::math::float4 worldFromModelNormalMatrix[3]; // a mat3 expanded to 48 bytes,
+                                                          // the instance index is stored in [0].w
+};
+
+static_assert(CONFIG_MAX_INSTANCES * sizeof(PerRenderableUibInstance) <= 16384,
+        "The instances UBO must fit in 16 KiB");
+
 } // namespace filament
 
 #endif // TNT_FILABRIDGE_UIBGENERATOR_H
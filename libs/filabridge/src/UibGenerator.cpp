@@ -154,4 +154,12 @@ UniformInterfaceBlock const& UibGenerator::getPerRenderableBonesUib() noexcept {
     return uib;
 }
 
+UniformInterfaceBlock const& UibGenerator::getPerRenderableInstancesUib() noexcept {
+    static UniformInterfaceBlock uib = UniformInterfaceBlock::Builder()
+            .name("InstancesUniforms")
+            .add("instances", CONFIG_MAX_INSTANCES * 7, UniformInterfaceBlock::Type::FLOAT4, Precision::HIGH)
+            .build();
+    return uib;
+}
+
 } // namespace filament
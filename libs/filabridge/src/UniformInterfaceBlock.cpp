@@ -123,6 +123,12 @@ ssize_t UniformInterfaceBlock::getUniformOffset(const char* name, size_t index)
     return mUniformsInfoList[pos->second].getBufferOffset(index);
 }
 
+UniformInterfaceBlock::UniformInfo const* UniformInterfaceBlock::getUniformInfo(
+        const char* name) const noexcept {
+    auto const& pos = mInfoMap.find(name);
+    return pos != mInfoMap.end() ? &mUniformsInfoList[pos->second] : nullptr;
+}
+
 
 uint8_t UTILS_NOINLINE UniformInterfaceBlock::baseAlignmentForType(UniformInterfaceBlock::Type type) noexcept {
     switch (type) {
@@ -382,6 +382,15 @@ public:
     //! The material output is multiplied by the shadowing factor (UNLIT model only).
     MaterialBuilder& shadowMultiplier(bool shadowMultiplier) noexcept;
 
+    /**
+     * Makes the material usable by instanced renderables, see
+     * filament::RenderableManager::Builder::instances(). getWorldFromModelMatrix() and
+     * getWorldFromModelNormalMatrix() return the transforms of the instance being drawn, and
+     * getInstanceIndex() returns its index. An instanced material can only be used by instanced
+     * renderables, and has no skinning or morphing variants.
+     */
+    MaterialBuilder& instanced(bool instanced) noexcept;
+
     /**
      * Reduces specular aliasing for materials that have low roughness. Turning this feature on also
      * helps preserve the shapes of specular highlights as an object moves away from the camera.
@@ -663,6 +672,7 @@ private:
     float mSpecularAntiAliasingThreshold = 0.2f;
 
     bool mShadowMultiplier = false;
+    bool mInstanced = false;
 
     uint8_t mParameterCount = 0;
 
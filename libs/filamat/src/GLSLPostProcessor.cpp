@@ -331,6 +331,8 @@ void GLSLPostProcessor::fullOptimization(const TShader& tShader,
         glslOptions.es = config.shaderModel == filament::backend::ShaderModel::GL_ES_30;
         glslOptions.version = shaderVersionFromModel(config.shaderModel);
         glslOptions.enable_420pack_extension = glslOptions.version >= 420;
+        // we always draw with a base instance of 0, gl_InstanceIndex is simply gl_InstanceID
+        glslOptions.vertex.support_nonzero_base_instance = false;
         glslOptions.fragment.default_float_precision = glslOptions.es ?
                 CompilerGLSL::Options::Precision::Mediump : CompilerGLSL::Options::Precision::Highp;
         glslOptions.fragment.default_int_precision = glslOptions.es ?
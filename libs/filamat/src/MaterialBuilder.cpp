@@ -314,6 +314,11 @@ MaterialBuilder& MaterialBuilder::shadowMultiplier(bool shadowMultiplier) noexce
     return *this;
 }
 
+MaterialBuilder& MaterialBuilder::instanced(bool instanced) noexcept {
+    mInstanced = instanced;
+    return *this;
+}
+
 MaterialBuilder& MaterialBuilder::specularAntiAliasing(bool specularAntiAliasing) noexcept {
     mSpecularAntiAliasing = specularAntiAliasing;
     return *this;
@@ -450,6 +455,7 @@ void MaterialBuilder::prepareToBuild(MaterialInfo& info) noexcept {
     info.specularAntiAliasing = mSpecularAntiAliasing;
     info.clearCoatIorChange = mClearCoatIorChange;
     info.flipUV = mFlipUV;
+    info.isInstanced = mInstanced;
     info.requiredAttributes = mRequiredAttributes;
     info.blendingMode = mBlendingMode;
     info.postLightingBlendingMode = mPostLightingBlendingMode;
@@ -626,8 +632,10 @@ bool MaterialBuilder::generateShaders(JobSystem& jobSystem, const std::vector<Va
             mMaterialVertexCode.getLineOffset(), mMaterialDomain);
 
     bool emptyVertexCode = mMaterialVertexCode.getResolved().empty();
+    // instanced materials can't use the depth variants of the default material, which
+    // ignore the instances
     bool customDepth = sg.hasCustomDepthShader() ||
-            mBlendingMode == BlendingMode::MASKED || !emptyVertexCode;
+            mBlendingMode == BlendingMode::MASKED || !emptyVertexCode || mInstanced;
     container.addSimpleChild<bool>(ChunkType::MaterialHasCustomDepthShader, customDepth);
 
     std::atomic_bool cancelJobs(false);
@@ -902,9 +910,12 @@ Package MaterialBuilder::build(JobSystem& jobSystem) noexcept {
         writeSurfaceChunks(container);
     }
 
-    // Generate all shaders and write the shader chunks.
+    // Generate all shaders and write the shader chunks. Instanced renderables can't be skinned,
+    // and the instances use the binding point of the bones.
+    const uint8_t variantFilter = mInstanced ?
+            uint8_t(mVariantFilter | filament::Variant::SKINNING_OR_MORPHING) : mVariantFilter;
     const auto variants = mMaterialDomain == MaterialDomain::SURFACE ?
-        determineSurfaceVariants(mVariantFilter, isLit(), mShadowMultiplier) :
+        determineSurfaceVariants(variantFilter, isLit(), mShadowMultiplier) :
         determinePostProcessVariants();
     bool success = generateShaders(jobSystem, variants, container, info);
 
@@ -994,6 +1005,7 @@ void MaterialBuilder::writeSurfaceChunks(ChunkContainer& container) const noexce
     }
 
     container.addSimpleChild<bool>(ChunkType::MaterialClearCoatIorChange, mClearCoatIorChange);
+    container.addSimpleChild<bool>(ChunkType::MaterialInstanced, mInstanced);
     container.addSimpleChild<uint32_t>(ChunkType::MaterialRequiredAttributes, mRequiredAttributes.getValue());
     container.addSimpleChild<bool>(ChunkType::MaterialSpecularAntiAliasing, mSpecularAntiAliasing);
     container.addSimpleChild<float>(ChunkType::MaterialSpecularAntiAliasingVariance, mSpecularAntiAliasingVariance);
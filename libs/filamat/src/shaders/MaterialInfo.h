@@ -40,6 +40,7 @@ struct UTILS_PUBLIC MaterialInfo {
     bool specularAntiAliasing;
     bool clearCoatIorChange;
     bool flipUV;
+    bool isInstanced;
     bool multiBounceAO;
     bool multiBounceAOSet;
     bool specularAOSet;
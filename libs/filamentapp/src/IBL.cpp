@@ -18,7 +18,9 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <filament/Engine.h>
 #include <filament/Material.h>
@@ -61,20 +63,38 @@ bool IBL::loadFromKtx(const std::string& prefix) {
         return false;
     }
 
+    // The bundles are views of the file contents, so that the (possibly large) cubemaps are not
+    // copied. The contents are freed once the textures have been uploaded.
+    struct KtxFile {
+        std::vector<uint8_t> contents;
+        std::unique_ptr<KtxBundle> ktx;
+    };
+
     auto createKtx = [] (Path path) {
         using namespace std;
         ifstream file(path.getPath(), ios::binary);
-        vector<uint8_t> contents((istreambuf_iterator<char>(file)), {});
-        return new image::KtxBundle(contents.data(), contents.size());
+        auto* ktxFile = new KtxFile{ vector<uint8_t>((istreambuf_iterator<char>(file)), {}) };
+        ktxFile->ktx = make_unique<KtxBundle>(ktxFile->contents.data(),
+                uint32_t(ktxFile->contents.size()), KtxBundle::Storage::VIEW);
+        return ktxFile;
     };
 
-    KtxBundle* iblKtx = createKtx(iblPath);
-    KtxBundle* skyKtx = createKtx(skyPath);
+    auto createTexture = [this] (KtxFile* ktxFile) {
+        return ktx::createTexture(&mEngine, *ktxFile->ktx, false, [](void* userdata) {
+            delete (KtxFile*) userdata;
+        }, ktxFile);
+    };
+
+    KtxFile* iblKtx = createKtx(iblPath);
+    KtxFile* skyKtx = createKtx(skyPath);
+
+    // the spherical harmonics must be read before the bundle can be freed by the upload
+    const bool hasSphericalHarmonics = iblKtx->ktx->getSphericalHarmonics(mBands);
 
-    mSkyboxTexture = ktx::createTexture(&mEngine, skyKtx, false);
-    mTexture = ktx::createTexture(&mEngine, iblKtx, false);
+    mSkyboxTexture = createTexture(skyKtx);
+    mTexture = createTexture(iblKtx);
 
-    if (!iblKtx->getSphericalHarmonics(mBands)) {
+    if (!hasSphericalHarmonics) {
         return false;
     }
 
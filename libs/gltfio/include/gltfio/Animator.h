@@ -42,17 +42,40 @@ public:
      * Applies rotation, translation, and scale to entities that have been targeted by the given
      * animation definition. Uses filament::TransformManager.
      *
+     * The animator caches which keyframes were used by the previous call to speed up the next one,
+     * so the same animator must not be used from several threads at once, even though this method
+     * is const. This cache never changes the result.
+     *
      * @param animationIndex Zero-based index for the \c animation of interest.
      * @param time Elapsed time of interest in seconds.
      */
     void applyAnimation(size_t animationIndex, float time) const;
 
+    /**
+     * Applies several animations at once, typically to many instances of an asset. This has the
+     * same effect as calling applyAnimation() for each animator in order, but is faster because
+     * all the channels are evaluated before any filament::TransformManager update.
+     *
+     * A given animation of a given animator must not appear more than once.
+     *
+     * @param animators Array of \c count animators.
+     * @param animationIndices Array of \c count zero-based indices, one per animator.
+     * @param times Array of \c count elapsed times in seconds, one per animator.
+     * @param count Number of animations to apply.
+     */
+    static void applyAnimations(const Animator* const* animators, const size_t* animationIndices,
+            const float* times, size_t count);
+
     /**
      * Computes root-to-node transforms for all bone nodes, then passes
      * the results into filament::RenderableManager::setBones.
      * Uses filament::TransformManager and filament::RenderableManager.
      *
      * NOTE: this operation is independent of \c animation.
+     *
+     * With many joints, the matrices are computed in parallel with the Engine's
+     * utils::JobSystem when this is called from a thread adopted by it, such as the thread that
+     * created the Engine. On other threads they're computed serially.
      */
     void updateBoneMatrices();
 
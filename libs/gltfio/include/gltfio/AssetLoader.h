@@ -152,6 +152,20 @@ public:
      */
     FilamentAsset* createAssetFromBinary(const uint8_t* bytes, uint32_t nbytes);
 
+    /**
+     * Memory-maps a JSON-based or GLB glTF 2.0 file and returns a bundle of Filament objects.
+     * Returns null on failure.
+     *
+     * Unlike createAssetFromBinary, the binary chunk of GLB files is not copied: the vertex and
+     * index data are uploaded straight from the mapped file, which stays mapped until the source
+     * data of the asset is released (see FilamentAsset::releaseSourceData) and all the uploads
+     * have completed. To also map the external buffers of JSON-based files, see
+     * ResourceConfiguration::memoryMapBuffers.
+     *
+     * This is not supported on WebGL.
+     */
+    FilamentAsset* createAssetFromFile(const char* path);
+
     /**
      * Consumes the contents of a glTF 2.0 file and produces a primary asset with one or more
      * instances. The primary asset has ownership over the instances.
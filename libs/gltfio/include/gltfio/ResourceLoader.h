@@ -50,6 +50,20 @@ struct ResourceConfiguration {
     //! If true, computes the bounding boxes of all \c POSITION attibutes. Well formed glTF files
     //! do not need this, but it is useful for robustness.
     bool recomputeBoundingBoxes;
+
+    //! If true, the external buffers (e.g. \c .bin files) are memory-mapped rather than read
+    //! into memory, and the vertex and index data are uploaded straight from the mapped files.
+    //! This reduces the peak memory usage when loading large assets. The files stay mapped until
+    //! the source data of the asset is released and all the uploads have completed. This is only
+    //! supported on platforms with a file system, and ignored for resources added with
+    //! #addResourceData. See also AssetLoader::createAssetFromFile.
+    bool memoryMapBuffers = false;
+
+    //! Maximum size in bytes of the decoded texels that are held in memory before being uploaded
+    //! to the GPU. Textures are decoded concurrently on the JobSystem until this budget is
+    //! reached, and the remaining ones are decoded as the others get uploaded. A texture larger
+    //! than the budget is decoded on its own. Zero means no limit.
+    size_t textureDecodeBudget = 64 * 1024 * 1024;
 };
 
 /**
@@ -25,6 +25,7 @@
 #include <filament/RenderableManager.h>
 #include <filament/TransformManager.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Log.h>
 
 #include <math/mat4.h>
@@ -33,8 +34,9 @@
 #include <math/vec3.h>
 #include <math/vec4.h>
 
-#include <map>
+#include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using namespace filament;
@@ -44,12 +46,12 @@ using namespace utils;
 
 namespace gltfio {
 
-using TimeValues = std::map<float, size_t>;
+using TimeValues = std::vector<float>;
 using SourceValues = std::vector<float>;
 using BoneVector = std::vector<filament::math::mat4f>;
 
 struct Sampler {
-    TimeValues times;
+    TimeValues times; // sorted
     SourceValues values;
     enum { LINEAR, STEP, CUBIC } interpolation;
 };
@@ -57,34 +59,79 @@ struct Sampler {
 struct Channel {
     const Sampler* sourceData;
     utils::Entity targetEntity;
+    uint32_t target; // index into Animation::targets
+
+    // Keyframe found by the previous evaluation. This is only a search hint, it doesn't change
+    // the result of an evaluation, which is why it can be updated by Animator's const methods.
+    mutable uint32_t cursor;
     enum { TRANSLATION, ROTATION, SCALE, WEIGHTS } transformType;
 };
 
+// Values computed for the nodes targeted by an animation, before they're applied to the
+// TransformManager and RenderableManager. Each node is only decomposed and recomposed once, no
+// matter how many of its properties are animated.
+struct Targets {
+    enum : uint8_t { TRANSLATION = 0x1, ROTATION = 0x2, SCALE = 0x4, WEIGHTS = 0x8 };
+    vector<utils::Entity> entities;
+    vector<float3> translations;
+    vector<quatf> rotations;
+    vector<float3> scales;
+    vector<float4> weights;
+    vector<uint8_t> animated; // which of the above are set for each node
+};
+
 struct Animation {
     float duration;
     std::string name;
     vector<Sampler> samplers;
     vector<Channel> channels;
+
+    // Scratch values written by each evaluation and consumed right away, they're not part of the
+    // observable state of the Animator.
+    mutable Targets targets;
+};
+
+// Skinning data of all the skins handled by an animator, flattened so that bone matrices can be
+// computed in parallel. Each skin's joints and each target's bones are contiguous.
+struct Skinning {
+    struct Target {
+        utils::Entity entity;
+        uint32_t firstJoint;
+        uint32_t jointCount;
+        uint32_t firstBone;
+    };
+    vector<utils::Entity> joints;
+    vector<mat4f> inverseBindMatrices;  // one per joint
+    vector<TransformManager::Instance> jointInstances;
+    vector<mat4f> jointMatrices;        // world transform * inverse bind matrix, one per joint
+    vector<Target> targets;
+    vector<RenderableManager::Instance> renderables; // one per target
+    vector<size_t> boneCounts;                       // one per target
+    vector<TransformManager::Instance> targetInstances;
+    BoneVector boneMatrices;
+    bool dirty = true;
 };
 
 struct AnimatorImpl {
     vector<Animation> animations;
-    BoneVector boneMatrices;
+    Skinning skinning;
     FFilamentAsset* asset = nullptr;
     FFilamentInstance* instance = nullptr;
     RenderableManager* renderableManager;
     TransformManager* transformManager;
 };
 
-static void createSampler(const cgltf_animation_sampler& src, Sampler& dst) {
-    // Copy the time values into a red-black tree.
-    const cgltf_accessor* timelineAccessor = src.input;
+static const float* getTimeValues(const cgltf_accessor* timelineAccessor) {
     const uint8_t* timelineBlob = (const uint8_t*) timelineAccessor->buffer_view->buffer->data;
-    const float* timelineFloats = (const float*) (timelineBlob + timelineAccessor->offset +
+    return (const float*) (timelineBlob + timelineAccessor->offset +
             timelineAccessor->buffer_view->offset);
-    for (size_t i = 0, len = timelineAccessor->count; i < len; ++i) {
-        dst.times[timelineFloats[i]] = i;
-    }
+}
+
+static void createSampler(const cgltf_animation_sampler& src, Sampler& dst) {
+    // Copy the time values into a contiguous array, they've been validated to be sorted.
+    const cgltf_accessor* timelineAccessor = src.input;
+    const float* timelineFloats = getTimeValues(timelineAccessor);
+    dst.times.assign(timelineFloats, timelineFloats + timelineAccessor->count);
 
     // Convert source data to float.
     const cgltf_accessor* valuesAccessor = src.output;
@@ -160,6 +207,10 @@ static bool validateAnimation(const cgltf_animation& anim) {
         if (sampler->input->count * components * values != sampler->output->count) {
             return false;
         }
+        const float* times = getTimeValues(sampler->input);
+        if (!std::is_sorted(times, times + sampler->input->count)) {
+            return false;
+        }
     }
     return true;
 }
@@ -187,11 +238,33 @@ static void addChannels(const NodeMap& nodeMap, const cgltf_animation& srcAnim,
         Channel dstChannel;
         dstChannel.sourceData = samplers + (srcChannel.sampler - srcSamplers);
         dstChannel.targetEntity = targetEntity;
+        dstChannel.target = 0;
+        dstChannel.cursor = 0;
         setTransformType(srcChannel, dstChannel);
         dst.channels.push_back(dstChannel);
     }
 }
 
+// Gathers the nodes targeted by the channels of an animation.
+static void createTargets(Animation& anim) {
+    Targets& targets = anim.targets;
+    std::unordered_map<utils::Entity, uint32_t> indices;
+    targets.entities.clear();
+    for (Channel& channel : anim.channels) {
+        auto result = indices.emplace(channel.targetEntity, uint32_t(targets.entities.size()));
+        if (result.second) {
+            targets.entities.push_back(channel.targetEntity);
+        }
+        channel.target = result.first->second;
+    }
+    const size_t count = targets.entities.size();
+    targets.translations.resize(count);
+    targets.rotations.resize(count);
+    targets.scales.resize(count);
+    targets.weights.resize(count);
+    targets.animated.resize(count);
+}
+
 Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
     assert(asset->mResourcesLoaded && asset->mSourceAsset);
     mImpl = new AnimatorImpl();
@@ -228,7 +301,7 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
             Sampler& dstSampler = dstAnim.samplers[j];
             createSampler(srcSampler, dstSampler);
             if (dstSampler.times.size() > 1) {
-                float maxtime = (--dstSampler.times.end())->first;
+                float maxtime = dstSampler.times.back();
                 dstAnim.duration = std::max(dstAnim.duration, maxtime);
             }
         }
@@ -243,6 +316,7 @@ Animator::Animator(FFilamentAsset* asset, FFilamentInstance* instance) {
                 addChannels(instance->nodeMap, srcAnim, dstAnim);
             }
         }
+        createTargets(dstAnim);
     }
 }
 
@@ -253,7 +327,9 @@ void Animator::addInstance(FFilamentInstance* instance) {
         const cgltf_animation& srcAnim = srcAnims[i];
         Animation& dstAnim = mImpl->animations[i];
         addChannels(instance->nodeMap, srcAnim, dstAnim);
+        createTargets(dstAnim);
     }
+    mImpl->skinning.dirty = true;
 }
 
 Animator::~Animator() {
@@ -264,39 +340,56 @@ size_t Animator::getAnimationCount() const {
     return mImpl->animations.size();
 }
 
-void Animator::applyAnimation(size_t animationIndex, float time) const {
-    const Animation& anim = mImpl->animations[animationIndex];
-    TransformManager* transformManager = mImpl->transformManager;
-    RenderableManager* renderableManager = mImpl->renderableManager;
+// Returns the index of the first keyframe at or after the given time, or times.size() if there
+// is none, like std::lower_bound. The search starts from the result of the previous call, which
+// makes it constant time when the animation plays forward.
+static size_t findNextKeyframe(const TimeValues& times, float time, uint32_t& cursor) {
+    const size_t count = times.size();
+    size_t next = std::min(size_t(cursor), count);
+    if (next > 0 && times[next - 1] >= time) {
+        // We went backward, e.g. the animation looped.
+        next = std::lower_bound(times.begin(), times.begin() + next, time) - times.begin();
+    } else {
+        // Check the next few keyframes before falling back to a binary search.
+        for (size_t end = std::min(next + 4, count); next < end && times[next] < time; ++next) {}
+        if (next < count && times[next] < time) {
+            next = std::lower_bound(times.begin() + next, times.end(), time) - times.begin();
+        }
+    }
+    cursor = uint32_t(next);
+    return next;
+}
+
+// Evaluates all the channels of an animation, without touching any Filament component.
+static void sampleAnimation(const Animation& anim, float time) {
+    Targets& targets = anim.targets;
+    std::fill(targets.animated.begin(), targets.animated.end(), 0);
     time = fmod(time, anim.duration);
     for (const auto& channel : anim.channels) {
         const Sampler* sampler = channel.sourceData;
-        if (sampler->times.size() < 2) {
+        const TimeValues& times = sampler->times;
+        if (times.size() < 2) {
             continue;
         }
 
-        TransformManager::Instance node = transformManager->getInstance(channel.targetEntity);
-        const TimeValues& times = sampler->times;
-
         // Find the first keyframe after the given time, or the keyframe that matches it exactly.
-        TimeValues::const_iterator iter = times.lower_bound(time);
+        const size_t next = findNextKeyframe(times, time, channel.cursor);
 
         // Compute the interpolant (between 0 and 1) and determine the keyframe pair.
         float t = 0.0f;
         size_t nextIndex;
         size_t prevIndex;
-        if (iter == times.end()) {
+        if (next == times.size()) {
             nextIndex = times.size() - 1;
             prevIndex = nextIndex;
-        } else if (iter == times.begin()) {
+        } else if (next == 0) {
             nextIndex = 0;
             prevIndex = 0;
         } else {
-            TimeValues::const_iterator prev = iter; --prev;
-            nextIndex = iter->second;
-            prevIndex = prev->second;
-            const float nextTime = iter->first;
-            const float prevTime = prev->first;
+            nextIndex = next;
+            prevIndex = next - 1;
+            const float nextTime = times[nextIndex];
+            const float prevTime = times[prevIndex];
             float deltaTime = nextTime - prevTime;
             assert(deltaTime >= 0);
             if (deltaTime > 0) {
@@ -304,19 +397,11 @@ void Animator::applyAnimation(size_t animationIndex, float time) const {
             }
         }
 
-        // Perform the interpolation. This is a simple but inefficient implementation; Filament
-        // stores transforms as mat4's but glTF animation is based on TRS (translation rotation
-        // scale).
-        mat4f xform = transformManager->getTransform(node);
-        float3 scale;
-        quatf rotation;
-        float3 translation;
-        decomposeMatrix(xform, &translation, &rotation, &scale);
-
         if (sampler->interpolation == Sampler::STEP) {
             t = 0.0f;
         }
 
+        const uint32_t target = channel.target;
         switch (channel.transformType) {
 
             case Channel::SCALE: {
@@ -326,10 +411,11 @@ void Animator::applyAnimation(size_t animationIndex, float time) const {
                     float3 tang0 = srcVec3[prevIndex * 3 + 2];
                     float3 tang1 = srcVec3[nextIndex * 3];
                     float3 vert1 = srcVec3[nextIndex * 3 + 1];
-                    scale = cubicSpline(vert0, tang0, vert1, tang1, t);
+                    targets.scales[target] = cubicSpline(vert0, tang0, vert1, tang1, t);
                 } else {
-                    scale = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+                    targets.scales[target] = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
                 }
+                targets.animated[target] |= Targets::SCALE;
                 break;
             }
 
@@ -340,10 +426,12 @@ void Animator::applyAnimation(size_t animationIndex, float time) const {
                     float3 tang0 = srcVec3[prevIndex * 3 + 2];
                     float3 tang1 = srcVec3[nextIndex * 3];
                     float3 vert1 = srcVec3[nextIndex * 3 + 1];
-                    translation = cubicSpline(vert0, tang0, vert1, tang1, t);
+                    targets.translations[target] = cubicSpline(vert0, tang0, vert1, tang1, t);
                 } else {
-                    translation = ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
+                    targets.translations[target] =
+                            ((1 - t) * srcVec3[prevIndex]) + (t * srcVec3[nextIndex]);
                 }
+                targets.animated[target] |= Targets::TRANSLATION;
                 break;
             }
 
@@ -354,10 +442,11 @@ void Animator::applyAnimation(size_t animationIndex, float time) const {
                     quatf tang0 = srcQuat[prevIndex * 3 + 2];
                     quatf tang1 = srcQuat[nextIndex * 3];
                     quatf vert1 = srcQuat[nextIndex * 3 + 1];
-                    rotation = normalize(cubicSpline(vert0, tang0, vert1, tang1, t));
+                    targets.rotations[target] = normalize(cubicSpline(vert0, tang0, vert1, tang1, t));
                 } else {
-                    rotation = slerp(srcQuat[prevIndex], srcQuat[nextIndex], t);
+                    targets.rotations[target] = slerp(srcQuat[prevIndex], srcQuat[nextIndex], t);
                 }
+                targets.animated[target] |= Targets::ROTATION;
                 break;
             }
 
@@ -391,58 +480,178 @@ void Animator::applyAnimation(size_t animationIndex, float time) const {
                     }
                 }
 
-                auto renderable = renderableManager->getInstance(channel.targetEntity);
-                renderableManager->setMorphWeights(renderable, weights);
-                continue;
+                targets.weights[target] = weights;
+                targets.animated[target] |= Targets::WEIGHTS;
+                break;
+            }
+        }
+    }
+}
+
+// Applies the values computed by sampleAnimation() to the targeted nodes.
+static void applyTargets(const Targets& targets, TransformManager* transformManager,
+        RenderableManager* renderableManager) {
+    for (size_t i = 0, n = targets.entities.size(); i < n; ++i) {
+        const uint8_t animated = targets.animated[i];
+        if (!animated) {
+            continue;
+        }
+
+        if (animated & Targets::WEIGHTS) {
+            auto renderable = renderableManager->getInstance(targets.entities[i]);
+            renderableManager->setMorphWeights(renderable, targets.weights[i]);
+        }
+
+        if (!(animated & (Targets::TRANSLATION | Targets::ROTATION | Targets::SCALE))) {
+            continue;
+        }
+
+        // Filament stores transforms as mat4's but glTF animation is based on TRS (translation
+        // rotation scale), so the properties that aren't animated come from the current transform.
+        TransformManager::Instance node = transformManager->getInstance(targets.entities[i]);
+        float3 scale;
+        quatf rotation;
+        float3 translation;
+        if ((animated & Targets::TRANSLATION) && (animated & Targets::ROTATION) &&
+                (animated & Targets::SCALE)) {
+            translation = targets.translations[i];
+            rotation = targets.rotations[i];
+            scale = targets.scales[i];
+        } else {
+            decomposeMatrix(transformManager->getTransform(node), &translation, &rotation, &scale);
+            if (animated & Targets::TRANSLATION) {
+                translation = targets.translations[i];
+            }
+            if (animated & Targets::ROTATION) {
+                rotation = targets.rotations[i];
+            }
+            if (animated & Targets::SCALE) {
+                scale = targets.scales[i];
             }
         }
+        transformManager->setTransform(node, composeMatrix(translation, rotation, scale));
+    }
+}
 
-        xform = composeMatrix(translation, rotation, scale);
-        transformManager->setTransform(node, xform);
+void Animator::applyAnimation(size_t animationIndex, float time) const {
+    const Animation& anim = mImpl->animations[animationIndex];
+    sampleAnimation(anim, time);
+    applyTargets(anim.targets, mImpl->transformManager, mImpl->renderableManager);
+}
+
+void Animator::applyAnimations(const Animator* const* animators, const size_t* animationIndices,
+        const float* times, size_t count) {
+    // Evaluate all the channels first, which only touches the animators' own data, then update
+    // the components.
+    for (size_t i = 0; i < count; ++i) {
+        const AnimatorImpl* impl = animators[i]->mImpl;
+        sampleAnimation(impl->animations[animationIndices[i]], times[i]);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const AnimatorImpl* impl = animators[i]->mImpl;
+        applyTargets(impl->animations[animationIndices[i]].targets,
+                impl->transformManager, impl->renderableManager);
+    }
+}
+
+static void createSkinning(const SkinVector& skins, Skinning& skinning) {
+    for (const auto& skin : skins) {
+        const uint32_t firstJoint = uint32_t(skinning.joints.size());
+        const uint32_t jointCount = uint32_t(skin.joints.size());
+        skinning.joints.insert(skinning.joints.end(), skin.joints.begin(), skin.joints.end());
+        skinning.inverseBindMatrices.insert(skinning.inverseBindMatrices.end(),
+                skin.inverseBindMatrices.begin(), skin.inverseBindMatrices.begin() + jointCount);
+        for (const auto& entity : skin.targets) {
+            const uint32_t firstBone = uint32_t(skinning.boneMatrices.size());
+            skinning.targets.push_back({ entity, firstJoint, jointCount, firstBone });
+            skinning.boneCounts.push_back(jointCount);
+            skinning.boneMatrices.resize(firstBone + jointCount);
+        }
     }
 }
 
 void Animator::updateBoneMatrices() {
     auto renderableManager = mImpl->renderableManager;
     auto transformManager = mImpl->transformManager;
+    Skinning& skinning = mImpl->skinning;
+
+    if (skinning.dirty) {
+        skinning = {};
+        if (mImpl->instance) {
+            createSkinning(mImpl->instance->skins, skinning);
+        } else if (!mImpl->asset->isInstanced()) {
+            createSkinning(mImpl->asset->mSkins, skinning);
+        } else {
+            for (FFilamentInstance* instance : mImpl->asset->mInstances) {
+                createSkinning(instance->skins, skinning);
+            }
+        }
+        skinning.jointInstances.resize(skinning.joints.size());
+        skinning.jointMatrices.resize(skinning.joints.size());
+        skinning.renderables.resize(skinning.targets.size());
+        skinning.targetInstances.resize(skinning.targets.size());
+        skinning.dirty = false;
+    }
 
-    auto update = [=](const SkinVector& skins, BoneVector& boneVector) {
-        for (const auto& skin : skins) {
-            size_t njoints = skin.joints.size();
-            boneVector.resize(njoints);
-            for (const auto& entity : skin.targets) {
-                auto renderable = renderableManager->getInstance(entity);
-                if (!renderable) {
-                    continue;
-                }
-                mat4f inverseGlobalTransform;
-                auto xformable = transformManager->getInstance(entity);
-                if (xformable) {
-                    inverseGlobalTransform = inverse(transformManager->getWorldTransform(xformable));
-                }
-                for (size_t boneIndex = 0; boneIndex < njoints; ++boneIndex) {
-                    const auto& joint = skin.joints[boneIndex];
-                    TransformManager::Instance jointInstance = transformManager->getInstance(joint);
-                    mat4f globalJointTransform = transformManager->getWorldTransform(jointInstance);
-                    boneVector[boneIndex] =
-                            inverseGlobalTransform *
-                            globalJointTransform *
-                            skin.inverseBindMatrices[boneIndex];
-                }
-                renderableManager->setBones(renderable, boneVector.data(), boneVector.size());
+    // Component instances can change when components are added or removed, so we look them up
+    // every time, but only once per joint and target.
+    for (size_t i = 0, n = skinning.joints.size(); i < n; ++i) {
+        skinning.jointInstances[i] = transformManager->getInstance(skinning.joints[i]);
+    }
+    for (size_t i = 0, n = skinning.targets.size(); i < n; ++i) {
+        const utils::Entity entity = skinning.targets[i].entity;
+        skinning.renderables[i] = renderableManager->getInstance(entity);
+        skinning.targetInstances[i] = transformManager->getInstance(entity);
+    }
+
+    // The joint matrices are shared by all the targets of a skin, compute them first.
+    auto computeJointMatrices = [&skinning, transformManager](uint32_t start, uint32_t count) {
+        for (uint32_t i = start, end = start + count; i < end; ++i) {
+            skinning.jointMatrices[i] =
+                    transformManager->getWorldTransform(skinning.jointInstances[i]) *
+                    skinning.inverseBindMatrices[i];
+        }
+    };
+
+    auto computeBoneMatrices = [&skinning, transformManager](uint32_t start, uint32_t count) {
+        for (uint32_t i = start, end = start + count; i < end; ++i) {
+            const Skinning::Target& target = skinning.targets[i];
+            if (!skinning.renderables[i]) {
+                continue;
+            }
+            mat4f inverseGlobalTransform;
+            if (skinning.targetInstances[i]) {
+                inverseGlobalTransform = inverse(
+                        transformManager->getWorldTransform(skinning.targetInstances[i]));
+            }
+            mat4f const* UTILS_RESTRICT joints = skinning.jointMatrices.data() + target.firstJoint;
+            mat4f* UTILS_RESTRICT bones = skinning.boneMatrices.data() + target.firstBone;
+            for (size_t j = 0; j < target.jointCount; ++j) {
+                bones[j] = inverseGlobalTransform * joints[j];
             }
         }
     };
 
-    if (mImpl->instance) {
-        update(mImpl->instance->skins, mImpl->boneMatrices);
-    } else if (!mImpl->asset->isInstanced()) {
-        update(mImpl->asset->mSkins, mImpl->boneMatrices);
+    // Only use the JobSystem when there is enough work to amortize it, and when this thread can
+    // wait for jobs.
+    const uint32_t jointCount = uint32_t(skinning.joints.size());
+    const uint32_t targetCount = uint32_t(skinning.targets.size());
+    JobSystem& js = mImpl->asset->mEngine->getJobSystem();
+    if (skinning.boneMatrices.size() < 1024 || !js.isThreadAdopted()) {
+        computeJointMatrices(0, jointCount);
+        computeBoneMatrices(0, targetCount);
     } else {
-        for (FFilamentInstance* instance : mImpl->asset->mInstances) {
-            update(instance->skins, mImpl->boneMatrices);
-        }
+        auto* job = jobs::parallel_for(js, nullptr, 0, jointCount,
+                std::ref(computeJointMatrices), jobs::CountSplitter<256, 8>());
+        js.runAndWait(job);
+        job = jobs::parallel_for(js, nullptr, 0, targetCount,
+                std::ref(computeBoneMatrices), jobs::CountSplitter<8, 8>());
+        js.runAndWait(job);
     }
+
+    // Finally, upload the bones of all the targets at once, they're stored back to back.
+    renderableManager->setBones(skinning.renderables.data(), skinning.boneCounts.data(),
+            targetCount, skinning.boneMatrices.data());
 }
 
 float Animator::getAnimationDuration(size_t animationIndex) const {
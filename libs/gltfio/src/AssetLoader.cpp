@@ -98,6 +98,7 @@ struct FAssetLoader : public AssetLoader {
 
     FFilamentAsset* createAssetFromJson(const uint8_t* bytes, uint32_t nbytes);
     FFilamentAsset* createAssetFromBinary(const uint8_t* bytes, uint32_t nbytes);
+    FFilamentAsset* createAssetFromFile(const char* path);
     FFilamentAsset* createInstancedAsset(const uint8_t* bytes, uint32_t numBytes,
         FilamentInstance** instances, size_t numInstances);
     FilamentInstance* createInstance(FFilamentAsset* primary);
@@ -195,6 +196,29 @@ FFilamentAsset* FAssetLoader::createAssetFromBinary(const uint8_t* bytes, uint32
     return mResult;
 }
 
+FFilamentAsset* FAssetLoader::createAssetFromFile(const char* path) {
+    std::unique_ptr<MappedFile> file = MappedFile::map(path);
+    if (!file) {
+        return nullptr;
+    }
+
+    // The file type is detected from its magic identifier. For GLB files, cgltf points all the
+    // buffer views into the mapped file, which is kept alive with the source data.
+    cgltf_options options {};
+    cgltf_data* sourceAsset;
+    cgltf_result result = cgltf_parse(&options, file->getData(), file->getSize(), &sourceAsset);
+    if (result != cgltf_result_success) {
+        slog.e << "Unable to parse glTF file " << path << io::endl;
+        return nullptr;
+    }
+    const bool hasBinaryChunk = sourceAsset->bin != nullptr;
+    createAsset(sourceAsset, 0);
+    if (mResult && hasBinaryChunk) {
+        mResult->mSourceAsset->mappedFiles.push_back(std::move(file));
+    }
+    return mResult;
+}
+
 FFilamentAsset* FAssetLoader::createInstancedAsset(const uint8_t* bytes, uint32_t numBytes,
         FilamentInstance** instances, size_t numInstances) {
     ASSERT_PRECONDITION(numInstances > 0, "Instance count must be 1 or more.");
@@ -1197,6 +1221,10 @@ FilamentAsset* AssetLoader::createAssetFromBinary(uint8_t const* bytes, uint32_t
     return upcast(this)->createAssetFromBinary(bytes, nbytes);
 }
 
+FilamentAsset* AssetLoader::createAssetFromFile(const char* path) {
+    return upcast(this)->createAssetFromFile(path);
+}
+
 FilamentAsset* AssetLoader::createInstancedAsset(const uint8_t* bytes, uint32_t numBytes,
         FilamentInstance** instances, size_t numInstances) {
     return upcast(this)->createInstancedAsset(bytes, numBytes, instances, numInstances);
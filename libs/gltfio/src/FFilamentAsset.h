@@ -39,6 +39,7 @@
 #include "upcast.h"
 #include "DependencyGraph.h"
 #include "DracoCache.h"
+#include "MappedFile.h"
 #include "FFilamentInstance.h"
 
 #include <tsl/robin_map.h>
@@ -239,10 +240,23 @@ struct FFilamentAsset : public FilamentAsset {
     // Encapsulates reference-counted source data, which includes the cgltf hierachy
     // and potentially also includes buffer data that can be uploaded to the GPU.
     struct SourceAsset {
-        ~SourceAsset() { cgltf_free(hierarchy); }
+        ~SourceAsset() {
+            // cgltf does not own the buffers that point into mapped files
+            for (cgltf_size i = 0, n = hierarchy ? hierarchy->buffers_count : 0; i < n; i++) {
+                cgltf_buffer& buffer = hierarchy->buffers[i];
+                for (auto const& file : mappedFiles) {
+                    if (file->contains(buffer.data)) {
+                        buffer.data = nullptr;
+                        break;
+                    }
+                }
+            }
+            cgltf_free(hierarchy);
+        }
         cgltf_data* hierarchy;
         DracoCache dracoCache;
         std::vector<uint8_t> glbData;
+        std::vector<std::unique_ptr<MappedFile>> mappedFiles;
     };
 
     // We used shared ownership for the raw cgltf data in order to permit ResourceLoader to
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MappedFile.h"
+
+#include <utils/Log.h>
+
+#if defined(WIN32)
+#include <Windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace utils;
+
+namespace gltfio {
+
+#if defined(WIN32)
+
+std::unique_ptr<MappedFile> MappedFile::map(const char* path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        slog.e << "Unable to open " << path << io::endl;
+        return {};
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return {};
+    }
+    // the view keeps a reference to the mapping object, which keeps one to the file
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        slog.e << "Unable to map " << path << io::endl;
+        return {};
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        slog.e << "Unable to map " << path << io::endl;
+        return {};
+    }
+    return std::unique_ptr<MappedFile>(new MappedFile((uint8_t*) data, size_t(size.QuadPart)));
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(mData);
+}
+
+#elif !defined(__EMSCRIPTEN__)
+
+std::unique_ptr<MappedFile> MappedFile::map(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        slog.e << "Unable to open " << path << io::endl;
+        return {};
+    }
+    struct stat st{};
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return {};
+    }
+    // the mapping stays valid after the file is closed
+    void* data = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        slog.e << "Unable to map " << path << io::endl;
+        return {};
+    }
+    return std::unique_ptr<MappedFile>(new MappedFile((uint8_t*) data, size_t(st.st_size)));
+}
+
+MappedFile::~MappedFile() {
+    munmap(mData, mSize);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::map(const char* path) {
+    slog.e << "Memory mapped files are not supported on this platform." << io::endl;
+    return {};
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
+
+} // namespace gltfio
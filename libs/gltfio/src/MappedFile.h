@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLTFIO_MAPPED_FILE_H
+#define GLTFIO_MAPPED_FILE_H
+
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gltfio {
+
+// Maps the content of a file in memory, for as long as the MappedFile is alive.
+//
+// The mapping is private (copy-on-write) so that the loaders can patch the data in place (e.g.
+// when normalizing skinning weights) without modifying the file. Pages are only read from the
+// file when they are first accessed, and the unmodified ones can be evicted by the system at any
+// time, so large buffers do not need to be resident in memory all at once.
+class MappedFile {
+public:
+    // Returns null if the file cannot be opened or mapped, or if it's empty.
+    static std::unique_ptr<MappedFile> map(const char* path);
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    ~MappedFile();
+
+    uint8_t* getData() const { return mData; }
+    size_t getSize() const { return mSize; }
+
+    bool contains(const void* p) const {
+        return p >= mData && p < mData + mSize;
+    }
+
+private:
+    MappedFile(uint8_t* data, size_t size) : mData(data), mSize(size) {}
+    uint8_t* const mData;
+    const size_t mSize;
+};
+
+} // namespace gltfio
+
+#endif // GLTFIO_MAPPED_FILE_H
@@ -18,6 +18,7 @@
 #include <gltfio/Image.h>
 
 #include "FFilamentAsset.h"
+#include "MappedFile.h"
 #include "upcast.h"
 
 #include <filament/Engine.h>
@@ -28,6 +29,9 @@
 
 #include <geometry/SurfaceOrientation.h>
 
+#include <image/KtxBundle.h>
+#include <image/KtxUtility.h>
+
 #include <utils/JobSystem.h>
 #include <utils/Log.h>
 #include <utils/Systrace.h>
@@ -41,6 +45,7 @@
 #include <tsl/robin_map.h>
 
 #include <string>
+#include <vector>
 
 #if defined(__EMSCRIPTEN__) || defined(ANDROID)
 #define USE_FILESYSTEM 0
@@ -59,12 +64,24 @@ namespace {
     struct TextureCacheEntry {
         Texture* texture;
         std::atomic<stbi_uc*> texels;
+        std::atomic<bool> decoded;              // set by the decoder, even if decoding failed
+        JobSystem::Job* job;                    // retained until the texels are uploaded
+        std::unique_ptr<image::KtxBundle> ktx;  // KTX textures are uploaded as-is
+        std::unique_ptr<gltfio::MappedFile> ktxFile; // KTX file viewed by the bundle, if any
+        const uint8_t* sourceData;              // null for file-based textures
         uint32_t bufferSize;
+        std::string path;
         int width;
         int height;
-        int numComponents;
+        int numComponents;                      // number of channels in the source image
+        int decodedComponents;                  // number of channels requested from stb_image
         bool srgb;
+        bool scheduled;
         bool completed;
+
+        size_t getDecodedSize() const {
+            return size_t(width) * size_t(height) * size_t(decodedComponents);
+        }
     };
 
     using BufferTextureCache = tsl::robin_map<const void*, std::unique_ptr<TextureCacheEntry>>;
@@ -80,11 +97,27 @@ struct ResourceLoader::Impl {
         mEngine = config.engine;
         mNormalizeSkinningWeights = config.normalizeSkinningWeights;
         mRecomputeBoundingBoxes = config.recomputeBoundingBoxes;
+        mMemoryMapBuffers = config.memoryMapBuffers;
+        mTextureDecodeBudget = config.textureDecodeBudget;
+        mTextureSwizzleSupported = isTextureSwizzleSupported(mEngine->getBackend());
+    }
+
+    // Texture swizzling is not available in WebGL, and is not implemented by the Metal and Vulkan
+    // backends yet. Without it, one and two channel images are expanded to RGB and RGBA.
+    static bool isTextureSwizzleSupported(Engine::Backend backend) {
+    #if defined(__EMSCRIPTEN__)
+        return false;
+    #else
+        return backend == Engine::Backend::OPENGL;
+    #endif
     }
 
     Engine* mEngine;
     bool mNormalizeSkinningWeights;
     bool mRecomputeBoundingBoxes;
+    bool mMemoryMapBuffers;
+    size_t mTextureDecodeBudget;
+    bool mTextureSwizzleSupported;
     std::string mGltfPath;
 
     // User-provided resource data with URI string keys, populated with addResourceData().
@@ -99,17 +132,28 @@ struct ResourceLoader::Impl {
     UriTextureCache mUriTextureCache;
     int mNumDecoderTasks;
     int mNumDecoderTasksFinished;
-    JobSystem::Job* mDecoderRootJob = nullptr;
     FFilamentAsset* mCurrentAsset = nullptr;
 
+    // Size of the texels that have been decoded or are being decoded, but not uploaded yet.
+    size_t mDecodedBytesInFlight = 0;
+
     void computeTangents(FFilamentAsset* asset);
     bool createTextures(bool async);
     void cancelTextureDecoding();
-    void addTextureCacheEntry(const TextureSlot& tb);
+    bool addTextureCacheEntry(const TextureSlot& tb);
     void bindTextureToMaterial(const TextureSlot& tb);
     void decodeSingleTexture();
-    void uploadPendingTextures();
+    void scheduleDecoderJobs();
+    void uploadPendingTextures(bool wait);
+    void uploadTexture(TextureCacheEntry* entry);
     void releasePendingTextures();
+    void waitForDecoderJobs();
+
+    template<typename F>
+    void forEachTexture(F f) {
+        for (auto& pair : mBufferTextureCache) f(pair.second.get());
+        for (auto& pair : mUriTextureCache) f(pair.second.get());
+    }
     ~Impl();
 };
 
@@ -179,6 +223,26 @@ void importSkins(const cgltf_data* gltf, const NodeMap& nodeMap, SkinVector& dst
     }
 }
 
+#if USE_FILESYSTEM
+// Used in place of cgltf's default file reader to memory-map the external buffers. The mappings
+// are owned by the source asset, so that they stay alive until all the uploads have completed.
+static cgltf_result mapBufferFile(const cgltf_memory_options* memoryOptions,
+        const cgltf_file_options* fileOptions, const char* path, cgltf_size* size, void** data) {
+    auto sourceAsset = (FFilamentAsset::SourceAsset*) fileOptions->user_data;
+    std::unique_ptr<MappedFile> file = MappedFile::map(path);
+    if (!file) {
+        return cgltf_result_file_not_found;
+    }
+    if (*size > file->getSize()) {
+        return cgltf_result_data_too_short;
+    }
+    *size = file->getSize();
+    *data = file->getData();
+    sourceAsset->mappedFiles.push_back(std::move(file));
+    return cgltf_result_success;
+}
+#endif
+
 static void convertBytesToShorts(uint16_t* dst, const uint8_t* src, size_t count) {
     for (size_t i = 0; i < count; ++i) {
         dst[i] = src[i];
@@ -340,6 +404,10 @@ bool ResourceLoader::loadResources(FFilamentAsset* asset, bool async) {
     #else
 
     // Read data from the file system and base64 URIs.
+    if (pImpl->mMemoryMapBuffers) {
+        options.file.read = mapBufferFile;
+        options.file.user_data = asset->mSourceAsset.get();
+    }
     cgltf_result result = cgltf_load_buffers(&options, (cgltf_data*) gltf, pImpl->mGltfPath.c_str());
     if (result != cgltf_result_success) {
         slog.e << "Unable to load resources." << io::endl;
@@ -445,88 +513,204 @@ void ResourceLoader::asyncUpdateLoad() {
     if (!UTILS_HAS_THREADING) {
         pImpl->decodeSingleTexture();
     }
-    pImpl->uploadPendingTextures();
+    pImpl->uploadPendingTextures(false);
+    if (UTILS_HAS_THREADING) {
+        pImpl->scheduleDecoderJobs();
+    }
+}
+
+static void decodeTexture(TextureCacheEntry* entry) {
+    int width, height, comp;
+    if (entry->sourceData) {
+        entry->texels = stbi_load_from_memory(entry->sourceData, entry->bufferSize,
+                &width, &height, &comp, entry->decodedComponents);
+    } else {
+        entry->texels = stbi_load(entry->path.c_str(), &width, &height, &comp,
+                entry->decodedComponents);
+    }
+    entry->decoded = true;
+}
+
+static bool isKtx(const uint8_t* data, size_t size) {
+    static const uint8_t MAGIC[] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x31, 0x31, 0xbb};
+    return size >= 64 && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+// Picks the number of channels to decode. sRGB textures are always decoded to RGBA because
+// SRGB8_A8 is the only sRGB format that can be mipmapped on all backends. Single channel images
+// (e.g. occlusion maps) and gray-alpha images are kept as-is and swizzled when sampled, unless the
+// backend cannot swizzle.
+static int getDecodedComponents(int numComponents, bool srgb, bool swizzleSupported) {
+    if (srgb) {
+        return 4;
+    }
+    if (!swizzleSupported && numComponents < 3) {
+        return numComponents + 2;
+    }
+    return numComponents;
 }
 
 void ResourceLoader::Impl::decodeSingleTexture() {
     assert(!UTILS_HAS_THREADING);
-    int w, h, c;
-
-    // Check if any buffer-based textures haven't been decoded yet.
+    auto decode = [this](TextureCacheEntry* entry) {
+        if (entry->scheduled) {
+            return false;
+        }
+        mDecodedBytesInFlight += entry->getDecodedSize();
+        entry->scheduled = true;
+        decodeTexture(entry);
+        return true;
+    };
     for (auto& pair : mBufferTextureCache) {
-        const uint8_t* sourceData = (const uint8_t*) pair.first;
-        TextureCacheEntry* entry = pair.second.get();
-        if (entry->texels) {
-            continue;
+        if (decode(pair.second.get())) {
+            return;
         }
-        entry->texels = stbi_load_from_memory(sourceData, entry->bufferSize, &w, &h, &c, 4);
-        return;
     }
-
-    // Check if any URI-based textures haven't been decoded yet.
     for (auto& pair : mUriTextureCache) {
-        auto uri = pair.first;
-        TextureCacheEntry* entry = pair.second.get();
-        if (entry->texels) {
-            continue;
-        }
-
-        // First, check the user-supplied resource cache for this URI.
-        auto iter = mUriDataCache.find(uri);
-        if (iter != mUriDataCache.end()) {
-            const uint8_t* sourceData = (const uint8_t*) iter->second.buffer;
-            entry->texels = stbi_load_from_memory(sourceData, iter->second.size, &w, &h, &c, 4);
+        if (decode(pair.second.get())) {
             return;
         }
+    }
+}
+
+void ResourceLoader::Impl::scheduleDecoderJobs() {
+    // This is called on every asyncUpdateLoad(). There is no current asset after a cancelled load,
+    // and the current asset (which might have been destroyed since) is not read once all of its
+    // textures have been scheduled.
+    if (!mCurrentAsset) {
+        return;
+    }
+
+    JobSystem* js = &mEngine->getJobSystem();
+    FFilamentAsset::SourceHandle retainSourceAsset;
 
-        // Otherwise load it from the file system if this platform supports it.
-        #if !USE_FILESYSTEM
-            slog.e << "Unable to load texture: " << uri << io::endl;
-            entry->completed = true;
-            mNumDecoderTasksFinished++;
+    // Decoded texels are held until they are uploaded, so we only start as many decoder jobs as
+    // the memory budget allows. Textures that are larger than the budget are decoded alone.
+    forEachTexture([&](TextureCacheEntry* entry) {
+        if (entry->scheduled) {
             return;
-        #else
-            Path fullpath = Path(mGltfPath).getParent() + uri;
-            entry->texels = stbi_load(fullpath.c_str(), &w, &h, &c, 4);
+        }
+        const size_t size = entry->getDecodedSize();
+        if (mTextureDecodeBudget && mDecodedBytesInFlight &&
+                mDecodedBytesInFlight + size > mTextureDecodeBudget) {
             return;
-        #endif
+        }
+        mDecodedBytesInFlight += size;
+        entry->scheduled = true;
+
+        // Create a copy of the shared_ptr to the source data to prevent it from being freed during
+        // the texture decoding process.
+        if (!retainSourceAsset) {
+            retainSourceAsset = mCurrentAsset->mSourceAsset;
+        }
+        entry->job = js->runAndRetain(jobs::createJob(*js, nullptr, [retainSourceAsset, entry] {
+            decodeTexture(entry);
+        }));
+    });
+}
+
+void ResourceLoader::Impl::waitForDecoderJobs() {
+    JobSystem* js = &mEngine->getJobSystem();
+    forEachTexture([js](TextureCacheEntry* entry) {
+        if (entry->job) {
+            js->waitAndRelease(entry->job);
+            entry->job = nullptr;
+        }
+    });
+}
+
+void ResourceLoader::Impl::uploadTexture(TextureCacheEntry* entry) {
+    Engine& engine = *mEngine;
+    Texture* texture = entry->texture;
+    entry->completed = true;
+    mNumDecoderTasksFinished++;
+
+    if (image::KtxBundle* ktx = entry->ktx.release()) {
+        // The mip chain of KTX textures is uploaded as-is, the bundle is freed after the last level
+        // has been consumed by the driver.
+        using namespace image::ktx;
+        const image::KtxInfo& info = ktx->getInfo();
+        const uint32_t levels = ktx->getNumMipLevels();
+        struct Userdata {
+            image::KtxBundle* ktx;
+            std::unique_ptr<MappedFile> file;
+            uint32_t remainingBuffers;
+        };
+        auto* user = new Userdata{ ktx, std::move(entry->ktxFile), levels };
+        auto callback = [](void*, size_t, void* u) {
+            auto* user = (Userdata*) u;
+            if (--user->remainingBuffers == 0) {
+                delete user->ktx;
+                delete user;
+            }
+        };
+        for (uint32_t level = 0; level < levels; ++level) {
+            uint8_t* data;
+            uint32_t size;
+            ktx->getBlob({ level, 0, 0 }, &data, &size);
+            if (isCompressed(info)) {
+                texture->setImage(engine, level, Texture::PixelBufferDescriptor(data, size,
+                        toCompressedPixelDataType(info), size, callback, user));
+            } else {
+                texture->setImage(engine, level, Texture::PixelBufferDescriptor(data, size,
+                        toPixelDataFormat(info), toPixelDataType(info), callback, user));
+            }
+        }
+        mCurrentAsset->mDependencyGraph.markAsReady(texture);
+        return;
+    }
+
+    mDecodedBytesInFlight -= entry->getDecodedSize();
+    uint8_t* texels = entry->texels;
+    if (!texels) {
+        // Decoding failed, we still mark the texture as ready so that the renderables that use it
+        // are not held back forever.
+        slog.e << "Unable to decode " << (entry->path.empty() ? "texture" : entry->path)
+                << io::endl;
+        mCurrentAsset->mDependencyGraph.markAsReady(texture);
+        return;
     }
+
+    static constexpr Texture::Format formats[] = {
+            Texture::Format::R, Texture::Format::RG, Texture::Format::RGB, Texture::Format::RGBA };
+    Texture::PixelBufferDescriptor pbd(texels, entry->getDecodedSize(),
+            formats[entry->decodedComponents - 1], Texture::Type::UBYTE, FREE_CALLBACK);
+    texture->setImage(engine, 0, std::move(pbd));
+    texture->generateMipmaps(engine);
+    mCurrentAsset->mDependencyGraph.markAsReady(texture);
 }
 
-void ResourceLoader::Impl::uploadPendingTextures() {
-    auto upload = [this](TextureCacheEntry* entry, Engine& engine) {
-        Texture* texture = entry->texture;
-        uint8_t* texels = entry->texels;
-        if (texture && texels && !entry->completed) {
-            Texture::PixelBufferDescriptor pbd(texels,
-                    texture->getWidth() * texture->getHeight() * 4,
-                    Texture::Format::RGBA, Texture::Type::UBYTE, FREE_CALLBACK);
-            texture->setImage(engine, 0, std::move(pbd));
-            texture->generateMipmaps(engine);
-            entry->completed = true;
-            mNumDecoderTasksFinished++;
-            mCurrentAsset->mDependencyGraph.markAsReady(texture);
+void ResourceLoader::Impl::uploadPendingTextures(bool wait) {
+    JobSystem* js = &mEngine->getJobSystem();
+    forEachTexture([this, js, wait](TextureCacheEntry* entry) {
+        if (!entry->texture || entry->completed || !entry->scheduled) {
+            return;
         }
-    };
-    for (auto& pair : mBufferTextureCache) upload(pair.second.get(), *mEngine);
-    for (auto& pair : mUriTextureCache) upload(pair.second.get(), *mEngine);
+        if (!wait && !entry->decoded && !entry->ktx) {
+            return;
+        }
+        if (entry->job) {
+            js->waitAndRelease(entry->job);
+            entry->job = nullptr;
+        }
+        uploadTexture(entry);
+    });
 }
 
 void ResourceLoader::Impl::releasePendingTextures() {
-    auto release = [this](TextureCacheEntry* entry, Engine& engine) {
-        Texture* texture = entry->texture;
+    forEachTexture([](TextureCacheEntry* entry) {
         uint8_t* texels = entry->texels;
-        if (texture && texels && !entry->completed) {
+        if (entry->texture && texels && !entry->completed) {
             // Normally the ownership of these texels is transferred to PixelBufferDescriptor, but
             // if uploads have been cancelled then we need to free them explicitly.
             free(texels);
+            entry->texels = nullptr;
         }
-    };
-    for (auto& pair : mBufferTextureCache) release(pair.second.get(), *mEngine);
-    for (auto& pair : mUriTextureCache) release(pair.second.get(), *mEngine);
+    });
+    mDecodedBytesInFlight = 0;
 }
 
-void ResourceLoader::Impl::addTextureCacheEntry(const TextureSlot& tb) {
+bool ResourceLoader::Impl::addTextureCacheEntry(const TextureSlot& tb) {
     TextureCacheEntry* entry = nullptr;
 
     const cgltf_texture* srcTexture = tb.texture;
@@ -536,54 +720,93 @@ void ResourceLoader::Impl::addTextureCacheEntry(const TextureSlot& tb) {
     void** data = bv ? &bv->buffer->data : nullptr;
     const size_t offset = bv ? bv->offset : 0;
 
+    // Reads the image header: KTX bundles are loaded right away since they need no decoding,
+    // other images are only peeked at to determine their dimensions and number of channels.
+    auto peek = [this, &tb](TextureCacheEntry* entry, const uint8_t* sourceData, uint32_t size,
+            image::KtxBundle::Storage storage = image::KtxBundle::Storage::COPY) {
+        entry->srgb = tb.srgb;
+        if (isKtx(sourceData, size)) {
+            entry->ktx = std::make_unique<image::KtxBundle>(sourceData, size, storage);
+            entry->width = entry->ktx->getInfo().pixelWidth;
+            entry->height = entry->ktx->getInfo().pixelHeight;
+            entry->scheduled = true;
+            return true;
+        }
+        if (!stbi_info_from_memory(sourceData, size, &entry->width, &entry->height,
+                &entry->numComponents)) {
+            return false;
+        }
+        entry->sourceData = sourceData;
+        entry->bufferSize = size;
+        entry->decodedComponents = getDecodedComponents(entry->numComponents, entry->srgb,
+                mTextureSwizzleSupported);
+        return true;
+    };
+
     // Check if the texture binding uses BufferView data (i.e. it does not have a URI).
     if (data) {
         const uint8_t* sourceData = offset + (const uint8_t*) *data;
         entry = mBufferTextureCache[sourceData] ? mBufferTextureCache[sourceData].get() : nullptr;
         if (entry) {
-            return;
+            return true;
         }
         entry = (mBufferTextureCache[sourceData] = std::make_unique<TextureCacheEntry>()).get();
-        entry->srgb = tb.srgb;
-        if (!stbi_info_from_memory(sourceData, totalSize, &entry->width, &entry->height,
-                &entry->numComponents)) {
+        if (!peek(entry, sourceData, totalSize)) {
             slog.e << "Unable to decode BufferView texture: " << stbi_failure_reason() << io::endl;
             mBufferTextureCache.erase(sourceData);
-            return;
         }
-        entry->bufferSize = totalSize;
-        return;
+        return true;
     }
 
     // Check if we already created a Texture object for this URI.
     entry = mUriTextureCache[uri] ? mUriTextureCache[uri].get() : nullptr;
     if (entry) {
-        return;
+        return true;
     }
 
     entry = (mUriTextureCache[uri] = std::make_unique<TextureCacheEntry>()).get();
-    entry->srgb = tb.srgb;
 
     // Check the user-supplied resource cache for this URI, otherwise peek at the file.
     auto iter = mUriDataCache.find(uri);
     if (iter != mUriDataCache.end()) {
         const uint8_t* sourceData = (const uint8_t*) iter->second.buffer;
-        if (!stbi_info_from_memory(sourceData, iter->second.size, &entry->width,
-                &entry->height, &entry->numComponents)) {
+        if (!peek(entry, sourceData, uint32_t(iter->second.size))) {
             slog.e << "Unable to decode " << uri << " : " << stbi_failure_reason() << io::endl;
             mUriTextureCache.erase(uri);
         }
-        return;
+        return true;
     }
     #if !USE_FILESYSTEM
         slog.e << "Unable to load texture: " << uri << io::endl;
+        mUriTextureCache.erase(uri);
+        return false;
     #else
         Path fullpath = Path(mGltfPath).getParent() + uri;
-        if (!stbi_info(fullpath.c_str(), &entry->width, &entry->height, &entry->numComponents)) {
-            slog.e << "Unable to decode " << fullpath.c_str() << " : " << stbi_failure_reason()
+        entry->srgb = tb.srgb;
+        entry->path = fullpath.getPath();
+
+        // KTX files need no decoding, they are memory-mapped and their blobs are uploaded straight
+        // from the mapping, which is kept alive until the driver has consumed them.
+        if (fullpath.getExtension() == "ktx") {
+            entry->ktxFile = MappedFile::map(entry->path.c_str());
+            if (!entry->ktxFile || !peek(entry, entry->ktxFile->getData(),
+                    uint32_t(entry->ktxFile->getSize()), image::KtxBundle::Storage::VIEW)) {
+                slog.e << "Unable to load " << entry->path << io::endl;
+                mUriTextureCache.erase(uri);
+            }
+            return true;
+        }
+
+        if (!stbi_info(entry->path.c_str(), &entry->width, &entry->height,
+                &entry->numComponents)) {
+            slog.e << "Unable to decode " << entry->path << " : " << stbi_failure_reason()
                     << io::endl;
             mUriTextureCache.erase(uri);
+            return true;
         }
+        entry->decodedComponents = getDecodedComponents(entry->numComponents, entry->srgb,
+                mTextureSwizzleSupported);
+        return true;
     #endif
 }
 
@@ -618,11 +841,7 @@ void ResourceLoader::Impl::bindTextureToMaterial(const TextureSlot& tb) {
 }
 
 void ResourceLoader::Impl::cancelTextureDecoding() {
-    JobSystem* js = &mEngine->getJobSystem();
-    if (mDecoderRootJob) {
-        js->waitAndRelease(mDecoderRootJob);
-        mDecoderRootJob = nullptr;
-    }
+    waitForDecoderJobs();
     releasePendingTextures();
     mBufferTextureCache.clear();
     mUriTextureCache.clear();
@@ -633,19 +852,61 @@ void ResourceLoader::Impl::cancelTextureDecoding() {
 
 bool ResourceLoader::Impl::createTextures(bool async) {
     // If any decoding jobs are still underway, wait for them to finish.
-    JobSystem* js = &mEngine->getJobSystem();
-    if (mDecoderRootJob) {
-        js->waitAndRelease(mDecoderRootJob);
-        mDecoderRootJob = nullptr;
-    }
+    waitForDecoderJobs();
+    releasePendingTextures();
 
     mBufferTextureCache.clear();
     mUriTextureCache.clear();
 
     // First, determine texture dimensions and create texture cache entries.
     FFilamentAsset* asset = mCurrentAsset;
+    bool success = true;
     for (auto slot : asset->mTextureSlots) {
-        addTextureCacheEntry(slot);
+        success = addTextureCacheEntry(slot) && success;
+    }
+
+    // Next create blank Filament textures.
+    auto createTexture = [=](TextureCacheEntry* entry) {
+        using Swizzle = Texture::Swizzle;
+        Texture::Builder builder;
+        builder.width(entry->width).height(entry->height).levels(0xff);
+        if (entry->ktx) {
+            const image::KtxInfo& info = entry->ktx->getInfo();
+            Texture::InternalFormat format = image::ktx::toTextureFormat(info);
+            if (entry->srgb && format == Texture::InternalFormat::RGB8) {
+                format = Texture::InternalFormat::SRGB8;
+            }
+            if (entry->srgb && format == Texture::InternalFormat::RGBA8) {
+                format = Texture::InternalFormat::SRGB8_A8;
+            }
+            if (!Texture::isTextureFormatSupported(*mEngine, format)) {
+                slog.e << "Unsupported KTX texture format: " << info.glInternalFormat << io::endl;
+                return false;
+            }
+            builder.levels(uint8_t(entry->ktx->getNumMipLevels())).format(format);
+        } else if (entry->decodedComponents == 1) {
+            builder.format(Texture::InternalFormat::R8)
+                    .swizzle(Swizzle::CHANNEL_0, Swizzle::CHANNEL_0, Swizzle::CHANNEL_0,
+                            Swizzle::SUBSTITUTE_ONE);
+        } else if (entry->decodedComponents == 2) {
+            builder.format(Texture::InternalFormat::RG8)
+                    .swizzle(Swizzle::CHANNEL_0, Swizzle::CHANNEL_0, Swizzle::CHANNEL_0,
+                            Swizzle::CHANNEL_1);
+        } else if (entry->decodedComponents == 3) {
+            builder.format(Texture::InternalFormat::RGB8);
+        } else {
+            builder.format(entry->srgb ? Texture::InternalFormat::SRGB8_A8 :
+                    Texture::InternalFormat::RGBA8);
+        }
+        entry->texture = builder.build(*mEngine);
+        asset->takeOwnership(entry->texture);
+        return true;
+    };
+    for (auto iter = mBufferTextureCache.begin(); iter != mBufferTextureCache.end();) {
+        iter = createTexture(iter->second.get()) ? std::next(iter) : mBufferTextureCache.erase(iter);
+    }
+    for (auto iter = mUriTextureCache.begin(); iter != mUriTextureCache.end();) {
+        iter = createTexture(iter->second.get()) ? std::next(iter) : mUriTextureCache.erase(iter);
     }
 
     // Tally up the total number of textures that need to be decoded. Zero textures is a special
@@ -659,95 +920,40 @@ bool ResourceLoader::Impl::createTextures(bool async) {
         mNumDecoderTasksFinished = 0;
     }
 
-    // Next create blank Filament textures.
-    auto createTexture = [=](TextureCacheEntry* entry) {
-        entry->texture = Texture::Builder()
-            .width(entry->width)
-            .height(entry->height)
-            .levels(0xff)
-            .format(entry->srgb ? Texture::InternalFormat::SRGB8_A8 : Texture::InternalFormat::RGBA8)
-            .build(*mEngine);
-        asset->takeOwnership(entry->texture);
-    };
-    for (auto& pair : mBufferTextureCache) createTexture(pair.second.get());
-    for (auto& pair : mUriTextureCache) createTexture(pair.second.get());
-
     // Bind the textures to material instances.
     for (auto slot : asset->mTextureSlots) {
         bindTextureToMaterial(slot);
     }
 
+    // KTX textures need no decoding so they are uploaded right away.
+    forEachTexture([this](TextureCacheEntry* entry) {
+        if (entry->ktx) {
+            uploadTexture(entry);
+        }
+    });
+
     // Before creating jobs for PNG / JPEG decoding, we might need to return early. On single
     // threaded systems, it is usually fine to create jobs because the job system will simply
     // execute serially. However if the client requests async behavior, then we need to wait
     // until subsequent calls to asyncUpdateLoad().
     if (!UTILS_HAS_THREADING && async) {
-        return true;
-    }
-
-    JobSystem::Job* parent = js->createJob();
-
-    // Create a copy of the shared_ptr to the source data to prevent it from being freed during
-    // the texture decoding process.
-    FFilamentAsset::SourceHandle retainSourceAsset = asset->mSourceAsset;
-
-    // Kick off jobs that decode texels from buffer pointers.
-    for (auto& pair : mBufferTextureCache) {
-        const uint8_t* sourceData = (const uint8_t*) pair.first;
-        TextureCacheEntry* entry = pair.second.get();
-        JobSystem::Job* decode = jobs::createJob(*js, parent, [retainSourceAsset, entry, sourceData] {
-            int width, height, comp;
-            entry->texels = stbi_load_from_memory(sourceData, entry->bufferSize,
-                    &width, &height, &comp, 4);
-        });
-        js->run(decode);
-    }
-
-    // Kick off jobs that decode texels from URI strings.
-    for (auto& pair : mUriTextureCache) {
-        auto uri = pair.first;
-        TextureCacheEntry* entry = pair.second.get();
-
-        // First, check the user-supplied resource cache for this URI.
-        auto iter = mUriDataCache.find(uri);
-        if (iter != mUriDataCache.end()) {
-            const uint8_t* sourceData = (const uint8_t*) iter->second.buffer;
-            JobSystem::Job* decode = jobs::createJob(*js, parent, [retainSourceAsset, entry, sourceData, iter] {
-                int width, height, comp;
-                entry->texels = stbi_load_from_memory(sourceData, iter->second.size, &width,
-                        &height, &comp, 4);
-            });
-            js->run(decode);
-            continue;
-        }
-
-        // Otherwise load it from the file system if this platform supports it.
-        #if !USE_FILESYSTEM
-            slog.e << "Unable to load texture: " << uri << io::endl;
-            return false;
-        #else
-            Path fullpath = Path(mGltfPath).getParent() + uri;
-            JobSystem::Job* decode = jobs::createJob(*js, parent, [retainSourceAsset, entry, fullpath] {
-                int width, height, comp;
-                entry->texels = stbi_load(fullpath.c_str(), &width, &height, &comp, 4);
-            });
-            js->run(decode);
-        #endif
+        return success;
     }
 
+    // Kick off as many decoder jobs as the memory budget allows, the remaining ones are started
+    // from asyncUpdateLoad() as the decoded texels get uploaded.
+    scheduleDecoderJobs();
     if (async) {
-        mDecoderRootJob = js->runAndRetain(parent);
-        return true;
+        return success;
     }
 
-    // Wait for decoding to finish.
-    js->runAndWait(parent);
-
-    // Finally, upload texels to the GPU and generate mipmaps.
-    mCurrentAsset = asset;
-    uploadPendingTextures();
+    // Upload the texels to the GPU and generate mipmaps as textures finish decoding.
+    while (mNumDecoderTasksFinished < mNumDecoderTasks) {
+        uploadPendingTextures(true);
+        scheduleDecoderJobs();
+    }
 
-    return true;
+    return success;
 }
 
 void ResourceLoader::Impl::computeTangents(FFilamentAsset* asset) {
@@ -939,9 +1145,8 @@ void ResourceLoader::Impl::computeTangents(FFilamentAsset* asset) {
 }
 
 ResourceLoader::Impl::~Impl() {
-    if (mDecoderRootJob) {
-        mEngine->getJobSystem().waitAndRelease(mDecoderRootJob);
-    }
+    waitForDecoderJobs();
+    releasePendingTextures();
 }
 
 void ResourceLoader::applySparseData(FFilamentAsset* asset) const {
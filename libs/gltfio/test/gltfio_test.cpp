@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <gltfio/Animator.h>
+#include <gltfio/AssetLoader.h>
+#include <gltfio/FilamentAsset.h>
+#include <gltfio/MaterialProvider.h>
+#include <gltfio/ResourceLoader.h>
+
+#include <filament/Engine.h>
+#include <filament/TransformManager.h>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+
+#include <cmath>
+#include <string>
+#include <thread>
+
+using namespace filament;
+using namespace filament::math;
+using namespace gltfio;
+
+// A single node whose translation is animated with 4 linear keyframes, one per second. The
+// embedded buffer holds the times { 0, 1, 2, 3 } followed by the translations (i * i, -i, 2 * i).
+static const char* ANIMATED_NODE_GLTF = R"({
+    "asset": { "version": "2.0" },
+    "scene": 0,
+    "scenes": [ { "nodes": [ 0 ] } ],
+    "nodes": [ { "name": "moving" } ],
+    "buffers": [ {
+        "byteLength": 64,
+        "uri": "data:application/octet-stream;base64,AAAAAAAAgD8AAABAAABAQAAAAAAAAACAAAAAAAAAgD8AAIC/AAAAQAAAgEAAAADAAACAQAAAEEEAAEDAAADAQA=="
+    } ],
+    "bufferViews": [
+        { "buffer": 0, "byteOffset": 0, "byteLength": 16 },
+        { "buffer": 0, "byteOffset": 16, "byteLength": 48 }
+    ],
+    "accessors": [
+        { "bufferView": 0, "componentType": 5126, "count": 4, "type": "SCALAR",
+          "min": [ 0 ], "max": [ 3 ] },
+        { "bufferView": 1, "componentType": 5126, "count": 4, "type": "VEC3" }
+    ],
+    "animations": [ {
+        "name": "move",
+        "samplers": [ { "input": 0, "output": 1, "interpolation": "LINEAR" } ],
+        "channels": [ { "sampler": 0, "target": { "node": 0, "path": "translation" } } ]
+    } ]
+})";
+
+// Five triangles, each with a material that samples a different PNG stored in the embedded buffer:
+// an RGB base color, a gray occlusion map, a gray-alpha metallic-roughness map, an RGBA emissive
+// map, and a base color whose header is valid but whose pixel data cannot be decoded.
+static const char* TEXTURED_GLTF = R"({
+    "asset": { "version": "2.0" },
+    "scene": 0,
+    "scenes": [ { "nodes": [ 0, 1, 2, 3, 4 ] } ],
+    "nodes": [ { "mesh": 0 }, { "mesh": 1 }, { "mesh": 2 }, { "mesh": 3 }, { "mesh": 4 } ],
+    "meshes": [
+        { "primitives": [ { "attributes": { "POSITION": 0 }, "material": 0 } ] },
+        { "primitives": [ { "attributes": { "POSITION": 0 }, "material": 1 } ] },
+        { "primitives": [ { "attributes": { "POSITION": 0 }, "material": 2 } ] },
+        { "primitives": [ { "attributes": { "POSITION": 0 }, "material": 3 } ] },
+        { "primitives": [ { "attributes": { "POSITION": 0 }, "material": 4 } ] }
+    ],
+    "materials": [
+        { "pbrMetallicRoughness": { "baseColorTexture": { "index": 0 } } },
+        { "occlusionTexture": { "index": 1 } },
+        { "pbrMetallicRoughness": { "metallicRoughnessTexture": { "index": 2 } } },
+        { "emissiveTexture": { "index": 3 }, "emissiveFactor": [ 1, 1, 1 ] },
+        { "pbrMetallicRoughness": { "baseColorTexture": { "index": 4 } } }
+    ],
+    "textures": [
+        { "source": 0 }, { "source": 1 }, { "source": 2 }, { "source": 3 }, { "source": 4 }
+    ],
+    "images": [
+        { "bufferView": 1, "mimeType": "image/png" },
+        { "bufferView": 2, "mimeType": "image/png" },
+        { "bufferView": 3, "mimeType": "image/png" },
+        { "bufferView": 4, "mimeType": "image/png" },
+        { "bufferView": 5, "mimeType": "image/png" }
+    ],
+    "buffers": [ {
+        "byteLength": 405,
+        "uri": "data:application/octet-stream;base64,AAAAAAAAAAAAAAAAAACAPwAAAAAAAAAAAAAAAAAAgD8AAAAAiVBORw0KGgoAAAANSUhEUgAAAAIAAAACCAIAAAD91JpzAAAAFklEQVR4nGNgENEISKlg0LAJqOhZAAATlgPBNoAv9QAAAABJRU5ErkJgggCJUE5HDQoaCgAAAA1JSERSAAAAAgAAAAIIAAAAAFfdUvgAAAAOSURBVHicY2AIYNCoAAACDgDxgBGxCgAAAABJRU5ErkJgggCJUE5HDQoaCgAAAA1JSERSAAAAAgAAAAIIBAAAANi/xa8AAAASSURBVHicY2AQCUhh0LCp6AEACAICMcNMDMYAAAAASUVORK5CYIIAiVBORw0KGgoAAAANSUhEUgAAAAIAAAACCAYAAABytg0kAAAAFklEQVR4nGNgENGwCUip6GGAUAu2AAAmggWhR+qChAAAAABJRU5ErkJgggCJUE5HDQoaCgAAAA1JSERSAAAAAgAAAAIIAgAAAP3UmnMAAAAESURBVAAAAADqI+cHAAAAAElFTkSuQmCC"
+    } ],
+    "bufferViews": [
+        { "buffer": 0, "byteOffset": 0, "byteLength": 36 },
+        { "buffer": 0, "byteOffset": 36, "byteLength": 79 },
+        { "buffer": 0, "byteOffset": 116, "byteLength": 71 },
+        { "buffer": 0, "byteOffset": 188, "byteLength": 75 },
+        { "buffer": 0, "byteOffset": 264, "byteLength": 79 },
+        { "buffer": 0, "byteOffset": 344, "byteLength": 61 }
+    ],
+    "accessors": [
+        { "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3",
+          "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ] }
+    ]
+})";
+
+static constexpr size_t TEXTURED_GLTF_TEXTURE_COUNT = 5;
+
+class GltfioTest : public testing::Test {
+protected:
+    void SetUp() override {
+        mEngine = Engine::create(Engine::Backend::NOOP);
+        mMaterials = createUbershaderLoader(mEngine);
+        mLoader = AssetLoader::create({ mEngine, mMaterials, nullptr });
+    }
+
+    void TearDown() override {
+        AssetLoader::destroy(&mLoader);
+        mMaterials->destroyMaterials();
+        delete mMaterials;
+        Engine::destroy(&mEngine);
+    }
+
+    FilamentAsset* createAsset(const char* json) {
+        const std::string content(json);
+        return mLoader->createAssetFromJson(
+                (const uint8_t*) content.data(), uint32_t(content.size()));
+    }
+
+    FilamentAsset* loadAsset(const char* json) {
+        FilamentAsset* asset = createAsset(json);
+        if (asset) {
+            ResourceLoader resourceLoader({ mEngine, nullptr, false, false });
+            EXPECT_TRUE(resourceLoader.loadResources(asset));
+        }
+        return asset;
+    }
+
+    // The translation of ANIMATED_NODE_GLTF at the given time, which wraps around the duration.
+    static float3 expectedTranslation(float time) {
+        time = std::fmod(time, 3.0f);
+        const float i = std::floor(time);
+        const float t = time - i;
+        const float3 prev = { i * i, -i, 2 * i };
+        const float3 next = { (i + 1) * (i + 1), -(i + 1), 2 * (i + 1) };
+        return (1 - t) * prev + t * next;
+    }
+
+    float3 getTranslation(utils::Entity entity) const {
+        TransformManager& tcm = mEngine->getTransformManager();
+        return tcm.getTransform(tcm.getInstance(entity))[3].xyz;
+    }
+
+    Engine* mEngine = nullptr;
+    MaterialProvider* mMaterials = nullptr;
+    AssetLoader* mLoader = nullptr;
+};
+
+TEST_F(GltfioTest, AnimationCursor) {
+    FilamentAsset* asset = loadAsset(ANIMATED_NODE_GLTF);
+    ASSERT_NE(asset, nullptr);
+    const Animator* animator = asset->getAnimator();
+    ASSERT_EQ(animator->getAnimationCount(), 1);
+    EXPECT_FLOAT_EQ(animator->getAnimationDuration(0), 3.0f);
+    const utils::Entity node = asset->getFirstEntityByName("moving");
+    ASSERT_FALSE(node.isNull());
+
+    // The keyframe cached by each evaluation must not change the result of the next one, whether
+    // the animation plays forward, jumps backward, loops or lands exactly on a keyframe.
+    const float times[] = {
+            0.0f, 0.1f, 0.5f, 0.9f, 1.0f, 1.25f, 2.75f, 2.9f,   // forward
+            0.2f, 2.5f, 1.5f, 1.0f, 0.0f,                        // backward
+            2.8f, 3.5f, 4.0f, 5.9f, 6.0f,                        // looping
+            1.75f, 1.75f, 2.0f, 0.75f };
+    for (float time : times) {
+        animator->applyAnimation(0, time);
+        const float3 expected = expectedTranslation(time);
+        const float3 actual = getTranslation(node);
+        EXPECT_NEAR(expected.x, actual.x, 1e-5f) << "at " << time;
+        EXPECT_NEAR(expected.y, actual.y, 1e-5f) << "at " << time;
+        EXPECT_NEAR(expected.z, actual.z, 1e-5f) << "at " << time;
+    }
+
+    // applyAnimations() goes through the same cache
+    for (float time : times) {
+        const size_t index = 0;
+        Animator::applyAnimations(&animator, &index, &time, 1);
+        const float3 expected = expectedTranslation(time);
+        const float3 actual = getTranslation(node);
+        EXPECT_NEAR(expected.x, actual.x, 1e-5f) << "at " << time;
+        EXPECT_NEAR(expected.y, actual.y, 1e-5f) << "at " << time;
+        EXPECT_NEAR(expected.z, actual.z, 1e-5f) << "at " << time;
+    }
+
+    mLoader->destroyAsset(asset);
+}
+
+TEST_F(GltfioTest, TextureDecodeFailure) {
+    // The texture that fails to decode must not hold back its renderable, nor the loading.
+    FilamentAsset* asset = loadAsset(TEXTURED_GLTF);
+    ASSERT_NE(asset, nullptr);
+    utils::Entity renderables[TEXTURED_GLTF_TEXTURE_COUNT + 1];
+    EXPECT_EQ(asset->popRenderables(renderables, TEXTURED_GLTF_TEXTURE_COUNT + 1),
+            TEXTURED_GLTF_TEXTURE_COUNT);
+    mLoader->destroyAsset(asset);
+}
+
+TEST_F(GltfioTest, TextureDecodeBudget) {
+    FilamentAsset* asset = createAsset(TEXTURED_GLTF);
+    ASSERT_NE(asset, nullptr);
+
+    // Every texture is larger than the budget, so they are decoded one at a time and each update
+    // uploads at most one of them.
+    ResourceConfiguration config = { mEngine, nullptr, false, false };
+    config.textureDecodeBudget = 1;
+    ResourceLoader resourceLoader(config);
+    ASSERT_TRUE(resourceLoader.asyncBeginLoad(asset));
+    EXPECT_EQ(resourceLoader.asyncGetLoadProgress(), 0.0f);
+    float progress = 0.0f;
+    while (progress < 1.0f) {
+        std::this_thread::yield();
+        resourceLoader.asyncUpdateLoad();
+        const float next = resourceLoader.asyncGetLoadProgress();
+        ASSERT_GE(next, progress);
+        ASSERT_LE(next - progress, 1.0f / TEXTURED_GLTF_TEXTURE_COUNT + 1e-5f);
+        progress = next;
+    }
+
+    utils::Entity renderables[TEXTURED_GLTF_TEXTURE_COUNT + 1];
+    EXPECT_EQ(asset->popRenderables(renderables, TEXTURED_GLTF_TEXTURE_COUNT + 1),
+            TEXTURED_GLTF_TEXTURE_COUNT);
+    mLoader->destroyAsset(asset);
+}
+
+TEST_F(GltfioTest, AsyncUpdateAfterLoad) {
+    ResourceLoader resourceLoader({ mEngine, nullptr, false, false });
+
+    // Updating after a cancelled load has nothing left to do.
+    FilamentAsset* asset = createAsset(TEXTURED_GLTF);
+    ASSERT_NE(asset, nullptr);
+    ASSERT_TRUE(resourceLoader.asyncBeginLoad(asset));
+    resourceLoader.asyncCancelLoad();
+    resourceLoader.asyncUpdateLoad();
+    resourceLoader.asyncUpdateLoad();
+    mLoader->destroyAsset(asset);
+
+    // Neither has updating after the loaded asset has been destroyed.
+    asset = createAsset(TEXTURED_GLTF);
+    ASSERT_NE(asset, nullptr);
+    ASSERT_TRUE(resourceLoader.loadResources(asset));
+    EXPECT_EQ(resourceLoader.asyncGetLoadProgress(), 1.0f);
+    mLoader->destroyAsset(asset);
+    resourceLoader.asyncUpdateLoad();
+    resourceLoader.asyncUpdateLoad();
+    EXPECT_EQ(resourceLoader.asyncGetLoadProgress(), 1.0f);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <image/ImageOps.h>
+#include <image/ImageSampler.h>
+#include <image/LinearImage.h>
+
+#include <utils/JobSystem.h>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace image;
+using namespace utils;
+
+// All benchmarks work on 8k x 8k images, the first argument selects the single-threaded path (0)
+// or the JobSystem path (1).
+static constexpr uint32_t SIZE = 8192;
+
+static LinearImage createImage(uint32_t channels) {
+    LinearImage image(SIZE, SIZE, channels);
+    float* data = image.getPixelRef();
+    for (size_t i = 0, n = size_t(SIZE) * SIZE * channels; i < n; i++) {
+        data[i] = float((i * 7919u) % 1021u) / 1020.0f;
+    }
+    return image;
+}
+
+static void BM_resampleImage(benchmark::State& state) {
+    const LinearImage source = createImage(3);
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        LinearImage result = state.range(0) ?
+                resampleImage(source, SIZE / 2, SIZE / 2, Filter::DEFAULT, js) :
+                resampleImage(source, SIZE / 2, SIZE / 2, Filter::DEFAULT);
+        benchmark::DoNotOptimize(result.getPixelRef());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * SIZE * SIZE);
+    js.emancipate();
+}
+
+static void BM_generateMipmaps(benchmark::State& state) {
+    const LinearImage source = createImage(3);
+    const uint32_t count = getMipmapCount(source);
+    std::vector<LinearImage> levels(count);
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        if (state.range(0)) {
+            generateMipmaps(source, Filter::DEFAULT, levels.data(), count, js);
+        } else {
+            generateMipmaps(source, Filter::DEFAULT, levels.data(), count);
+        }
+        benchmark::DoNotOptimize(levels.back().getPixelRef());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * SIZE * SIZE);
+    js.emancipate();
+}
+
+static void BM_computeCoordField(benchmark::State& state) {
+    // a sparse mask, roughly one pixel in 16 is present
+    LinearImage mask(SIZE, SIZE, 1);
+    float* data = mask.getPixelRef();
+    for (size_t i = 0, n = size_t(SIZE) * SIZE; i < n; i++) {
+        data[i] = ((uint32_t(i) * 2654435761u) >> 28) == 0 ? 1.0f : 0.0f;
+    }
+    auto presence = [](const LinearImage& img, uint32_t col, uint32_t row, void*) {
+        return img.getPixelRef(col, row)[0] > 0.5f;
+    };
+    JobSystem js;
+    js.adopt();
+    for (auto _ : state) {
+        LinearImage result = state.range(0) ?
+                computeCoordField(mask, presence, nullptr, js) :
+                computeCoordField(mask, presence, nullptr);
+        benchmark::DoNotOptimize(result.getPixelRef());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()) * SIZE * SIZE);
+    js.emancipate();
+}
+
+BENCHMARK(BM_resampleImage)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_generateMipmaps)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_computeCoordField)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
@@ -22,6 +22,10 @@
 #include <cstddef>
 #include <initializer_list>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
 // Concatenates images horizontally to create a filmstrip atlas, similar to numpy's hstack.
@@ -68,6 +72,12 @@ using PresenceCallback = bool(*)(const LinearImage& img, uint32_t col, uint32_t
 // field or generalized Voronoi map.
 LinearImage computeCoordField(const LinearImage& src, PresenceCallback presence, void* user);
 
+// Multithreaded variant of computeCoordField, which splits the rows of the distance transform
+// passes between the threads of the given job system. The presence callback is always invoked
+// from the calling thread, which must have been adopted by the job system.
+LinearImage computeCoordField(const LinearImage& src, PresenceCallback presence, void* user,
+        utils::JobSystem& js);
+
 // Generates a single-channel Euclidean distance field with positive values outside the region
 // of interest in the source image, and zero values inside. If sqrt is false, the computed
 // distances are squared. If signed distance (SDF) is desired, this function can be called a second
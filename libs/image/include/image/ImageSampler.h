@@ -19,6 +19,10 @@
 
 #include <image/LinearImage.h>
 
+namespace utils {
+class JobSystem;
+} // namespace utils
+
 namespace image {
 
 /**
@@ -110,6 +114,17 @@ LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t he
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
         Filter filter = Filter::DEFAULT);
 
+/**
+ * Multithreaded variants of resampleImage. The rows of the horizontal pass and the rows of the
+ * vertical pass are split between the threads of the given job system. The result is identical
+ * to the single-threaded version. The calling thread must have been adopted by the job system.
+ */
+LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
+        const ImageSampler& sampler, utils::JobSystem& js);
+
+LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
+        Filter filter, utils::JobSystem& js);
+
 /**
  * Computes a single sample for the given texture coordinate and writes the resulting color
  * components into the given output holder.
@@ -139,6 +154,14 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
  */
 void generateMipmaps(const LinearImage& source, Filter, LinearImage* result, uint32_t mipCount);
 
+/**
+ * Multithreaded variant of generateMipmaps, where the miplevels are generated concurrently using
+ * the given job system, and each miplevel is resampled with the multithreaded resampleImage.
+ * The calling thread must have been adopted by the job system.
+ */
+void generateMipmaps(const LinearImage& source, Filter, LinearImage* result, uint32_t mipCount,
+        utils::JobSystem& js);
+
 /**
  * Returns the number of miplevels it would take to downsample the given image down to 1x1. This
  * number does not include the original image (i.e. mip 0).
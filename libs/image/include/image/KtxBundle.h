@@ -71,12 +71,25 @@ public:
      */
     KtxBundle(uint32_t numMipLevels, uint32_t arrayLength, bool isCubemap);
 
+    /**
+     * Controls whether a deserialized bundle owns a copy of its blobs.
+     */
+    enum class Storage : uint8_t {
+        COPY,   //!< blobs are copied, the serialized data can be freed as soon as the bundle exists
+        VIEW    //!< blobs point into the serialized data, which must outlive the bundle
+    };
+
     /**
      * Creates a new bundle by deserializing the given data.
      *
      * Typically, this constructor is used to consume the contents of a KTX file.
+     *
+     * With Storage::VIEW, the blobs are not copied but indexed in place, e.g. in a memory-mapped
+     * KTX file, so that getBlob() returns pointers into the given data. In this case the data must
+     * outlive the bundle and any PixelBufferDescriptor created from its blobs (see KtxUtility),
+     * and the blobs are read-only: setBlob() and allocateBlob() fail.
      */
-    KtxBundle(uint8_t const* bytes, uint32_t nbytes);
+    KtxBundle(uint8_t const* bytes, uint32_t nbytes, Storage storage = Storage::COPY);
 
     /**
      * Serializes the bundle into the given target memory. Returns false if there's not enough
@@ -126,6 +139,11 @@ public:
      */
     bool isCubemap() const { return mNumCubeFaces > 1; }
 
+    /**
+     * Returns whether the blobs of this bundle point into memory that it doesn't own.
+     */
+    bool isView() const;
+
     /**
      * Retrieves a weak reference to a given data blob. Returns false if the given blob index is out
      * of bounds, or if the blob at the given index is empty.
@@ -134,13 +152,13 @@ public:
 
     /**
      * Copies the given data into the blob at the given index, replacing whatever is already there.
-     * Returns false if the given blob index is out of bounds.
+     * Returns false if the given blob index is out of bounds, or if the bundle is a view.
      */
     bool setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size);
 
     /**
      * Allocates the blob at the given index to the given number of bytes. This allows subsequent
-     * calls to setBlob to be thread-safe.
+     * calls to setBlob to be thread-safe. Returns false if the bundle is a view.
      */
     bool allocateBlob(KtxBlobIndex index, uint32_t size);
 
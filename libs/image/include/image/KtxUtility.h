@@ -52,6 +52,10 @@ namespace ktx {
     /**
      * Creates a Texture object from a KTX file and populates all of its faces and miplevels.
      *
+     * The pixel buffers point directly into the blobs of the bundle, no copy is made. If the bundle
+     * is a view (see KtxBundle::Storage::VIEW), e.g. over a memory-mapped file, the data it
+     * references must stay valid until the callback is called.
+     *
      * @param engine Used to create the Filament Texture
      * @param ktx In-memory representation of a KTX file
      * @param srgb Forces the KTX-specified format into an SRGB format if possible
@@ -144,6 +148,8 @@ namespace ktx {
      * Creates a Texture object from a KTX bundle, populates all of its faces and miplevels,
      * and automatically destroys the bundle after all the texture data has been uploaded.
      *
+     * The data referenced by a view bundle is not freed by this function.
+     *
      * @param engine Used to create the Filament Texture
      * @param ktx In-memory representation of a KTX file
      * @param srgb Forces the KTX-specified format into an SRGB format if possible
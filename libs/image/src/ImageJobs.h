@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_IMAGEJOBS_H
+#define IMAGE_IMAGEJOBS_H
+
+#include <utils/JobSystem.h>
+
+#include <functional>
+
+#include <stdint.h>
+
+namespace image {
+
+// Calls work(start, count) over the given number of rows, either on the calling thread or split
+// between the threads of the given job system, in which case the calling thread must have been
+// adopted by it.
+template<typename F>
+inline void forEachRow(utils::JobSystem* js, uint32_t rows, F work) {
+    if (!js) {
+        work(0, rows);
+        return;
+    }
+    js->runAndWait(utils::jobs::parallel_for(*js, nullptr, 0, rows, std::ref(work),
+            utils::jobs::CountSplitter<16>()));
+}
+
+} // namespace image
+
+#endif /* IMAGE_IMAGEJOBS_H */
@@ -16,8 +16,11 @@
 
 #include <image/ImageOps.h>
 
+#include "ImageJobs.h"
+
 #include <math/vec3.h>
 #include <math/vec4.h>
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 
 #include <algorithm>
@@ -25,6 +28,7 @@
 #include <ratio>
 
 using namespace filament::math;
+using namespace utils;
 
 namespace image {
 
@@ -195,25 +199,31 @@ LinearImage combineChannels(LinearImage const* img, size_t count) {
 // (b) allows the client to consume columns in the same way that it consumes rows. Our
 // implementation does not support in-place transposition but it is simple and robust for non-square
 // images.
-LinearImage transpose(const LinearImage& image) {
+static LinearImage transpose(const LinearImage& image, JobSystem* js) {
     const uint32_t width = image.getWidth();
     const uint32_t height = image.getHeight();
     const uint32_t channels = image.getChannels();
     LinearImage result(height, width, channels);
     float const* source = image.getPixelRef();
     float* target = result.getPixelRef();
-    for (uint32_t n = 0; n < width * height; ++n) {
-        const uint32_t i = n / width;
-        const uint32_t j = n % width;
-        float const* src = source + channels * n;
-        float* dst = target + channels * (height * j + i);
-        for (uint32_t c = 0; c < channels; ++c) {
-            dst[c] = src[c];
+    forEachRow(js, height, [=](uint32_t start, uint32_t count) {
+        for (uint32_t i = start; i < start + count; ++i) {
+            float const* src = source + channels * width * i;
+            for (uint32_t j = 0; j < width; ++j, src += channels) {
+                float* dst = target + channels * (height * j + i);
+                for (uint32_t c = 0; c < channels; ++c) {
+                    dst[c] = src[c];
+                }
+            }
         }
-    }
+    });
     return result;
 }
 
+LinearImage transpose(const LinearImage& image) {
+    return transpose(image, nullptr);
+}
+
 LinearImage cropRegion(const LinearImage& image, uint32_t left, uint32_t top, uint32_t right,
         uint32_t bottom) {
     uint32_t width = right - left;
@@ -311,22 +321,24 @@ static void edt(const float* f, float* d, float* z, float* v, float* i, size_t n
     }
 }
 
-static LinearImage computeHorizontalEdt(const LinearImage& src, LinearImage cx) {
+static LinearImage computeHorizontalEdt(const LinearImage& src, LinearImage cx, JobSystem* js) {
     const uint32_t width = src.getWidth();
     const uint32_t height = src.getHeight();
     LinearImage tmp0(width + 1, height + 1, 1);
     LinearImage tmp1(width + 1, height + 1, 1);
     LinearImage dst(width, height, 1);
 
-    // TODO: use utils::job::parallel_for.
-    for (uint32_t row = 0; row < height; ++row) {
-        const float* f = src.getPixelRef(0, row);
-        float* d = dst.getPixelRef(0, row);
-        float* z = tmp0.getPixelRef(0, row);
-        float* v = tmp1.getPixelRef(0, row);
-        float* i = cx.getPixelRef(0, row);
-        edt(f, d, z, v, i, width);
-    }
+    // Rows are independent, and each one has its own temporaries.
+    forEachRow(js, height, [&](uint32_t start, uint32_t count) {
+        for (uint32_t row = start; row < start + count; ++row) {
+            const float* f = src.getPixelRef(0, row);
+            float* d = dst.getPixelRef(0, row);
+            float* z = tmp0.getPixelRef(0, row);
+            float* v = tmp1.getPixelRef(0, row);
+            float* i = cx.getPixelRef(0, row);
+            edt(f, d, z, v, i, width);
+        }
+    });
 
     return dst;
 }
@@ -334,7 +346,8 @@ static LinearImage computeHorizontalEdt(const LinearImage& src, LinearImage cx)
 // Implements the paper 'Distance Transforms of Sampled Functions' by Felzenszwalb and Huttenlocher
 // but generalized to compute a coordinate field rather than a distance field. Coordinate fields are
 // more broadly useful and transforming them into distance fields is extremely cheap.
-LinearImage computeCoordField(const LinearImage& src, PresenceCallback presence, void* user) {
+static LinearImage computeCoordField(const LinearImage& src, PresenceCallback presence, void* user,
+        JobSystem* js) {
     const uint32_t width = src.getWidth();
     const uint32_t height = src.getHeight();
     LinearImage f0(width, height, 1);
@@ -348,28 +361,39 @@ LinearImage computeCoordField(const LinearImage& src, PresenceCallback presence,
     LinearImage cx(width, height, 1);
     LinearImage cy(height, width, 1);
 
-    f0 = computeHorizontalEdt(f0, cx);
-    f0 = transpose(f0);
-    f0 = computeHorizontalEdt(f0, cy);
-    f0 = transpose(f0);
+    f0 = computeHorizontalEdt(f0, cx, js);
+    f0 = transpose(f0, js);
+    f0 = computeHorizontalEdt(f0, cy, js);
+    f0 = transpose(f0, js);
 
     // NOTE: this could be extended to compute a volumetric distance field by transposing
     // X with Z at this point (rather than X with Y) and re-invoking computeHorizontalEdt.
 
     LinearImage coords(width, height, 2);
-    for (uint32_t row = 0; row < height; ++row) {
-        for (uint32_t col = 0; col < width; ++col) {
-            float y = cy.getPixelRef(row, col)[0];
-            float x = cx.getPixelRef(col, y)[0];
-            float* dst = coords.getPixelRef(col, row);
-            dst[0] = x;
-            dst[1] = y;
+    forEachRow(js, height, [&](uint32_t start, uint32_t count) {
+        for (uint32_t row = start; row < start + count; ++row) {
+            for (uint32_t col = 0; col < width; ++col) {
+                float y = cy.getPixelRef(row, col)[0];
+                float x = cx.getPixelRef(col, y)[0];
+                float* dst = coords.getPixelRef(col, row);
+                dst[0] = x;
+                dst[1] = y;
+            }
         }
-    }
+    });
 
     return coords;
 }
 
+LinearImage computeCoordField(const LinearImage& src, PresenceCallback presence, void* user) {
+    return computeCoordField(src, presence, user, nullptr);
+}
+
+LinearImage computeCoordField(const LinearImage& src, PresenceCallback presence, void* user,
+        JobSystem& js) {
+    return computeCoordField(src, presence, user, &js);
+}
+
 LinearImage edtFromCoordField(const LinearImage& coordField, bool sqrt) {
     const uint32_t width = coordField.getWidth();
     const uint32_t height = coordField.getHeight();
@@ -17,18 +17,24 @@
 #include <image/ImageSampler.h>
 #include <image/ImageOps.h>
 
+#include "ImageJobs.h"
+
 #include <math/scalar.h>
 #include <math/vec3.h>
 #include <math/vec4.h>
 
-#include <utils/Panic.h>
 #include <utils/CString.h>
+#include <utils/JobSystem.h>
+#include <utils/Panic.h>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <unordered_map>
 
 using namespace image;
+using namespace utils;
 
 namespace {
 
@@ -172,22 +178,41 @@ void generateMadProgram(uint32_t ntarget, uint32_t nsource, float left, float ri
     }
 }
 
-// Transforms a MAD program intended for single-channel data into a program intended for
-// multi-channel data.
-void expandMadProgram(uint32_t nchannels, MadProgram* program) {
-    if (nchannels == 1) {
-        return;
+// Executes a MAD program over a row of pixels with N channels. Each instruction applies to all the
+// channels of a pixel at once, which lets the compiler use SIMD for RGB and RGBA images.
+template<uint32_t N>
+void executeMadProgram(float* target, float const* source, MadProgram const& program) {
+    for (auto mad : program) {
+        float* dst = target + mad.targetIndex * N;
+        float const* src = source + mad.sourceIndex * N;
+        for (uint32_t c = 0; c < N; ++c) {
+            dst[c] += src[c] * mad.weight;
+        }
     }
-    MadProgram result;
-    result.reserve(program->size() * nchannels);
-    for (auto mad : *program) {
-        mad.sourceIndex *= nchannels;
-        mad.targetIndex *= nchannels;
-        for (uint32_t j = 0; j < nchannels; ++j, ++mad.sourceIndex, ++mad.targetIndex) {
-            result.push_back(mad);
+}
+
+template<uint32_t N>
+void executeMinProgram(float* target, float const* source, MadProgram const& program) {
+    for (auto mad : program) {
+        float* dst = target + mad.targetIndex * N;
+        float const* src = source + mad.sourceIndex * N;
+        for (uint32_t c = 0; c < N; ++c) {
+            dst[c] = std::min(src[c], dst[c]);
         }
     }
-    program->swap(result);
+}
+
+using RowProgram = void(*)(float* target, float const* source, MadProgram const& program);
+
+RowProgram getRowProgram(uint32_t nchan, bool minimum) {
+    switch (nchan) {
+        case 1: return minimum ? executeMinProgram<1> : executeMadProgram<1>;
+        case 2: return minimum ? executeMinProgram<2> : executeMadProgram<2>;
+        case 3: return minimum ? executeMinProgram<3> : executeMadProgram<3>;
+        case 4: return minimum ? executeMinProgram<4> : executeMadProgram<4>;
+    }
+    PANIC_PRECONDITION("Unsupported number of channels: %u", nchan);
+    return nullptr;
 }
 
 FilterFunction createFilterFunction(Filter ftype) {
@@ -226,8 +251,10 @@ void normalize(LinearImage& image) {
     }
 }
 
+// Resizes the image horizontally by executing the MAD instructions over each row.
 LinearImage resampleImage1D(const LinearImage& source, MadProgram* program,
-        uint32_t twidth, Filter filter, float left, float right, float filterRadiusMultiplier) {
+        uint32_t twidth, Filter filter, float left, float right, float filterRadiusMultiplier,
+        JobSystem* js = nullptr) {
     const uint32_t swidth = source.getWidth();
     const uint32_t sheight = source.getHeight();
     const uint32_t nchan = source.getChannels();
@@ -238,38 +265,23 @@ LinearImage resampleImage1D(const LinearImage& source, MadProgram* program,
     // Generate a flat list of multiply-add (MAD) instructions.
     program->clear();
     generateMadProgram(twidth, swidth, left, right, hfn, filterRadiusMultiplier, program);
-    expandMadProgram(nchan, program);
 
     // Allocate the target image.
     LinearImage result(twidth, sheight, nchan);
-    float const* sourceRow = source.getPixelRef();
-    float* targetRow = result.getPixelRef();
 
     // The MIN filter is special because it starts with non-zero values and ignores filter weights.
-    if (filter == Filter::MINIMUM) {
-        for (uint32_t n = 0; n < twidth * sheight * nchan; ++n) {
-            targetRow[n] = std::numeric_limits<float>::max();
-        }
-        for (uint32_t row = 0; row < sheight; ++row) {
-            for (auto mad : *program) {
-                const float a = sourceRow[mad.sourceIndex];
-                const float b = targetRow[mad.targetIndex];
-                targetRow[mad.targetIndex] = std::min(a, b);
-            }
-            targetRow += twidth * nchan;
-            sourceRow += swidth * nchan;
-        }
-        return result;
+    const bool minimum = filter == Filter::MINIMUM;
+    if (minimum) {
+        float* target = result.getPixelRef();
+        std::fill(target, target + twidth * sheight * nchan, std::numeric_limits<float>::max());
     }
 
-    // Resize the image horizontally by executing the MAD instructions over each row.
-    for (uint32_t row = 0; row < sheight; ++row) {
-        for (auto mad : *program) {
-            targetRow[mad.targetIndex] += sourceRow[mad.sourceIndex] * mad.weight;
+    const RowProgram execute = getRowProgram(nchan, minimum);
+    forEachRow(js, sheight, [&](uint32_t start, uint32_t count) {
+        for (uint32_t row = start; row < start + count; ++row) {
+            execute(result.getPixelRef(0, row), source.getPixelRef(0, row), *program);
         }
-        targetRow += twidth * nchan;
-        sourceRow += swidth * nchan;
-    }
+    });
 
     // Perform post processing for the current pass.
     if (filter == Filter::GAUSSIAN_NORMALS) {
@@ -278,16 +290,61 @@ LinearImage resampleImage1D(const LinearImage& source, MadProgram* program,
     return result;
 }
 
-} // anonymous namespace
+// Resizes the image vertically. Each MAD instruction adds an entire source row to a target row,
+// which avoids transposing the image and vectorizes well regardless of the number of channels.
+LinearImage resampleImageVertical(const LinearImage& source, MadProgram* program,
+        uint32_t theight, Filter filter, float top, float bottom, float filterRadiusMultiplier,
+        JobSystem* js = nullptr) {
+    const uint32_t swidth = source.getWidth();
+    const uint32_t sheight = source.getHeight();
+    const uint32_t nchan = source.getChannels();
+    const bool mag = theight > sheight;
+    if (filter == Filter::DEFAULT) filter = mag ? Filter::MITCHELL : Filter::LANCZOS;
+    const FilterFunction vfn = createFilterFunction(filter);
 
-namespace image {
+    program->clear();
+    generateMadProgram(theight, sheight, top, bottom, vfn, filterRadiusMultiplier, program);
 
-SingleSample::~SingleSample() {
-    delete[] data;
+    LinearImage result(swidth, theight, nchan);
+
+    const bool minimum = filter == Filter::MINIMUM;
+    if (minimum) {
+        float* target = result.getPixelRef();
+        std::fill(target, target + swidth * theight * nchan, std::numeric_limits<float>::max());
+    }
+
+    // The instructions are sorted by target row, so each job executes the instructions that
+    // write to its own range of rows.
+    const uint32_t rowSize = swidth * nchan;
+    MadInstruction const* const instructions = program->data();
+    MadInstruction const* const end = instructions + program->size();
+    forEachRow(js, theight, [&](uint32_t start, uint32_t count) {
+        MadInstruction const* mad = std::lower_bound(instructions, end, start,
+                [](MadInstruction const& mad, uint32_t row) { return mad.targetIndex < row; });
+        for (; mad != end && mad->targetIndex < start + count; ++mad) {
+            float* dst = result.getPixelRef(0, mad->targetIndex);
+            float const* src = source.getPixelRef(0, mad->sourceIndex);
+            const float weight = mad->weight;
+            if (minimum) {
+                for (uint32_t i = 0; i < rowSize; ++i) {
+                    dst[i] = std::min(src[i], dst[i]);
+                }
+            } else {
+                for (uint32_t i = 0; i < rowSize; ++i) {
+                    dst[i] += src[i] * weight;
+                }
+            }
+        }
+    });
+
+    if (filter == Filter::GAUSSIAN_NORMALS) {
+        normalize(result);
+    }
+    return result;
 }
 
-LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
-        const ImageSampler& sampler) {
+LinearImage resampleImageImpl(const LinearImage& source, uint32_t width, uint32_t height,
+        const ImageSampler& sampler, JobSystem* js) {
     ASSERT_PRECONDITION(
         sampler.east.mode == Boundary::EXCLUDE &&
         sampler.north.mode == Boundary::EXCLUDE &&
@@ -302,11 +359,54 @@ LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t he
     const float bottom = sampler.sourceRegion.bottom;
     MadProgram program;
     LinearImage result;
-    result = transpose(resampleImage1D(source, &program, width, hfilter, left, right, radius));
-    result = transpose(resampleImage1D(result, &program, height, vfilter, top, bottom, radius));
+    result = resampleImage1D(source, &program, width, hfilter, left, right, radius, js);
+    result = resampleImageVertical(result, &program, height, vfilter, top, bottom, radius, js);
     return result;
 }
 
+void generateMipmapsImpl(const LinearImage& source, Filter filter, LinearImage* result,
+        uint32_t mips, JobSystem* js) {
+    mips = std::min(mips, getMipmapCount(source));
+    uint32_t width = source.getWidth();
+    uint32_t height = source.getHeight();
+    JobSystem::Job* parent = js ? js->createJob() : nullptr;
+    for (uint32_t n = 0; n < mips; ++n) {
+        width = std::max(width >> 1u, 1u);
+        height = std::max(height >> 1u, 1u);
+        if (!js) {
+            result[n] = resampleImageImpl(source, width, height, { filter, filter }, nullptr);
+            continue;
+        }
+        // Every level is generated from the original image, so they all take a similar amount of
+        // time and can be generated concurrently.
+        LinearImage* level = result + n;
+        js->run(jobs::createJob(*js, parent, [&source, level, width, height, filter, js]() {
+            *level = resampleImageImpl(source, width, height, { filter, filter }, js);
+        }));
+    }
+    if (js) {
+        js->runAndWait(parent);
+    }
+}
+
+} // anonymous namespace
+
+namespace image {
+
+SingleSample::~SingleSample() {
+    delete[] data;
+}
+
+LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
+        const ImageSampler& sampler) {
+    return resampleImageImpl(source, width, height, sampler, nullptr);
+}
+
+LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
+        const ImageSampler& sampler, JobSystem& js) {
+    return resampleImageImpl(source, width, height, sampler, &js);
+}
+
 LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
         Filter filter) {
     return resampleImage(source, width, height, ImageSampler {
@@ -315,6 +415,14 @@ LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t he
     });
 }
 
+LinearImage resampleImage(const LinearImage& source, uint32_t width, uint32_t height,
+        Filter filter, JobSystem& js) {
+    return resampleImage(source, width, height, ImageSampler {
+        .horizontalFilter = filter,
+        .verticalFilter = filter
+    }, js);
+}
+
 void computeSingleSample(const LinearImage& source, float x, float y, SingleSample* result,
         Filter filter) {
     const float radius = 1.0f;
@@ -338,14 +446,12 @@ void computeSingleSample(const LinearImage& source, float x, float y, SingleSamp
 // Unlike traditional mipmap generation, our implementation generates all levels from the original
 // image, under the premise that this produces a higher quality result.
 void generateMipmaps(const LinearImage& source, Filter filter, LinearImage* result, uint32_t mips) {
-    mips = std::min(mips, getMipmapCount(source));
-    uint32_t width = source.getWidth();
-    uint32_t height = source.getHeight();
-    for (uint32_t n = 0; n < mips; ++n) {
-        width = std::max(width >> 1u, 1u);
-        height = std::max(height >> 1u, 1u);
-        result[n] = resampleImage(source, width, height, filter);
-    }
+    generateMipmapsImpl(source, filter, result, mips, nullptr);
+}
+
+void generateMipmaps(const LinearImage& source, Filter filter, LinearImage* result, uint32_t mips,
+        JobSystem& js) {
+    generateMipmapsImpl(source, filter, result, mips, &js);
 }
 
 uint32_t getMipmapCount(const LinearImage& source) {
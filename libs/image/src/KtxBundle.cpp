@@ -56,12 +56,21 @@ struct KtxMetadata {
 // Extremely simple contiguous storage for an array of blobs. Assumes that the total number of blobs
 // is relatively small compared to the size of each blob, and that resizing individual blobs does
 // not occur frequently.
+// Views don't own the blobs, they only record where each one starts in the serialized data.
 struct KtxBlobList {
     std::vector<uint8_t> blobs;
     std::vector<uint32_t> sizes;
+    std::vector<uint8_t const*> views;
+
+    bool isView() const {
+        return !views.empty();
+    }
 
     // Obtains a pointer to the given blob.
     uint8_t* get(uint32_t blobIndex) {
+        if (isView()) {
+            return const_cast<uint8_t*>(views[blobIndex]);
+        }
         uint8_t* result = blobs.data();
         for (uint32_t i = 0; i < blobIndex; ++i) {
             result += sizes[i];
@@ -106,7 +115,7 @@ KtxBundle::KtxBundle(uint32_t numMipLevels, uint32_t arrayLength, bool isCubemap
     mBlobs->sizes.resize(numMipLevels * arrayLength * mNumCubeFaces);
 }
 
-KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
+KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes, Storage storage) :
         mBlobs(new KtxBlobList), mMetadata(new KtxMetadata) {
     ASSERT_PRECONDITION(sizeof(SerializationHeader) <= nbytes, "KTX buffer is too small");
 
@@ -149,18 +158,31 @@ KtxBundle::KtxBundle(uint8_t const* bytes, uint32_t nbytes) :
     const bool isNonArrayCube = mNumCubeFaces > 1 && mArrayLength == 1;
     const uint32_t facesPerMip = mArrayLength * mNumCubeFaces;
 
-    // Extract blobs from the serialized byte stream.
-    const uint32_t totalSize = nbytes - (pdata - bytes);
-    mBlobs->blobs.resize(totalSize);
+    // Extract blobs from the serialized byte stream, or only record where they are for views.
+    uint8_t const* const dataEnd = bytes + nbytes;
+    const bool isView = storage == Storage::VIEW;
+    if (isView) {
+        mBlobs->views.resize(mBlobs->sizes.size());
+    } else {
+        mBlobs->blobs.resize(nbytes - (pdata - bytes));
+    }
     for (uint32_t mipmap = 0; mipmap < mNumMipLevels; ++mipmap) {
+        ASSERT_PRECONDITION(pdata + sizeof(uint32_t) <= dataEnd, "KTX buffer is too small");
         const uint32_t imageSize = *((uint32_t const*) pdata);
         const uint32_t faceSize = isNonArrayCube ? imageSize : (imageSize / facesPerMip);
         const uint32_t levelSize = faceSize * mNumCubeFaces * mArrayLength;
         pdata += sizeof(uint32_t);
-        memcpy(mBlobs->get(flatten(this, {mipmap, 0, 0})), pdata, levelSize);
+        ASSERT_PRECONDITION(levelSize <= size_t(dataEnd - pdata), "KTX buffer is too small");
+        if (!isView) {
+            memcpy(mBlobs->get(flatten(this, {mipmap, 0, 0})), pdata, levelSize);
+        }
         for (uint32_t layer = 0; layer < mArrayLength; ++layer) {
             for (uint32_t face = 0; face < mNumCubeFaces; ++face) {
-                mBlobs->sizes[flatten(this, {mipmap, layer, face})] = faceSize;
+                const size_t flatIndex = flatten(this, {mipmap, layer, face});
+                mBlobs->sizes[flatIndex] = faceSize;
+                if (isView) {
+                    mBlobs->views[flatIndex] = pdata;
+                }
                 pdata += faceSize;
                 pdata += cubePadding;
             }
@@ -304,6 +326,10 @@ bool KtxBundle::getSphericalHarmonics(filament::math::float3* result) {
     return true;
 }
 
+bool KtxBundle::isView() const {
+    return mBlobs->isView();
+}
+
 bool KtxBundle::getBlob(KtxBlobIndex index, uint8_t** data, uint32_t* size) const {
     if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
@@ -320,7 +346,7 @@ bool KtxBundle::getBlob(KtxBlobIndex index, uint8_t** data, uint32_t* size) cons
 }
 
 bool KtxBundle::setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size) {
-    if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
+    if (mBlobs->isView() || index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
         return false;
     }
@@ -334,7 +360,7 @@ bool KtxBundle::setBlob(KtxBlobIndex index, uint8_t const* data, uint32_t size)
 }
 
 bool KtxBundle::allocateBlob(KtxBlobIndex index, uint32_t size) {
-    if (index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
+    if (mBlobs->isView() || index.mipLevel >= mNumMipLevels || index.arrayIndex >= mArrayLength ||
             index.cubeFace >= mNumCubeFaces) {
         return false;
     }
@@ -20,19 +20,26 @@
 #include <image/ImageSampler.h>
 #include <image/LinearImage.h>
 
+#include <imageio/BlockCompression.h>
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageDiffer.h>
 #include <imageio/ImageEncoder.h>
 
 #include <gtest/gtest.h>
 
+#include <stb_dxt.h>
+
+#include <utils/JobSystem.h>
 #include <utils/Panic.h>
 #include <utils/Path.h>
 
 #include <math/vec3.h>
 #include <math/vec4.h>
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <random>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -76,6 +83,9 @@ static void updateOrCompare(const LinearImage& limg, const utils::Path& fname);
 // Subtracts two images, does an abs(), then normalizes such that min/max transform to 0/1.
 static LinearImage diffImages(const LinearImage& a, const LinearImage& b);
 
+// Expects the two images to have the same dimensions and bit-identical pixels.
+static void expectIdentical(const LinearImage& a, const LinearImage& b);
+
 TEST_F(ImageTest, LuminanceFilters) { // NOLINT
     auto tiny = createGrayFromAscii("000 010 000");
     ASSERT_EQ(tiny.getWidth(), 3);
@@ -362,6 +372,38 @@ TEST_F(ImageTest, Mipmaps) { // NOLINT
     }
 }
 
+TEST_F(ImageTest, Multithreaded) { // NOLINT
+    // the calling thread must be adopted to wait on the jobs
+    utils::JobSystem js(3);
+    js.adopt();
+
+    LinearImage src = resampleImage(createColorFromAscii("01234 43210 12340 02413"), 301, 173,
+            Filter::MITCHELL);
+
+    // The rows are split between the threads, but each pixel is computed the same way.
+    for (Filter filter : { Filter::BOX, Filter::MITCHELL, Filter::GAUSSIAN_SCALARS }) {
+        expectIdentical(resampleImage(src, 97, 211, filter),
+                resampleImage(src, 97, 211, filter, js));
+    }
+
+    const uint32_t count = getMipmapCount(src);
+    vector<LinearImage> mips(count);
+    vector<LinearImage> threadedMips(count);
+    generateMipmaps(src, Filter::HERMITE, mips.data(), count);
+    generateMipmaps(src, Filter::HERMITE, threadedMips.data(), count, js);
+    for (uint32_t index = 0; index < count; ++index) {
+        expectIdentical(mips[index], threadedMips[index]);
+    }
+
+    auto presence = [] (const LinearImage& img, uint32_t col, uint32_t row, void*) {
+        return img.getPixelRef(col, row)[0] > 0.5f;
+    };
+    expectIdentical(computeCoordField(src, presence, nullptr),
+            computeCoordField(src, presence, nullptr, js));
+
+    js.emancipate();
+}
+
 TEST_F(ImageTest, Ktx) { // NOLINT
     uint8_t foo[] = {1, 2, 3};
     uint8_t* data;
@@ -427,6 +469,127 @@ TEST_F(ImageTest, Ktx) { // NOLINT
     }
 }
 
+TEST_F(ImageTest, KtxView) { // NOLINT
+    KtxBundle nascent(2, 1, true);
+    for (uint32_t level = 0; level < 2; level++) {
+        for (uint32_t face = 0; face < 6; face++) {
+            const uint8_t blob[] = { uint8_t(level), uint8_t(face), 0xab, 0xcd };
+            ASSERT_TRUE(nascent.setBlob({level, 0, face}, blob, sizeof(blob)));
+        }
+    }
+    nascent.setMetadata("foo", "bar");
+    vector<uint8_t> buffer(nascent.getSerializedLength());
+    ASSERT_TRUE(nascent.serialize(buffer.data(), buffer.size()));
+
+    KtxBundle copy(buffer.data(), buffer.size());
+    KtxBundle view(buffer.data(), buffer.size(), KtxBundle::Storage::VIEW);
+    ASSERT_FALSE(copy.isView());
+    ASSERT_TRUE(view.isView());
+    ASSERT_EQ(view.getNumMipLevels(), 2);
+    ASSERT_TRUE(view.isCubemap());
+    ASSERT_EQ(string(view.getMetadata("foo")), "bar");
+
+    // The blobs of the view point into the serialized data.
+    for (uint32_t level = 0; level < 2; level++) {
+        for (uint32_t face = 0; face < 6; face++) {
+            uint8_t* copyData;
+            uint8_t* viewData;
+            uint32_t copySize;
+            uint32_t viewSize;
+            ASSERT_TRUE(copy.getBlob({level, 0, face}, &copyData, &copySize));
+            ASSERT_TRUE(view.getBlob({level, 0, face}, &viewData, &viewSize));
+            ASSERT_EQ(viewSize, copySize);
+            ASSERT_GE(viewData, buffer.data());
+            ASSERT_LE(viewData + viewSize, buffer.data() + buffer.size());
+            ASSERT_EQ(memcmp(viewData, copyData, viewSize), 0);
+            ASSERT_EQ(viewData[0], level);
+            ASSERT_EQ(viewData[1], face);
+        }
+    }
+
+    vector<uint8_t> reserialized(view.getSerializedLength());
+    ASSERT_TRUE(view.serialize(reserialized.data(), reserialized.size()));
+    ASSERT_EQ(reserialized, buffer);
+
+    const uint8_t foo[] = {1, 2, 3};
+    ASSERT_FALSE(view.setBlob({0, 0, 0}, foo, sizeof(foo)));
+    ASSERT_FALSE(view.allocateBlob({0, 0, 0}, sizeof(foo)));
+}
+
+TEST_F(ImageTest, S3tcCompression) { // NOLINT
+    // odd dimensions, so that the last column and row of blocks are padded, and enough rows of
+    // blocks to be split between threads
+    constexpr uint32_t width = 29;
+    constexpr uint32_t height = 37;
+    constexpr uint32_t xblocks = (width + 3) / 4;
+    constexpr uint32_t yblocks = (height + 3) / 4;
+
+    std::default_random_engine generator(82828); // NOLINT
+    std::uniform_real_distribution<float> distribution(-0.1f, 1.1f);
+    LinearImage src(width, height, 4);
+    float* pixels = src.getPixelRef();
+    for (uint32_t i = 0; i < width * height * 4; i++) {
+        pixels[i] = distribution(generator);
+    }
+
+    // compresses one block at a time, the padding repeats the last column and row
+    auto compressSerially = [&src](bool dxt5) {
+        vector<uint8_t> result;
+        uint8_t block[64];
+        uint8_t dst[16];
+        for (uint32_t by = 0; by < yblocks; by++) {
+            for (uint32_t bx = 0; bx < xblocks; bx++) {
+                for (uint32_t j = 0; j < 16; j++) {
+                    const uint32_t x = std::min(width - 1, bx * 4 + j % 4);
+                    const uint32_t y = std::min(height - 1, by * 4 + j / 4);
+                    const float* pixel = src.getPixelRef(x, y);
+                    for (uint32_t c = 0; c < 4; c++) {
+                        block[j * 4 + c] = (uint8_t) std::min(255.0f,
+                                std::max(0.0f, pixel[c] * 255.0f));
+                    }
+                }
+                stb_compress_dxt_block(dst, block, dxt5, 8);
+                result.insert(result.end(), dst, dst + (dxt5 ? 16 : 8));
+            }
+        }
+        return result;
+    };
+
+    const vector<uint8_t> dxt1 = compressSerially(false);
+    const vector<uint8_t> dxt5 = compressSerially(true);
+    for (CompressedFormat format : { CompressedFormat::RGB_S3TC_DXT1,
+            CompressedFormat::SRGB_S3TC_DXT1, CompressedFormat::RGBA_S3TC_DXT5,
+            CompressedFormat::SRGB_ALPHA_S3TC_DXT5 }) {
+        const bool alpha = format == CompressedFormat::RGBA_S3TC_DXT5 ||
+                format == CompressedFormat::SRGB_ALPHA_S3TC_DXT5;
+        const vector<uint8_t>& expected = alpha ? dxt5 : dxt1;
+        CompressedTexture tex = s3tcCompress(src, { format, false });
+        EXPECT_EQ(tex.format, format);
+        ASSERT_EQ(tex.size, expected.size());
+        EXPECT_EQ(memcmp(tex.data.get(), expected.data(), expected.size()), 0);
+    }
+
+    // BC4 and BC5 are made of the first one or two channels
+    CompressedTexture bc4 = s3tcCompress(src, { CompressedFormat::RED_RGTC1, false });
+    EXPECT_EQ(bc4.size, xblocks * yblocks * 8);
+    CompressedTexture bc5 = s3tcCompress(src, { CompressedFormat::RED_GREEN_RGTC2, false });
+    EXPECT_EQ(bc5.size, xblocks * yblocks * 16);
+
+    // with a single channel, BC5 duplicates R into G, so each block is made of two copies of the
+    // BC4 block
+    LinearImage red = extractChannel(src, 0);
+    CompressedTexture redBc4 = s3tcCompress(red, { CompressedFormat::RED_RGTC1, false });
+    CompressedTexture redBc5 = s3tcCompress(red, { CompressedFormat::RED_GREEN_RGTC2, false });
+    ASSERT_EQ(redBc4.size, bc4.size);
+    ASSERT_EQ(redBc5.size, bc5.size);
+    EXPECT_EQ(memcmp(redBc4.data.get(), bc4.data.get(), bc4.size), 0);
+    for (uint32_t i = 0; i < xblocks * yblocks; i++) {
+        const uint8_t* block = redBc5.data.get() + i * 16;
+        EXPECT_EQ(memcmp(block, redBc4.data.get() + i * 8, 8), 0) << "R of block " << i;
+        EXPECT_EQ(memcmp(block + 8, redBc4.data.get() + i * 8, 8), 0) << "G of block " << i;
+    }
+}
+
 TEST_F(ImageTest, getSphericalHarmonics) {
     KtxBundle ktx(2, 1, true);
 
@@ -669,6 +832,14 @@ static bool intersect(Ray ray, Sphere sphere, float* t) {
     return true;
 }
 
+static void expectIdentical(const LinearImage& a, const LinearImage& b) {
+    ASSERT_EQ(a.getWidth(), b.getWidth());
+    ASSERT_EQ(a.getHeight(), b.getHeight());
+    ASSERT_EQ(a.getChannels(), b.getChannels());
+    const size_t size = sizeof(float) * a.getWidth() * a.getHeight() * a.getChannels();
+    EXPECT_EQ(memcmp(a.getPixelRef(), b.getPixelRef(), size), 0);
+}
+
 static LinearImage diffImages(const LinearImage& a, const LinearImage& b) {
     const uint32_t width = a.getWidth(), height = a.getHeight(), nchan = a.getChannels();
     ASSERT_PRECONDITION(width == b.getWidth() && height == b.getHeight() &&
@@ -53,6 +53,9 @@ enum class CompressedFormat {
     SRGB_ALPHA_S3TC_DXT3 = 0x8C4E,
     SRGB_ALPHA_S3TC_DXT5 = 0x8C4F,
 
+    RED_RGTC1 = 0x8DBB,
+    RED_GREEN_RGTC2 = 0x8DBD,
+
     RGBA_ASTC_4x4 = 0x93B0,
     RGBA_ASTC_5x4 = 0x93B1,
     RGBA_ASTC_5x5 = 0x93B2,
@@ -165,12 +168,14 @@ struct S3tcConfig {
     bool srgb;
 };
 
-// Uses the CPU to compress a linear image (1 to 4 channels) into an S3TC texture.
+// Uses the CPU to compress a linear image (1 to 4 channels) into an S3TC texture, or into a BC4 / BC5
+// (RGTC) texture made of the first one or two channels of the image. Rows of blocks are compressed
+// on multiple threads.
 CompressedTexture s3tcCompress(const LinearImage& source, S3tcConfig config);
 
 // Parses an underscore-delimited string to produce an S3TC compression configuration. Currently
-// this only accepts "rgb_dxt1" and "rgba_dxt5". If the string is malformed, this returns a config
-// with an invalid format.
+// this only accepts "rgb_dxt1", "rgba_dxt5", "r_bc4" and "rg_bc5". If the string is malformed,
+// this returns a config with an invalid format.
 S3tcConfig s3tcParseOptionString(const std::string& options);
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -20,7 +20,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <thread>
+#include <vector>
 
 #include <astcenc.h>
 #include <Etc.h>
@@ -28,6 +30,13 @@
 #define STB_DXT_IMPLEMENTATION
 #include <stb_dxt.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#   define S3TC_HAS_SSE2 1
+#   include <emmintrin.h>
+#else
+#   define S3TC_HAS_SSE2 0
+#endif
+
 namespace image {
 
 static LinearImage extendToFourChannels(LinearImage source);
@@ -355,22 +364,41 @@ AstcConfig astcParseOptionString(const std::string& configString) {
     return config;
 }
 
-static uint32_t imin(uint32_t a, uint32_t b) {
-    return (a < b) ? a : b;
+// Converts floats in [0, 1] to bytes, truncating like a plain cast would.
+static void convertToBytes(uint8_t* dst, float const* src, size_t count) {
+    size_t i = 0;
+#if S3TC_HAS_SSE2
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 16 <= count; i += 16) {
+        __m128i v[4];
+        for (size_t j = 0; j < 4; j++) {
+            __m128 f = _mm_mul_ps(_mm_loadu_ps(src + i + j * 4), scale);
+            f = _mm_min_ps(scale, _mm_max_ps(zero, f));
+            v[j] = _mm_cvttps_epi32(f);
+        }
+        const __m128i lo = _mm_packs_epi32(v[0], v[1]);
+        const __m128i hi = _mm_packs_epi32(v[2], v[3]);
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = (uint8_t) std::min(255.0f, std::max(0.0f, src[i] * 255.0f));
+    }
 }
 
-static void extract4x4RGBA(uint8_t* dst, const LinearImage& source, uint32_t x0, uint32_t y0) {
-    const uint32_t maxx = source.getWidth() - 1;
+// Converts the 4 rows of pixels covered by a row of blocks to bytes. The rows are padded to a
+// multiple of 4 pixels by repeating the last column, and the last row is repeated at the bottom.
+static void extractBlockRow(uint8_t* dst, const LinearImage& source, uint32_t y0,
+        uint32_t stride) {
+    const uint32_t width = source.getWidth();
     const uint32_t maxy = source.getHeight() - 1;
-    for (uint32_t y = y0, y1 = y0 + 4; y < y1; ++y) {
-        for (uint32_t x = x0, x1 = x0 + 4; x < x1; ++x, dst += 4) {
-            int clamped_x = imin(maxx, x);
-            int clamped_y = imin(maxy, y);
-            float const* rgba = source.getPixelRef(clamped_x, clamped_y);
-            dst[0] = (uint8_t) std::min(255.0f, std::max(0.0f, (rgba[0] * 255.0f)));
-            dst[1] = (uint8_t) std::min(255.0f, std::max(0.0f, (rgba[1] * 255.0f)));
-            dst[2] = (uint8_t) std::min(255.0f, std::max(0.0f, (rgba[2] * 255.0f)));
-            dst[3] = (uint8_t) std::min(255.0f, std::max(0.0f, (rgba[3] * 255.0f)));
+    const uint32_t channels = source.getChannels();
+    const uint32_t rowSize = width * channels;
+    for (uint32_t y = y0, y1 = y0 + 4; y < y1; ++y, dst += stride) {
+        convertToBytes(dst, source.getPixelRef(0, std::min(maxy, y)), rowSize);
+        for (uint32_t i = rowSize; i < stride; i++) {
+            dst[i] = dst[i - channels];
         }
     }
 }
@@ -378,26 +406,103 @@ static void extract4x4RGBA(uint8_t* dst, const LinearImage& source, uint32_t x0,
 // Our S3TC / DXT encoder uses the STB implementation by Fabian Giesen.
 //
 // Due to limitations in STB, this only supports the following formats:
-//  - DXT1 with no alpha (16 input pixels in 64 bits of output, 6:1)
-//  - DXT5 with alpha (16 input pixels into 128 bits of output, 4:1)
+//  - DXT1 with no alpha (16 input pixels in 64 bits of output, 6:1), linear or sRGB
+//  - DXT5 with alpha (16 input pixels into 128 bits of output, 4:1), linear or sRGB
+//  - BC4 with one channel (16 input pixels in 64 bits of output, 2:1)
+//  - BC5 with two channels (16 input pixels into 128 bits of output, 2:1)
+//
+// Rows of blocks are split between threads, each thread converts the 4 rows of pixels of a row of
+// blocks to bytes at once before compressing its blocks.
 //
 // TODO: investigate using something more capable than STB (eg AMD Compressenator, bimg, libsquish)
 CompressedTexture s3tcCompress(const LinearImage& original, S3tcConfig config) {
-    const bool dxt5 = config.format == CompressedFormat::RGBA_S3TC_DXT5;
-    LinearImage source = extendToFourChannels(original);
-    uint8_t block[64];
-    uint32_t xblocks = (source.getWidth() + 3) / 4;
-    uint32_t yblocks = (source.getHeight() + 3) / 4;
-    uint32_t size = xblocks * yblocks * (dxt5 ? 16 : 8);
+    LinearImage source;
+    uint32_t blockSize;
+    switch (config.format) {
+        // opaque DXT1 blocks are also valid in the formats with 1-bit alpha
+        case CompressedFormat::RGB_S3TC_DXT1:
+        case CompressedFormat::RGBA_S3TC_DXT1:
+        case CompressedFormat::SRGB_S3TC_DXT1:
+        case CompressedFormat::SRGB_ALPHA_S3TC_DXT1:
+            source = extendToFourChannels(original);
+            blockSize = 8;
+            break;
+        case CompressedFormat::RGBA_S3TC_DXT5:
+        case CompressedFormat::SRGB_ALPHA_S3TC_DXT5:
+            source = extendToFourChannels(original);
+            blockSize = 16;
+            break;
+        case CompressedFormat::RED_RGTC1:
+            source = original.getChannels() == 1 ? original : extractChannel(original, 0);
+            blockSize = 8;
+            break;
+        case CompressedFormat::RED_GREEN_RGTC2: {
+            if (original.getChannels() == 2) {
+                source = original;
+            } else {
+                auto r = extractChannel(original, 0);
+                auto g = original.getChannels() > 1 ? extractChannel(original, 1) : r;
+                source = combineChannels({r, g});
+            }
+            blockSize = 16;
+            break;
+        }
+        default:
+            return {};
+    }
+
+    const CompressedFormat format = config.format;
+    const uint32_t channels = source.getChannels();
+    const uint32_t xblocks = (source.getWidth() + 3) / 4;
+    const uint32_t yblocks = (source.getHeight() + 3) / 4;
+    const uint32_t size = xblocks * yblocks * blockSize;
+    const uint32_t stride = xblocks * 4 * channels;
     uint8_t* buffer = new uint8_t[size];
-    uint8_t* dst = buffer;
-    for (int y = 0, h = source.getHeight(); y < h; y += 4) {
-        for (int x = 0, w = source.getWidth(); x < w; x += 4) {
-            extract4x4RGBA(block, source, x, y);
-            stb_compress_dxt_block(dst, block, dxt5, 8);
-            dst += dxt5 ? 16 : 8;
+
+    auto compressRows = [&source, format, channels, xblocks, stride, blockSize, buffer](
+            uint32_t firstRow, uint32_t lastRow) {
+        std::vector<uint8_t> rows(stride * 4);
+        uint8_t block[64];
+        const uint32_t blockRowSize = 4 * channels;
+        for (uint32_t row = firstRow; row < lastRow; row++) {
+            extractBlockRow(rows.data(), source, row * 4, stride);
+            uint8_t* dst = buffer + row * xblocks * blockSize;
+            for (uint32_t x = 0; x < xblocks; x++, dst += blockSize) {
+                for (uint32_t y = 0; y < 4; y++) {
+                    memcpy(block + y * blockRowSize,
+                            rows.data() + y * stride + x * blockRowSize, blockRowSize);
+                }
+                switch (format) {
+                    case CompressedFormat::RED_RGTC1:
+                        stb_compress_bc4_block(dst, block);
+                        break;
+                    case CompressedFormat::RED_GREEN_RGTC2:
+                        stb_compress_bc5_block(dst, block);
+                        break;
+                    default:
+                        // the 16-byte blocks are DXT5, which has an alpha block
+                        stb_compress_dxt_block(dst, block, blockSize == 16, 8);
+                        break;
+                }
+            }
         }
+    };
+
+    // The first row is compressed on the calling thread, because STB lazily initializes its tables
+    // the first time a block is compressed, which isn't thread safe.
+    compressRows(0, std::min(1u, yblocks));
+
+    const uint32_t threadCount = std::max(1u,
+            std::min(std::thread::hardware_concurrency(), yblocks - 1));
+    const uint32_t rowsPerThread = (yblocks - 1 + threadCount - 1) / threadCount;
+    std::vector<std::thread> threads;
+    for (uint32_t row = 1; row < yblocks; row += rowsPerThread) {
+        threads.emplace_back(compressRows, row, std::min(yblocks, row + rowsPerThread));
+    }
+    for (auto& thread : threads) {
+        thread.join();
     }
+
     return {
         .format = config.format,
         .size = size,
@@ -412,6 +517,12 @@ S3tcConfig s3tcParseOptionString(const std::string& options) {
     if (options == "rgba_dxt5") {
         return {CompressedFormat::RGBA_S3TC_DXT5, false};
     }
+    if (options == "r_bc4") {
+        return {CompressedFormat::RED_RGTC1, false};
+    }
+    if (options == "rg_bc5") {
+        return {CompressedFormat::RED_GREEN_RGTC2, false};
+    }
     return {};
 }
 
@@ -96,6 +96,7 @@ static bool printMaterial(ostream& json, const ChunkContainer& container) {
     printFloatChunk(json, container, MaterialSpecularAntiAliasingVariance, "variance");
     printFloatChunk(json, container, MaterialSpecularAntiAliasingThreshold, "threshold");
     printChunk<bool, bool>(json, container, MaterialClearCoatIorChange, "clear_coat_IOR_change");
+    printChunk<bool, bool>(json, container, MaterialInstanced, "instanced");
     json << "\"_\": 0 },\n";
     json << "\"raster\": {\n";
     printChunk<BlendingMode, uint8_t>(json, container, MaterialBlendingMode, "blending");
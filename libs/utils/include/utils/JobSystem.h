@@ -88,6 +88,10 @@ public:
     // adopt more thread.
     void emancipate();
 
+    // Returns whether the current thread is part of this JobSystem's thread pool, either as one
+    // of its worker threads or because it was adopted. Only these threads can wait for jobs.
+    bool isThreadAdopted() noexcept;
+
 
     // If a parent is not specified when creating a job, that job will automatically take the
     // root job as a parent.
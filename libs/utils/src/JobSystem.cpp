@@ -514,6 +514,12 @@ void JobSystem::emancipate() {
     mThreadMap.erase(iter);
 }
 
+bool JobSystem::isThreadAdopted() noexcept {
+    std::lock_guard<utils::SpinLock> lock(mThreadMapLock);
+    auto iter = mThreadMap.find(std::this_thread::get_id());
+    return iter != mThreadMap.end() && iter->second->js == this;
+}
+
 io::ostream& operator<<(io::ostream& out, JobSystem const& js) {
     for (auto const& item : js.mThreadStates) {
         out << size_t(item.id) << ": " << item.workQueue.getCount() << io::endl;
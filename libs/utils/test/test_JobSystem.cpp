@@ -344,3 +344,26 @@ TEST(JobSystem, JobSystemDelegates) {
 
     js.emancipate();
 }
+
+TEST(JobSystem, JobSystemIsThreadAdopted) {
+    JobSystem js;
+    EXPECT_FALSE(js.isThreadAdopted());
+
+    js.adopt();
+    EXPECT_TRUE(js.isThreadAdopted());
+
+    // worker threads are part of the pool too
+    std::atomic_bool worker = { false };
+    JobSystem::Job* job = js.createJob(nullptr, [&worker](JobSystem& js, JobSystem::Job*) {
+        worker = js.isThreadAdopted();
+    });
+    js.runAndWait(job);
+    EXPECT_TRUE(worker.load());
+
+    // another JobSystem doesn't own this thread
+    JobSystem other;
+    EXPECT_FALSE(other.isThreadAdopted());
+
+    js.emancipate();
+    EXPECT_FALSE(js.isThreadAdopted());
+}
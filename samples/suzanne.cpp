@@ -86,11 +86,13 @@ int main(int argc, char** argv) {
         auto& rcm = engine->getRenderableManager();
         auto& em = utils::EntityManager::get();
 
-        // Create textures. The KTX bundles are freed by KtxUtility.
-        auto albedo = new image::KtxBundle(MONKEY_ALBEDO_S3TC_DATA, MONKEY_ALBEDO_S3TC_SIZE);
-        auto ao = new image::KtxBundle(MONKEY_AO_DATA, MONKEY_AO_SIZE);
-        auto metallic = new image::KtxBundle(MONKEY_METALLIC_DATA, MONKEY_METALLIC_SIZE);
-        auto roughness = new image::KtxBundle(MONKEY_ROUGHNESS_DATA, MONKEY_ROUGHNESS_SIZE);
+        // Create textures. The KTX bundles are freed by KtxUtility, they are views of the embedded
+        // resources so their blobs are uploaded without being copied.
+        constexpr auto VIEW = image::KtxBundle::Storage::VIEW;
+        auto albedo = new image::KtxBundle(MONKEY_ALBEDO_S3TC_DATA, MONKEY_ALBEDO_S3TC_SIZE, VIEW);
+        auto ao = new image::KtxBundle(MONKEY_AO_DATA, MONKEY_AO_SIZE, VIEW);
+        auto metallic = new image::KtxBundle(MONKEY_METALLIC_DATA, MONKEY_METALLIC_SIZE, VIEW);
+        auto roughness = new image::KtxBundle(MONKEY_ROUGHNESS_DATA, MONKEY_ROUGHNESS_SIZE, VIEW);
         app.albedo = ktx::createTexture(engine, albedo, true);
         app.ao = ktx::createTexture(engine, ao, false);
         app.metallic = ktx::createTexture(engine, metallic, false);
@@ -12,14 +12,43 @@ mat4 getSpotLightFromWorldMatrix(uint index) {
 }
 #endif
 
+#if defined(HAS_INSTANCING)
+// each instance is stored as 7 vec4: the worldFromModel matrix, then the normal matrix, with
+// the instance index in the w component of its first column (see PerRenderableUibInstance)
+uint getInstanceOffset() {
+#if defined(TARGET_LANGUAGE_SPIRV)
+    return uint(gl_InstanceIndex) * 7u;
+#else
+    return uint(gl_InstanceID) * 7u;
+#endif
+}
+
+/** @public-api */
+uint getInstanceIndex() {
+    return uint(instancesUniforms.instances[getInstanceOffset() + 4u].w);
+}
+#endif
+
 /** @public-api */
 mat4 getWorldFromModelMatrix() {
+#if defined(HAS_INSTANCING)
+    uint i = getInstanceOffset();
+    return mat4(instancesUniforms.instances[i + 0u], instancesUniforms.instances[i + 1u],
+            instancesUniforms.instances[i + 2u], instancesUniforms.instances[i + 3u]);
+#else
     return objectUniforms.worldFromModelMatrix;
+#endif
 }
 
 /** @public-api */
 mat3 getWorldFromModelNormalMatrix() {
+#if defined(HAS_INSTANCING)
+    uint i = getInstanceOffset();
+    return mat3(instancesUniforms.instances[i + 4u].xyz, instancesUniforms.instances[i + 5u].xyz,
+            instancesUniforms.instances[i + 6u].xyz);
+#else
     return objectUniforms.worldFromModelNormalMatrix;
+#endif
 }
 
 //------------------------------------------------------------------------------
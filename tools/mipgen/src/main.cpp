@@ -27,6 +27,7 @@
 #include <imageio/ImageDecoder.h>
 #include <imageio/ImageEncoder.h>
 
+#include <utils/JobSystem.h>
 #include <utils/Path.h>
 
 #include <getopt/getopt.h>
@@ -51,6 +52,7 @@ static bool g_ktxContainer = false;
 static bool g_linearized = false;
 static bool g_quietMode = false;
 static uint32_t g_mipLevelCount = 0;
+static uint32_t g_jobCount = 0;
 
 static const char* USAGE = R"TXT(
 MIPGEN generates mipmaps for an image down to the 1x1 level.
@@ -90,6 +92,9 @@ Options:
    --mip-levels=N, -m N
        specifies the number of mip levels to generate
        if 0 (default), all levels are generated
+   --jobs=N, -j N
+       number of threads used to generate the miplevels
+       if 0 (default), a thread per core is used
    --compression=COMPRESSION, -c COMPRESSION
        format specific compression:
 )TXT"
@@ -97,7 +102,7 @@ Options:
 R"TXT(
            KTX:
              astc_[fast|thorough]_[ldr|hdr]_WxH, where WxH is a valid block size
-             s3tc_rgb_dxt1, s3tc_rgba_dxt5
+             s3tc_rgb_dxt1, s3tc_rgba_dxt5, s3tc_r_bc4, s3tc_rg_bc5
              etc_FORMAT_METRIC_EFFORT
                FORMAT is r11, signed_r11, rg11, signed_rg11, rgb8, srgb8, rgb8_alpha
                          srgb8_alpha, rgba8, or srgb8_alpha8
@@ -159,7 +164,7 @@ static void license() {
 }
 
 static int handleArguments(int argc, char* argv[]) {
-    static constexpr const char* OPTSTR = "hLlgpf:c:k:saqm:";
+    static constexpr const char* OPTSTR = "hLlgpf:c:k:saqm:j:";
     static const struct option OPTIONS[] = {
             { "help",                 no_argument, 0, 'h' },
             { "license",              no_argument, 0, 'L' },
@@ -173,6 +178,7 @@ static int handleArguments(int argc, char* argv[]) {
             { "add-alpha",            no_argument, 0, 'a' },
             { "quiet",                no_argument, 0, 'q' },
             { "mip-levels",     required_argument, 0, 'm' },
+            { "jobs",           required_argument, 0, 'j' },
             { 0, 0, 0, 0 }  // termination of the option list
     };
 
@@ -254,6 +260,13 @@ static int handleArguments(int argc, char* argv[]) {
                     // keep default value
                 }
                 break;
+            case 'j':
+                try {
+                    g_jobCount = std::stoi(arg);
+                } catch (std::invalid_argument &e) {
+                    // keep default value
+                }
+                break;
         }
     }
 
@@ -316,7 +329,15 @@ int main(int argc, char* argv[]) {
     uint32_t count = getMipmapCount(sourceImage);
     count = g_mipLevelCount == 0 ? count : min(g_mipLevelCount - 1, count);
     vector<LinearImage> miplevels(count);
-    generateMipmaps(sourceImage, g_filter, miplevels.data(), count);
+    if (g_jobCount == 1) {
+        generateMipmaps(sourceImage, g_filter, miplevels.data(), count);
+    } else {
+        // the main thread is adopted and counts as one of the jobs
+        JobSystem js(g_jobCount ? g_jobCount - 1 : 0);
+        js.adopt();
+        generateMipmaps(sourceImage, g_filter, miplevels.data(), count, js);
+        js.emancipate();
+    }
 
     if (g_ktxContainer) {
         if (!g_quietMode) {
@@ -359,6 +380,13 @@ int main(int argc, char* argv[]) {
             // glFormat should be 0, and glBaseInternalFormat should be RED, RG, RGB, or RGBA.
             // The glInternalFormat field is the only field that specifies the actual format.
             info.glFormat = 0;
+            if (config.type == CompressionConfig::S3TC) {
+                if (config.s3tc.format == CompressedFormat::RED_RGTC1) {
+                    info.glBaseInternalFormat = KtxBundle::RED;
+                } else if (config.s3tc.format == CompressedFormat::RED_GREEN_RGTC2) {
+                    info.glBaseInternalFormat = KtxBundle::RG;
+                }
+            }
         }
 #else
         if (!g_compression.empty()) {